@@ -9,11 +9,18 @@ SET SHELL_PATH=..\code\my_shell.html
 
 SET WARNING_FLAGS=-Wno-null-dereference -Wno-missing-braces -Wno-unused-variable -Wno-writable-strings 
 
+REM To run the AI on its own threads (needs a server that sends the COOP/COEP headers, for SharedArrayBuffer):
+REM SET THREAD_FLAGS=-pthread -s PTHREAD_POOL_SIZE=4
+SET THREAD_FLAGS=
+
+REM WASM SIMD, for the particle update (bi_particles.h). Without it that update uses plain floats.
+SET SIMD_FLAGS=-msimd128
+
 pushd %BUILD_DIR%
 
 @echo on
 
-call emcc -o game.html %SOURCE_MAIN% -Os -Wall %RAYLIB_LIB% -I. -I%INCLUDE_DIR% -L. -s USE_GLFW=3 -DPLATFORM_WEB --preload-file %RESOURCES_DIR% -s EXPORTED_RUNTIME_METHODS=ccall --shell-file %SHELL_PATH% %WARNING_FLAGS%
+call emcc -o game.html %SOURCE_MAIN% -Os -Wall %RAYLIB_LIB% -I. -I%INCLUDE_DIR% -L. -s USE_GLFW=3 -DPLATFORM_WEB --preload-file %RESOURCES_DIR% -s EXPORTED_RUNTIME_METHODS=ccall --shell-file %SHELL_PATH% %WARNING_FLAGS% %THREAD_FLAGS% %SIMD_FLAGS%
 
 @echo off
 
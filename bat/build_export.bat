@@ -0,0 +1,26 @@
+@echo off
+
+REM Native build of the replay to video exporter (code\bi_export.cpp). It needs a compiler with pthreads, like MinGW-w64,
+REM and Raylib's sources in lib\src: stb_image, and rtext.c, which code\bi_fontgen.cpp copies the default font from into
+REM build\bi_default_font.h first. Run it from the repo root, e.g.
+REM build\bi_export.exe break-in.bireplay -o match.y4m
+
+SET SOURCE_EXPORT=..\code\bi_export.cpp
+SET SOURCE_FONTGEN=..\code\bi_fontgen.cpp
+SET BUILD_DIR=..\build
+SET INCLUDE_DIR=..\lib\src
+
+pushd %BUILD_DIR%
+
+@echo on
+
+call g++ -o bi_fontgen.exe %SOURCE_FONTGEN% -O2
+@if errorlevel 1 goto end
+call bi_fontgen.exe %INCLUDE_DIR%\rtext.c bi_default_font.h
+@if errorlevel 1 goto end
+call g++ -o bi_export.exe %SOURCE_EXPORT% -O2 -pthread -I%INCLUDE_DIR% -I.
+
+:end
+@echo off
+
+popd
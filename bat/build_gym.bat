@@ -0,0 +1,16 @@
+@echo off
+
+REM Native build of the training library (code\bi_gym.h, code\bi_gym.cpp). It needs a compiler with pthreads, like MinGW-w64.
+
+SET SOURCE_GYM=..\code\bi_gym.cpp
+SET BUILD_DIR=..\build
+
+pushd %BUILD_DIR%
+
+@echo on
+
+call g++ -o bi_gym.dll %SOURCE_GYM% -O2 -shared -fvisibility=hidden -pthread
+
+@echo off
+
+popd
@@ -0,0 +1,22 @@
+@echo off
+
+REM Native build of the game, with the match on its own thread (see SIM_THREAD in code\bi_main.cpp). It needs a
+REM compiler with pthreads, like MinGW-w64, and Raylib built for the desktop (PLATFORM_DESKTOP) in lib\libraylib_desktop.a.
+REM Run it from the repo root, so it finds the resources: build\break-in.exe
+
+SET SOURCE_MAIN=..\code\bi_main.cpp
+SET BUILD_DIR=..\build
+SET RAYLIB_LIB=..\lib\libraylib_desktop.a
+SET INCLUDE_DIR=..\lib\src
+
+SET WARNING_FLAGS=-Wno-missing-braces -Wno-unused-variable -Wno-write-strings
+
+pushd %BUILD_DIR%
+
+@echo on
+
+call g++ -o break-in.exe %SOURCE_MAIN% -O2 -pthread -I%INCLUDE_DIR% %RAYLIB_LIB% -lopengl32 -lgdi32 -lwinmm %WARNING_FLAGS%
+
+@echo off
+
+popd
@@ -0,0 +1,17 @@
+@echo off
+
+REM Native build of the headless AI tuner (code\bi_tuner.cpp). It needs a compiler with pthreads, like MinGW-w64.
+REM Run it from the repo root, e.g. build\bi_tuner.exe Hard
+
+SET SOURCE_TUNER=..\code\bi_tuner.cpp
+SET BUILD_DIR=..\build
+
+pushd %BUILD_DIR%
+
+@echo on
+
+call g++ -o bi_tuner.exe %SOURCE_TUNER% -O2 -pthread
+
+@echo off
+
+popd
@@ -0,0 +1,1228 @@
+//
+// Contains the bots that play the game. They only look at the game_state and fill a game_input,
+// so they work the same in the game and headless. Include it after bi_game.h and bi_threads.h.
+//
+
+#ifndef BI_AI_H
+#define BI_AI_H
+
+//
+// AI that places shapes automatically
+//
+
+//
+// Escape paths
+//
+// Which empty tiles a ball could use to get from below the bricks to the top of the screen. The board
+// is kept as one u32 per row (bit x is column x), so the flood fill moves whole rows at a time: each
+// row takes what's reachable in the rows next to it and spreads it sideways through its empty tiles,
+// and that's repeated until nothing changes.
+//
+
+struct escape_paths{
+    b32 open; // A ball can get from below the bricks to above 'topRow' going through empty tiles.
+    s32 topRow; // Rows above it count as empty.
+    s32 numRows;
+    u32 empty[MAX_GRID_DIM_Y];
+    u32 path[MAX_GRID_DIM_Y]; // Empty tiles that are on some way through.
+    u32 cut[MAX_GRID_DIM_Y]; // Tiles that close every way through by themselves when filled.
+};
+
+// Grows 'gen' through the set bits of 'pro' along the row, in both directions (Kogge-Stone fill).
+inline u32 SpreadAlongRow(u32 gen, u32 pro){
+    u32 up = gen;
+    u32 upPro = pro;
+    u32 down = gen;
+    u32 downPro = pro;
+    for(s32 shift = 1; shift < 32; shift *= 2){
+        up |= upPro & (up << shift);
+        upPro &= (upPro << shift);
+        down |= downPro & (down >> shift);
+        downPro &= (downPro >> shift);
+    }
+    return up | down;
+}
+
+// Grows 'reach' (which must be inside 'empty') through 'empty' until it stops changing.
+void FloodFillRows(u32 *empty, u32 *reach, s32 numRows){
+    b32 changed = true;
+    while(changed){
+        changed = false;
+        for(s32 pass = 0; pass < 2; pass++){ // Downwards, then upwards
+            for(s32 i = 0; i < numRows; i++){
+                s32 y = (pass == 0 ? i : numRows - 1 - i);
+                u32 r = reach[y];
+                if (y > 0)
+                    r |= reach[y - 1] & empty[y];
+                if (y < numRows - 1)
+                    r |= reach[y + 1] & empty[y];
+                r = SpreadAlongRow(r, empty[y]);
+                if (r != reach[y]){
+                    reach[y] = r;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// Returns true if a ball could get from below the bricks to the first row.
+b32 CanEscapeThroughRows(u32 *empty, s32 numRows){
+    u32 reach[MAX_GRID_DIM_Y] = {};
+    reach[numRows - 1] = empty[numRows - 1]; // Below the bricks is all empty.
+    FloodFillRows(empty, reach, numRows);
+    return (reach[0] != 0);
+}
+
+void AnalyzeEscapePaths(game_state *game, escape_paths *paths, s32 topRow = 0){
+    ZeroStruct(paths);
+    paths->topRow = topRow;
+    paths->numRows = game->gridDim.y;
+    u32 fullRow = (1u << game->gridDim.x) - 1;
+    b32 anyFullRow = false;
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        paths->empty[y] = ~game->stats.rowBits[y] & fullRow;
+        if (y >= topRow && !paths->empty[y])
+            anyFullRow = true;
+    }
+    if (anyFullRow)
+        return; // Nothing gets through a full row.
+    u32 *empty = paths->empty + topRow;
+    s32 numRows = game->gridDim.y - topRow;
+
+    // Reachable from below and from above: the tiles on the way through are in both.
+    u32 fromBelow[MAX_GRID_DIM_Y] = {};
+    u32 fromAbove[MAX_GRID_DIM_Y] = {};
+    fromBelow[numRows - 1] = empty[numRows - 1];
+    fromAbove[0] = empty[0];
+    FloodFillRows(empty, fromBelow, numRows);
+    paths->open = (fromBelow[0] != 0);
+    if (!paths->open)
+        return;
+    FloodFillRows(empty, fromAbove, numRows);
+    for(s32 y = 0; y < numRows; y++){
+        paths->path[topRow + y] = fromBelow[y] & fromAbove[y];
+    }
+
+    // A cut is on every way through, so it's enough to try the tiles of one of them: a shortest one,
+    // found with a breadth-first flood from below that remembers the step each tile was reached at.
+    s16 steps[MAX_GRID_DIM_X*MAX_GRID_DIM_Y];
+    memset(steps, -1, sizeof(steps));
+    u32 visited[MAX_GRID_DIM_Y] = {};
+    u32 frontier[MAX_GRID_DIM_Y] = {};
+    frontier[numRows - 1] = empty[numRows - 1] & fromAbove[numRows - 1];
+    visited[numRows - 1] = frontier[numRows - 1];
+    s16 step = 0;
+    for(; !(frontier[0] & visited[0]); step++){
+        u32 next[MAX_GRID_DIM_Y];
+        for(s32 y = 0; y < numRows; y++){
+            for(u32 bits = frontier[y]; bits; bits &= bits - 1)
+                steps[y*game->gridDim.x + __builtin_ctz(bits)] = step;
+            u32 n = (frontier[y] << 1) | (frontier[y] >> 1);
+            if (y > 0)
+                n |= frontier[y - 1];
+            if (y < numRows - 1)
+                n |= frontier[y + 1];
+            next[y] = n & paths->path[topRow + y] & ~visited[y];
+        }
+        for(s32 y = 0; y < numRows; y++){
+            frontier[y] = next[y];
+            visited[y] |= next[y];
+        }
+    }
+    u32 shortest[MAX_GRID_DIM_Y] = {};
+    v2s tile = V2S(__builtin_ctz(frontier[0]), 0); // Reached at 'step'.
+    for(; step >= 0; step--){
+        shortest[tile.y] |= 1u << tile.x;
+        v2s offsets[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for(s32 i = 0; i < ArrayCount(offsets); i++){
+            v2s neighbor = tile + offsets[i];
+            if (neighbor.x >= 0 && neighbor.y >= 0 && neighbor.x < game->gridDim.x && neighbor.y < numRows &&
+                steps[neighbor.y*game->gridDim.x + neighbor.x] == step - 1){
+                tile = neighbor;
+                break;
+            }
+        }
+    }
+
+    for(s32 y = 0; y < numRows; y++){
+        u32 row = paths->path[topRow + y];
+        if ((row & (row - 1)) == 0){
+            // Every way through crosses every row, so a row with a single path tile is a cut.
+            paths->cut[topRow + y] = row;
+            continue;
+        }
+        for(u32 bits = shortest[y]; bits; bits &= bits - 1){
+            u32 bit = bits & (~bits + 1);
+            u32 blocked[MAX_GRID_DIM_Y];
+            memcpy(blocked, empty, numRows*sizeof(u32));
+            blocked[y] &= ~bit;
+            if (!CanEscapeThroughRows(blocked, numRows))
+                paths->cut[topRow + y] |= bit;
+        }
+    }
+}
+
+// Like the original column check: first look for ways to the top, then for ways that only the first row blocks.
+b32 FindEscapePaths(game_state *game, escape_paths *paths){
+    for(s32 topRow = 0; topRow < 2; topRow++){
+        AnalyzeEscapePaths(game, paths, topRow);
+        if (paths->open)
+            return true;
+    }
+    return false;
+}
+
+// The tiles of 'slot' (already rotated) at 'shapePos', as grid rows.
+void ShapeRowMasks(brick_shape_slot *slot, v2s shapePos, u32 *masks){
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        u32 mask = 0;
+        for(s32 x = 0; x < slot->shapeDim.x; x++){
+            if (slot->shape.rows[0][y] & (1 << (7 - x)))
+                mask |= 1u << (shapePos.x + x);
+        }
+        masks[y] = mask;
+    }
+}
+
+// Extra heuristic for placements when the top is exposed: the most for closing all the ways through,
+// some for blocking part of them, and a bit more the closer to the top.
+f32 EscapeHeuristic(escape_paths *paths, brick_shape_slot *slot, v2s shapePos){
+    u32 masks[8];
+    ShapeRowMasks(slot, shapePos, masks);
+    b32 coversPath = false;
+    b32 coversCut = false;
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        coversPath = coversPath || (masks[y] & paths->path[shapePos.y + y]);
+        coversCut = coversCut || (masks[y] & paths->cut[shapePos.y + y]);
+    }
+    f32 result = 0;
+    if (coversPath){
+        b32 closes = coversCut;
+        if (!closes){
+            u32 blocked[MAX_GRID_DIM_Y];
+            memcpy(blocked, paths->empty, sizeof(blocked));
+            for(s32 y = 0; y < slot->shapeDim.y; y++){
+                blocked[shapePos.y + y] &= ~masks[y];
+            }
+            closes = !CanEscapeThroughRows(blocked + paths->topRow, paths->numRows - paths->topRow);
+        }
+        result = (closes ? .7f : .3f) + .3f*Square(1.f - Clamp01(shapePos.y/4.f));
+    }
+    return result;
+}
+
+// Picks a tile to cover: one of the cuts if there are any, otherwise any tile on the way through.
+v2s RandomEscapeTile(escape_paths *paths){
+    s32 numRows = paths->numRows;
+    u32 *rows = paths->cut;
+    s32 count = 0;
+    for(s32 y = 0; y < numRows; y++)
+        count += __builtin_popcount(rows[y]);
+    if (!count){
+        rows = paths->path;
+        for(s32 y = 0; y < numRows; y++)
+            count += __builtin_popcount(rows[y]);
+    }
+    s32 pick = RandomS32(count - 1);
+    for(s32 y = 0; y < numRows; y++){
+        for(u32 bits = rows[y]; bits; bits &= bits - 1){
+            if (pick-- == 0)
+                return V2S(__builtin_ctz(bits), y);
+        }
+    }
+    return V2S(0);
+}
+
+//
+// Weights
+//
+// The numbers the bricks AI plays by. The defaults are the hand-set ones; bi_tuner.cpp searches for
+// better ones with headless matches and saves them as named profiles, which the game loads at startup.
+//
+
+#define BRICKS_AI_PROFILES_PATH "resources/ai_profiles.txt"
+#define MAX_BRICKS_AI_PROFILES 8
+#define MAX_BRICKS_AI_TRIES 100
+
+struct bricks_ai_weights{
+    f32 adjacent; // Touching other bricks
+    f32 yPos; // Being low
+    f32 time; // Hurrying as the next shape gets closer
+    f32 emergency; // Covering the ways to the top
+    f32 spawnerStrength; // How much each special brick's own heuristic counts
+    f32 powerupStrength;
+    f32 badPowerupStrength;
+    f32 arrowStrength;
+    s32 numTries; // Random placements tried per frame
+};
+
+struct bricks_ai_profile{
+    char name[32];
+    bricks_ai_weights weights;
+};
+
+bricks_ai_weights DefaultBricksAIWeights(){
+    bricks_ai_weights result;
+    result.adjacent = .4f;
+    result.yPos = .3f;
+    result.time = .1f;
+    result.emergency = .8f;
+    result.spawnerStrength = .5f;
+    result.powerupStrength = .3f;
+    result.badPowerupStrength = .3f;
+    result.arrowStrength = .4f;
+    result.numTries = 25;
+    return result;
+}
+
+// Fills 'profiles' from the text of a profiles file: one profile per line, "name adjacent yPos time emergency
+// spawner powerup badPowerup arrow tries". Lines starting with '#' and lines that don't parse are skipped.
+// Returns the number of profiles.
+s32 ParseBricksAIProfiles(char *text, bricks_ai_profile *profiles, s32 maxProfiles){
+    s32 numProfiles = 0;
+    char *line = text;
+    while(*line && numProfiles < maxProfiles){
+        char *lineEnd = line;
+        while(*lineEnd && *lineEnd != '\n')
+            lineEnd++;
+        char lineText[256];
+        s32 lineLength = Min((s32)(lineEnd - line), (s32)ArrayCount(lineText) - 1);
+        memcpy(lineText, line, lineLength);
+        lineText[lineLength] = 0;
+        if (lineText[0] != '#'){
+            bricks_ai_profile *p = &profiles[numProfiles];
+            bricks_ai_weights *w = &p->weights;
+            char format[64];
+            sprintf(format, "%%%ds %%f %%f %%f %%f %%f %%f %%f %%f %%d", (s32)sizeof(p->name) - 1);
+            s32 numRead = sscanf(lineText, format, p->name, &w->adjacent, &w->yPos, &w->time, &w->emergency,
+                                 &w->spawnerStrength, &w->powerupStrength, &w->badPowerupStrength, &w->arrowStrength, &w->numTries);
+            if (numRead == 10){
+                w->numTries = ClampS32(w->numTries, 1, MAX_BRICKS_AI_TRIES);
+                numProfiles++;
+            }
+        }
+        line = (*lineEnd ? lineEnd + 1 : lineEnd);
+    }
+    return numProfiles;
+}
+
+// Writes 'profile' as a line of a profiles file (with the '\n').
+void PrintBricksAIProfile(char *dest, s32 destSize, bricks_ai_profile *profile){
+    bricks_ai_weights *w = &profile->weights;
+    snprintf(dest, destSize, "%s %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %d\n", profile->name, w->adjacent, w->yPos, w->time,
+             w->emergency, w->spawnerStrength, w->powerupStrength, w->badPowerupStrength, w->arrowStrength, w->numTries);
+}
+
+// How much the special brick heuristic counts, for shapes with a special brick.
+f32 SpecialHeuristicStrength(bricks_ai_weights *weights, special_brick_type special){
+    f32 result = 0;
+    if (special == SpecialBrick_Spawner){
+        result = weights->spawnerStrength;
+    }else if (special == SpecialBrick_Powerup){
+        result = weights->powerupStrength;
+    }else if (special == SpecialBrick_BadPowerup){
+        result = weights->badPowerupStrength;
+    }else if (special == SpecialBrick_Arrow){
+        result = weights->arrowStrength;
+    }
+    return result;
+}
+
+// The part of the placement heuristic that grows as the next shape gets closer, so we hurry to place.
+// It's the same for every placement of a shape, so it's separate from BrickPlacementHeuristic().
+f32 BrickTimeHeuristic(game_state *game, bricks_ai_weights *weights, special_brick_type special){
+    f32 heuristicTime = Square(game->spawnShapeTimer/game->config.spawnShapeTime);
+    f32 result = heuristicTime*weights->time*(1.f - SpecialHeuristicStrength(weights, special));
+    return result;
+}
+
+// How good it is to place 'slot' (already rotated) at 'shapePos', in [0, 1] more or less, without BrickTimeHeuristic().
+// Returns -1 if it doesn't fit.
+f32 BrickPlacementHeuristic(game_state *game, bricks_ai_weights *weights, brick_shape_slot *slot, v2s shapePos, f32 emergencyHeuristic){
+    v2s shapePosMin = V2S(0);
+    v2s shapePosMax = game->gridDim - slot->shapeDim;
+    // Check collision
+    u32 masks[8];
+    ShapeRowMasks(slot, shapePos, masks);
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        if (masks[y] & game->stats.rowBits[shapePos.y + y])
+            return -1.f;
+    }
+
+    // Find fraction of empty adjancent tiles
+    s32 numFreeAdjacentTiles = 0;
+    s32 numFullAdjacentTiles = 0;
+    f32 heuristicSpecialPlacement = 0;
+    special_brick_type special = slot->shape.specialType;
+    f32 specialHeuristicStrength = SpecialHeuristicStrength(weights, special);
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        for(s32 x = 0; x < slot->shapeDim.x; x++){
+            if (slot->shape.rows[0][y] & (1 << (7 - x))){ // Tile in shape
+                // The adjacent tiles in the same shape are ignored. They're empty now, so they're counted in freeNeighbors.
+                v2s tilePos = shapePos + V2S(x, y);
+                u32 bit = 1u << tilePos.x;
+                s32 numInShape = ((masks[y] << 1) & bit ? 1 : 0) + ((masks[y] >> 1) & bit ? 1 : 0) +
+                                 (y > 0 && (masks[y - 1] & bit) ? 1 : 0) + (y + 1 < slot->shapeDim.y && (masks[y + 1] & bit) ? 1 : 0);
+                s32 numFreeAdjacent = game->stats.freeNeighbors[tilePos.y*game->gridDim.x + tilePos.x] - numInShape;
+                s32 numFullAdjacent = 4 - numInShape - numFreeAdjacent;
+                numFreeAdjacentTiles += numFreeAdjacent;
+                numFullAdjacentTiles += numFullAdjacent;
+
+                // Special brick heuristic.
+                if (special && slot->shape.rows[1][y] & (1 << (7 - x))){
+                    // (Below the grid is free and its column bit is 0.)
+                    u32 columnBits = game->stats.columnBits[tilePos.x];
+                    b32 tileBelowIsFree = !((columnBits >> (tilePos.y + 1)) & 1);
+                    if (tileBelowIsFree && y + 1 < slot->shapeDim.y) // Check if tile below is occupied by a tile in the same shape
+                        tileBelowIsFree = !(masks[y + 1] & bit);
+                    b32 tileAboveIsFree = false;
+                    if (tilePos.y > 0){
+                        tileAboveIsFree = !((columnBits >> (tilePos.y - 1)) & 1);
+                        if (tileAboveIsFree && y - 1 >= 0) // Check if tile above is occupied by a tile in the same shape
+                            tileAboveIsFree = !(masks[y - 1] & bit);
+                    }
+
+                    // Set custom heuristics for each special
+                    if (special == SpecialBrick_Spawner){
+                        heuristicSpecialPlacement = .6f*Square(SafeDivide1((f32)numFullAdjacent, (f32)(numFreeAdjacent + numFullAdjacent))) + .4f*(tileBelowIsFree ? 0 : 1.f);
+                    }else if (special == SpecialBrick_Powerup){
+                        heuristicSpecialPlacement = .7f*Square(SafeDivide1((f32)numFullAdjacent, (f32)(numFreeAdjacent + numFullAdjacent))) + .3f*(tileBelowIsFree ? 0 : 1.f);
+                    }else if (special == SpecialBrick_BadPowerup){
+                        f32 howCenteredItIs = 1.f - ((f32)(shapePos.x + x) - (f32)game->gridDim.x/2.f)/(f32)(game->gridDim.x/2.f);
+                        b32 howCoveredItIs = SafeDivide1((f32)numFreeAdjacent, (f32)(numFreeAdjacent + numFullAdjacent));
+                        heuristicSpecialPlacement = .5f*howCoveredItIs + .3f*howCenteredItIs + .2f*(tileBelowIsFree ? 1.f : 0);
+                    }else if (special == SpecialBrick_Arrow){
+                        heuristicSpecialPlacement = (tileAboveIsFree ? 0 : .66f) + (tileBelowIsFree ? .33f : 0);
+                    }
+                }
+            }
+        }
+    }
+    f32 fractionAdjacent = SafeDivide1((f32)numFullAdjacentTiles, (f32)(numFreeAdjacentTiles + numFullAdjacentTiles));
+    f32 heuristicAdjacent = Square(fractionAdjacent);
+
+    f32 heuristicYPos = Square(MapRangeTo01((f32)shapePos.y, (f32)shapePosMax.y, (f32)shapePosMin.y));
+
+    // Bring all different heuristics together with different weights
+    f32 heuristic = heuristicAdjacent*weights->adjacent + heuristicYPos*weights->yPos + emergencyHeuristic*weights->emergency;
+    heuristic = Lerp(heuristic, heuristicSpecialPlacement, specialHeuristicStrength);
+    return heuristic;
+}
+
+//
+// Placement cache
+//
+// The board often stays the same for many frames while the AI keeps trying placements, so the scores
+// are kept by (board hash, shape orientation, special type). A score is computed the first time a
+// position is tried, and after that it's a lookup. Entries are replaced when another key maps to them.
+//
+
+#define PLACEMENT_CACHE_SIZE 32
+#define PLACEMENT_NOT_SCORED -2.f
+
+struct placement_cache_entry{
+    u64 key; // 0 if unused
+    f32 scores[MAX_GRID_DIM_X*MAX_GRID_DIM_Y]; // Indexed by shape position. PLACEMENT_NOT_SCORED, or what BrickPlacementHeuristic() returned.
+};
+
+struct placement_cache{
+    placement_cache_entry entries[PLACEMENT_CACHE_SIZE];
+    bricks_ai_weights weights; // The scores were computed with these.
+
+    // Escape paths of the last board, since the scores depend on them.
+    u64 pathsBoardHash;
+    b32 pathsValid;
+    b32 emergency;
+    escape_paths paths;
+
+    u64 numLookups;
+    u64 numHits;
+};
+
+// 'weights' null uses the default ones.
+void InitPlacementCache(placement_cache *cache, bricks_ai_weights *weights = 0){
+    ZeroStruct(cache);
+    cache->weights = (weights ? *weights : DefaultBricksAIWeights());
+}
+
+// Escape paths of the current board (see FindEscapePaths()).
+escape_paths *GetEscapePaths(placement_cache *cache, game_state *game, b32 *emergency){
+    if (!cache->pathsValid || cache->pathsBoardHash != game->stats.boardHash){
+        cache->emergency = FindEscapePaths(game, &cache->paths);
+        cache->pathsBoardHash = game->stats.boardHash;
+        cache->pathsValid = true;
+    }
+    *emergency = cache->emergency;
+    return &cache->paths;
+}
+
+// The entry for placing 'slot' (already rotated) on the current board. Clears it if it was for something else.
+placement_cache_entry *GetPlacementCacheEntry(placement_cache *cache, game_state *game, brick_shape_slot *slot){
+    u64 key = game->stats.boardHash;
+    key = SimpleHash64(key ^ ((u64)slot->shapeDim.x << 8) ^ ((u64)slot->shapeDim.y << 16) ^ ((u64)slot->shape.specialType << 24));
+    u64 rows0 = 0;
+    u64 rows1 = 0;
+    memcpy(&rows0, slot->shape.rows[0], sizeof(rows0));
+    memcpy(&rows1, slot->shape.rows[1], sizeof(rows1));
+    key = SimpleHash64(key ^ rows0);
+    key = SimpleHash64(key ^ rows1);
+    key |= 1; // Never 0
+
+    placement_cache_entry *entry = &cache->entries[key % ArrayCount(cache->entries)];
+    if (entry->key != key){
+        entry->key = key;
+        for(s32 i = 0; i < ArrayCount(entry->scores); i++){
+            entry->scores[i] = PLACEMENT_NOT_SCORED;
+        }
+    }
+    return entry;
+}
+
+// BrickPlacementHeuristic() with the emergency part (but not the time part), through the cache.
+f32 CachedPlacementHeuristic(placement_cache *cache, placement_cache_entry *entry, game_state *game, brick_shape_slot *slot, v2s shapePos){
+    f32 *score = &entry->scores[shapePos.y*game->gridDim.x + shapePos.x];
+    cache->numLookups++;
+    if (*score == PLACEMENT_NOT_SCORED){
+        b32 emergency;
+        escape_paths *paths = GetEscapePaths(cache, game, &emergency);
+        f32 emergencyHeuristic = (emergency ? EscapeHeuristic(paths, slot, shapePos) : 0);
+        *score = BrickPlacementHeuristic(game, &cache->weights, slot, shapePos, emergencyHeuristic);
+    }else{
+        cache->numHits++;
+    }
+    return *score;
+}
+
+// Plays with the weights 'cache' was initialized with. Meant to be called every tick.
+void UpdateBricksAI(game_state *game, placement_cache *cache, game_input *input){
+    brick_shape_slot *slot = 0;
+    s32 slotIndex = 0;
+    s32 preferredSlotIndex = RandomS32(ArrayCount(game->availableSlots) - 1);
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        s32 index = (preferredSlotIndex + i) % ArrayCount(game->availableSlots);
+        if (game->availableSlots[index].occupied){
+            slot = &game->availableSlots[index];
+            slotIndex = index;
+            break;
+        }
+    }
+    if (slot){
+        // Figure out if there's a way for the ball to get to the top of the screen.
+        // In that case we'll try harder to cover it.
+        b32 emergency;
+        escape_paths *paths = GetEscapePaths(cache, game, &emergency);
+
+        // The rotations, done once for all the tries.
+        brick_shape_slot rotatedSlots[4];
+        rotatedSlots[0] = *slot;
+        for(s32 i = 1; i < ArrayCount(rotatedSlots); i++){
+            rotatedSlots[i] = rotatedSlots[i - 1];
+            RotateShape90Degrees(&rotatedSlots[i], 0);
+        }
+
+        s32 bestRotations = 0;
+        v2s bestShapePos = {0};
+        f32 bestHeuristic = 0;
+        for(s32 tries = 0; tries < cache->weights.numTries; tries++){
+            // Try to place the shape in a random position and random rotation.
+            // We do that multiple times and take the best position (higher heuristic).
+            s32 numRotations = RandomS32(3);
+            brick_shape_slot slotTry = rotatedSlots[numRotations];
+            v2s shapePosMin = V2S(0);
+            v2s shapePosMax = game->gridDim - slotTry.shapeDim;
+            v2s shapePos = {RandomRangeS32(shapePosMin.x, shapePosMax.x), RandomRangeS32(shapePosMin.y, shapePosMax.y)};
+            if (emergency){
+                v2s target = RandomEscapeTile(paths);
+                if (RandomChance(.6f)){ // Increase probability of spawning with a brick at the target column
+                    shapePos.x = ClampS32(target.x - RandomS32(slotTry.shapeDim.x - 1), shapePosMin.x, shapePosMax.x);
+                }
+                if (RandomChance(.4f)){ // Increase probability of spawning with a brick at the target row
+                    shapePos.y = ClampS32(target.y - RandomS32(slotTry.shapeDim.y - 1), shapePosMin.y, shapePosMax.y);
+                }
+            }
+            placement_cache_entry *entry = GetPlacementCacheEntry(cache, game, &slotTry);
+            f32 heuristic = CachedPlacementHeuristic(cache, entry, game, &slotTry, shapePos);
+            if (heuristic >= 0)
+                heuristic += BrickTimeHeuristic(game, &cache->weights, slotTry.shape.specialType);
+            if (heuristic > bestHeuristic){
+                bestHeuristic = heuristic;
+                bestShapePos = shapePos;
+                bestRotations = numRotations;
+            }
+        }
+        if (RandomChance(Square(bestHeuristic))){
+            // Place it down
+            input->rotateSlot[slotIndex] = -bestRotations;
+            input->placeShape = true;
+            input->placeSlotIndex = slotIndex;
+            input->placeTilePos = bestShapePos;
+        }
+    }
+}
+
+
+//
+// AI that plays the paddle
+//
+
+// Where and when a ball will get to the paddle, following its bounces.
+struct ball_prediction{
+    b32 valid; // False for balls on the paddle, balls going to the top and balls we couldn't follow.
+    f32 x; // Ball center when it gets to the top of the paddle.
+    f32 ticks; // Ticks (of GAME_TICK_DT) until then.
+    f32 score; // How good the path after bouncing off the paddle is (see ScorePaddleShot).
+};
+
+ball_prediction PredictBall(game_state *game, ball_state *ball, s32 maxBounces = 8){
+    ball_prediction result = {};
+    if (CheckFlag(ball->flags, BallFlags_OnPaddle) || ball->speed == V2(0))
+        return result;
+    f32 stopY = game->paddlePos.y - game->paddleDim.y/2 - ball->r;
+    ball_trace trace;
+    TraceBall(game, ball->pos, ball->speed, ball->r, stopY, maxBounces, &trace);
+    if (trace.end == TraceEnd_StopY){
+        result.valid = true;
+        result.x = trace.points[trace.numPoints - 1].x;
+        result.ticks = trace.length/(Length(ball->speed)*game->gameSpeed);
+    }
+    return result;
+}
+
+// Higher is better for the paddle: going through the top wins, and otherwise we want to get high and break bricks.
+f32 ScorePaddleShot(game_state *game, v2 pos, v2 dir, f32 r){
+    ball_trace trace;
+    TraceBall(game, pos, dir, r, pos.y + 1.f, 4, &trace);
+    f32 minY = pos.y;
+    for(s32 i = 0; i < trace.numPoints; i++){
+        minY = Min(minY, trace.points[i].y);
+    }
+    f32 result = .5f*trace.numBrickHits - minY/game->tileDim.y;
+    if (trace.end == TraceEnd_Top)
+        result += 100.f;
+    return result;
+}
+
+// Distance the paddle slides if we let go of the keys now. Mirrors the deceleration in UpdatePaddleMovement().
+f32 PaddleStoppingDistance(game_state *game){
+    f32 v = game->paddleXSpeed;
+    f32 result = 0;
+    for(s32 i = 0; i < 120 && Abs(v) > .05f; i++){
+        if (game->powerupCountdownSlipperyControls){
+            v = Lerp(MoveTowards(v, 0, .01f*game->gameSpeed), 0, .02f*game->gameSpeed);
+        }else{
+            v = Lerp(MoveTowards(v, 0, 1.f*game->gameSpeed), 0, .3f*game->gameSpeed);
+        }
+        result += v*game->gameSpeed;
+    }
+    return result;
+}
+
+// Rough number of ticks the paddle needs to travel 'distance' from standing still.
+f32 PaddleTicksToTravel(game_state *game, f32 distance){
+    f32 maxSpeed = (game->powerupCountdownSlipperyControls ? 10.f : 7.f)*game->gameSpeed;
+    f32 accelTicks = (game->powerupCountdownSlipperyControls ? 20.f : 8.f);
+    f32 result = Abs(distance)/maxSpeed + accelTicks;
+    return result;
+}
+
+struct paddle_bot{
+    s32 savingBallIndex; // -1 if none
+    v2 savingBallSpeed; // To notice when it bounced and we have to aim again.
+    f32 aimOffset; // Where on the paddle we want to catch it (relative to the center).
+    s32 ticksSinceAim;
+    s32 ticksHoldingBall; // With the magnet.
+    f32 launchX; // Where we want to launch the held ball from.
+    f32 targetX; // Where we're taking the paddle.
+};
+
+void InitPaddleBot(paddle_bot *bot){
+    ZeroStruct(bot);
+    bot->savingBallIndex = -1;
+}
+
+// Sets the movement keys of 'input' to take the paddle to bot->targetX, letting go early enough to stop there.
+void SteerPaddleBot(game_state *game, paddle_bot *bot, game_input *input){
+    f32 remaining = bot->targetX - (game->paddlePos.x + PaddleStoppingDistance(game));
+    b32 right = false;
+    b32 left = false;
+    if (remaining > 2.f){
+        right = true;
+    }else if (remaining < -2.f){
+        left = true;
+    }
+    if (game->powerupCountdownReverseControls)
+        SWAP(right, left);
+    input->right = right;
+    input->left = left;
+    input->rightPressed = input->leftPressed = false;
+}
+
+// Fills the paddle part of 'input' (movement and launch). Meant to be called every tick, or by StepBotMatch().
+void UpdatePaddleAI(game_state *game, paddle_bot *bot, game_input *input){
+    f32 halfWidth = game->paddleDim.x/2;
+    f32 paddleMinX = halfWidth;
+    f32 paddleMaxX = game->viewDim.x - halfWidth;
+    f32 paddleTop = game->paddlePos.y - game->paddleDim.y/2;
+    f32 catchMargin = Min(6.f, halfWidth*.5f); // Don't plan to catch balls right at the edge.
+
+    // Choose which ball to save: the first one that arrives that we can still get to.
+    ball_prediction predictions[ArrayCount(game->balls)];
+    s32 saveIndex = -1;
+    s32 firstIndex = -1;
+    b32 anyStuck = false;
+    b32 anyStuckRandom = false;
+    for(s32 i = 0; i < game->numBalls; i++){
+        ball_state *b = &game->balls[i];
+        if (CheckFlag(b->flags, BallFlags_OnPaddle)){
+            anyStuck = true;
+            if (CheckFlag(b->flags, BallFlags_StuckShootRandomly))
+                anyStuckRandom = true;
+        }
+        predictions[i] = PredictBall(game, b);
+        if (!predictions[i].valid)
+            continue;
+        if (firstIndex == -1 || predictions[i].ticks < predictions[firstIndex].ticks)
+            firstIndex = i;
+        f32 closestX = Clamp(game->paddlePos.x, predictions[i].x - halfWidth + catchMargin, predictions[i].x + halfWidth - catchMargin);
+        b32 reachable = (PaddleTicksToTravel(game, closestX - game->paddlePos.x) <= predictions[i].ticks);
+        if (reachable && (saveIndex == -1 || predictions[i].ticks < predictions[saveIndex].ticks))
+            saveIndex = i;
+    }
+    if (saveIndex == -1)
+        saveIndex = firstIndex; // Nothing is reachable, try anyway.
+
+    f32 targetX = game->paddlePos.x;
+    if (saveIndex != -1){
+        ball_state *b = &game->balls[saveIndex];
+        ball_prediction *pred = &predictions[saveIndex];
+
+        // Choose where on the paddle to catch it to aim the bounce.
+        // (Only when the ball changes direction, or once in a while, since the board changes.)
+        bot->ticksSinceAim++;
+        if (saveIndex != bot->savingBallIndex || b->speed != bot->savingBallSpeed || bot->ticksSinceAim > 20){
+            bot->savingBallIndex = saveIndex;
+            bot->savingBallSpeed = b->speed;
+            bot->ticksSinceAim = 0;
+            f32 bestScore = -MAX_F32;
+            bot->aimOffset = 0;
+            const s32 numCandidates = 7;
+            for(s32 c = 0; c < numCandidates; c++){
+                f32 offset = Lerp(-halfWidth + catchMargin, halfWidth - catchMargin, c/(f32)(numCandidates - 1));
+                f32 x = Clamp(pred->x - offset, paddleMinX, paddleMaxX);
+                if (PaddleTicksToTravel(game, x - game->paddlePos.x) > pred->ticks)
+                    continue;
+                f32 score = ScorePaddleShot(game, V2(pred->x, paddleTop - b->r), PaddleBounceDir(game, pred->x - x), b->r);
+                score -= .01f*Abs(offset); // Prefer the center when it doesn't matter.
+                if (score > bestScore){
+                    bestScore = score;
+                    bot->aimOffset = offset;
+                }
+            }
+        }
+        targetX = pred->x - bot->aimOffset;
+
+        // Grab a good drop on the way if there's time.
+        f32 ballTicks = pred->ticks;
+        for(s32 i = 0; i < game->numDrops; i++){
+            drop_state *drop = &game->drops[i];
+            if (drop->type > LAST_GOOD_DROP)
+                continue;
+            f32 dropTicks = (paddleTop - DROP_RADIUS - drop->pos.y)/(drop->ySpeed*game->gameSpeed);
+            if (dropTicks < 0)
+                continue;
+            if (PaddleTicksToTravel(game, drop->pos.x - game->paddlePos.x) < dropTicks &&
+                dropTicks + PaddleTicksToTravel(game, targetX - drop->pos.x) < ballTicks){
+                targetX = drop->pos.x;
+                break;
+            }
+        }
+    }else{
+        bot->savingBallIndex = -1;
+        // No ball coming: go for good drops, and get away from bad ones.
+        f32 bestDropTicks = MAX_F32;
+        for(s32 i = 0; i < game->numDrops; i++){
+            drop_state *drop = &game->drops[i];
+            f32 dropTicks = (paddleTop - DROP_RADIUS - drop->pos.y)/(drop->ySpeed*game->gameSpeed);
+            if (dropTicks < 0)
+                continue;
+            if (drop->type <= LAST_GOOD_DROP){
+                if (dropTicks < bestDropTicks && PaddleTicksToTravel(game, drop->pos.x - game->paddlePos.x) < dropTicks){
+                    bestDropTicks = dropTicks;
+                    targetX = drop->pos.x;
+                }
+            }else if (bestDropTicks == MAX_F32 && Abs(drop->pos.x - game->paddlePos.x) < halfWidth + DROP_RADIUS){
+                targetX = (drop->pos.x < game->viewDim.x/2 ? drop->pos.x + halfWidth + 2*DROP_RADIUS : drop->pos.x - halfWidth - 2*DROP_RADIUS);
+            }
+        }
+
+        if (anyStuck){
+            if (anyStuckRandom){
+                input->launch = true;
+            }else{
+                // Magnet: the launch direction is fixed by where the ball stuck, so choose where to launch from.
+                ball_state *b = 0;
+                for(s32 i = 0; i < game->numBalls; i++){
+                    if (CheckFlag(game->balls[i].flags, BallFlags_OnPaddle)){
+                        b = &game->balls[i];
+                        break;
+                    }
+                }
+                v2 dir = BallPaddleBounceDir(game, b);
+                v2 relativePos = b->pos - game->paddlePos;
+                f32 bestScore = -MAX_F32;
+                f32 bestX = game->paddlePos.x;
+                if (bot->ticksHoldingBall % 10 == 0){
+                    const s32 numCandidates = 9;
+                    for(s32 c = 0; c < numCandidates; c++){
+                        f32 x = Lerp(paddleMinX, paddleMaxX, c/(f32)(numCandidates - 1));
+                        f32 score = ScorePaddleShot(game, V2(Clamp(x + relativePos.x, b->r, game->viewDim.x - b->r), b->pos.y), dir, b->r);
+                        score -= .002f*Abs(x - game->paddlePos.x);
+                        if (score > bestScore){
+                            bestScore = score;
+                            bestX = x;
+                        }
+                    }
+                    bot->launchX = bestX;
+                }
+                targetX = bot->launchX;
+                bot->ticksHoldingBall++;
+                if (Abs(game->paddlePos.x - targetX) < 4.f || bot->ticksHoldingBall > 3*60){
+                    input->launch = true;
+                }
+            }
+        }
+    }
+    if (!anyStuck || input->launch)
+        bot->ticksHoldingBall = 0;
+
+    bot->targetX = Clamp(targetX, paddleMinX, paddleMaxX);
+    SteerPaddleBot(game, bot, input);
+}
+
+
+//
+// Bot matches
+//
+// Headless matches (tuner, match grid, gym, planner rollouts) don't need to run every tick: between
+// events balls and drops move in straight lines. StepBotMatch() lets the paddle bot decide on a regular
+// tick and then skips the uneventful ticks after it (see GameTicksUntilNextEvent()), only steering
+// towards the target it chose. The bricks bot still looks at every tick, since it rolls its chance to
+// place on each one and places the best of that tick's tries, but its scores are cached while the board
+// doesn't change, so that's cheap.
+//
+
+#define BOT_DECISION_TICKS 20 // The paddle bot decides again at least this often.
+
+// Advances the match by one decision of the paddle bot. Either bot can be null, to play that side with
+// 'input' (optional), which is used as is on the first tick, and only its held keys afterwards. Returns
+// the ticks advanced, at most 'maxTicks'. game->events has the events of the regular ticks.
+s32 StepBotMatch(game_state *game, paddle_bot *bot, placement_cache *cache, s32 maxTicks, game_input *input = 0){
+    game_input tickInput = {};
+    if (input)
+        tickInput = *input;
+    if (bot)
+        UpdatePaddleAI(game, bot, &tickInput);
+    if (cache)
+        UpdateBricksAI(game, cache, &tickInput);
+    s32 numEvents = game->numEvents;
+    s32 numBalls = game->numBalls;
+    s32 numDrops = game->numDrops;
+    UpdateGame(game, &tickInput, GAME_TICK_DT);
+    s32 result = 1;
+
+    // Only skip if nothing happened that the paddle bot would want to react to. Not with drops falling
+    // either, since it weighs catching or dodging them against the balls every tick, nor while holding a
+    // ball with the magnet, since it times the launch.
+    b32 skip = (game->numEvents == numEvents && game->numBalls == numBalls && game->numDrops == numDrops && !game->numDrops);
+    for(s32 i = 0; i < game->numBalls; i++){
+        if (CheckFlag(game->balls[i].flags, BallFlags_OnPaddle))
+            skip = false;
+    }
+    if (skip){
+        game_input held = {};
+        held.right = tickInput.right;
+        held.left = tickInput.left;
+        held.launch = tickInput.launch;
+        s32 numTicks = MinS32(GameTicksUntilNextEvent(game, &held), MinS32(maxTicks, BOT_DECISION_TICKS) - 1);
+        b32 anySlot = false;
+        for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+            if (game->availableSlots[i].occupied)
+                anySlot = true;
+        }
+        for(s32 skipped = 0; skipped < numTicks;){
+            if (bot)
+                SteerPaddleBot(game, bot, &held);
+            if (cache && anySlot){
+                game_input bricksInput = held;
+                UpdateBricksAI(game, cache, &bricksInput);
+                if (bricksInput.placeShape){
+                    // Placing is an event, so this one is a regular tick, and the paddle bot decides after it.
+                    UpdateGame(game, &bricksInput, GAME_TICK_DT);
+                    skipped++;
+                    numTicks = skipped;
+                    break;
+                }
+            }
+            s32 n = 1;
+            if (!held.right && !held.left && game->paddleXSpeed == 0 && !(cache && anySlot))
+                n = numTicks - skipped; // Nothing changes for the bots until then.
+            SkipGameTicks(game, &held, n);
+            skipped += n;
+        }
+        result += numTicks;
+        if (bot)
+            bot->ticksSinceAim += numTicks;
+    }
+    return result;
+}
+
+
+//
+// Rollout planner for the bricks
+//
+// A stronger (and much more expensive) alternative to UpdateBricksAI(). It takes the best placements
+// according to BrickPlacementHeuristic() and plays each of them out for a few seconds, against the
+// paddle bot and with different random seeds, to see how often a ball gets through the top. Then it
+// places the one that let the fewest through.
+// The rollouts are spread over frames (there's a time budget per frame) and over the thread pool.
+// Their results are kept from frame to frame while the bricks and the available shapes stay the same.
+//
+
+#define PLANNER_MAX_CANDIDATES 6
+#define PLANNER_ROLLOUTS_PER_CANDIDATE 8
+#define PLANNER_ROLLOUT_TICKS (4*60)
+#define PLANNER_DEFAULT_BUDGET 2000 // Microseconds per frame
+#define PLANNER_MAX_THINK_TIME 150000 // Microseconds. After this it decides with the rollouts it has (if there's at least one per candidate).
+
+struct brick_placement{
+    s32 slotIndex;
+    s32 rotations; // Counter-clockwise quarter turns.
+    v2s pos;
+    f32 heuristic;
+};
+
+struct bricks_rollout{
+    game_state *game; // Where to start (only read).
+    brick_placement placement;
+    u64 seed;
+    f32 danger; // Result: 1 if a ball got through the top, otherwise up to .5 depending on how high a ball got.
+};
+
+struct bricks_planner{
+    u64 boardKey; // Of the board the candidates were chosen for.
+    brick_placement candidates[PLANNER_MAX_CANDIDATES];
+    s32 numCandidates;
+    s32 numRollouts[PLANNER_MAX_CANDIDATES];
+    f32 sumDanger[PLANNER_MAX_CANDIDATES];
+    u64 thinkMicroseconds; // Spent on these candidates.
+    u64 nextSeed;
+    u64 budgetMicroseconds;
+    placement_cache cache;
+};
+
+void InitBricksPlanner(bricks_planner *planner, u64 budgetMicroseconds = PLANNER_DEFAULT_BUDGET){
+    ZeroStruct(planner);
+    planner->budgetMicroseconds = budgetMicroseconds;
+    InitPlacementCache(&planner->cache);
+}
+
+// Changes when the bricks or the available shapes change.
+u64 BricksBoardKey(game_state *game){
+    u64 result = game->stats.boardHash;
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        brick_shape_slot *slot = &game->availableSlots[i];
+        u64 value = (slot->occupied ? 1 + slot->shape.specialType : 0);
+        for(s32 y = 0; y < slot->shapeDim.y; y++){
+            value = (value << 8) ^ slot->shape.rows[0][y] ^ ((u64)slot->shape.rows[1][y] << 32);
+        }
+        result = SimpleHash64(result ^ value);
+    }
+    return result;
+}
+
+// Scores every rotation and position of the available shapes and keeps the best ones, sorted. Returns how many.
+s32 FindBestBrickPlacements(game_state *game, placement_cache *cache, brick_placement *result, s32 maxResults){
+    s32 numResults = 0;
+    for(s32 slotIndex = 0; slotIndex < ArrayCount(game->availableSlots); slotIndex++){
+        if (!game->availableSlots[slotIndex].occupied)
+            continue;
+        brick_shape_slot rotated[4];
+        for(s32 rotations = 0; rotations < 4; rotations++){
+            rotated[rotations] = (rotations ? rotated[rotations - 1] : game->availableSlots[slotIndex]);
+            if (rotations)
+                RotateShape90Degrees(&rotated[rotations], false);
+            brick_shape_slot *slot = &rotated[rotations];
+
+            // Symmetric shapes repeat themselves.
+            b32 repeated = false;
+            for(s32 i = 0; i < rotations; i++){
+                if (rotated[i].shapeDim == slot->shapeDim && memcmp(rotated[i].shape.rows, slot->shape.rows, sizeof(slot->shape.rows)) == 0)
+                    repeated = true;
+            }
+            if (repeated)
+                continue;
+
+            placement_cache_entry *entry = GetPlacementCacheEntry(cache, game, slot);
+            f32 heuristicTime = BrickTimeHeuristic(game, &cache->weights, slot->shape.specialType);
+            for(s32 y = 0; y <= game->gridDim.y - slot->shapeDim.y; y++){
+                for(s32 x = 0; x <= game->gridDim.x - slot->shapeDim.x; x++){
+                    f32 heuristic = CachedPlacementHeuristic(cache, entry, game, slot, V2S(x, y));
+                    if (heuristic < 0)
+                        continue;
+                    heuristic += heuristicTime;
+                    // Insert sorted
+                    s32 index = numResults;
+                    while(index > 0 && result[index - 1].heuristic < heuristic)
+                        index--;
+                    if (index >= maxResults)
+                        continue;
+                    numResults = MinS32(numResults + 1, maxResults);
+                    for(s32 i = numResults - 1; i > index; i--)
+                        result[i] = result[i - 1];
+                    result[index].slotIndex = slotIndex;
+                    result[index].rotations = rotations;
+                    result[index].pos = V2S(x, y);
+                    result[index].heuristic = heuristic;
+                }
+            }
+        }
+    }
+    return numResults;
+}
+
+// Thread job: places the shape in a copy of the game and plays it out with the paddle bot.
+void RunBricksRollout(void *data){
+    bricks_rollout *rollout = (bricks_rollout *)data;
+    game_state sim = *rollout->game;
+    PcgRandomSeed(rollout->seed, SimpleHash((u32)rollout->seed), &sim.random);
+    paddle_bot bot;
+    InitPaddleBot(&bot);
+
+    game_input input = {};
+    input.rotateSlot[rollout->placement.slotIndex] = -rollout->placement.rotations;
+    input.placeShape = true;
+    input.placeSlotIndex = rollout->placement.slotIndex;
+    input.placeTilePos = rollout->placement.pos;
+
+    // Balls move in straight lines over the skipped ticks, so their highest points are at the ends.
+    f32 boardHeight = sim.gridDim.y*sim.tileDim.y;
+    f32 minBallY = boardHeight;
+    for(s32 tick = 0; tick < PLANNER_ROLLOUT_TICKS && !sim.gameEnded;){
+        tick += StepBotMatch(&sim, &bot, 0, PLANNER_ROLLOUT_TICKS - tick, (tick == 0 ? &input : 0));
+        sim.numEvents = 0;
+        for(s32 i = 0; i < sim.numBalls; i++){
+            minBallY = Min(minBallY, sim.balls[i].pos.y);
+        }
+    }
+    if (sim.gameEnded && sim.paddleWon){
+        rollout->danger = 1.f;
+    }else{
+        rollout->danger = .5f*Square(1.f - Clamp01(minBallY/boardHeight));
+    }
+}
+
+// Call it every frame instead of UpdateBricksAI(). It places a shape once all the candidates have their rollouts.
+// 'pool' must not be used by anyone else at the same time.
+void UpdateBricksPlanner(bricks_planner *planner, game_state *game, thread_pool *pool, game_input *input){
+    u64 startTime = GetMicroseconds();
+    u64 boardKey = BricksBoardKey(game);
+    if (boardKey != planner->boardKey){
+        planner->boardKey = boardKey;
+        planner->numCandidates = FindBestBrickPlacements(game, &planner->cache, planner->candidates, PLANNER_MAX_CANDIDATES);
+        ZeroArray(planner->numRollouts);
+        ZeroArray(planner->sumDanger);
+        planner->thinkMicroseconds = 0;
+    }
+    if (!planner->numCandidates)
+        return;
+
+    // Run batches of rollouts (one per thread) until we run out of time or have all of them.
+    bricks_rollout rollouts[MAX_WORKER_THREADS + 1];
+    s32 rolloutCandidates[ArrayCount(rollouts)];
+    b32 done = false;
+    while(!done && GetMicroseconds() - startTime < planner->budgetMicroseconds){
+        s32 numRollouts = 0;
+        s32 counts[PLANNER_MAX_CANDIDATES];
+        for(s32 c = 0; c < planner->numCandidates; c++){
+            counts[c] = planner->numRollouts[c];
+        }
+        while(numRollouts < MinS32(pool->numThreads + 1, ArrayCount(rollouts))){
+            // Candidate with the fewest rollouts
+            s32 c = 0;
+            for(s32 i = 1; i < planner->numCandidates; i++){
+                if (counts[i] < counts[c])
+                    c = i;
+            }
+            if (counts[c] >= PLANNER_ROLLOUTS_PER_CANDIDATE)
+                break;
+            counts[c]++;
+            bricks_rollout *rollout = &rollouts[numRollouts];
+            rollout->game = game;
+            rollout->placement = planner->candidates[c];
+            rollout->seed = planner->nextSeed++;
+            rollout->danger = 0;
+            rolloutCandidates[numRollouts] = c;
+            numRollouts++;
+        }
+        for(s32 i = 0; i < numRollouts; i++){
+            AddThreadJob(pool, RunBricksRollout, &rollouts[i]);
+        }
+        WaitForThreadJobs(pool);
+        for(s32 i = 0; i < numRollouts; i++){
+            planner->numRollouts[rolloutCandidates[i]]++;
+            planner->sumDanger[rolloutCandidates[i]] += rollouts[i].danger;
+        }
+        done = (numRollouts == 0);
+    }
+    planner->thinkMicroseconds += GetMicroseconds() - startTime;
+
+    // Decide when all the rollouts are done, or with what we have if it's taking too long.
+    s32 minRollouts = (planner->thinkMicroseconds >= PLANNER_MAX_THINK_TIME ? 1 : PLANNER_ROLLOUTS_PER_CANDIDATE);
+    for(s32 c = 0; c < planner->numCandidates; c++){
+        if (planner->numRollouts[c] < minRollouts)
+            return; // Not yet
+    }
+    s32 best = 0;
+    f32 bestScore = MAX_F32;
+    for(s32 c = 0; c < planner->numCandidates; c++){
+        // The heuristic breaks ties (usually nothing gets through).
+        f32 score = planner->sumDanger[c]/planner->numRollouts[c] - .05f*planner->candidates[c].heuristic;
+        if (score < bestScore){
+            bestScore = score;
+            best = c;
+        }
+    }
+    brick_placement *placement = &planner->candidates[best];
+    input->rotateSlot[placement->slotIndex] = -placement->rotations;
+    input->placeShape = true;
+    input->placeSlotIndex = placement->slotIndex;
+    input->placeTilePos = placement->pos;
+    planner->boardKey = 0; // Start over next frame.
+}
+
+
+//
+// Asynchronous bricks AI
+//
+// Runs the planner on its own thread on a copy of the game, so the frame never waits for it, however
+// long it thinks. Each frame the game takes its decision if there's one, and gives it a fresh copy if
+// it's idle. Decisions go through the input, so they're applied at the start of a tick, and only if
+// they still fit (the board may have changed while it was thinking).
+// Without threads it just calls UpdateBricksPlanner() every frame, within the planner's budget.
+//
+
+#define ASYNC_AI_SLICE 4000 // Microseconds of thinking on each copy of the game.
+
+struct async_bricks_ai{
+    thread_pool *pool; // For the rollouts. Only the AI thread uses it.
+    bricks_planner planner; // Only the AI thread touches it.
+    game_state snapshot;
+    game_input decision; // For 'snapshot'
+    b32 busy; // The AI thread is thinking about 'snapshot'.
+    b32 hasDecision;
+    b32 threaded;
+#if BI_THREADS
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+#endif
+};
+
+#if BI_THREADS
+void *AsyncBricksAIThreadProc(void *data){
+    async_bricks_ai *ai = (async_bricks_ai *)data;
+    pthread_mutex_lock(&ai->mutex);
+    while(true){
+        if (!ai->busy){
+            pthread_cond_wait(&ai->wake, &ai->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&ai->mutex);
+        game_input decision = {};
+        UpdateBricksPlanner(&ai->planner, &ai->snapshot, ai->pool, &decision);
+        pthread_mutex_lock(&ai->mutex);
+        if (decision.placeShape){
+            ai->decision = decision;
+            ai->hasDecision = true;
+        }
+        ai->busy = false;
+    }
+    return 0;
+}
+#endif
+
+// Starts the AI thread (it lives until the program ends). Call it once.
+void InitAsyncBricksAI(async_bricks_ai *ai, thread_pool *pool){
+    ZeroStruct(ai);
+    ai->pool = pool;
+    InitBricksPlanner(&ai->planner);
+#if BI_THREADS
+    pthread_mutex_init(&ai->mutex, 0);
+    pthread_cond_init(&ai->wake, 0);
+    if (pthread_create(&ai->thread, 0, AsyncBricksAIThreadProc, ai) == 0){
+        pthread_detach(ai->thread);
+        ai->threaded = true;
+        ai->planner.budgetMicroseconds = ASYNC_AI_SLICE;
+    }
+#endif
+}
+
+// True if 'decision', made for 'snapshot', can still be done in 'game'.
+b32 BricksDecisionStillFits(game_state *game, game_state *snapshot, game_input *decision){
+    s32 slotIndex = decision->placeSlotIndex;
+    brick_shape_slot *slot = &game->availableSlots[slotIndex];
+    if (!slot->occupied || memcmp(slot, &snapshot->availableSlots[slotIndex], sizeof(*slot)) != 0)
+        return false;
+    brick_shape_slot rotated = *slot;
+    for(s32 r = decision->rotateSlot[slotIndex]; r < 0; r++)
+        RotateShape90Degrees(&rotated, false);
+    for(s32 r = decision->rotateSlot[slotIndex]; r > 0; r--)
+        RotateShape90Degrees(&rotated, true);
+    return CanPlaceShape(game, &rotated, decision->placeTilePos);
+}
+
+// Call it every frame (when the game isn't paused) instead of UpdateBricksAI().
+void UpdateAsyncBricksAI(async_bricks_ai *ai, game_state *game, game_input *input){
+    if (!ai->threaded){
+        UpdateBricksPlanner(&ai->planner, game, ai->pool, input);
+        return;
+    }
+#if BI_THREADS
+    pthread_mutex_lock(&ai->mutex);
+    b32 placing = false;
+    if (ai->hasDecision){
+        ai->hasDecision = false;
+        if (BricksDecisionStillFits(game, &ai->snapshot, &ai->decision)){
+            s32 slotIndex = ai->decision.placeSlotIndex;
+            input->rotateSlot[slotIndex] = ai->decision.rotateSlot[slotIndex];
+            input->placeShape = true;
+            input->placeSlotIndex = slotIndex;
+            input->placeTilePos = ai->decision.placeTilePos;
+            placing = true;
+        }
+    }
+    if (!ai->busy && !placing){ // (After placing, wait until the next frame to see the result.)
+        ai->snapshot = *game;
+        ai->snapshot.numEvents = 0;
+        ai->busy = true;
+        pthread_cond_signal(&ai->wake);
+    }
+    pthread_mutex_unlock(&ai->mutex);
+#endif
+}
+
+// Forgets the decision it may have (for a new game). The planner notices the new board by itself.
+void ResetAsyncBricksAI(async_bricks_ai *ai){
+#if BI_THREADS
+    if (ai->threaded)
+        pthread_mutex_lock(&ai->mutex);
+#endif
+    ai->hasDecision = false;
+#if BI_THREADS
+    if (ai->threaded)
+        pthread_mutex_unlock(&ai->mutex);
+#endif
+}
+
+#endif
@@ -96,7 +96,8 @@ struct pcg_random_state{
     u64 state;
     u64 inc;
 };
-static pcg_random_state globalPcgRandom = { 0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL };
+// Per thread, so code running on worker threads (AI searches) can use the Random*() functions too.
+static thread_local pcg_random_state globalPcgRandom = { 0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL };
 
 u32 PcgRandomU32(pcg_random_state *pcg = &globalPcgRandom){
     u64 oldstate = pcg->state;
@@ -110,13 +111,19 @@ u32 PcgRandomU32(pcg_random_state *pcg = &globalPcgRandom){
 }
 // Seed the rng.  Specified in two parts, state initializer and a
 // sequence selection constant (a.k.a. stream id)
-void PcgRandomSeed(u64 initstate, u64 initseq) {
-    auto rng = &globalPcgRandom;
+void PcgRandomSeed(u64 initstate, u64 initseq, pcg_random_state *rng = &globalPcgRandom) {
     rng->state = 0U;
     rng->inc = (initseq << 1u) | 1u;
-    PcgRandomU32();
+    PcgRandomU32(rng);
     rng->state += initstate;
-    PcgRandomU32();
+    PcgRandomU32(rng);
+}
+// Makes the Random*() functions below draw from 'state' instead of the global state.
+// Call it again with the same pointer to put things back (the state advanced in between is kept in 'state').
+inline void SwapRandomState(pcg_random_state *state){
+    pcg_random_state temp = globalPcgRandom;
+    globalPcgRandom = *state;
+    *state = temp;
 }
 
 
@@ -0,0 +1,526 @@
+//
+// What a match looks like, as render commands (see bi_render.h): the board, the HUD, the shapes and the
+// special bricks. It only reads the game, so the game and the headless tools (bi_export.cpp) draw
+// matches the same way. Include it after bi_render.h.
+//
+
+#ifndef BI_DRAW_H
+#define BI_DRAW_H
+
+#include <stdio.h>
+
+#define SLOT_DIM 75.f // Shape slots on the right side bar
+#define BACKGROUND_COLOR V4(.1f, .02f, .12f)
+#define GUI_BACKGROUND_COLOR V4(.6f, .3f, .4f)
+
+// Active powerups in the order the HUD shows them: good ones first, then by time left. They're only
+// sorted again when one starts or ends (or is picked up again), so they don't swap places as they run out.
+struct hud_powerups{
+    drop_type types[LAST_BAD_DROP + 1];
+    s32 numGood;
+    s32 num;
+    f32 times[LAST_BAD_DROP + 1]; // PowerupTimeFraction() of each type.
+};
+
+// The game's state when a frame is drawn, besides the match itself.
+struct match_view{
+    v2 winDim;
+    v2 viewPos; // Top-left of the board
+    f64 time; // Seconds, for the animations.
+    hud_powerups *hud;
+    particle_system *particles; // In board coordinates, drawn over the bricks. Can be 0.
+    b32 bricksAsRects; // Instead of RenderBricks(), which can't be scaled and caches a single board.
+    b32 plainSpecials; // Special bricks on the board with a still, simpler overlay. Cheaper.
+
+    // The shape being dragged with the mouse, if draggingShapeIndex != -1.
+    s32 draggingShapeIndex;
+    v2 mousePos;
+    b32 isDraggingShapeOnWorld;
+    b32 isDraggingShapePosValid;
+    v2s draggingShapeTilePos;
+};
+
+void UpdateHudPowerups(hud_powerups *hud, game_state *game){
+    b32 changed = false;
+    for(s32 type = Drop_BigPaddle; type <= LAST_BAD_DROP; type++){
+        f32 t = PowerupTimeFraction(game, (drop_type)type);
+        if ((t > 0) != (hud->times[type] > 0) || t > hud->times[type]){
+            changed = true;
+        }
+        hud->times[type] = t;
+    }
+    if (changed){
+        hud->num = 0;
+        for(s32 type = Drop_BigPaddle; type <= LAST_BAD_DROP; type++){
+            if (type == FIRST_BAD_DROP){
+                hud->numGood = hud->num;
+            }
+            if (hud->times[type] > 0){
+                s32 first = (type < FIRST_BAD_DROP ? 0 : hud->numGood);
+                s32 j = hud->num++;
+                for(; j > first && hud->times[hud->types[j - 1]] < hud->times[type]; j--){
+                    hud->types[j] = hud->types[j - 1];
+                }
+                hud->types[j] = (drop_type)type;
+            }
+        }
+    }
+}
+
+// Top-left of a shape slot: the available ones, then the next ones a bit lower.
+v2 SlotPos(game_state *game, v2 viewPos, v2 winDim, s32 index){
+    f32 regionX = viewPos.x + game->viewDim.x;
+    f32 regionW = Max(0.f, winDim.x - regionX);
+    v2 result = V2(regionX + regionW/2 - SLOT_DIM/2, 30.f + (SLOT_DIM + 10.f)*index);
+    if (index >= ArrayCount(game->availableSlots)){
+        result.y += 60.f;
+    }
+    return result;
+}
+
+// 'plain' leaves out the animations and the spawner's corners.
+void RenderBrickSpecial(render_buffer *rb, v2 brickPos, v2 brickDim, special_brick_type type, v4 brickColor, f32 alpha, f64 time, b32 plain = false){
+    if (type == SpecialBrick_Powerup || type == SpecialBrick_BadPowerup){
+        v4 color = (type == SpecialBrick_Powerup ? V4_White(alpha) : V4_Black(alpha));
+
+        // Draw 4-point star sprite
+        v2 texPos = V2(0);
+        v2 texDim = V2(32);
+        RenderSprite(rb, texPos, texDim, brickPos, brickDim, color);
+
+    }else if (type == SpecialBrick_Arrow){
+        v4 color = V4_White(alpha);
+        f32 t = (f32)fmod(time, .8)/.8f;
+        if (plain){
+            t = .5f; // Centered, so it's never cut.
+        }
+
+        v2 triDim = {Min(brickDim.x, 2*brickDim.y), brickDim.y};
+        v2 triPos = brickPos + (brickDim - triDim)/2 + V2(0, brickDim.y*(-1.f + 2*t));
+        v2 p0 = triPos + V2(triDim.x/2, triDim.y); // Bottom
+        v2 p1 = triPos + V2(triDim.x, 0); // Top Right
+        v2 p2 = triPos; // Top Left
+
+        if (p0.y <= brickPos.y + brickDim.y && p1.y >= brickPos.y){
+            RenderTriangle(rb, p0, p1, p2, color);
+        }else if (p1.y < brickPos.y){
+            f32 l = Min(1.f, (p0.y - brickPos.y)/brickDim.y);
+            RenderTriangle(rb, p0, LerpV2(p0, p1, l), LerpV2(p0, p2, l), color);
+        }else{
+            f32 l = Min(1.f, (brickPos.y + brickDim.y - p1.y)/brickDim.y);
+            RenderTriangle(rb, LerpV2(p2, p0, l), p1, p2, color);
+            RenderTriangle(rb, LerpV2(p2, p0, l), LerpV2(p1, p0, l), p1, color);
+        }
+    }else if (type == SpecialBrick_Spawner){
+        RenderRect(rb, brickPos, brickDim, V4_Black());
+
+        v2 c = brickPos + brickDim/2;
+        v2 r = brickDim/2;
+
+        v4 colorInner = brickColor;
+        v4 colorCorners = V4_White(alpha);
+        double flickerPeriod = 1.0;
+        if (!plain && fmod(time, flickerPeriod) > flickerPeriod/2){
+            SWAP(colorInner, colorCorners);
+        }
+
+        // Inner diamond
+        r *= .4f;
+        RenderTriangle(rb, c + V2(0, -r.y), c + V2(-r.x, 0), c + V2(0, r.y), colorInner);
+        RenderTriangle(rb, c + V2(0, -r.y), c + V2(0, r.y), c + V2(r.x, 0 ), colorInner);
+
+        if (plain)
+            return;
+
+        // Corners
+        r = brickDim/2;
+        f32 m = .2f;
+        RenderTriangle(rb, c + -r, c + V2(-r.x, -m*r.y), c + V2(-m*r.x, -r.y), colorCorners);
+        RenderTriangle(rb, c + V2(-r.x, r.y), c + V2(-m*r.x, r.y), c + V2(-r.x, m*r.y), colorCorners);
+        RenderTriangle(rb, c + r, c + V2(r.x, m*r.y), c + V2(m*r.x, r.y), colorCorners);
+        RenderTriangle(rb, c + V2(r.x, -r.y), c + V2(m*r.x, -r.y), c + V2(r.x, -m*r.y), colorCorners);
+
+    }
+}
+
+// Draws it centered.
+void RenderBrickShape(render_buffer *rb, brick_shape_slot *slot, v2 tileDim, v2 centerPos, f32 scale, f64 time, f32 alpha = 1.f){
+    v2 p = centerPos - Hadamard(V2(slot->shapeDim), tileDim*scale)/2;
+    v4 col = slot->shape.color;
+    col.a = alpha;
+    f32 m = TILE_DRAW_MARGIN;
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        for(s32 x = 0; x < slot->shapeDim.x; x++){
+            if (slot->shape.rows[0][y] & (0x1 << (7 - x))){
+                RenderRect(rb, p + scale*V2(x*tileDim.x + m, y*tileDim.y + m), scale*(tileDim - V2(2*m)), col);
+            }
+            if (slot->shape.rows[1][y] & (0x1 << (7 - x))){
+                RenderBrickSpecial(rb, p + scale*V2(x*tileDim.x + m, y*tileDim.y + m), scale*(tileDim - V2(2*m)), slot->shape.specialType, col, 1.f, time);
+            }
+        }
+    }
+}
+
+void RenderRotateArrow(render_buffer *rb, v2 pos, v2 dim, b32 flipX, v4 color){
+    v2 texPos = V2((flipX ? 80.f : 32.f), 0);
+    RenderSprite(rb, texPos, V2(48.f*(flipX ? -1 : 1), 48), pos, dim, color);
+}
+
+// The look of DoButton(). 'highlight': 1 hovered, -1 pressed.
+void RenderButton(render_buffer *rb, v2 pos, v2 dim, char *text, v4 color, s32 style, s32 highlight){
+    if (highlight > 0){
+        color = Clamp01V4(color + V4_Grey(.2f, 0));
+    }else if (highlight < 0){
+        color = Clamp01V4(color + V4_Grey(-.2f, 0));
+    }
+    if (style == 1){
+        RenderRect(rb, pos, dim, Clamp01V4(color*1.1f));
+        v2 m = {3.f, 3.f};
+        RenderRect(rb, pos + m, dim - 2*m, V4_Black());
+        m += V2(3.f, 3.f);
+        RenderRect(rb, pos + m, dim - 2*m, color);
+    }else if (style == 2 || style == 3){
+        RenderRect(rb, pos, dim, V4_White());
+        v2 m = V2(3.f, 3.f);
+        RenderRect(rb, pos + m, dim - 2*m, color);
+        // Arrow
+        v2 arrowDim = V2(24.f);
+        v4 arrowColor = V4_Grey(.88f);
+        if (highlight > 0){
+            arrowColor = Clamp01V4(arrowColor + V4_Grey(.2f, 0));
+        }else if (highlight < 0){
+            arrowColor = Clamp01V4(arrowColor + V4_Grey(-.2f, 0));
+        }
+        RenderRotateArrow(rb, pos + dim/2 - arrowDim/2, arrowDim, (style == 3), arrowColor);
+    }else{
+        RenderRect(rb, pos, dim, color);
+    }
+
+    if (text && text[0]){
+        f32 fontSize = 20.f;
+        RenderText(rb, text, pos.x + dim.x/2, (f32)(s32)(pos.y + dim.y/2 - fontSize/2), (s32)fontSize, V4_Black(), RenderText_CenterX);
+    }
+}
+
+// The board and the HUD. The buttons are left to the caller.
+void DrawMatch(render_buffer *rb, game_state *game, match_view *view){
+    v2 viewPos = view->viewPos;
+    v2 winDim = view->winDim;
+    f64 time = view->time;
+
+    rb->layer = RenderLayer_Background;
+    RenderClear(rb, V4_Black());
+
+    rb->layer = RenderLayer_World;
+    // View background
+    RenderRect(rb, V2(viewPos.x, 0), V2(game->viewDim.x, winDim.y), BACKGROUND_COLOR);
+
+    // Draw drops
+    for(s32 i = 0; i < game->numDrops; i++){
+        v2 texDim = V2(32.f);
+        v2 texPos = V2(((s32)game->drops[i].type)*texDim.x, 48.f);
+        if (game->drops[i].type >= FIRST_BAD_DROP){
+            texPos = V2(((s32)game->drops[i].type - (s32)FIRST_BAD_DROP)*texDim.x, 80.f);
+        }
+        RenderSprite(rb, texPos, texDim, viewPos + game->drops[i].pos - texDim/2, texDim);
+    }
+
+    // Draw bricks, and the special overlays on top of them.
+    f32 m = TILE_DRAW_MARGIN;
+    if (view->bricksAsRects){
+        for(s32 y = 0; y < game->gridDim.y; y++){
+            for(s32 x = 0; x < game->gridDim.x; x++){
+                tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+                if (tile->occupied){
+                    RenderRect(rb, viewPos + V2(x*game->tileDim.x + m, y*game->tileDim.y + m), game->tileDim - V2(m*2), tile->color);
+                }
+            }
+        }
+    }else{
+        RenderBricks(rb, game, viewPos);
+    }
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+            if (tile->occupied && tile->specialType != SpecialBrick_None){
+                v2 p = viewPos + V2(x*game->tileDim.x, y*game->tileDim.y);
+                f32 alpha = 1.f;
+                if (tile->specialType != SpecialBrick_Spawner){ // Momentary Special Bricks fade out
+                    alpha = MapRangeToRangeClamp(tile->specialTypeTimer, SPECIAL_BRICK_DESTROY_TIME, SPECIAL_BRICK_DESTROY_TIME - SPECIAL_BRICK_FADEOUT_TIME, .15f, 1.f);
+                }
+                RenderBrickSpecial(rb, p + V2(m), game->tileDim - V2(m*2), tile->specialType, tile->color, tile->specialAlpha*alpha, time, view->plainSpecials);
+            }
+        }
+    }
+
+    // Draw particles
+    if (view->particles){
+        RenderParticles(rb, view->particles, viewPos);
+    }
+
+    // Draw Paddle
+    {
+        v4 paddleColor = V4_White();
+        if (game->powerupCountdownReverseControls){
+            paddleColor = V4(.98f, .9f, .12f);
+        }else if (game->powerupCountdownSlipperyControls){
+            paddleColor = V4(.25f, 1.f, 1.f);
+        }
+        RenderRect(rb, viewPos + game->paddlePos - game->paddleDim/2 + V2(game->paddleDim.y/2, 0), game->paddleDim - V2(game->paddleDim.y, 0), paddleColor);
+        RenderCircle(rb, viewPos + game->paddlePos + V2(-game->paddleDim.x/2 + game->paddleDim.y/2, 0), game->paddleDim.y/2, paddleColor);
+        RenderCircle(rb, viewPos + game->paddlePos + V2( game->paddleDim.x/2 - game->paddleDim.y/2, 0), game->paddleDim.y/2, paddleColor);
+
+        if (game->powerupCountdownMagnet){
+            for(s32 i = 0; i < game->numBalls; i++){
+                ball_state *ball = &game->balls[i];
+                if (CheckFlag(ball->flags, BallFlags_OnPaddle) && !CheckFlag(ball->flags, BallFlags_StuckShootRandomly)){
+                    // Aim line following the bounces the ball would do.
+                    ball_trace trace;
+                    f32 maxLength = 600.f;
+                    TraceBall(game, ball->pos, BallPaddleBounceDir(game, ball), ball->r, game->paddlePos.y - game->paddleDim.y/2 - ball->r, 4, &trace);
+                    f32 length = 0;
+                    for(s32 j = 0; j + 1 < trace.numPoints && length < maxLength; j++){
+                        v2 p0 = trace.points[j];
+                        v2 p1 = trace.points[j + 1];
+                        f32 segmentLength = Length(p1 - p0);
+                        s32 numSegments = (s32)Max(1.f, segmentLength/5.f);
+                        for(s32 k = 0; k < numSegments; k++){
+                            f32 t0 = k/(f32)numSegments;
+                            f32 t1 = (k + 1)/(f32)numSegments;
+                            f32 distance = length + t0*segmentLength;
+                            if (distance < ball->r)
+                                continue; // Start at the edge of the ball.
+                            f32 alpha = Square(1.f - Clamp01(distance/maxLength))*.8f;
+                            RenderLine(rb, viewPos + LerpV2(p0, p1, t0), viewPos + LerpV2(p0, p1, t1), 3.f, V4(1.f, .3f, .5f, alpha));
+                        }
+                        length += segmentLength;
+                    }
+                }
+            }
+        }
+    }
+
+    // Draw Barrier
+    if (game->powerupCountdownBarrier){
+        v2 barrierPos = viewPos + V2(0, game->barrierTopY);
+        RenderRect(rb, barrierPos, V2(game->viewDim.x, game->barrierHeight), V4_White());
+
+        f32 d = game->barrierHeight; // diagonal width and height (becauseangle is 45 deg)
+        s32 num = (s32)(game->viewDim.x/(d*4) + .5f);
+        f32 lineWidth = game->viewDim.x/(num*2);
+        v4 color = V4(1.f, .4f, .96f);
+        for(s32 i = 0; i < num; i++){
+            v2 p = barrierPos + V2(lineWidth*2*i, 0);
+            RenderTriangle(rb, p + V2(d, 0), p + V2(0, d), p + V2(lineWidth, d), color);
+            RenderTriangle(rb, p + V2(d, 0), p + V2(lineWidth, d), p + V2(d + lineWidth, 0), color);
+        }
+    }
+
+    // Draw Randomizer
+    if (game->powerupCountdownRandomizer){
+        s32 num = (s32)Round(game->viewDim.x/50.f);
+        for(s32 i = 0; i < num; i++){
+            f32 sep = game->viewDim.x/(2.f*num);
+            v2 pos = viewPos + V2((1.f + 2.f*i)*sep, game->randomizerY);
+            RenderText(rb, "?", pos.x, (f32)(s32)(pos.y - 10.f), 20, V4(1.f,  .4f, .97f), RenderText_CenterX);
+        }
+    }
+
+    // Draw Balls
+    for(s32 i = 0; i < game->numBalls; i++){
+        RenderCircle(rb, viewPos + game->balls[i].pos, game->balls[i].r, V4_Grey((game->powerupCountdownMagnet ? .55f : 1.f)));
+    }
+
+    // "Speed up" message
+    char speedStr[50];
+    sprintf(speedStr, (Abs(Frac(game->gameSpeed + .5f) - .5f) < .001f ? "%.0fx" : "%.01fx"), game->gameSpeed);
+    if (game->speedUpMessageTimer){
+        f32 t = Clamp01(game->speedUpMessageTimer/game->speedUpMessageTime);
+        f32 h = 100.f;
+
+        f32 a = Min(1.f, game->speedUpMessageTimer/.3f); // Fade in
+        f32 fadeout = Clamp01((game->speedUpMessageTime - game->speedUpMessageTimer)/.33f); // Fade out
+        a = Min(a, fadeout);
+        f32 alpha = a*(.4f + Map01ToBellSin(t)*.3f);
+
+        RenderRect(rb, V2(viewPos.x, winDim.y/2 - h/2), V2(game->viewDim.x, h), V4_White(alpha));
+        f32 fontSize = 40.f;
+        f32 xOff = Lerp(-60.f, 50.f, t*.1f + Map01ToArcSin(t)*.9f) + (t*t*t)*100.f + (1.f - fadeout)*30.f;
+        // With the spacing of DrawTextEx(), which I think gives better anti-aliasing/stuttering results.
+        RenderText(rb, "Speed up!", viewPos.x + game->viewDim.x/2 + xOff, winDim.y/2 - fontSize/2 - 20.f, (s32)fontSize, V4_Black(Min(1.f, alpha + .3f)), RenderText_CenterX, 2);
+        // Secondary text
+        xOff = xOff*.7f;
+        RenderText(rb, speedStr, viewPos.x + game->viewDim.x/2 + xOff, winDim.y/2 + 15.f, 20, V4_Grey(.15f, Min(1.f, alpha + .0f)), RenderText_CenterX, 2);
+    }
+
+    //
+    // HUD
+    //
+    // The text goes after the shapes, so they're all one batch. (Nothing overlaps.)
+    rb->layer = RenderLayer_Hud;
+
+    // GUI background (side bars)
+    RenderRect(rb, V2(0), V2(viewPos.x, winDim.y), GUI_BACKGROUND_COLOR);
+    RenderRect(rb, V2(viewPos.x + game->viewDim.x, 0), V2(winDim.x - viewPos.x - game->viewDim.x, winDim.y), GUI_BACKGROUND_COLOR);
+
+    // Lifes left
+    s32 lifesPerRow = 4;
+    f32 lifeR = 7.f;
+    f32 lifeSep = 2*lifeR + 8.f;
+    f32 lifeYSep = 20.f;
+    for(s32 i = 0; i < game->paddleLifes; i++){
+        v2 p = V2((viewPos.x - lifeSep*lifesPerRow)/2 + lifeR + (i % lifesPerRow)*lifeSep, winDim.y - 35 - lifeYSep*(i/lifesPerRow));
+        RenderCircle(rb, p + V2(2.f), lifeR, V4_Black(.3f));
+        RenderCircle(rb, p, lifeR, V4_White());
+    }
+
+    // Draw powerups
+    hud_powerups *hud = view->hud;
+    for(s32 i = 0; i < hud->num; i++){
+        drop_type type = hud->types[i];
+        v2 texDim = V2(32.f);
+        f32 scale = 1.f;
+        v2 texPos;
+        v2 p;
+        if (i < hud->numGood){
+            texPos = V2(((s32)type - (s32)FIRST_GOOD_DROP)*texDim.x, 48.f);
+            p = V2(20.f + (texDim.x*scale + 11.f)*i, 120);
+        }else{
+            s32 columns = 3;
+            s32 index = i - hud->numGood;
+            texPos = V2(((s32)type - (s32)FIRST_BAD_DROP)*texDim.x, 80.f);
+            p = V2(20.f + (texDim.x*scale + 11.f)*(index % columns), 170 + (index/columns)*50.f);
+        }
+        f32 r1 = texDim.y*scale/2 - 2.f;
+        f32 r2 = texDim.y*scale/2 + 4.f;
+        RenderProgressRing(rb, p + texDim*scale/2, r1, r2, hud->times[type], V4(1.f, 1.f, 1.f, .95f), V4(.1f, .1f, .1f, .95f));
+        RenderSprite(rb, texPos, texDim, p, texDim*scale);
+    }
+
+    // Draw shape slots
+    v2 slotDim = V2(SLOT_DIM);
+    for(s32 i = 0; i < ArrayCount(game->availableSlots) + ArrayCount(game->nextSlots); i++){
+        brick_shape_slot *slot = (i < ArrayCount(game->availableSlots) ? &game->availableSlots[i] : &game->nextSlots[i - ArrayCount(game->availableSlots)]);
+
+        v2 slotPos = SlotPos(game, viewPos, winDim, i);
+        v4 outlineColor = V4_Grey(200/255.f); // LIGHTGRAY
+        v4 fillColor = (slot->occupied ? BACKGROUND_COLOR : V4_Black());
+        if (i < ArrayCount(game->availableSlots)) {
+            if (slot->occupied)
+                outlineColor = V4_White();
+        }else{
+            outlineColor = V4_Grey(130/255.f); // GRAY
+            fillColor = V4(.2f, .14f, .19f, 1.f);
+        }
+        // Draw frame
+        f32 fm = 3.f;
+        RenderRect(rb, slotPos + V2(fm), slotDim - V2(2*fm), fillColor);
+        RenderRect(rb, slotPos, V2(slotDim.x - fm, fm), outlineColor);
+        RenderRect(rb, V2(slotPos.x + slotDim.x - fm, slotPos.y), V2(fm, slotDim.y - fm), outlineColor);
+        RenderRect(rb, V2(slotPos.x + fm, slotPos.y + slotDim.y - fm), V2(slotDim.x - fm, fm), outlineColor);
+        RenderRect(rb, V2(slotPos.x, slotPos.y + fm), V2(fm, slotDim.y - fm), outlineColor);
+
+        // Draw shape
+        if (slot->occupied){
+            v2 space = slotDim - V2(2*(fm + 5.f));
+            f32 scale = Min(.6f, space.x/(Max(slot->shapeDim.x, slot->shapeDim.y)*game->tileDim.x)); // Avoids choppy rotations
+            RenderBrickShape(rb, slot, game->tileDim, slotPos + slotDim/2, scale, time);
+        }
+    }
+
+    // Loading bar arrow
+    {
+        f32 regionX = viewPos.x + game->viewDim.x;
+        f32 regionW = winDim.x - regionX;
+
+        v4 emptyColor = V4_Black();
+        v4 fillColor = V4_White();
+        v2 triDim = {46.f, 23.f};
+        v2 rectDim = {14.f, 32.f};
+        v2 triPos  = {regionX + regionW/2 - triDim.x/2, winDim.y/2 - (triDim.y + rectDim.y)/2};
+        v2 rectPos = {regionX + regionW/2 - rectDim.x/2, triPos.y + triDim.y};
+        f32 t = Clamp01(game->spawnShapeTimer/game->config.spawnShapeTime);
+        f32 rectT = Clamp01(t*(rectDim.y + triDim.y)/(rectDim.y));
+        f32 triT = Clamp01((t*(rectDim.y + triDim.y) - rectDim.y)/(triDim.y));
+        // Arrow triangle
+        v2 tri0 = triPos + V2(0, triDim.y);
+        v2 tri1 = triPos + triDim;
+        v2 tri2 = triPos + V2(triDim.x/2, 0);
+        if (triT == 0){
+            RenderTriangle(rb, tri0, tri1, tri2, emptyColor);
+        }else if (triT == 1.f){
+            RenderTriangle(rb, tri0, tri1, tri2, fillColor);
+        }else{
+            v2 tri02 = LerpV2(tri0, tri2, triT);
+            v2 tri12 = LerpV2(tri1, tri2, triT);
+            RenderTriangle(rb, tri0, tri1, tri12, fillColor);
+            RenderTriangle(rb, tri0, tri12, tri02, fillColor);
+            RenderTriangle(rb, tri02, tri12, tri2, emptyColor);
+        }
+        // Arrow rectangle
+        if (rectT == 0){
+            RenderRect(rb, rectPos, rectDim, emptyColor);
+        }else if (rectT == 1.f){
+            RenderRect(rb, rectPos, rectDim, fillColor);
+        }else{
+            RenderRect(rb, rectPos + V2(0, (1.f - rectT)*rectDim.y), V2(rectDim.x, rectT*rectDim.y), fillColor);
+            RenderRect(rb, rectPos, V2(rectDim.x, (1.f - rectT)*rectDim.y), emptyColor);
+        }
+    }
+
+    // Game timer and speed
+    {
+        char str[50];
+        sprintf(str, "%02i:%02i", (s32)(game->gameTime/60), ((s32)game->gameTime) % 60);
+        RenderText(rb, str, viewPos.x/2 + 2.f, 20 + 2.f, 20, V4_Black(.3f), RenderText_CenterX);
+        RenderText(rb, str, viewPos.x/2, 20, 20, V4_White(), RenderText_CenterX);
+    }
+    if (game->config.doSpeedUp){
+        RenderText(rb, speedStr, viewPos.x/2 + 2.f, 50 + 2.f, 20, V4_Black(.3f), RenderText_CenterX);
+        RenderText(rb, speedStr, viewPos.x/2, 50, 20, V4_White(), RenderText_CenterX);
+    }
+    // Combo message
+    if (game->sameColorCombo > 1){
+        char text[50];
+        sprintf(text, "Combo x%i!", game->sameColorCombo);
+        v2 pos = {viewPos.x/2, winDim.y - 80 - lifeYSep*MaxS32(0, (game->paddleLifes - 1)/lifesPerRow)};
+        RenderText(rb, text, pos.x + 2, pos.y + 2, 20, V4_Black(.3f), RenderText_CenterX);
+        RenderText(rb, text, pos.x, pos.y, 20, LerpV4(game->sameColorComboLastColor, V4_White(), .1f), RenderText_CenterX);
+    }
+
+    // Draw dragging shape
+    rb->layer = RenderLayer_Dragging;
+    if (view->draggingShapeIndex != -1){
+        brick_shape_slot slot = game->availableSlots[view->draggingShapeIndex];
+        if (view->isDraggingShapeOnWorld){
+            if (!view->isDraggingShapePosValid){
+                slot.shape.color = V4_Grey(.5f);
+            }
+            v2 p = viewPos + Hadamard(V2(view->draggingShapeTilePos) + V2(slot.shapeDim)/2, game->tileDim);
+            RenderBrickShape(rb, &slot, game->tileDim, p, 1.f, time, .6f);
+        }else{
+            RenderBrickShape(rb, &slot, game->tileDim, view->mousePos, 1.f, time, .6f);
+        }
+        // Dotted line indicating the end of the grid
+        for(s32 x = 0; x < game->gridDim.x;  x++){
+            RenderRect(rb, viewPos + V2(x*game->tileDim.x + 3.f, game->gridDim.y*game->tileDim.y), V2(game->tileDim.x - 2*3.f, 4.f), V4_Grey(.5f, .2f));
+        }
+    }
+}
+
+// The band across the screen with who won. (The game puts its buttons on it.)
+void DrawMatchResult(render_buffer *rb, game_state *game, v2 winDim){
+    rb->layer = RenderLayer_Overlay;
+    f32 h = 220.f;
+    RenderRect(rb, V2(0, (winDim.y - h)/2), V2(winDim.x, h), V4_Black(.5f));
+
+    f32 titleFontSize = 30;
+    f32 titleY = (winDim.y - h)/2 + 30.f;
+    if (game->paddleWon){
+        RenderText(rb, "The paddle won!", winDim.x/2, titleY, (s32)titleFontSize, V4_White(), RenderText_CenterX);
+    }else{
+        RenderText(rb, "The bricks won!", winDim.x/2, titleY, (s32)titleFontSize, V4_White(), RenderText_CenterX | RenderText_Colorful);
+    }
+}
+
+#endif
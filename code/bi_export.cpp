@@ -0,0 +1,353 @@
+/*
+*  Replay to video: plays a replay (see bi_replay.h) headless and draws its frames like the game does
+*  (bi_draw.h), with the software renderer (bi_soft_render.h) as the backend, into a raw Y4M video that
+*  players and encoders read as is. For example:
+*      bi_export match.bireplay | ffmpeg -i - match.mp4
+*
+*  Frames are drawn out of order, on all the cores. A first pass plays the whole match, which only takes a
+*  moment, and keeps a copy of the game state every second (keyframes). The video is then cut in chunks of
+*  frames, and each job plays its chunk from the keyframe before it, drawing and converting its frames.
+*  The chunks are written in order, one batch while the next one is being drawn, so memory doesn't grow
+*  with the length of the match.
+*
+*  The frames of a replay have the dt the game had, so they're resampled to the video's frame rate: each
+*  video frame shows the game as it was at that time. (Pauses aren't in replays.)
+*
+*  Usage: bi_export <replay file> [options]
+*    -o PATH         Output file (default: stdout)
+*    -fps N          (default 60)
+*    -hold S         Seconds the end of the match stays on screen (default 3).
+*    -threads N      Worker threads (default: one less than the number of cores).
+*    -texture PATH   The sprites (default resources/main.png, run it from the repo root).
+*
+*  It doesn't use Raylib, only stb_image from its sources to read the png, and the data of Raylib's
+*  default font, which bi_fontgen.cpp copies from its rtext.c into bi_default_font.h. Build it natively
+*  with bat/build_export.bat, which generates that header first.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "external/stb_image.h"
+
+#include "bi_base.h"
+#include "bi_math.h"
+#include "bi_game.h"
+#include "bi_threads.h"
+#include "bi_replay.h"
+#include "bi_particles.h"
+#include "bi_render.h"
+#include "bi_draw.h"
+#include "bi_soft_render.h"
+#include "bi_default_font.h" // Generated, see bi_fontgen.cpp
+
+#define EXPORT_WIDTH 800 // The game's window
+#define EXPORT_HEIGHT 450
+#define EXPORT_KEYFRAME_TICKS 60 // Replay frames between keyframes
+#define EXPORT_CHUNK_FRAMES 12 // Video frames per job
+
+#define EXPORT_FRAME_SIZE (EXPORT_WIDTH*EXPORT_HEIGHT*3/2) // Y4M 4:2:0
+
+
+//
+// Drawing
+//
+// The match is drawn by bi_draw.h, like in the game. The rotate buttons are the game's too, without
+// the mouse over them.
+//
+
+void DrawExportFrame(render_buffer *rb, game_state *game, hud_powerups *hud, particle_system *particles, f64 time){
+    ResetRenderBuffer(rb);
+    match_view view = {};
+    view.winDim = V2(EXPORT_WIDTH, EXPORT_HEIGHT);
+    view.viewPos = (view.winDim - game->viewDim)/2;
+    view.time = time;
+    view.hud = hud;
+    view.particles = particles;
+    view.draggingShapeIndex = -1;
+    DrawMatch(rb, game, &view);
+
+    rb->layer = RenderLayer_Gui;
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        v2 slotPos = SlotPos(game, view.viewPos, view.winDim, i);
+        v2 buttonDim = V2(34.f);
+        f32 m = 7.f;
+        RenderButton(rb, slotPos + V2(SLOT_DIM + m, (SLOT_DIM - buttonDim.y)/2), buttonDim, "", V4_Grey(.25f), 2, 0);
+        RenderButton(rb, V2(slotPos.x - m - buttonDim.x, slotPos.y + (SLOT_DIM - buttonDim.y)/2), buttonDim, "", V4_Grey(.25f), 3, 0);
+    }
+
+    if (game->gameEnded){
+        DrawMatchResult(rb, game, view.winDim);
+    }
+}
+
+
+//
+// Exporter
+//
+
+struct exporter;
+struct export_job{
+    exporter *e;
+    s32 firstFrame;
+    s32 numFrames;
+    soft_renderer renderer;
+    render_buffer renderBuffer;
+    hud_powerups hud;
+    particle_system particles;
+    game_state game;
+    u8 *frames; // numFrames Y4M frames
+};
+
+struct exporter{
+    replay rep;
+    s32 fps;
+    game_state *keyframes; // The game before replay frame i*EXPORT_KEYFRAME_TICKS
+    s32 numKeyframes;
+    s32 *frameTicks; // For each video frame, the replay frames played by then.
+    s32 numVideoFrames;
+
+    soft_image texture;
+    soft_font font;
+    thread_pool pool;
+    export_job *jobs; // 2 batches of batchSize: one is written while the other one is drawn.
+    s32 batchSize;
+};
+
+// Full range BT.601 (what C420jpeg means), with the chroma of each 2x2 block averaged.
+void ConvertFrameToYUV(soft_image *image, u8 *out){
+    s32 w = image->width;
+    s32 h = image->height;
+    u8 *yPlane = out;
+    u8 *uPlane = yPlane + w*h;
+    u8 *vPlane = uPlane + (w/2)*(h/2);
+    for(s32 y = 0; y < h; y++){
+        u32 *row = image->pixels + y*w;
+        for(s32 x = 0; x < w; x++){
+            u32 c = row[x];
+            s32 cr = c & 0xFF, cg = (c >> 8) & 0xFF, cb = (c >> 16) & 0xFF;
+            yPlane[y*w + x] = (u8)((77*cr + 150*cg + 29*cb + 128) >> 8);
+        }
+    }
+    for(s32 y = 0; y < h/2; y++){
+        u32 *row0 = image->pixels + (2*y)*w;
+        u32 *row1 = row0 + w;
+        for(s32 x = 0; x < w/2; x++){
+            u32 c[4] = {row0[2*x], row0[2*x + 1], row1[2*x], row1[2*x + 1]};
+            s32 cr = 0, cg = 0, cb = 0;
+            for(s32 i = 0; i < 4; i++){
+                cr += c[i] & 0xFF;
+                cg += (c[i] >> 8) & 0xFF;
+                cb += (c[i] >> 16) & 0xFF;
+            }
+            // Sums of 4, so the shift is 10 instead of 8.
+            uPlane[y*(w/2) + x] = (u8)ClampS32((-43*cr - 85*cg + 128*cb + (128 << 10) + 512) >> 10, 0, 255);
+            vPlane[y*(w/2) + x] = (u8)ClampS32((128*cr - 107*cg - 21*cb + (128 << 10) + 512) >> 10, 0, 255);
+        }
+    }
+}
+
+// Plays the replay from a keyframe before the chunk up to each of its frames, and draws them.
+//
+// The particles are updated with the replay frames, and each burst's random numbers are seeded with its
+// tick, so they come out the same in every job. The job starts early enough for the ones that are still
+// alive at its first frame to be there.
+void RunExportJob(void *data){
+    export_job *job = (export_job *)data;
+    exporter *e = job->e;
+    s32 firstTick = e->frameTicks[job->firstFrame];
+    s32 tick = (firstTick/EXPORT_KEYFRAME_TICKS)*EXPORT_KEYFRAME_TICKS;
+    f32 timeBefore = 0;
+    for(s32 t = tick; t < firstTick; t++){
+        timeBefore += e->rep.frames[t].dt;
+    }
+    while(tick > 0 && timeBefore < MAX_PARTICLE_LIFETIME){
+        tick -= EXPORT_KEYFRAME_TICKS;
+        for(s32 t = tick; t < tick + EXPORT_KEYFRAME_TICKS; t++){
+            timeBefore += e->rep.frames[t].dt;
+        }
+    }
+    job->game = e->keyframes[tick/EXPORT_KEYFRAME_TICKS];
+    ZeroStruct(&job->hud); // The powerups start sorted by time left, the game's order can differ until one changes.
+    ClearParticles(&job->particles);
+    for(s32 i = 0; i < job->numFrames; i++){
+        s32 frameIndex = job->firstFrame + i;
+        for(; tick < e->frameTicks[frameIndex]; tick++){
+            replay_frame *frame = &e->rep.frames[tick];
+            UpdateGame(&job->game, &frame->input, frame->dt);
+            for(s32 j = 0; j < job->game.numEvents; j++){
+                PcgRandomSeed(tick, j, &job->particles.rng);
+                EmitGameEventParticles(&job->particles, &job->game.events[j]);
+            }
+            job->game.numEvents = 0;
+            UpdateParticles(&job->particles, frame->dt);
+        }
+        UpdateHudPowerups(&job->hud, &job->game);
+        DrawExportFrame(&job->renderBuffer, &job->game, &job->hud, &job->particles, frameIndex/(f64)e->fps);
+        SoftDrawRenderCommands(&job->renderer, &job->renderBuffer);
+        SoftRenderFlush(&job->renderer);
+        ConvertFrameToYUV(&job->renderer.target, job->frames + (size_t)i*EXPORT_FRAME_SIZE);
+    }
+}
+
+int main(int argc, char **argv){
+    if (argc < 2 || argv[1][0] == '-'){
+        fprintf(stderr, "Usage: bi_export <replay file> [-o PATH] [-fps N] [-hold S] [-threads N] [-texture PATH]\n");
+        return 1;
+    }
+    char *replayPath = argv[1];
+    char *outPath = 0;
+    char *texturePath = "resources/main.png";
+    f32 holdSeconds = 3.f;
+    s32 numThreads = -1;
+
+    static exporter e = {};
+    e.fps = 60;
+    for(s32 i = 2; i + 1 < argc; i += 2){
+        char *option = argv[i];
+        char *value = argv[i + 1];
+        if (!strcmp(option, "-o")){
+            outPath = value;
+        }else if (!strcmp(option, "-fps")){
+            e.fps = ClampS32(atoi(value), 1, 240);
+        }else if (!strcmp(option, "-hold")){
+            holdSeconds = Max(0.f, (f32)atof(value));
+        }else if (!strcmp(option, "-threads")){
+            numThreads = atoi(value);
+        }else if (!strcmp(option, "-texture")){
+            texturePath = value;
+        }else{
+            fprintf(stderr, "Unknown option %s\n", option);
+            return 1;
+        }
+    }
+
+    if (!LoadReplay(&e.rep, replayPath)){
+        fprintf(stderr, "Couldn't read the replay %s\n", replayPath);
+        return 1;
+    }
+    s32 numComponents;
+    e.texture.pixels = (u32 *)stbi_load(texturePath, &e.texture.width, &e.texture.height, &numComponents, 4);
+    if (!e.texture.pixels){
+        fprintf(stderr, "Couldn't read %s, the sprites will be missing.\n", texturePath);
+    }
+    InitSoftDefaultFont(&e.font, globalDefaultFontData, globalDefaultFontWidths);
+    InitThreadPool(&e.pool, numThreads);
+    u64 startTime = GetMicroseconds();
+
+    // First pass: keyframes, and which replay frames each video frame shows.
+    s32 numTicks = e.rep.header.numFrames;
+    e.numKeyframes = numTicks/EXPORT_KEYFRAME_TICKS + 1;
+    e.keyframes = (game_state *)malloc(e.numKeyframes*sizeof(game_state));
+    f64 matchTime = 0;
+    for(s32 i = 0; i < numTicks; i++){
+        matchTime += e.rep.frames[i].dt;
+    }
+    e.numVideoFrames = (s32)(matchTime*e.fps) + 1 + (s32)(holdSeconds*e.fps);
+    e.frameTicks = (s32 *)malloc(e.numVideoFrames*sizeof(s32));
+    if (!e.keyframes || !e.frameTicks){
+        fprintf(stderr, "Not enough memory.\n");
+        return 1;
+    }
+    {
+        static game_state game;
+        InitGame(&game, &e.rep.header.config, e.rep.header.seed);
+        f64 time = 0;
+        s32 videoFrame = 0;
+        for(s32 tick = 0; tick <= numTicks; tick++){
+            if (tick % EXPORT_KEYFRAME_TICKS == 0){
+                e.keyframes[tick/EXPORT_KEYFRAME_TICKS] = game;
+            }
+            // Video frames before the end of this replay frame show the game as it was before it.
+            f64 nextTime = (tick < numTicks ? time + e.rep.frames[tick].dt : 1e30);
+            for(; videoFrame < e.numVideoFrames && videoFrame/(f64)e.fps < nextTime - 1e-6; videoFrame++){
+                e.frameTicks[videoFrame] = tick;
+            }
+            if (tick < numTicks){
+                UpdateGame(&game, &e.rep.frames[tick].input, e.rep.frames[tick].dt);
+                game.numEvents = 0;
+                time = nextTime;
+            }
+        }
+        if (game.stats.boardHash != e.rep.header.endBoardHash){
+            fprintf(stderr, "Warning: the match played differently than when it was recorded (a build with different math?)\n");
+        }
+    }
+
+    e.batchSize = MinS32(MAX_THREAD_JOBS, e.pool.numThreads + 1);
+    e.jobs = (export_job *)calloc(2*e.batchSize, sizeof(export_job));
+    if (!e.jobs){
+        fprintf(stderr, "Not enough memory.\n");
+        return 1;
+    }
+    for(s32 i = 0; i < 2*e.batchSize; i++){
+        export_job *job = &e.jobs[i];
+        job->e = &e;
+        job->frames = (u8 *)malloc((size_t)EXPORT_CHUNK_FRAMES*EXPORT_FRAME_SIZE);
+        if (!job->frames || !InitRenderBuffer(&job->renderBuffer) || !InitParticleSystem(&job->particles) || !InitSoftRenderer(&job->renderer, EXPORT_WIDTH, EXPORT_HEIGHT, (e.texture.pixels ? &e.texture : 0), &e.font)){
+            fprintf(stderr, "Not enough memory.\n");
+            return 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if (outPath){
+        out = fopen(outPath, "wb");
+        if (!out){
+            fprintf(stderr, "Couldn't write %s\n", outPath);
+            return 1;
+        }
+    }else{
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+    fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", EXPORT_WIDTH, EXPORT_HEIGHT, e.fps);
+
+    // Batches of chunks. While the workers draw a batch, this thread writes the one before, then helps.
+    s32 nextFrame = 0;
+    s32 numWriting = 0; // Jobs of the other batch waiting to be written
+    export_job *writing = e.jobs + e.batchSize;
+    export_job *drawing = e.jobs;
+    b32 writeFailed = false;
+    while(numWriting || nextFrame < e.numVideoFrames){
+        s32 numDrawing = 0;
+        for(; numDrawing < e.batchSize && nextFrame < e.numVideoFrames; numDrawing++){
+            export_job *job = &drawing[numDrawing];
+            job->firstFrame = nextFrame;
+            job->numFrames = MinS32(EXPORT_CHUNK_FRAMES, e.numVideoFrames - nextFrame);
+            nextFrame += job->numFrames;
+            AddThreadJob(&e.pool, RunExportJob, job);
+        }
+        for(s32 i = 0; i < numWriting && !writeFailed; i++){
+            for(s32 j = 0; j < writing[i].numFrames && !writeFailed; j++){
+                fputs("FRAME\n", out);
+                writeFailed = (fwrite(writing[i].frames + (size_t)j*EXPORT_FRAME_SIZE, EXPORT_FRAME_SIZE, 1, out) != 1);
+            }
+        }
+        WaitForThreadJobs(&e.pool);
+        if (writeFailed){
+            fprintf(stderr, "Couldn't write the video.\n");
+            return 1;
+        }
+        SWAP(writing, drawing);
+        numWriting = numDrawing;
+    }
+    if (out != stdout){
+        fclose(out);
+    }else{
+        fflush(out);
+    }
+
+    f64 seconds = (GetMicroseconds() - startTime)/1000000.0;
+    fprintf(stderr, "%d frames (%.0fs of video) in %.1fs with %d threads, %.1fx real time.\n", e.numVideoFrames,
+            e.numVideoFrames/(f64)e.fps, seconds, e.pool.numThreads + 1, e.numVideoFrames/(f64)e.fps/Max(.001, seconds));
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+*  Font header generator, run by bat/build_export.bat before building the exporter. It copies the data
+*  of Raylib's default font out of Raylib's rtext.c, so the software renderer (bi_soft_render.h) draws
+*  the same text as the game: the bits of the 128x128 atlas (defaultFontData) and the width of each
+*  glyph (charsWidth), from LoadFontDefault(). The header also gets rtext.c's notice, with its zlib
+*  license.
+*
+*  Usage: bi_fontgen <rtext.c> <output header>
+*
+*  It fails (exit code 1) if it doesn't find both arrays with the expected sizes, so a Raylib that
+*  changed them stops the build instead of making videos with the wrong text.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bi_base.h"
+
+#define FONT_DATA_WORDS 512 // 128x128 bits
+#define FONT_NUM_GLYPHS 224 // From 32
+
+// Reads the numbers in the initializer of the array 'name' in 'source'. False unless it has exactly
+// 'count'.
+b32 ParseSourceArray(char *source, char *name, u32 *values, s32 count){
+    char *it = strstr(source, name);
+    if (!it)
+        return false;
+    it = strchr(it, '{');
+    if (!it)
+        return false;
+    for(s32 i = 0; i < count; i++){
+        while(*it && *it != '}' && (*it < '0' || *it > '9'))
+            it++;
+        if (*it < '0' || *it > '9')
+            return false;
+        values[i] = (u32)strtoul(it, &it, 0);
+    }
+    while(*it && *it != '}' && (*it < '0' || *it > '9'))
+        it++;
+    return (*it == '}');
+}
+
+int main(int argc, char **argv){
+    if (argc != 3){
+        fprintf(stderr, "Usage: bi_fontgen <rtext.c> <output header>\n");
+        return 1;
+    }
+    char *sourcePath = argv[1];
+    char *outPath = argv[2];
+
+    FILE *file = fopen(sourcePath, "rb");
+    if (!file){
+        fprintf(stderr, "Couldn't read %s\n", sourcePath);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *source = (char *)malloc(size + 1);
+    if (!source || size <= 0 || fread(source, size, 1, file) != 1){
+        fprintf(stderr, "Couldn't read %s\n", sourcePath);
+        return 1;
+    }
+    fclose(file);
+    source[size] = 0;
+
+    static u32 data[FONT_DATA_WORDS];
+    static u32 widths[FONT_NUM_GLYPHS];
+    if (!ParseSourceArray(source, "defaultFontData[", data, FONT_DATA_WORDS) ||
+        !ParseSourceArray(source, "charsWidth[", widths, FONT_NUM_GLYPHS)){
+        fprintf(stderr, "%s doesn't have Raylib's default font as expected (defaultFontData[%d], charsWidth[%d]).\n",
+                sourcePath, FONT_DATA_WORDS, FONT_NUM_GLYPHS);
+        return 1;
+    }
+    // The notice is the comment the file starts with.
+    char *noticeEnd = (!strncmp(source, "/*", 2) ? strstr(source, "*/") : 0);
+    if (!noticeEnd){
+        fprintf(stderr, "%s doesn't start with Raylib's notice.\n", sourcePath);
+        return 1;
+    }
+
+    FILE *out = fopen(outPath, "wb");
+    if (!out){
+        fprintf(stderr, "Couldn't write %s\n", outPath);
+        return 1;
+    }
+    fprintf(out, "// Raylib's default font, generated by bi_fontgen.cpp from rtext.c. Don't edit it.\n");
+    fprintf(out, "// The data is Raylib's, under this notice:\n\n");
+    fwrite(source, noticeEnd + 2 - source, 1, out);
+    fprintf(out, "\n\n#ifndef BI_DEFAULT_FONT_H\n#define BI_DEFAULT_FONT_H\n\n");
+    fprintf(out, "static unsigned int globalDefaultFontData[%d] = {", FONT_DATA_WORDS);
+    for(s32 i = 0; i < FONT_DATA_WORDS; i++){
+        fprintf(out, "%s0x%08x,", (i % 8 ? " " : "\n    "), data[i]);
+    }
+    fprintf(out, "\n};\n\nstatic unsigned char globalDefaultFontWidths[%d] = {", FONT_NUM_GLYPHS);
+    for(s32 i = 0; i < FONT_NUM_GLYPHS; i++){
+        fprintf(out, "%s%u,", (i % 32 ? " " : "\n    "), widths[i]);
+    }
+    fprintf(out, "\n};\n\n#endif\n");
+    if (fclose(out) != 0){
+        fprintf(stderr, "Couldn't write %s\n", outPath);
+        return 1;
+    }
+    free(source);
+    return 0;
+}
@@ -0,0 +1,1689 @@
+//
+// Contains the match simulation: the board, balls, drops, shapes and powerups, and the rules
+// that advance them. It doesn't depend on Raylib, so it can also run headless (bots, tools).
+// Include it after bi_base.h and bi_math.h.
+//
+
+#ifndef BI_GAME_H
+#define BI_GAME_H
+
+enum special_brick_type : u8{
+    SpecialBrick_None = 0,
+    SpecialBrick_Powerup,
+    SpecialBrick_BadPowerup,
+    SpecialBrick_Arrow,
+    SpecialBrick_Spawner,
+};
+#define TILE_DRAW_MARGIN 3.f
+#define SPECIAL_BRICK_DESTROY_TIME 60.f // Seconds until a momentary special brick becomes a normal brick.
+#define SPECIAL_BRICK_FADEOUT_TIME 15.f
+#define SPAWNER_PERIOD 5.f // Seconds between spawner brick growths.
+struct tile_state{
+    b32 occupied;
+    special_brick_type specialType;
+    f32 specialTypeTimer; // in seconds
+    f32 specialAlpha; // Fade-in used to avoid unfairly placing a bad powerup right in front of the ball.
+    v4 color;
+};
+
+#define DEFAULT_BALL_RADIUS 6.f
+#define DEFAULT_BALL_SPEED 5.f
+enum ball_flags{
+    BallFlags_OnPaddle = 0x1, // Ball stuck on the paddle, waiting for player to press space.
+    BallFlags_StuckShootRandomly = 0x2, // If set, stuck ball should start in a random direction.
+    BallFlags_InRandomizer = 0x4, // Used to only count the randomizer collision once.
+};
+struct ball_state{
+    v2 pos;
+    v2 speed; // (pixels per frame)
+    s32 flags;
+    f32 positionOnPaddle; // [-1, 1] Only used when on paddle.
+    f32 r; // radius.
+};
+
+struct brick_shape{
+    // Each u8 represents a row, with each bit representing a position in that row.
+    // The first subscript is 0 for occupied brick and 1 for "special".
+    // E.g. ((rows[0][2] >> (7 - 3)) & 0x1) Evaluates to 1 if there is a solid brick at x=3, y=2.
+    //      ((rows[1][2] >> (7 - 3)) & 0x1) Evaluates to 1 if that brick is a special brick (type dictated by specialType).
+    u8 rows[2][8];
+    special_brick_type specialType;
+    v4 color;
+};
+struct brick_shape_slot{
+    brick_shape shape;
+    b32 occupied;
+    v2s shapeDim; // In tiles
+};
+
+enum drop_type{
+    // Good
+    Drop_Life,
+    Drop_ExtraBall,
+    Drop_BigPaddle,
+    Drop_Magnet,
+    Drop_BigBalls,
+    Drop_Barrier,
+    Drop_TwoExtraBalls,
+
+    // Bad
+    Drop_FastBalls,
+    Drop_SlowBalls,
+    Drop_SmallPaddle,
+    Drop_ReverseControls,
+    Drop_SlipperyControls,
+    Drop_Randomizer,
+};
+#define FIRST_GOOD_DROP Drop_Life
+#define LAST_GOOD_DROP Drop_TwoExtraBalls
+#define FIRST_BAD_DROP Drop_FastBalls
+#define LAST_BAD_DROP Drop_Randomizer
+#define DROP_RADIUS 15.f
+
+#define DEFAULT_POWERUP_TIME 25.f
+#define POWERUP_TIME_BIG_PADDLE        DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_MAGNET            30.f
+#define POWERUP_TIME_BIG_BALLS         30.f
+#define POWERUP_TIME_BARRIER           DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_FAST_BALLS        DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_SLOW_BALLS        DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_SMALL_PADDLE      DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_REVERSE_CONTROLS  DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_SLIPPERY_CONTROLS DEFAULT_POWERUP_TIME
+#define POWERUP_TIME_RANDOMIZER        30.f
+
+#define PADDLE_WIDTH_SMALL 50
+#define PADDLE_WIDTH_NORMAL 90
+#define PADDLE_WIDTH_BIG 130
+
+struct drop_state{
+    v2 pos;
+    drop_type type;
+    f32 ySpeed;
+};
+
+#define MAX_GAME_SPEED 2.f
+
+#define DEFAULT_SAME_COLOR_COMBO_MAX 4
+#define DEFAULT_SPAWN_SHAPE_TIME 8.f
+#define DEFAULT_DO_SPEED_UP false
+#define DEFAULT_INITIAL_PADDLE_LIFES 3
+#define DEFAULT_SPECIAL_BRICK_CHANCE .5f
+
+#define TILE_COLOR_RED    V4(1.f, .2f, .2f)
+#define TILE_COLOR_ORANGE V4(1.f, .5f, .1f)
+#define TILE_COLOR_YELLOW V4(.92f, .85f, .06f)
+#define TILE_COLOR_GREEN  V4(.25f, .85f, .1f)
+#define TILE_COLOR_BLUE   V4(.4f, .3f, 1.f)
+#define TILE_COLOR_PURPLE V4(.8f, .4f, 1.f)
+
+#define DEFAULT_GRID_DIM V2S(12, 12)
+#define DEFAULT_TILE_DIM V2(37, 19)
+#define MAX_GRID_DIM_X 20
+#define MAX_GRID_DIM_Y 20
+
+// Headless code steps the game at this fixed rate. (The game itself still uses the frame's dt.)
+#define GAME_TICK_DT (1.f/60.f)
+
+// Things configurable in the options menu. They're copied into the game when it starts.
+struct game_config{
+    f32 spawnShapeTime; // Seconds
+    b32 doSpeedUp;
+    s32 sameColorComboMax;
+    s32 initialPaddleLifes;
+    f32 specialBrickChance;
+};
+
+// What both players want to do during a tick.
+struct game_input{
+    // Paddle
+    b32 right;
+    b32 left;
+    b32 rightPressed; // Only true the tick the key goes down.
+    b32 leftPressed;
+    b32 launch;
+
+    // Bricks
+    s32 rotateSlot[2]; // Quarter turns to apply to each available slot (positive is clockwise). Applied before placing.
+    b32 placeShape;
+    s32 placeSlotIndex;
+    v2s placeTilePos; // Top-left tile of the shape.
+};
+
+// Things that happened inside the simulation that the outside may want to react to (sounds, effects).
+enum game_event_type{
+    GameEvent_BallHit, // Wall or barrier
+    GameEvent_PaddleLaunch,
+    GameEvent_PaddleHit,
+    GameEvent_BrickBreak, // value: combo sound index. color: the brick's
+    GameEvent_ArrowBounce,
+    GameEvent_Randomizer,
+    GameEvent_SpawnerDrop,
+    GameEvent_ShapePlaced,
+    GameEvent_LifeLost,
+    GameEvent_PaddleWon,
+    GameEvent_BricksWon,
+    GameEvent_ComboDone, // A same color combo finished (after its last BrickBreak). color: the bricks'
+};
+struct game_event{
+    game_event_type type;
+    v2 pos;
+    s32 value;
+    v4 color;
+};
+
+#define NUM_COMBO_SOUNDS 5
+
+// Summaries of the tiles kept up to date on every tile write (see UpdateTileStats()), so the AI and the
+// event-driven stepping can look things up instead of scanning the board.
+struct board_stats{
+    u32 rowBits[MAX_GRID_DIM_Y]; // Bit x is set if tile (x, y) is occupied.
+    u32 columnBits[MAX_GRID_DIM_X]; // Bit y is set if tile (x, y) is occupied.
+    u32 specialColumnBits[MAX_GRID_DIM_X]; // Same, for occupied tiles with a special type.
+    u8 freeNeighbors[MAX_GRID_DIM_X*MAX_GRID_DIM_Y]; // How many of the 4 adjacent tiles are empty. Below the grid counts as empty, the sides and the top as full.
+
+    // Zobrist hash of the bricks: the XOR of a random key for each occupied tile and its special type.
+    // Two games with the same bricks have the same hash, so it also works as a checksum to catch desyncs.
+    u64 boardHash;
+    u8 tileKinds[MAX_GRID_DIM_X*MAX_GRID_DIM_Y]; // What's hashed for each tile: 0 if empty, otherwise 1 + special type.
+};
+
+struct game_state{
+    game_config config;
+    pcg_random_state random;
+
+    v2s gridDim;
+    v2 tileDim;
+    v2 viewDim;
+    f32 bottomY; // Balls and drops are lost below this.
+    tile_state tiles[MAX_GRID_DIM_X*MAX_GRID_DIM_Y];
+    board_stats stats;
+
+    f32 randomizerY;
+    f32 barrierTopY;
+    f32 barrierHeight;
+
+    v2 paddleDim;
+    f32 gameTime;
+    f32 gameSpeed;
+    f32 speedUpMessageTimer; // 0 for inactive. Non-zero shows "Speed up!" message.
+    f32 speedUpMessageTime;
+
+    v2 paddlePos; // Center position
+    f32 paddleXSpeed; // in pixels per frame (16.66ms frame)
+    s32 paddleLastInputDir;
+
+    ball_state balls[10];
+    s32 numBalls;
+    s32 paddleLifes;
+
+    drop_state drops[20];
+    s32 numDrops;
+
+    brick_shape_slot availableSlots[2];
+    brick_shape_slot nextSlots[2];
+    f32 spawnShapeTimer; // Seconds
+
+    b32 gameEnded;
+    b32 paddleWon; // (when gameEnded)  true: attacker won;  false: defender won
+
+    // Powerups
+    f32 powerupCountdownBigPaddle;
+    f32 powerupCountdownMagnet;
+    f32 powerupCountdownBigBalls;
+    f32 powerupCountdownBarrier;
+    // Bad Powerups
+    f32 powerupCountdownFastBalls;
+    f32 powerupCountdownSlowBalls;
+    f32 powerupCountdownSmallPaddle;
+    f32 powerupCountdownReverseControls;
+    f32 powerupCountdownSlipperyControls;
+    f32 powerupCountdownRandomizer;
+
+    s32 sameColorCombo;
+    v4 sameColorComboLastColor;
+
+    // Filled by UpdateGame(). Whoever steps the game reads and clears them (extra events are dropped when full).
+    game_event events[32];
+    s32 numEvents;
+};
+
+static brick_shape globalShapeCatalog[] = {
+    {{{0xF0}}, SpecialBrick_None, TILE_COLOR_YELLOW},       // Line:     @@@@
+    {{{0xC0, 0xC0}}, SpecialBrick_None, TILE_COLOR_BLUE},   // Square:   @@ / @@
+    {{{0xC0, 0x60}}, SpecialBrick_None, TILE_COLOR_GREEN},  // Stairs:   @@ /  @@
+    {{{0x40, 0xE0}}, SpecialBrick_None, TILE_COLOR_ORANGE}, // Triangle:  @ / @@@
+    {{{0xF0, 0x10}}, SpecialBrick_None, TILE_COLOR_PURPLE}, // L:        @@@@ /    @
+    {{{0xC0}}, SpecialBrick_None, TILE_COLOR_RED},          // 2 Blocks: @@
+    {{{0x80}}, SpecialBrick_None, TILE_COLOR_YELLOW},       // 1 Block:  @
+};
+
+
+void PushGameEvent(game_state *game, game_event_type type, v2 pos, s32 value = 0, v4 color = {}){
+    if (game->numEvents < ArrayCount(game->events)){
+        game_event *event = &game->events[game->numEvents++];
+        event->type = type;
+        event->pos = pos;
+        event->value = value;
+        event->color = color;
+    }
+}
+
+// Fraction of the powerup's time that's left, 0 if it's not active.
+f32 PowerupTimeFraction(game_state *game, drop_type type){
+    f32 result = 0;
+    switch(type){
+        case Drop_BigPaddle:        { result = game->powerupCountdownBigPaddle/POWERUP_TIME_BIG_PADDLE; } break;
+        case Drop_Magnet:           { result = game->powerupCountdownMagnet/POWERUP_TIME_MAGNET; } break;
+        case Drop_BigBalls:         { result = game->powerupCountdownBigBalls/POWERUP_TIME_BIG_BALLS; } break;
+        case Drop_Barrier:          { result = game->powerupCountdownBarrier/POWERUP_TIME_BARRIER; } break;
+        case Drop_FastBalls:        { result = game->powerupCountdownFastBalls/POWERUP_TIME_FAST_BALLS; } break;
+        case Drop_SlowBalls:        { result = game->powerupCountdownSlowBalls/POWERUP_TIME_SLOW_BALLS; } break;
+        case Drop_SmallPaddle:      { result = game->powerupCountdownSmallPaddle/POWERUP_TIME_SMALL_PADDLE; } break;
+        case Drop_ReverseControls:  { result = game->powerupCountdownReverseControls/POWERUP_TIME_REVERSE_CONTROLS; } break;
+        case Drop_SlipperyControls: { result = game->powerupCountdownSlipperyControls/POWERUP_TIME_SLIPPERY_CONTROLS; } break;
+        case Drop_Randomizer:       { result = game->powerupCountdownRandomizer/POWERUP_TIME_RANDOMIZER; } break;
+        default: break;
+    }
+    return result;
+}
+
+//
+// Board stats
+//
+
+// The random key for a tile kind (see board_stats::tileKinds) at a tile index. Empty tiles don't have one.
+inline u64 ZobristKey(s32 tileIndex, s32 kind){
+    u64 result = (kind ? SimpleHash64(((u64)tileIndex << 8) | (u64)kind) : 0);
+    return result;
+}
+
+// Call it after changing the occupied flag or the special type of a tile.
+void UpdateTileStats(game_state *game, s32 x, s32 y){
+    board_stats *stats = &game->stats;
+    s32 index = y*game->gridDim.x + x;
+    tile_state *tile = &game->tiles[index];
+    b32 wasOccupied = (stats->rowBits[y] >> x) & 1;
+    b32 occupied = (tile->occupied != 0);
+    b32 special = (occupied && tile->specialType != SpecialBrick_None);
+    SetOrUnsetFlag(stats->rowBits[y], 1u << x, occupied);
+    SetOrUnsetFlag(stats->columnBits[x], 1u << y, occupied);
+    SetOrUnsetFlag(stats->specialColumnBits[x], 1u << y, special);
+    u8 kind = (occupied ? 1 + tile->specialType : 0);
+    stats->boardHash ^= ZobristKey(index, stats->tileKinds[index]) ^ ZobristKey(index, kind);
+    stats->tileKinds[index] = kind;
+    if (occupied != wasOccupied){
+        v2s offsets[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for(s32 i = 0; i < ArrayCount(offsets); i++){
+            v2s n = V2S(x, y) + offsets[i];
+            if (n.x >= 0 && n.y >= 0 && n.x < game->gridDim.x && n.y < game->gridDim.y){
+                stats->freeNeighbors[n.y*game->gridDim.x + n.x] += (occupied ? -1 : 1);
+            }
+        }
+    }
+}
+
+// Rebuilds the stats from the tiles.
+void InitTileStats(game_state *game){
+    ZeroStruct(&game->stats);
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            game->stats.freeNeighbors[y*game->gridDim.x + x] = (x > 0) + (x < game->gridDim.x - 1) + (y > 0) + 1; // (Below is always free: either empty or out of the grid.)
+        }
+    }
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            UpdateTileStats(game, x, y);
+        }
+    }
+}
+
+// Lowest occupied row of the column, or -1 if it's empty.
+inline s32 LowestOccupiedRow(game_state *game, s32 x){
+    u32 bits = game->stats.columnBits[x];
+    s32 result = (bits ? 31 - __builtin_clz(bits) : -1);
+    return result;
+}
+
+#define MIN_PADDLE_BOUNCE_ANGLE (.3f*PI/2.f)
+// Direction a ball leaves the paddle with when it hits it at 'relativeX' from its center.
+v2 PaddleBounceDir(game_state *game, f32 relativeX){
+    f32 t = Clamp(relativeX/(game->paddleDim.x/2), -1.f, 1.f);
+    t = Lerp(t, -1.f + Map01ToArcSin(.5f + t*.5f)*2.f, .4f); // Gives less angles to the center and more to the edges.
+    v2 result = V2LengthDir(1.f, Lerp(PI + MIN_PADDLE_BOUNCE_ANGLE, 2*PI - MIN_PADDLE_BOUNCE_ANGLE, .5f + t*.5f));
+    return result;
+}
+v2 BallPaddleBounceDir(game_state *game, ball_state *ball){
+    v2 result = PaddleBounceDir(game, ball->pos.x - game->paddlePos.x);
+    return result;
+}
+
+f32 BallRadius(game_state *game){
+    f32 result = DEFAULT_BALL_RADIUS;
+    if (game->powerupCountdownBigBalls){
+        result *= 2.f;
+    }
+    return result;
+}
+f32 BallSpeed(game_state *game){
+    f32 result = DEFAULT_BALL_SPEED;
+    if (game->powerupCountdownFastBalls > game->powerupCountdownSlowBalls){
+        result *= 1.5f;
+    }else if (game->powerupCountdownSlowBalls > game->powerupCountdownFastBalls){
+        result *= .66f;
+    }
+    return result;
+}
+
+
+void FlipShapeSlot(brick_shape_slot *slot, b32 flipX, b32 flipY, b32 swapXY){
+    auto shape = &slot->shape;
+
+    // Flip horizontally
+    if (flipX){
+        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
+            for(s32 j = 0; j < ArrayCount(shape->rows[i]); j++){
+                u8 bits = shape->rows[i][j];
+                shape->rows[i][j] = ((bits >> 7) & 0x01) |
+                                    ((bits >> 5) & 0x02) |
+                                    ((bits >> 3) & 0x04) |
+                                    ((bits >> 1) & 0x08) |
+                                    ((bits << 1) & 0x10) |
+                                    ((bits << 3) & 0x20) |
+                                    ((bits << 5) & 0x40) |
+                                    ((bits << 7) & 0x80);
+            }
+        }
+    }
+    // Flip vertically
+    if (flipY){
+        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
+            for(s32 j = 0; j < ArrayCount(shape->rows[i])/2; j++){
+                SWAP(shape->rows[i][j], shape->rows[i][ArrayCount(shape->rows[i]) - 1 - j]);
+            }
+        }
+    }
+    // Rotate (Swap x and y)
+    if (swapXY){
+        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
+            Assert(ArrayCount(shape->rows[i]) == 8);
+            for(s32 y = 0; y < 8; y++){
+                for(s32 x = y + 1; x < 8; x++){
+                    u8 bitNE = (shape->rows[i][y] >> (7 - x)) & 0x1;
+                    u8 bitSW = (shape->rows[i][x] >> (7 - y)) & 0x1;
+                    SetOrUnsetFlag(shape->rows[i][y], 1 << (7 - x), bitSW);
+                    SetOrUnsetFlag(shape->rows[i][x], 1 << (7 - y), bitNE);
+                }
+            }
+        }
+    }
+
+    // Move to top-left
+    v2s offset = {0};
+    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
+        if (shape->rows[0][y])
+            break;
+        offset.y++;
+    }
+    offset.x = 8;
+    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
+        for(s32 x = 0; x < offset.x; x++){
+            if (shape->rows[0][y] & (0x1 << (7 - x))){
+                offset.x = x;
+                break;
+            }
+        }
+    }
+    Assert(offset.x < 8 && offset.y < 8);
+    for(s32 i = 0; i < ArrayCount(shape->rows); i++){
+        for(s32 y = 0; y < ArrayCount(shape->rows[i]); y++){
+            s32 ySrc = y + offset.y;
+            shape->rows[i][y] = (ySrc < 8 ? (shape->rows[i][ySrc] << offset.x) : 0);
+        }
+    }
+
+    // Get dim
+    slot->shapeDim = V2S(0);
+    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
+        if (shape->rows[0][y]){
+            slot->shapeDim.y = y + 1;
+            for(s32 x = slot->shapeDim.x; x < 8; x++){
+                if (shape->rows[0][y] & (1 << (7 - x)))
+                    slot->shapeDim.x = x + 1;
+            }
+        }
+    }
+}
+void FillShapeSlot(game_state *game, brick_shape_slot *slot){
+    slot->occupied = true;
+    // Choose random shape
+    slot->shape = globalShapeCatalog[RandomS32(ArrayCount(globalShapeCatalog) - 1)];
+
+    FlipShapeSlot(slot, RandomU32(1), RandomU32(1), RandomU32(1));
+
+    // Place powerup
+    if (RandomChance(game->config.specialBrickChance)){
+        s32 numBricks = 0;
+        for(s32 y = 0; y < slot->shapeDim.y; y++){
+            for(s32 x = 0; x < slot->shapeDim.x; x++){
+                numBricks += (s32)((slot->shape.rows[0][y] >> (7 - x)) & 0x1);
+            }
+        }
+        if (numBricks){
+            // Decide special
+            s32 numSpecial = 1;
+            if (RandomChance(.25f)){
+                slot->shape.specialType = SpecialBrick_Arrow;
+                numSpecial = RandomRangeS32(2, 3);
+            }else if (RandomChance(.15f)){
+                slot->shape.specialType = SpecialBrick_Spawner;
+            }else{
+                slot->shape.specialType = (RandomS32(1) ? SpecialBrick_Powerup : SpecialBrick_BadPowerup);
+            }
+            s32 numPlaced = 0;
+            while(numPlaced < numSpecial && numPlaced < numBricks){
+                s32 chosenBrick = RandomS32(numBricks - numPlaced - 1);
+                for(s32 y = 0; y < slot->shapeDim.y; y++){
+                    for(s32 x = 0; x < slot->shapeDim.x; x++){
+                        if (slot->shape.rows[0][y] & (1 << (7 - x)) && !(slot->shape.rows[1][y] & (1 << (7 - x)))){
+                            if (chosenBrick == 0){
+                                SetFlag(slot->shape.rows[1][y], 1 << (7 - x));
+                                numPlaced++;
+                                goto LABEL_SpecialLoopEnd;
+                            }
+                            chosenBrick--;
+                        }
+                    }
+                }
+            LABEL_SpecialLoopEnd:
+                u8 apparentlyWeNeedThisToMakeTheLabelOrSomething = 69;
+            }
+        }
+    }
+}
+void RotateShape90Degrees(brick_shape_slot *slot, b32 clockwise){
+    // The idea here is that combining the 3 easy operations we can do to the bits
+    // (flip x, flip y, and swap x by y) we can accomplish a 90 degree CW and CCW rotations.
+    // For 90 degree CCW we'll first flip the X and then swap X by Y.
+    // For 90 degree CW we'll first flip the Y and then swap X by Y.
+
+    if (clockwise){
+        FlipShapeSlot(slot, 0, 1, 1);
+    }else{
+        FlipShapeSlot(slot, 1, 0, 1);
+    }
+}
+
+// Returns true if the shape fits in the grid at that position without overlapping any brick.
+b32 CanPlaceShape(game_state *game, brick_shape_slot *slot, v2s tilePos0){
+    v2s tilePos1 = tilePos0 + slot->shapeDim - V2S(1);
+    if (tilePos0.x < 0 || tilePos0.y < 0 || tilePos1.x >= game->gridDim.x || tilePos1.y >= game->gridDim.y)
+        return false;
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        for(s32 x = 0; x < slot->shapeDim.x; x++){
+            if (slot->shape.rows[0][y] & (1 << (7 - x))){
+                v2s tilePos = tilePos0 + V2S(x, y);
+                if (game->tiles[tilePos.y*game->gridDim.x + tilePos.x].occupied){
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void PlaceShape(game_state *game, brick_shape_slot *slot, v2s tilePos0){
+    slot->occupied = false;
+    for(s32 y = 0; y < slot->shapeDim.y; y++){
+        for(s32 x = 0; x < slot->shapeDim.x; x++){
+            if (slot->shape.rows[0][y] & (1 << (7 - x))){
+                v2s tilePos = tilePos0 + V2S(x, y);
+                tile_state *dest = &game->tiles[tilePos.y*game->gridDim.x + tilePos.x];
+                ZeroStruct(dest);
+                dest->occupied = true;
+                dest->color = slot->shape.color;
+                if (slot->shape.rows[1][y] & (1 << (7 - x))){
+                    dest->specialType = slot->shape.specialType;
+                    if (dest->specialType != SpecialBrick_BadPowerup)
+                        dest->specialAlpha = 1.f;
+                }
+                UpdateTileStats(game, tilePos.x, tilePos.y);
+            }
+        }
+    }
+    PushGameEvent(game, GameEvent_ShapePlaced, Hadamard(V2(tilePos0) + V2(slot->shapeDim)/2, game->tileDim));
+}
+
+
+drop_state *CreateDrop(game_state *game, v2 pos, drop_type type){
+    drop_state *result = 0;
+    if (game->numDrops < ArrayCount(game->drops)){
+        result = &game->drops[game->numDrops];
+        game->numDrops++;
+
+        ZeroStruct(result);
+        result->pos = pos;
+        result->type = type;
+        if (type >= FIRST_GOOD_DROP && type <= LAST_GOOD_DROP){
+            result->ySpeed = 2.f + RandomBilateral(.3f);
+        }else{
+            result->ySpeed = 1.5f + RandomBilateral(.2f);
+        }
+    }
+    return result;
+}
+
+void InitGame(game_state *game, game_config *config, u64 seed){
+    ZeroStruct(game);
+    game->config = *config;
+    PcgRandomSeed(seed, SimpleHash((u32)seed) | ((u64)SimpleHash((u32)(seed >> 32)) << 32), &game->random);
+    SwapRandomState(&game->random);
+
+    game->gridDim = DEFAULT_GRID_DIM;
+    game->tileDim = DEFAULT_TILE_DIM;
+    game->viewDim = V2(game->tileDim.x*game->gridDim.x, 440);
+    game->bottomY = 450; // Bottom of the window.
+    Assert(game->gridDim.x <= MAX_GRID_DIM_X && game->gridDim.y <= MAX_GRID_DIM_Y);
+
+    v4 colors[] = { TILE_COLOR_RED, TILE_COLOR_ORANGE, TILE_COLOR_YELLOW, TILE_COLOR_GREEN, TILE_COLOR_BLUE, TILE_COLOR_PURPLE };
+    for(s32 y = 0; y < ArrayCount(colors); y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+            tile->color = colors[y];
+            tile->occupied = true;
+        }
+    }
+    InitTileStats(game);
+    game->gameSpeed = 1.f;
+    game->speedUpMessageTime = 2.f;
+
+    game->paddleDim = V2(PADDLE_WIDTH_NORMAL, 10);
+    game->paddlePos = V2(game->viewDim.x/2, game->viewDim.y - 30);
+    game->paddleLifes = game->config.initialPaddleLifes;
+
+    game->randomizerY = game->paddlePos.y*.6f;
+    game->barrierTopY = game->paddlePos.y + 16.f;
+    game->barrierHeight = 8.f;
+
+    game->numBalls = 1;
+    game->balls[0].flags = BallFlags_OnPaddle | BallFlags_StuckShootRandomly;
+    game->balls[0].r = DEFAULT_BALL_RADIUS;
+
+    for(s32 i = 0; i < ArrayCount(game->nextSlots); i++){
+        FillShapeSlot(game, &game->nextSlots[i]);
+    }
+
+    SwapRandomState(&game->random);
+}
+
+// Also used to skip ticks, so it must not use randomness nor touch anything but the paddle.
+void UpdatePaddleMovement(game_state *game, game_input *input, f32 dtMul){
+    f32 maxSpeed = (game->powerupCountdownSlipperyControls ? 10.f : 7.f); // in pix/frame
+    b32 keyRight = input->right;
+    b32 keyLeft = input->left;
+    b32 keyRightPressed = input->rightPressed;
+    b32 keyLeftPressed = input->leftPressed;
+    if (game->powerupCountdownReverseControls){
+        SWAP(keyRight, keyLeft);
+        SWAP(keyRightPressed, keyLeftPressed);
+    }
+
+    if (!game->paddleLastInputDir)
+        game->paddleLastInputDir = 1;
+
+    if (!keyRight && !keyLeft){
+        // Decel
+        if (game->powerupCountdownSlipperyControls){
+            game->paddleXSpeed = Lerp(MoveTowards(game->paddleXSpeed, 0, .01f*dtMul*game->gameSpeed), 0, .02f*dtMul*game->gameSpeed);
+        }else{
+            game->paddleXSpeed = Lerp(MoveTowards(game->paddleXSpeed, 0, 1.f*dtMul*game->gameSpeed), 0, .3f*dtMul*game->gameSpeed);
+        }
+    }else{
+        if (keyRight && keyLeft){
+            if (keyRightPressed){
+                game->paddleLastInputDir = 1;
+            }else if (keyLeftPressed){
+                game->paddleLastInputDir = -1;
+            }
+        }else if (keyRight){
+            game->paddleLastInputDir = 1;
+        }else{
+            game->paddleLastInputDir = -1;
+        }
+        f32 target = maxSpeed*game->paddleLastInputDir;
+        if (game->powerupCountdownSlipperyControls){
+            f32 spd = LerpClamp(.025f, .5f, game->paddleXSpeed/target);
+            game->paddleXSpeed = Lerp(MoveTowards(game->paddleXSpeed, target, spd*dtMul*game->gameSpeed), target, .03f*dtMul*game->gameSpeed);
+        }else{
+            game->paddleXSpeed = Lerp(MoveTowards(game->paddleXSpeed, target, .05f*dtMul*game->gameSpeed), target, .1f*dtMul*game->gameSpeed);
+        }
+    }
+
+    f32 paddleXMin = game->paddleDim.x/2;
+    f32 paddleXMax = game->viewDim.x - game->paddleDim.x/2;
+    game->paddlePos.x = Clamp(game->paddlePos.x + game->paddleXSpeed*dtMul*game->gameSpeed, paddleXMin, paddleXMax);
+    if (game->paddlePos.x == paddleXMin){
+        if (game->paddleXSpeed < 0){
+            if (game->powerupCountdownSlipperyControls){
+                game->paddleXSpeed *= -.5f;
+            }else{
+                game->paddleXSpeed = 0;
+            }
+        }
+    }else if (game->paddlePos.x == paddleXMax){
+        if (game->paddleXSpeed > 0){
+            if (game->powerupCountdownSlipperyControls){
+                game->paddleXSpeed *= -.5f;
+            }else{
+                game->paddleXSpeed = 0;
+            }
+        }
+    }
+}
+
+void UpdatePaddleDim(game_state *game){
+    if (game->powerupCountdownSmallPaddle > game->powerupCountdownBigPaddle){
+        game->paddleDim.x = PADDLE_WIDTH_SMALL;
+    }else if (game->powerupCountdownBigPaddle > game->powerupCountdownSmallPaddle){
+        game->paddleDim.x = PADDLE_WIDTH_BIG;
+    }else{
+        game->paddleDim.x = PADDLE_WIDTH_NORMAL;
+    }
+}
+
+void StickBallToPaddle(game_state *game, ball_state *b){
+    b->pos = game->paddlePos + V2(b->positionOnPaddle*game->paddleDim.x/2, -game->paddleDim.y/2 - b->r);
+    b->pos.x = Clamp(b->pos.x, b->r, game->viewDim.x - b->r);
+}
+
+//
+// Advances the game one tick of 'dt' seconds.
+//
+void UpdateGame(game_state *game, game_input *input, f32 dt){
+    if (game->gameEnded)
+        return;
+    SwapRandomState(&game->random);
+
+    // dtMul is used in places we originally assumed a frame was always 1/60 seconds.
+    f32 dtMul = dt*60.f;
+    f32 gameTimePrev = game->gameTime;
+    game->gameTime += dt;
+
+    // Speed up game speed every minute.
+    if (game->config.doSpeedUp){
+        f32 gameSpeedPrev = game->gameSpeed;
+        game->gameSpeed = Min(MAX_GAME_SPEED, 1.f + .1f*Floor(game->gameTime/60));
+        if (game->gameSpeed != gameSpeedPrev){
+            game->speedUpMessageTimer += dt;
+        }else if (game->speedUpMessageTimer){
+            game->speedUpMessageTimer += dt;
+            if (game->speedUpMessageTimer > game->speedUpMessageTime)
+                game->speedUpMessageTimer = 0;
+        }
+    }
+
+    // Reduce powerup timers
+    game->powerupCountdownBigPaddle        = Max(0, game->powerupCountdownBigPaddle        - dt*game->gameSpeed);
+    game->powerupCountdownMagnet           = Max(0, game->powerupCountdownMagnet           - dt*game->gameSpeed);
+    game->powerupCountdownBigBalls         = Max(0, game->powerupCountdownBigBalls         - dt*game->gameSpeed);
+    game->powerupCountdownBarrier          = Max(0, game->powerupCountdownBarrier          - dt*game->gameSpeed);
+    game->powerupCountdownFastBalls        = Max(0, game->powerupCountdownFastBalls        - dt*game->gameSpeed);
+    game->powerupCountdownSlowBalls        = Max(0, game->powerupCountdownSlowBalls        - dt*game->gameSpeed);
+    game->powerupCountdownSmallPaddle      = Max(0, game->powerupCountdownSmallPaddle      - dt*game->gameSpeed);
+    game->powerupCountdownReverseControls  = Max(0, game->powerupCountdownReverseControls  - dt*game->gameSpeed);
+    game->powerupCountdownSlipperyControls = Max(0, game->powerupCountdownSlipperyControls - dt*game->gameSpeed);
+    game->powerupCountdownRandomizer       = Max(0, game->powerupCountdownRandomizer       - dt*game->gameSpeed);
+
+    UpdatePaddleDim(game);
+
+    // Rotate and place shapes
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        if (game->availableSlots[i].occupied){
+            for(s32 r = input->rotateSlot[i]; r > 0; r--)
+                RotateShape90Degrees(&game->availableSlots[i], true);
+            for(s32 r = input->rotateSlot[i]; r < 0; r++)
+                RotateShape90Degrees(&game->availableSlots[i], false);
+        }
+    }
+    if (input->placeShape){
+        AssertRange(0, input->placeSlotIndex, ArrayCount(game->availableSlots) - 1);
+        brick_shape_slot *slot = &game->availableSlots[input->placeSlotIndex];
+        if (slot->occupied && CanPlaceShape(game, slot, input->placeTilePos)){
+            PlaceShape(game, slot, input->placeTilePos);
+        }
+    }
+
+    // Update available slots
+    game->spawnShapeTimer = Min(game->config.spawnShapeTime, game->spawnShapeTimer + dt*game->gameSpeed);
+    if (game->spawnShapeTimer == game->config.spawnShapeTime){
+        brick_shape_slot *firstFreeSlot = 0;
+        for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+            if (!game->availableSlots[i].occupied){
+                firstFreeSlot = &game->availableSlots[i];
+                break;
+            }
+        }
+        if (firstFreeSlot){
+            game->spawnShapeTimer = 0;
+            *firstFreeSlot = game->nextSlots[0];
+            for(s32 i = 0; i < ArrayCount(game->nextSlots) - 1; i++){
+                game->nextSlots[i] = game->nextSlots[i + 1];
+            }
+            FillShapeSlot(game, &game->nextSlots[ArrayCount(game->nextSlots) - 1]);
+        }
+    }
+
+    // Paddle Movement
+    UpdatePaddleMovement(game, input, dtMul);
+
+    // Set position of balls on the paddle and shoot them out.
+    for(s32 i = 0; i < game->numBalls; i++){
+        auto b = &game->balls[i];
+        if (b->flags & BallFlags_OnPaddle){
+            StickBallToPaddle(game, b);
+
+            if (input->launch){
+                if (CheckFlag(b->flags, BallFlags_StuckShootRandomly)){
+                    f32 minAngle = (.5f*PI/2.f);
+                    b->speed = V2LengthDir(BallSpeed(game), Lerp(PI + minAngle, 2*PI - minAngle, Random01()));
+                }else{
+                    b->speed = BallPaddleBounceDir(game, b)*BallSpeed(game);
+                }
+                UnsetFlags(b->flags, BallFlags_OnPaddle | BallFlags_StuckShootRandomly);
+                PushGameEvent(game, GameEvent_PaddleLaunch, b->pos);
+            }else{
+                b->speed = V2(0);
+            }
+        }
+    }
+
+    // Update Drops
+    for(s32 i = 0; i < game->numDrops;){
+        game->drops[i].pos.y += game->drops[i].ySpeed*dtMul*game->gameSpeed;
+
+        b32 remove = (game->drops[i].pos.y - DROP_RADIUS > game->bottomY);
+        if (CircleInRectangle(game->drops[i].pos, DROP_RADIUS, game->paddlePos - game->paddleDim/2, game->paddleDim)){
+            remove = true;
+            switch(game->drops[i].type){
+            case Drop_Life: { game->paddleLifes++; } break;
+            case Drop_ExtraBall:
+            case Drop_TwoExtraBalls:
+            {
+                s32 num = (game->drops[i].type == Drop_TwoExtraBalls ? 2 : 1);
+                for(s32 index = 0; index < num; index++){
+                    if (game->numBalls < ArrayCount(game->balls)){
+                        auto newBall = &game->balls[game->numBalls];
+                        ZeroStruct(newBall);
+                        newBall->r = BallRadius(game);
+                        newBall->pos = game->paddlePos + V2(0, -game->paddleDim.y - newBall->r);
+                        f32 originalBallAngle = Random(2*PI);
+                        for(s32 i = 0; i < game->numBalls; i++){
+                            if (!CheckFlag(game->balls[i].flags, BallFlags_OnPaddle)){
+                                newBall->pos = game->balls[i].pos;
+                                originalBallAngle = AngleOf(game->balls[i].speed);
+                                break;
+                            }
+                        }
+                        // Random angle
+                        // Basically we get a random angle except we don't allow it to be too close to the original ball's, because then it's confusing.
+                        // We also don't allow it to be too horizontal.
+                        f32 minAngle = MIN_PADDLE_BOUNCE_ANGLE*.5f;
+                        f32 minAngleDifference = PI*.1f;
+                        f32 angle = NormalizeAngle(originalBallAngle + RandomRange(minAngleDifference, PI - minAngleDifference) + (RandomChance(.5f) ? PI : 0));
+                        if (angle > 0){
+                            angle = ClampAngle(angle, minAngle, PI - minAngle);
+                        }else{
+                            angle = ClampAngle(angle, PI + minAngle, 2*PI - minAngle);
+                        }
+                        newBall->speed = V2LengthDir(BallSpeed(game), angle);
+                        if (newBall->pos.y > game->paddlePos.y - 130) // If it's too low we force it to go upwards to be fair to the player.
+                            newBall->speed.y = -Abs(newBall->speed.y);
+                        game->numBalls++;
+                    }
+                }
+            } break;
+            case Drop_BigPaddle:        { game->powerupCountdownBigPaddle        = POWERUP_TIME_BIG_PADDLE; } break;
+            case Drop_Magnet:           { game->powerupCountdownMagnet           = POWERUP_TIME_MAGNET; } break;
+            case Drop_BigBalls:         { game->powerupCountdownBigBalls         = POWERUP_TIME_BIG_BALLS; } break;
+            case Drop_Barrier:          { game->powerupCountdownBarrier          = POWERUP_TIME_BARRIER; } break;
+            case Drop_FastBalls:        { game->powerupCountdownFastBalls        = POWERUP_TIME_FAST_BALLS; } break;
+            case Drop_SlowBalls:        { game->powerupCountdownSlowBalls        = POWERUP_TIME_SLOW_BALLS; } break;
+            case Drop_SmallPaddle:      { game->powerupCountdownSmallPaddle      = POWERUP_TIME_SMALL_PADDLE; } break;
+            case Drop_ReverseControls:  { game->powerupCountdownReverseControls  = POWERUP_TIME_REVERSE_CONTROLS; } break;
+            case Drop_SlipperyControls: { game->powerupCountdownSlipperyControls = POWERUP_TIME_SLIPPERY_CONTROLS; } break;
+            case Drop_Randomizer:       { game->powerupCountdownRandomizer       = POWERUP_TIME_RANDOMIZER; } break;
+            }
+            if (game->drops[i].type >= FIRST_GOOD_DROP && game->drops[i].type <= LAST_GOOD_DROP){
+                // TODO Powerup Sound
+            }else{
+                // TODO Powerdown Sound
+            }
+        }
+        if (remove){
+            game->numDrops--;
+            if (i < game->numDrops){
+                game->drops[i] = game->drops[game->numDrops]; // Swap by last
+            }
+        }else{
+            i++;
+        }
+    }
+
+    // Update Balls
+    for(s32 i = 0; i < game->numBalls;){
+        auto b = &game->balls[i];
+        v2 prevPos = b->pos;
+        b->pos += b->speed*dtMul*game->gameSpeed;
+        b->r = BallRadius(game);
+        if (b->speed != V2(0)){
+            b->speed = Normalize(b->speed)*BallSpeed(game);
+        }
+        b32 playBallHitSound = false;
+        // Bounce off walls
+        v2 minPos = V2(b->r);
+        v2 maxPos = game->viewDim - V2(b->r);
+        if (b->pos.x < minPos.x){
+            b->pos.x = minPos.x;
+            b->speed.x *= -1;
+            playBallHitSound = true;
+        }else if (b->pos.x > maxPos.x){
+            b->pos.x = maxPos.x;
+            b->speed.x *= -1;
+            playBallHitSound = true;
+        }
+        if (b->pos.y < 0){
+            game->gameEnded = true;
+            game->paddleWon = true;
+            PushGameEvent(game, GameEvent_PaddleWon, b->pos);
+        }
+        // Barrier
+        if (game->powerupCountdownBarrier && CircleInRectangle(b->pos, b->r, V2(0, game->barrierTopY), V2(game->viewDim.x, game->barrierHeight))){
+            b->speed.y = -Abs(b->speed.y);
+            playBallHitSound = true;
+        }
+        // Randomizer
+        if (game->powerupCountdownRandomizer && CircleInRectangle(b->pos, b->r, V2(0, game->randomizerY - 10.f), V2(game->viewDim.x, 20.f))){
+            if (!CheckFlag(b->flags, BallFlags_InRandomizer)){
+                SetFlag(b->flags, BallFlags_InRandomizer);
+                if (b->speed != V2(0)){
+                    f32 angleIncrement = RandomRange(PI*.1f, PI*.18f)*(RandomS32(1) ? -1.f : 1.f);
+                    f32 angle = NormalizeAngle(AngleOf(b->speed) + angleIncrement);
+                    f32 minAngle = MIN_PADDLE_BOUNCE_ANGLE*.5f;
+                    if (angle > 0){
+                        angle = ClampAngle(angle, minAngle, PI - minAngle);
+                    }else{
+                        angle = ClampAngle(angle, PI + minAngle, 2*PI - minAngle);
+                    }
+
+                    b->speed = V2LengthDir(Length(b->speed), angle);
+
+                    if (RandomChance(.4f))
+                        b->speed.y *= -1;
+
+                    PushGameEvent(game, GameEvent_Randomizer, b->pos);
+                }
+            }
+        }else{
+            UnsetFlag(b->flags, BallFlags_InRandomizer);
+        }
+        b32 incrementI = true;
+        if (b->pos.y - b->r > game->bottomY){ // Ball was lost downscreen
+            game->numBalls--;
+            if (game->numBalls == 0){
+                PushGameEvent(game, GameEvent_LifeLost, b->pos);
+                if (game->paddleLifes){
+                    game->paddleLifes--;
+                    game->numBalls++;
+                    // Spawn new ball
+                    ZeroStruct(b);
+                    b->r = DEFAULT_BALL_RADIUS;
+                    SetFlags(b->flags, BallFlags_OnPaddle | BallFlags_StuckShootRandomly);
+                }else{
+                    game->gameEnded = true;
+                    game->paddleWon = false;
+                    PushGameEvent(game, GameEvent_BricksWon, b->pos);
+                }
+            }else{
+                *b = game->balls[game->numBalls]; // Fill the hole in the array with the last element
+            }
+        }else{ // (Ball wasn't removed)
+            // Collide paddle
+            if (b->speed.y > 0 && CircleInRectangle(b->pos, b->r, game->paddlePos - game->paddleDim/2, game->paddleDim)){
+                if (game->powerupCountdownMagnet){
+                    // Stick to paddle.
+                    SetFlag(b->flags, BallFlags_OnPaddle);
+                    b->positionOnPaddle = Clamp((b->pos.x - game->paddlePos.x)/(game->paddleDim.x/2), -1.f, 1.f);
+                    StickBallToPaddle(game, b);
+                    b->speed = V2(0);
+                }else{
+                    // Bounce normally
+                    v2 paddleCornerTopLeft = game->paddlePos + V2(-game->paddleDim.x/2, -game->paddleDim.y/2);
+                    v2 paddleCornerTopRight = game->paddlePos + V2(game->paddleDim.x/2, -game->paddleDim.y/2);
+                    v2 speedN = RotateMinus90Degrees(Normalize(b->speed));
+                    f32 leftProj = Dot(speedN, paddleCornerTopLeft - b->pos);
+                    f32 rightProj = Dot(speedN, paddleCornerTopRight - b->pos);
+                    if (leftProj - b->r < 0 && rightProj + b->r > 0){ // Ball speed line intersects paddle's top edge.
+                        v2 newPos = b->pos;
+                        newPos.y = game->paddlePos.y - game->paddleDim.y/2 - b->r;
+                        if (b->speed.y){
+                            newPos.x = b->pos.x + (newPos.y - b->pos.y)*b->speed.x/b->speed.y;
+                        }
+                        b->pos = b->pos + LimitLengthV2(newPos - b->pos, Length(b->speed*dtMul*game->gameSpeed));
+                        b->pos.x = Clamp(b->pos.x, minPos.x, maxPos.x);
+
+                        b->speed = BallPaddleBounceDir(game, b)*BallSpeed(game);
+                    }
+                    PushGameEvent(game, GameEvent_PaddleHit, b->pos);
+                }
+            }
+
+            // Collide tiles
+            v2s tileMin = {(s32)Clamp((b->pos.x - b->r)/game->tileDim.x, 0, game->gridDim.x - 1),
+                           (s32)Clamp((b->pos.y - b->r)/game->tileDim.y, 0, game->gridDim.y - 1)};
+            v2s tileMax = {(s32)Clamp((b->pos.x + b->r)/game->tileDim.x, 0, game->gridDim.x - 1),
+                           (s32)Clamp((b->pos.y + b->r)/game->tileDim.y, 0, game->gridDim.y - 1)};
+
+            // Get the ball very close to the edge
+            f32 numerator = 1;
+            f32 denominator = 1;
+            v2 p = prevPos;
+            v2s collidedTiles[6];
+            s32 numCollidedTiles = 0;
+            Assert((tileMax.x - tileMin.x)*(tileMax.y - tileMin.y) <= ArrayCount(collidedTiles));
+            f32 m = 0;//3.f;
+            for(s32 j = 0; j < 20; j++){
+                f32 t = numerator/denominator;
+                v2 checkPos = LerpV2(prevPos, b->pos, t);
+                numerator *= 2;
+                denominator *= 2;
+                b32 collided = false;
+                for(s32 y = tileMin.y; y <= tileMax.y; y++){
+                    for(s32 x = tileMin.x; x <= tileMax.x; x++){
+                        if (!game->tiles[y*game->gridDim.x + x].occupied)
+                            continue;
+                        v2 tilePos = {x*game->tileDim.x, y*game->tileDim.y};
+                        if (CircleInRectangle(checkPos, b->r, tilePos + V2(m), game->tileDim - V2(2*m))){
+                            if (!collided){
+                                numCollidedTiles = 0; // Clear collision data from previous iterations
+                                collided = true;
+                            }
+                            collidedTiles[numCollidedTiles] = V2S(x, y);
+                            numCollidedTiles++;
+                        }
+                    }
+                }
+                if (collided){
+                    numerator -= 1;
+                }else{
+                    p = checkPos;
+                    if (numerator == denominator)
+                        break; // No collisions at first iteration.
+                    numerator += 1;
+                }
+            }
+            b->pos = p;
+            if (numCollidedTiles){
+                // Bounce
+
+                // Find closest edge to bounce against.
+                v2 n = Normalize(-b->speed);
+                f32 bestDistance = MAX_F32;
+                for(s32 j = 0; j < numCollidedTiles; j++){
+                    v2 tilePos = Hadamard(V2(collidedTiles[j]), game->tileDim) + V2(m);
+                    v2 brickPos = tilePos + V2(m);
+                    v2 brickDim = game->tileDim - V2(2*m);
+                    v2 dis = {0, 0};
+                    if (b->speed.x > 0 && p.x < brickPos.x){
+                        dis.x = p.x - brickPos.x;
+                    }else if (b->speed.x < 0 && p.x > brickPos.x + brickDim.x){
+                        dis.x = p.x - (brickPos.x + brickDim.x);
+                    }
+                    if (b->speed.y > 0 && p.y < brickPos.y){
+                        dis.y = p.y - brickPos.y;
+                    }else if (b->speed.y < 0 && p.y > brickPos.y + brickDim.y){
+                        dis.y = p.y - (brickPos.y + brickDim.y);
+                    }
+                    f32 length = Length(dis);
+                    if (length < bestDistance){
+                        bestDistance = length;
+
+                        if (Abs(dis.x) > Abs(dis.y)){
+                            n = V2(SignNonZero(dis.x), 0);
+                        }else{
+                            n = V2(0, SignNonZero(dis.y));
+                        }
+                    }
+
+                    b32 startedInside = CircleInRectangle(b->pos, b->r, tilePos + V2(m), game->tileDim - V2(2*m));
+
+                    auto tile = &game->tiles[collidedTiles[j].y*game->gridDim.x + collidedTiles[j].x];
+                    if (tile->specialType == SpecialBrick_Arrow && n != V2(0, -1.f) && !startedInside){
+                        // Bounce arrow brick
+                        if (b->speed.y < 0 && n.x){
+                            b->speed.y *= -1.f;
+                        }
+                        PushGameEvent(game, GameEvent_ArrowBounce, tilePos + game->tileDim/2);
+                    }else{ // Break brick normally
+                        // Drop
+                        if (tile->specialType != SpecialBrick_None && tile->specialAlpha > .5f){
+                            if (game->numDrops < ArrayCount(game->drops)){
+                                game->drops[game->numDrops].pos = tilePos + game->tileDim/2;
+                                if (tile->specialType == SpecialBrick_Spawner){
+                                    drop_type type;
+                                    if (RandomChance(.5f)){
+                                        type = (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP);
+                                    }else{
+                                        type = (drop_type)RandomRangeS32((s32)FIRST_BAD_DROP, (s32)LAST_BAD_DROP);
+                                    }
+                                    PushGameEvent(game, GameEvent_SpawnerDrop, tilePos + game->tileDim/2);
+
+                                    CreateDrop(game, tilePos + game->tileDim/2, type);
+                                }else if (tile->specialType == SpecialBrick_Powerup){
+                                    CreateDrop(game, tilePos + game->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP));
+                                }else if (tile->specialType == SpecialBrick_BadPowerup){
+                                    CreateDrop(game, tilePos + game->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_BAD_DROP, (s32)LAST_BAD_DROP));
+                                }
+                            }
+                        }
+                        s32 soundIndex = 1;
+                        b32 comboDone = false;
+                        if (game->config.sameColorComboMax){ // Combo is enabled
+                            // Combo
+                            if (tile->color == game->sameColorComboLastColor){
+                                game->sameColorCombo++;
+                            }else{
+                                game->sameColorComboLastColor = tile->color;
+                                game->sameColorCombo = 1;
+                            }
+                            // Sound
+                            if (game->config.sameColorComboMax == NUM_COMBO_SOUNDS){
+                                soundIndex = (game->sameColorCombo - 1) % NUM_COMBO_SOUNDS;
+                            }else{
+                                soundIndex = 1 + ((game->sameColorCombo - 1) % game->config.sameColorComboMax);
+                                soundIndex = ClampS32(soundIndex, 0, NUM_COMBO_SOUNDS - 1);
+                            }
+
+                            if (game->sameColorCombo % game->config.sameColorComboMax == 0){
+                                // Finished combo: drop powerup.
+                                CreateDrop(game, tilePos + game->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP));
+                                soundIndex = NUM_COMBO_SOUNDS - 1; // Chord sound
+                                comboDone = true;
+                            }
+                        }
+                        PushGameEvent(game, GameEvent_BrickBreak, tilePos + game->tileDim/2, soundIndex, tile->color);
+                        if (comboDone){
+                            PushGameEvent(game, GameEvent_ComboDone, tilePos + game->tileDim/2, 0, tile->color);
+                        }
+                        ZeroStruct(tile); // (tile->occupied = false;)
+                        UpdateTileStats(game, collidedTiles[j].x, collidedTiles[j].y);
+                    }
+                }
+
+                b->speed = b->speed - 2*Dot(b->speed, n)*n; // Bounce
+            }
+        }
+        if (playBallHitSound){
+            PushGameEvent(game, GameEvent_BallHit, b->pos);
+        }
+
+        if (incrementI)
+            i++;
+    }
+
+    // Update special bricks
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+            if (!tile->occupied || tile->specialType == SpecialBrick_None)
+                continue;
+            if (tile->specialType == SpecialBrick_Spawner){
+                if ((s32)(game->gameTime/SPAWNER_PERIOD) != (s32)(gameTimePrev/SPAWNER_PERIOD)){
+                    // Spawn
+                    s32 emptyCount = 0;
+                    s32 r = 2;
+                    v2s minTile = MaxV2S(V2S(0), V2S(x - r, y - r));
+                    v2s maxTile = MinV2S(game->gridDim - V2S(1), V2S(x + r, y + r));
+                    for(s32 ty = minTile.y; ty <= maxTile.y; ty++){
+                        for(s32 tx = minTile.x; tx <= maxTile.x; tx++){
+                            if (!game->tiles[ty*game->gridDim.x + tx].occupied){
+                                emptyCount++;
+                            }
+                        }
+                    }
+                    if (emptyCount){
+                        s32 chosenTile = RandomS32(emptyCount - 1);
+                        for(s32 ty = minTile.y; ty <= maxTile.y; ty++){
+                            for(s32 tx = minTile.x; tx <= maxTile.x; tx++){
+                                tile_state *emptyTile = &game->tiles[ty*game->gridDim.x + tx];
+                                if (!emptyTile->occupied){
+                                    if (chosenTile == 0){
+                                        ZeroStruct(emptyTile);
+                                        emptyTile->occupied = true;
+                                        emptyTile->color = tile->color;
+                                        UpdateTileStats(game, tx, ty);
+                                    }
+                                    chosenTile--;
+                                }
+                            }
+                        }
+                    }
+                }
+            }else{ // Momentary Special Bricks
+                tile->specialTypeTimer += dt;
+                tile->specialAlpha = Min(1.f, tile->specialAlpha + 1.3f*dt*game->gameSpeed);
+                if (tile->specialTypeTimer >= SPECIAL_BRICK_DESTROY_TIME){
+                    tile->specialType = SpecialBrick_None;
+                    tile->specialTypeTimer = 0;
+                    UpdateTileStats(game, x, y);
+                }
+            }
+        }
+    }
+
+    SwapRandomState(&game->random);
+}
+
+
+//
+// Event-driven stepping (headless fast-forward)
+//
+// Between interactions balls move in straight lines, drops fall at constant speed and timers count
+// down linearly. So instead of running every tick we find how many ticks are guaranteed to be
+// uneventful and jump over them at once. Anything that could change the outcome (walls, bricks, the
+// paddle, barrier, randomizer, powerups running out, shapes spawning, input...) is still resolved by a
+// regular UpdateGame() tick, so the rules are the same. Jumps are integrated in closed form, so
+// positions can differ from ticking by float rounding.
+//
+
+// Ticks until something moving 'speed' per tick covers 'distance'. 0 if it's already there.
+inline f32 TicksToCover(f32 distance, f32 speed){
+    f32 result = MAX_F32;
+    if (distance <= 0){
+        result = 0;
+    }else if (speed > 0){
+        result = distance/speed;
+    }
+    return result;
+}
+// Ticks until a coordinate moving 'speed' per tick gets into [min, max]. 0 if it's inside.
+inline f32 TicksToEnterRange(f32 pos, f32 speed, f32 min, f32 max){
+    f32 result = MAX_F32;
+    if (pos >= min && pos <= max){
+        result = 0;
+    }else if (pos < min && speed > 0){
+        result = (min - pos)/speed;
+    }else if (pos > max && speed < 0){
+        result = (max - pos)/speed;
+    }
+    return result;
+}
+// Ticks until a coordinate moving 'speed' per tick gets out of [min, max].
+inline f32 TicksToExitRange(f32 pos, f32 speed, f32 min, f32 max){
+    f32 result = MAX_F32;
+    if (speed > 0){
+        result = Max(0, (max - pos)/speed);
+    }else if (speed < 0){
+        result = Max(0, (min - pos)/speed);
+    }
+    return result;
+}
+// Ticks until a point moving 'speed' per tick gets into the rectangle [min, max]. 0 if it's inside.
+f32 TicksToEnterRectangle(v2 pos, v2 speed, v2 min, v2 max){
+    f32 tEnter = 0;
+    f32 tExit = MAX_F32;
+    f32 p[2]  = {pos.x, pos.y};
+    f32 s[2]  = {speed.x, speed.y};
+    f32 r0[2] = {min.x, min.y};
+    f32 r1[2] = {max.x, max.y};
+    for(s32 axis = 0; axis < 2; axis++){
+        if (s[axis] == 0){
+            if (p[axis] < r0[axis] || p[axis] > r1[axis])
+                return MAX_F32;
+        }else{
+            f32 t0 = (r0[axis] - p[axis])/s[axis];
+            f32 t1 = (r1[axis] - p[axis])/s[axis];
+            if (t0 > t1)
+                SWAP(t0, t1);
+            tEnter = Max(tEnter, t0);
+            tExit = Min(tExit, t1);
+        }
+    }
+    f32 result = (tEnter <= tExit ? tEnter : MAX_F32);
+    return result;
+}
+
+// Returns how many ticks (of GAME_TICK_DT) can be skipped with SkipGameTicks() before the next one that
+// might do anything other than move things along, assuming 'input' is held. 0 means: run a normal tick.
+s32 GameTicksUntilNextEvent(game_state *game, game_input *input){
+    if (game->gameEnded)
+        return 0;
+    if (input->placeShape || input->rightPressed || input->leftPressed)
+        return 0;
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        if (input->rotateSlot[i] && game->availableSlots[i].occupied)
+            return 0;
+    }
+
+    f32 dt = GAME_TICK_DT;
+    f32 dtMul = dt*60.f;
+    f32 t = MAX_F32; // Ticks until the earliest event
+
+    // Timers
+    f32 powerupCountdowns[] = {game->powerupCountdownBigPaddle, game->powerupCountdownMagnet, game->powerupCountdownBigBalls, game->powerupCountdownBarrier,
+                               game->powerupCountdownFastBalls, game->powerupCountdownSlowBalls, game->powerupCountdownSmallPaddle,
+                               game->powerupCountdownReverseControls, game->powerupCountdownSlipperyControls, game->powerupCountdownRandomizer};
+    for(s32 i = 0; i < ArrayCount(powerupCountdowns); i++){
+        if (powerupCountdowns[i])
+            t = Min(t, TicksToCover(powerupCountdowns[i], dt*game->gameSpeed));
+    }
+    if (game->config.doSpeedUp){
+        if (game->speedUpMessageTimer)
+            return 0;
+        if (game->gameSpeed < MAX_GAME_SPEED)
+            t = Min(t, TicksToCover(60.f*(Floor(game->gameTime/60.f) + 1.f) - game->gameTime, dt));
+    }
+    if (game->spawnShapeTimer < game->config.spawnShapeTime){
+        t = Min(t, TicksToCover(game->config.spawnShapeTime - game->spawnShapeTimer, dt*game->gameSpeed));
+    }else{
+        for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+            if (!game->availableSlots[i].occupied)
+                return 0;
+        }
+    }
+    b32 anySpawner = false;
+    for(s32 x = 0; x < game->gridDim.x; x++){
+        for(u32 bits = game->stats.specialColumnBits[x]; bits; bits &= bits - 1){
+            tile_state *tile = &game->tiles[__builtin_ctz(bits)*game->gridDim.x + x];
+            if (tile->specialType == SpecialBrick_Spawner){
+                anySpawner = true;
+            }else{
+                t = Min(t, TicksToCover(SPECIAL_BRICK_DESTROY_TIME - tile->specialTypeTimer, dt));
+            }
+        }
+    }
+    if (anySpawner){
+        t = Min(t, TicksToCover(SPAWNER_PERIOD*(Floor(game->gameTime/SPAWNER_PERIOD) + 1.f) - game->gameTime, dt));
+    }
+
+    // Drops
+    f32 paddleTop = game->paddlePos.y - game->paddleDim.y/2;
+    f32 paddleBottom = game->paddlePos.y + game->paddleDim.y/2;
+    for(s32 i = 0; i < game->numDrops; i++){
+        drop_state *drop = &game->drops[i];
+        f32 ySpeed = drop->ySpeed*dtMul*game->gameSpeed;
+        t = Min(t, TicksToEnterRange(drop->pos.y, ySpeed, paddleTop - DROP_RADIUS, paddleBottom + DROP_RADIUS));
+        t = Min(t, TicksToCover(game->bottomY + DROP_RADIUS - drop->pos.y, ySpeed));
+    }
+
+    // Balls
+    for(s32 i = 0; i < game->numBalls; i++){
+        ball_state *b = &game->balls[i];
+        if (CheckFlag(b->flags, BallFlags_OnPaddle)){
+            if (input->launch)
+                return 0;
+            continue;
+        }
+        v2 d = b->speed*dtMul*game->gameSpeed;
+        f32 r = b->r;
+
+        t = Min(t, TicksToExitRange(b->pos.x, d.x, r, game->viewDim.x - r)); // Walls
+        t = Min(t, TicksToCover(b->pos.y, -d.y)); // Top of the screen
+        t = Min(t, TicksToCover(game->bottomY + r - b->pos.y, d.y)); // Lost
+        if (d.y > 0){
+            t = Min(t, TicksToEnterRange(b->pos.y, d.y, paddleTop - r, paddleBottom + r));
+        }
+        if (game->powerupCountdownBarrier){
+            t = Min(t, TicksToEnterRange(b->pos.y, d.y, game->barrierTopY - r, game->barrierTopY + game->barrierHeight + r));
+        }
+        f32 randomizerMin = game->randomizerY - 10.f - r;
+        f32 randomizerMax = game->randomizerY + 10.f + r;
+        if (CheckFlag(b->flags, BallFlags_InRandomizer)){
+            t = Min(t, (game->powerupCountdownRandomizer ? TicksToExitRange(b->pos.y, d.y, randomizerMin, randomizerMax) : 0));
+        }else if (game->powerupCountdownRandomizer){
+            t = Min(t, TicksToEnterRange(b->pos.y, d.y, randomizerMin, randomizerMax));
+        }
+
+        // Bricks: only the occupied ones the ball can reach before the earliest event so far, found with
+        // the row bits. (Testing against the brick grown by the radius is a bit conservative at the corners.)
+        v2 end = b->pos + d*Min(t, 60.f*60.f);
+        s32 x0 = MaxS32(0, (s32)Floor((Min(b->pos.x, end.x) - r)/game->tileDim.x));
+        s32 x1 = MinS32(game->gridDim.x - 1, (s32)Floor((Max(b->pos.x, end.x) + r)/game->tileDim.x));
+        s32 y0 = MaxS32(0, (s32)Floor((Min(b->pos.y, end.y) - r)/game->tileDim.y));
+        s32 y1 = MinS32(game->gridDim.y - 1, (s32)Floor((Max(b->pos.y, end.y) + r)/game->tileDim.y));
+        if (x0 <= x1){
+            u32 columnMask = (0xFFFFFFFFu >> (31 - (x1 - x0))) << x0;
+            for(s32 y = y0; y <= y1; y++){
+                for(u32 bits = game->stats.rowBits[y] & columnMask; bits; bits &= bits - 1){
+                    v2 tilePos = {__builtin_ctz(bits)*game->tileDim.x, y*game->tileDim.y};
+                    t = Min(t, TicksToEnterRectangle(b->pos, d, tilePos - V2(r), tilePos + game->tileDim + V2(r)));
+                }
+            }
+        }
+    }
+
+    // Leave one tick of margin, the event itself must happen in a normal tick.
+    s32 result = (s32)Min(t, 60.f*60.f) - 1;
+    result = MaxS32(0, result);
+    return result;
+}
+
+// Advances 'numTicks' ticks (of GAME_TICK_DT) in one go. Only valid up to what GameTicksUntilNextEvent() returned.
+void SkipGameTicks(game_state *game, game_input *input, s32 numTicks){
+    f32 dt = GAME_TICK_DT;
+    f32 dtMul = dt*60.f;
+    f32 elapsed = numTicks*dt;
+
+    game->gameTime += elapsed;
+
+    game->powerupCountdownBigPaddle        = Max(0, game->powerupCountdownBigPaddle        - elapsed*game->gameSpeed);
+    game->powerupCountdownMagnet           = Max(0, game->powerupCountdownMagnet           - elapsed*game->gameSpeed);
+    game->powerupCountdownBigBalls         = Max(0, game->powerupCountdownBigBalls         - elapsed*game->gameSpeed);
+    game->powerupCountdownBarrier          = Max(0, game->powerupCountdownBarrier          - elapsed*game->gameSpeed);
+    game->powerupCountdownFastBalls        = Max(0, game->powerupCountdownFastBalls        - elapsed*game->gameSpeed);
+    game->powerupCountdownSlowBalls        = Max(0, game->powerupCountdownSlowBalls        - elapsed*game->gameSpeed);
+    game->powerupCountdownSmallPaddle      = Max(0, game->powerupCountdownSmallPaddle      - elapsed*game->gameSpeed);
+    game->powerupCountdownReverseControls  = Max(0, game->powerupCountdownReverseControls  - elapsed*game->gameSpeed);
+    game->powerupCountdownSlipperyControls = Max(0, game->powerupCountdownSlipperyControls - elapsed*game->gameSpeed);
+    game->powerupCountdownRandomizer       = Max(0, game->powerupCountdownRandomizer       - elapsed*game->gameSpeed);
+
+    game->spawnShapeTimer = Min(game->config.spawnShapeTime, game->spawnShapeTimer + elapsed*game->gameSpeed);
+
+    // The paddle's acceleration isn't linear, but it's cheap, so we just run it.
+    for(s32 i = 0; i < numTicks; i++){
+        UpdatePaddleMovement(game, input, dtMul);
+    }
+
+    for(s32 i = 0; i < game->numBalls; i++){
+        ball_state *b = &game->balls[i];
+        if (CheckFlag(b->flags, BallFlags_OnPaddle)){
+            StickBallToPaddle(game, b);
+        }else{
+            b->pos += b->speed*(numTicks*dtMul*game->gameSpeed);
+        }
+    }
+    for(s32 i = 0; i < game->numDrops; i++){
+        game->drops[i].pos.y += game->drops[i].ySpeed*(numTicks*dtMul*game->gameSpeed);
+    }
+    for(s32 x = 0; x < game->gridDim.x; x++){
+        for(u32 bits = game->stats.specialColumnBits[x]; bits; bits &= bits - 1){
+            tile_state *tile = &game->tiles[__builtin_ctz(bits)*game->gridDim.x + x];
+            if (tile->specialType != SpecialBrick_Spawner){
+                tile->specialTypeTimer += elapsed;
+                tile->specialAlpha = Min(1.f, tile->specialAlpha + 1.3f*elapsed*game->gameSpeed);
+            }
+        }
+    }
+}
+
+//
+// Ball tracing
+//
+// Follows the path a ball would take with nothing else changing: it bounces off the walls, the
+// barrier and the bricks (bricks that would break are ignored after being hit). It's used for the
+// magnet aim line and by the bots. It doesn't model the randomizer.
+//
+// Bricks are found with a DDA traversal of the grid (Amanatides & Woo, "A Fast Voxel Traversal
+// Algorithm for Ray Tracing"): we walk the cells that the ball's center goes through, in order, and
+// test the ray against the bricks around each cell, grown by the radius ("circle offsetting"). The
+// first hit found before leaving the cell is the closest one, so usually only a few cells are visited.
+//
+
+#define MAX_TRACE_POINTS 16
+enum trace_end{
+    TraceEnd_MaxBounces, // Ran out of bounces.
+    TraceEnd_Top, // Reached y=0 (The paddle wins).
+    TraceEnd_StopY, // Crossed stopY going down.
+};
+struct ball_trace{
+    v2 points[MAX_TRACE_POINTS]; // Start, each bounce and the end.
+    s32 numPoints;
+    trace_end end;
+    v2 endDir; // Direction at the last point.
+    f32 length; // Distance travelled by the center of the ball.
+    s32 numBrickHits;
+};
+
+// Ray (ro + rd*t) against a rectangle with rounded corners (the rectangle grown by r).
+// Returns the t where it enters, or -1 if it doesn't or it starts inside. 'n' gets the normal of
+// the side it enters through (for corners, the axis the ball would bounce on).
+f32 RayRoundedRectangle(v2 ro, v2 rd, v2 rectMin, v2 rectMax, f32 r, v2 *n){
+    // Slab test against the rectangle grown by r.
+    f32 tEnter = -MAX_F32;
+    f32 tExit = MAX_F32;
+    s32 enterAxis = 0;
+    f32 p[2]  = {ro.x, ro.y};
+    f32 d[2]  = {rd.x, rd.y};
+    f32 r0[2] = {rectMin.x - r, rectMin.y - r};
+    f32 r1[2] = {rectMax.x + r, rectMax.y + r};
+    for(s32 axis = 0; axis < 2; axis++){
+        if (d[axis] == 0){
+            if (p[axis] < r0[axis] || p[axis] > r1[axis])
+                return -1.f;
+        }else{
+            f32 t0 = (r0[axis] - p[axis])/d[axis];
+            f32 t1 = (r1[axis] - p[axis])/d[axis];
+            if (t0 > t1)
+                SWAP(t0, t1);
+            if (t0 > tEnter){
+                tEnter = t0;
+                enterAxis = axis;
+            }
+            tExit = Min(tExit, t1);
+        }
+    }
+    if (tEnter > tExit || tExit < 0)
+        return -1.f;
+    b32 startedInside = (tEnter < 0); // Of the grown rectangle. It may still be outside a rounded corner.
+    tEnter = Max(0, tEnter);
+
+    v2 hit = ro + rd*tEnter;
+    v2 corner = {(hit.x < rectMin.x ? rectMin.x : rectMax.x), (hit.y < rectMin.y ? rectMin.y : rectMax.y)};
+    b32 inCornerX = (hit.x < rectMin.x || hit.x > rectMax.x);
+    b32 inCornerY = (hit.y < rectMin.y || hit.y > rectMax.y);
+    if (startedInside && !(inCornerX && inCornerY))
+        return -1.f;
+    if (inCornerX && inCornerY){
+        // We entered the grown rectangle at one of its corners, where it's actually rounded.
+        // The ball either hits the corner circle, or slides past it into one of the sides.
+        v2 oc = ro - corner;
+        f32 b = Dot(oc, rd);
+        f32 a = Dot(rd, rd);
+        f32 c = Dot(oc, oc) - r*r;
+        f32 disc = b*b - a*c;
+        f32 tCircle = MAX_F32;
+        if (disc >= 0){
+            tCircle = (-b - SquareRoot(disc))/a;
+            if (tCircle < tEnter)
+                tCircle = MAX_F32;
+        }
+        // Sides: the rectangle grown only in x, and only in y.
+        f32 tSides = MAX_F32;
+        for(s32 axis = 0; axis < 2; axis++){
+            v2 sideMin = (axis == 0 ? V2(rectMin.x - r, rectMin.y) : V2(rectMin.x, rectMin.y - r));
+            v2 sideMax = (axis == 0 ? V2(rectMax.x + r, rectMax.y) : V2(rectMax.x, rectMax.y + r));
+            f32 t = TicksToEnterRectangle(ro, rd, sideMin, sideMax);
+            if (t < tSides){
+                tSides = t;
+            }
+        }
+        f32 t = Min(tCircle, tSides);
+        if (t == MAX_F32 || t > tExit)
+            return -1.f;
+        tEnter = t;
+        hit = ro + rd*tEnter;
+        v2 dis = hit - corner;
+        if (tCircle <= tSides){
+            enterAxis = (Abs(dis.x) > Abs(dis.y) ? 0 : 1);
+        }else{
+            enterAxis = (hit.x < rectMin.x || hit.x > rectMax.x ? 0 : 1);
+        }
+    }
+    *n = (enterAxis == 0 ? V2(-SignNonZero(rd.x), 0) : V2(0, -SignNonZero(rd.y)));
+    return tEnter;
+}
+
+// Casts a ball of radius r from 'ro' along 'rd' (doesn't need to be normalized; t is in units of rd)
+// up to maxT and returns the t of the first brick it hits, or -1. Bricks in 'ignoreTiles' are skipped.
+f32 RaycastBricks(game_state *game, v2 ro, v2 rd, f32 r, f32 maxT, v2s *hitTile, v2 *hitNormal, s32 *ignoreTiles = 0, s32 numIgnoreTiles = 0){
+    Assert(r <= Min(game->tileDim.x, game->tileDim.y)); // So only the 8 neighbor cells can be touched.
+    f32 result = -1.f;
+
+    // Start where the ray enters the grid (with a border of 1 cell for bricks touched from outside).
+    v2 gridMin = -game->tileDim;
+    v2 gridMax = Hadamard(V2(game->gridDim + V2S(1)), game->tileDim);
+    f32 t = TicksToEnterRectangle(ro, rd, gridMin, gridMax);
+    if (t > maxT)
+        return result;
+
+    v2 p = ro + rd*t;
+    v2s cell = {(s32)Floor(p.x/game->tileDim.x), (s32)Floor(p.y/game->tileDim.y)};
+    cell = MinV2S(MaxV2S(cell, V2S(-1)), game->gridDim);
+    v2s step = {(rd.x > 0 ? 1 : -1), (rd.y > 0 ? 1 : -1)};
+    // t at which we cross the next cell border on each axis, and t it takes to cross a whole cell.
+    v2 tMax = {MAX_F32, MAX_F32};
+    v2 tDelta = {MAX_F32, MAX_F32};
+    if (rd.x){
+        tMax.x = ((cell.x + (step.x > 0 ? 1 : 0))*game->tileDim.x - ro.x)/rd.x;
+        tDelta.x = game->tileDim.x/Abs(rd.x);
+    }
+    if (rd.y){
+        tMax.y = ((cell.y + (step.y > 0 ? 1 : 0))*game->tileDim.y - ro.y)/rd.y;
+        tDelta.y = game->tileDim.y/Abs(rd.y);
+    }
+
+    f32 bestT = MAX_F32;
+    while(true){
+        // Test the bricks around this cell.
+        for(s32 y = MaxS32(0, cell.y - 1); y <= MinS32(game->gridDim.y - 1, cell.y + 1); y++){
+            for(s32 x = MaxS32(0, cell.x - 1); x <= MinS32(game->gridDim.x - 1, cell.x + 1); x++){
+                s32 index = y*game->gridDim.x + x;
+                if (!game->tiles[index].occupied)
+                    continue;
+                b32 ignore = false;
+                for(s32 i = 0; i < numIgnoreTiles; i++){
+                    if (ignoreTiles[i] == index)
+                        ignore = true;
+                }
+                if (ignore)
+                    continue;
+                v2 tilePos = {x*game->tileDim.x, y*game->tileDim.y};
+                v2 n;
+                f32 tileT = RayRoundedRectangle(ro, rd, tilePos, tilePos + game->tileDim, r, &n);
+                if (tileT >= 0 && tileT < bestT){
+                    bestT = tileT;
+                    *hitTile = V2S(x, y);
+                    *hitNormal = n;
+                }
+            }
+        }
+        // Anything hit later would be found from a later cell, and nothing earlier can be.
+        f32 tCellExit = Min(tMax.x, tMax.y);
+        if (bestT <= tCellExit || tCellExit > maxT)
+            break;
+
+        // Step to the next cell.
+        if (tMax.x < tMax.y){
+            cell.x += step.x;
+            tMax.x += tDelta.x;
+        }else{
+            cell.y += step.y;
+            tMax.y += tDelta.y;
+        }
+        if (cell.x < -1 || cell.y < -1 || cell.x > game->gridDim.x || cell.y > game->gridDim.y)
+            break;
+    }
+    if (bestT <= maxT){
+        result = bestT;
+    }
+    return result;
+}
+
+// Traces the path of a ball at 'pos' moving along 'dir' until it reaches the top, crosses stopY going
+// down, or bounces maxBounces times.
+void TraceBall(game_state *game, v2 pos, v2 dir, f32 r, f32 stopY, s32 maxBounces, ball_trace *trace){
+    maxBounces = MinS32(maxBounces, MAX_TRACE_POINTS - 2);
+    trace->numPoints = 0;
+    trace->points[trace->numPoints++] = pos;
+    trace->end = TraceEnd_MaxBounces;
+    trace->length = 0;
+    trace->numBrickHits = 0;
+
+    s32 brokenTiles[MAX_TRACE_POINTS];
+    s32 numBrokenTiles = 0;
+    f32 len = Length(dir);
+    v2 d = (len ? dir/len : V2(0, -1.f));
+    for(s32 bounce = 0; bounce <= maxBounces; bounce++){
+        // Walls, top, barrier and stopY
+        f32 tSeg = MAX_F32;
+        v2 n = {};
+        trace_end segEnd = TraceEnd_MaxBounces;
+        if (d.x < 0){
+            tSeg = (r - pos.x)/d.x;
+            n = V2(1.f, 0);
+        }else if (d.x > 0){
+            tSeg = (game->viewDim.x - r - pos.x)/d.x;
+            n = V2(-1.f, 0);
+        }
+        if (d.y < 0){
+            f32 t = -pos.y/d.y;
+            if (t < tSeg){
+                tSeg = t;
+                segEnd = TraceEnd_Top;
+            }
+        }else if (d.y > 0){
+            f32 t = (stopY - pos.y)/d.y;
+            if (t < tSeg){
+                tSeg = t;
+                segEnd = TraceEnd_StopY;
+            }
+            if (game->powerupCountdownBarrier){
+                t = (game->barrierTopY - r - pos.y)/d.y;
+                if (t >= 0 && t < tSeg){
+                    tSeg = t;
+                    n = V2(0, -1.f);
+                    segEnd = TraceEnd_MaxBounces;
+                }
+            }
+        }
+        tSeg = Max(0, tSeg);
+
+        // Bricks
+        v2s hitTile;
+        v2 hitNormal;
+        f32 tBrick = RaycastBricks(game, pos, d, r, tSeg, &hitTile, &hitNormal, brokenTiles, numBrokenTiles);
+        b32 hitBrick = (tBrick >= 0);
+        if (hitBrick){
+            tSeg = tBrick;
+            n = hitNormal;
+            segEnd = TraceEnd_MaxBounces;
+        }
+
+        pos += d*tSeg;
+        trace->length += tSeg;
+        trace->points[trace->numPoints++] = pos;
+        if (segEnd != TraceEnd_MaxBounces){
+            trace->end = segEnd;
+            break;
+        }
+        if (bounce == maxBounces)
+            break;
+
+        // Bounce
+        d = d - 2*Dot(d, n)*n;
+        if (hitBrick){
+            trace->numBrickHits++;
+            s32 index = hitTile.y*game->gridDim.x + hitTile.x;
+            if (game->tiles[index].specialType == SpecialBrick_Arrow && n != V2(0, -1.f)){
+                if (d.y < 0 && n.x)
+                    d.y *= -1.f;
+            }else if (numBrokenTiles < ArrayCount(brokenTiles)){
+                brokenTiles[numBrokenTiles++] = index;
+            }
+        }
+        if (d.x == 0 && d.y == 0)
+            break;
+    }
+    trace->endDir = d;
+}
+
+#endif
@@ -0,0 +1,520 @@
+/*
+*  Implementation of the C API in bi_gym.h: vectorized environments for training agents.
+*
+*  Built as a shared library, without Raylib (see bat/build_gym.bat). Like bi_main.cpp it's a unity
+*  build: it includes the game and the AI directly.
+*
+*  Each environment owns everything it touches (the game, the opponent AI and the AI's random state), so
+*  a step is just a loop over the environments split into thread jobs, and the results only depend on
+*  the seeds and the actions, not on the threads.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bi_base.h"
+#include "bi_math.h"
+#include "bi_game.h"
+#include "bi_threads.h"
+#include "bi_ai.h"
+#include "bi_gym.h"
+
+struct gym_env{
+    game_state game;
+    paddle_bot paddleBot; // Opponent when the agent plays the bricks
+    placement_cache bricksCache; // Opponent when the agent plays the paddle
+    pcg_random_state aiRandom;
+    u64 seed; // Of the current episode. The next one's comes from it.
+    s32 lastDirection; // Of the paddle action, to know when a key is pressed.
+    b32 lastPlacementFailed;
+};
+
+struct gym_job{
+    bi_gym *gym;
+    s32 firstEnv;
+    s32 endEnv;
+};
+
+struct bi_gym{
+    bi_gym_config config;
+    game_config gameConfig;
+    gym_env *envs;
+    thread_pool pool;
+    gym_job jobs[MAX_THREAD_JOBS];
+    s32 numJobs;
+    bi_gym_observation_buffers bound; // See bi_gym_bind_observations().
+
+    // Arguments of the step being run
+    const s32 *actions;
+    f32 *observations;
+    f32 *rewards;
+    u8 *terminated;
+    u8 *truncated;
+};
+
+void StartGymEpisode(bi_gym *gym, gym_env *env, u64 seed){
+    env->seed = seed;
+    InitGame(&env->game, &gym->gameConfig, seed);
+    InitPaddleBot(&env->paddleBot);
+    InitPlacementCache(&env->bricksCache);
+    PcgRandomSeed(seed, SimpleHash64(seed), &env->aiRandom);
+    env->lastDirection = 0;
+    env->lastPlacementFailed = false;
+}
+
+void WriteGymFeatures(gym_env *env, f32 *out){
+    game_state *game = &env->game;
+    v2 boardDim = game->viewDim;
+    ZeroArrayPtr(out, BI_GYM_NUM_FEATURES);
+    f32 *o = out;
+
+    *o++ = game->paddlePos.x/boardDim.x*2.f - 1.f;
+    *o++ = game->paddleXSpeed/10.f;
+    *o++ = game->paddleDim.x/boardDim.x;
+    *o++ = game->paddleLifes/10.f;
+
+    for(s32 i = 0; i < BI_GYM_MAX_OBSERVED_BALLS; i++){
+        if (i < game->numBalls){
+            ball_state *b = &game->balls[i];
+            o[0] = 1.f;
+            o[1] = b->pos.x/boardDim.x*2.f - 1.f;
+            o[2] = b->pos.y/boardDim.y*2.f - 1.f;
+            o[3] = b->speed.x/10.f;
+            o[4] = b->speed.y/10.f;
+            o[5] = ((b->flags & BallFlags_OnPaddle) ? 1.f : 0);
+        }
+        o += 6;
+    }
+
+    for(s32 x = 0; x < MAX_GRID_DIM_X; x++){
+        if (x < game->gridDim.x){
+            *o = (LowestOccupiedRow(game, x) + 1)/(f32)game->gridDim.y;
+        }
+        o++;
+    }
+
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        brick_shape_slot *slot = &game->availableSlots[i];
+        if (slot->occupied){
+            o[0] = 1.f;
+            o[1] = slot->shapeDim.x/8.f;
+            o[2] = slot->shapeDim.y/8.f;
+            o[3] = slot->shape.specialType/4.f;
+        }
+        o += 4;
+    }
+
+    *o++ = 1.f - game->spawnShapeTimer/game->config.spawnShapeTime;
+    *o++ = game->gameSpeed/MAX_GAME_SPEED;
+    *o++ = (env->lastPlacementFailed ? 1.f : 0);
+    *o++ = game->numDrops/20.f;
+    Assert(o == out + BI_GYM_NUM_FEATURES);
+}
+
+//
+// Bound observations
+//
+
+inline f32 GymPowerupFraction(f32 countdown, f32 fullTime){
+    return Clamp01(countdown/fullTime);
+}
+
+void WriteGymGrid(game_state *game, f32 *out){
+    s32 planeSize = BI_GYM_GRID_WIDTH*BI_GYM_GRID_HEIGHT;
+    ZeroArrayPtr(out, BI_GYM_GRID_CHANNELS*planeSize);
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            f32 *o = out + y*BI_GYM_GRID_WIDTH + x;
+            o[BI_GYM_GRID_INSIDE*planeSize] = 1.f;
+            tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+            if (tile->occupied){
+                o[BI_GYM_GRID_OCCUPIED*planeSize] = 1.f;
+                o[BI_GYM_GRID_RED*planeSize] = tile->color.r;
+                o[BI_GYM_GRID_GREEN*planeSize] = tile->color.g;
+                o[BI_GYM_GRID_BLUE*planeSize] = tile->color.b;
+                if (tile->specialType){
+                    s32 channels[] = {0, BI_GYM_GRID_POWERUP, BI_GYM_GRID_BAD_POWERUP, BI_GYM_GRID_ARROW, BI_GYM_GRID_SPAWNER};
+                    o[channels[tile->specialType]*planeSize] = 1.f;
+                    o[BI_GYM_GRID_SPECIAL_TIME*planeSize] = Clamp01(tile->specialTypeTimer/SPECIAL_BRICK_DESTROY_TIME);
+                }
+            }
+        }
+    }
+}
+
+void WriteGymShapes(game_state *game, f32 *out){
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+        brick_shape_slot *slot = &game->availableSlots[i];
+        for(s32 c = 0; c < BI_GYM_SHAPE_CHANNELS; c++){
+            for(s32 y = 0; y < 8; y++){
+                for(s32 x = 0; x < 8; x++){
+                    *out++ = ((slot->occupied && ((slot->shape.rows[c][y] >> (7 - x)) & 1)) ? 1.f : 0);
+                }
+            }
+        }
+    }
+}
+
+void WriteGymBalls(game_state *game, f32 *out){
+    ZeroArrayPtr(out, BI_GYM_MAX_BALLS*BI_GYM_BALL_SIZE);
+    s32 numBalls = MinS32(game->numBalls, BI_GYM_MAX_BALLS);
+    for(s32 i = 0; i < numBalls; i++){
+        ball_state *b = &game->balls[i];
+        f32 *o = out + i*BI_GYM_BALL_SIZE;
+        o[0] = 1.f;
+        o[1] = b->pos.x/game->viewDim.x;
+        o[2] = b->pos.y/game->viewDim.y;
+        o[3] = b->speed.x/10.f;
+        o[4] = b->speed.y/10.f;
+        o[5] = b->r/10.f;
+        o[6] = ((b->flags & BallFlags_OnPaddle) ? 1.f : 0);
+    }
+}
+
+void WriteGymDrops(game_state *game, f32 *out){
+    ZeroArrayPtr(out, BI_GYM_MAX_DROPS*BI_GYM_DROP_SIZE);
+    s32 numDrops = MinS32(game->numDrops, BI_GYM_MAX_DROPS);
+    for(s32 i = 0; i < numDrops; i++){
+        drop_state *d = &game->drops[i];
+        f32 *o = out + i*BI_GYM_DROP_SIZE;
+        o[0] = 1.f;
+        o[1] = d->pos.x/game->viewDim.x;
+        o[2] = d->pos.y/game->viewDim.y;
+        o[3] = d->ySpeed/10.f;
+        o[4] = d->type/(f32)LAST_BAD_DROP;
+        o[5] = (d->type >= FIRST_BAD_DROP ? 1.f : 0);
+    }
+}
+
+void WriteGymState(gym_env *env, f32 *out){
+    game_state *game = &env->game;
+    ZeroArrayPtr(out, BI_GYM_STATE_SIZE);
+    f32 *o = out;
+    *o++ = game->paddlePos.x/game->viewDim.x;
+    *o++ = game->paddlePos.y/game->viewDim.y;
+    *o++ = game->paddleDim.x/game->viewDim.x;
+    *o++ = game->paddleXSpeed/10.f;
+    *o++ = game->paddleLifes/10.f;
+    *o++ = (f32)game->paddleLastInputDir;
+
+    *o++ = GymPowerupFraction(game->powerupCountdownBigPaddle, POWERUP_TIME_BIG_PADDLE);
+    *o++ = GymPowerupFraction(game->powerupCountdownMagnet, POWERUP_TIME_MAGNET);
+    *o++ = GymPowerupFraction(game->powerupCountdownBigBalls, POWERUP_TIME_BIG_BALLS);
+    *o++ = GymPowerupFraction(game->powerupCountdownBarrier, POWERUP_TIME_BARRIER);
+    *o++ = GymPowerupFraction(game->powerupCountdownFastBalls, POWERUP_TIME_FAST_BALLS);
+    *o++ = GymPowerupFraction(game->powerupCountdownSlowBalls, POWERUP_TIME_SLOW_BALLS);
+    *o++ = GymPowerupFraction(game->powerupCountdownSmallPaddle, POWERUP_TIME_SMALL_PADDLE);
+    *o++ = GymPowerupFraction(game->powerupCountdownReverseControls, POWERUP_TIME_REVERSE_CONTROLS);
+    *o++ = GymPowerupFraction(game->powerupCountdownSlipperyControls, POWERUP_TIME_SLIPPERY_CONTROLS);
+    *o++ = GymPowerupFraction(game->powerupCountdownRandomizer, POWERUP_TIME_RANDOMIZER);
+
+    *o++ = 1.f - game->spawnShapeTimer/game->config.spawnShapeTime;
+    *o++ = game->gameSpeed/MAX_GAME_SPEED;
+    *o++ = game->gameTime/300.f;
+    *o++ = (game->config.sameColorComboMax ? game->sameColorCombo/(f32)game->config.sameColorComboMax : 0);
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++)
+        *o++ = (game->availableSlots[i].occupied ? 1.f : 0);
+    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++)
+        *o++ = (game->availableSlots[i].occupied ? game->availableSlots[i].shape.specialType/4.f : 0);
+
+    *o++ = (env->lastPlacementFailed ? 1.f : 0);
+    Assert(o <= out + BI_GYM_STATE_SIZE);
+}
+
+// Fills the pixels whose centers are inside the rectangle (in board coordinates), or at least the one under its center.
+void FillGymRasterRect(u8 *out, s32 w, s32 h, v2 scale, v2 min, v2 max, u8 value){
+    s32 x0 = (s32)(min.x*scale.x + .5f);
+    s32 y0 = (s32)(min.y*scale.y + .5f);
+    s32 x1 = (s32)(max.x*scale.x + .5f);
+    s32 y1 = (s32)(max.y*scale.y + .5f);
+    if (x1 <= x0){
+        x0 = (s32)((min.x + max.x)*.5f*scale.x);
+        x1 = x0 + 1;
+    }
+    if (y1 <= y0){
+        y0 = (s32)((min.y + max.y)*.5f*scale.y);
+        y1 = y0 + 1;
+    }
+    x0 = ClampS32(x0, 0, w);
+    x1 = ClampS32(x1, 0, w);
+    y0 = ClampS32(y0, 0, h);
+    y1 = ClampS32(y1, 0, h);
+    for(s32 y = y0; y < y1; y++){
+        memset(out + y*w + x0, value, x1 - x0);
+    }
+}
+
+void FillGymRasterCircle(u8 *out, s32 w, s32 h, v2 scale, v2 center, f32 r, u8 value){
+    s32 x0 = ClampS32((s32)((center.x - r)*scale.x), 0, w - 1);
+    s32 x1 = ClampS32((s32)((center.x + r)*scale.x), 0, w - 1);
+    s32 y0 = ClampS32((s32)((center.y - r)*scale.y), 0, h - 1);
+    s32 y1 = ClampS32((s32)((center.y + r)*scale.y), 0, h - 1);
+    for(s32 y = y0; y <= y1; y++){
+        for(s32 x = x0; x <= x1; x++){
+            v2 p = {(x + .5f)/scale.x, (y + .5f)/scale.y};
+            if (LengthSqr(p - center) <= r*r)
+                out[y*w + x] = value;
+        }
+    }
+    s32 cx = (s32)(center.x*scale.x);
+    s32 cy = (s32)(center.y*scale.y);
+    if (cx >= 0 && cx < w && cy >= 0 && cy < h)
+        out[cy*w + cx] = value;
+}
+
+void WriteGymRaster(game_state *game, u8 *out, s32 w, s32 h){
+    memset(out, 0, w*h);
+    v2 scale = {w/game->viewDim.x, h/game->viewDim.y};
+    if (game->powerupCountdownBarrier){
+        FillGymRasterRect(out, w, h, scale, V2(0, game->barrierTopY), V2(game->viewDim.x, game->barrierTopY + game->barrierHeight), 64);
+    }
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+            if (tile->occupied){
+                v2 tilePos = {x*game->tileDim.x, y*game->tileDim.y};
+                FillGymRasterRect(out, w, h, scale, tilePos, tilePos + game->tileDim, (tile->specialType ? 160 : 96));
+            }
+        }
+    }
+    for(s32 i = 0; i < game->numDrops; i++){
+        FillGymRasterCircle(out, w, h, scale, game->drops[i].pos, DROP_RADIUS, 192);
+    }
+    FillGymRasterRect(out, w, h, scale, game->paddlePos - game->paddleDim/2, game->paddlePos + game->paddleDim/2, 224);
+    for(s32 i = 0; i < game->numBalls; i++){
+        FillGymRasterCircle(out, w, h, scale, game->balls[i].pos, game->balls[i].r, 255);
+    }
+}
+
+// Writes the observations of an environment to the bound buffers.
+void WriteGymObservations(bi_gym *gym, s32 envIndex){
+    bi_gym_observation_buffers *b = &gym->bound;
+    gym_env *env = &gym->envs[envIndex];
+    game_state *game = &env->game;
+    if (b->grid)
+        WriteGymGrid(game, b->grid + envIndex*BI_GYM_GRID_CHANNELS*BI_GYM_GRID_HEIGHT*BI_GYM_GRID_WIDTH);
+    if (b->shapes)
+        WriteGymShapes(game, b->shapes + envIndex*ArrayCount(game->availableSlots)*BI_GYM_SHAPE_CHANNELS*8*8);
+    if (b->balls)
+        WriteGymBalls(game, b->balls + envIndex*BI_GYM_MAX_BALLS*BI_GYM_BALL_SIZE);
+    if (b->drops)
+        WriteGymDrops(game, b->drops + envIndex*BI_GYM_MAX_DROPS*BI_GYM_DROP_SIZE);
+    if (b->state)
+        WriteGymState(env, b->state + envIndex*BI_GYM_STATE_SIZE);
+    if (b->raster)
+        WriteGymRaster(game, b->raster + (s64)envIndex*b->rasterWidth*b->rasterHeight, b->rasterWidth, b->rasterHeight);
+}
+
+//
+// Stepping
+//
+
+// Steps one environment, resetting it if the episode ends.
+void StepGymEnv(bi_gym *gym, s32 envIndex){
+    gym_env *env = &gym->envs[envIndex];
+    game_state *game = &env->game;
+    bi_gym_config *config = &gym->config;
+    bi_gym_rewards *r = &config->rewards;
+    const s32 *action = gym->actions + envIndex*BI_GYM_ACTION_SIZE;
+    b32 agentIsPaddle = (config->role == BI_GYM_ROLE_PADDLE);
+
+    f32 reward = 0;
+    b32 placing = false;
+    b32 placed = false;
+    for(s32 tick = 0; tick < config->ticksPerStep && !game->gameEnded;){
+        // The agent's side plays with 'input', the other one with its bot.
+        game_input input = {};
+        if (agentIsPaddle){
+            s32 direction = ClampS32(action[0], -1, 1);
+            input.left = (direction < 0);
+            input.right = (direction > 0);
+            input.leftPressed = (input.left && env->lastDirection >= 0);
+            input.rightPressed = (input.right && env->lastDirection <= 0);
+            input.launch = (action[1] != 0);
+            env->lastDirection = direction;
+        }else if (tick == 0 && action[0] >= 0){
+            placing = true;
+            s32 slotIndex = ClampS32(action[0], 0, ArrayCount(game->availableSlots) - 1);
+            input.rotateSlot[slotIndex] = action[3] & 3;
+            input.placeShape = true;
+            input.placeSlotIndex = slotIndex;
+            input.placeTilePos = V2S(action[1], action[2]);
+        }
+        SwapRandomState(&env->aiRandom);
+        s32 numTicks = StepBotMatch(game, (agentIsPaddle ? 0 : &env->paddleBot), (agentIsPaddle ? &env->bricksCache : 0),
+                                    config->ticksPerStep - tick, &input);
+        SwapRandomState(&env->aiRandom);
+
+        reward += r->perSecond*GAME_TICK_DT*numTicks;
+        for(s32 i = 0; i < game->numEvents; i++){
+            game_event_type type = game->events[i].type;
+            if (type == GameEvent_LifeLost){
+                reward += r->lifeLost;
+            }else if (type == GameEvent_BrickBreak){
+                reward += r->brickBroken;
+            }else if (type == GameEvent_PaddleHit){
+                reward += r->paddleHit;
+            }else if (type == GameEvent_ShapePlaced){
+                reward += r->shapePlaced;
+                if (tick == 0)
+                    placed = true;
+            }
+        }
+        game->numEvents = 0;
+        tick += numTicks;
+    }
+    if (placing){
+        env->lastPlacementFailed = !placed;
+        if (!placed)
+            reward += r->invalidPlacement;
+    }
+
+    b32 isTerminated = game->gameEnded;
+    b32 isTruncated = (!isTerminated && config->maxEpisodeSeconds > 0 && game->gameTime >= config->maxEpisodeSeconds);
+    if (isTerminated){
+        b32 agentWon = (game->paddleWon == agentIsPaddle);
+        reward += (agentWon ? r->win : r->lose);
+    }
+    if (isTerminated || isTruncated){
+        StartGymEpisode(gym, env, SimpleHash64(env->seed));
+    }
+
+    if (gym->observations)
+        WriteGymFeatures(env, gym->observations + envIndex*BI_GYM_NUM_FEATURES);
+    WriteGymObservations(gym, envIndex);
+    if (gym->rewards)
+        gym->rewards[envIndex] = reward;
+    if (gym->terminated)
+        gym->terminated[envIndex] = (u8)isTerminated;
+    if (gym->truncated)
+        gym->truncated[envIndex] = (u8)isTruncated;
+}
+
+void RunGymJob(void *data){
+    gym_job *job = (gym_job *)data;
+    for(s32 i = job->firstEnv; i < job->endEnv; i++){
+        StepGymEnv(job->gym, i);
+    }
+}
+
+//
+// API
+//
+
+extern "C" BI_GYM_API bi_gym_config bi_gym_default_config(int32_t role){
+    bi_gym_config config = {};
+    config.numEnvs = 1;
+    config.role = role;
+    config.numThreads = -1;
+    config.ticksPerStep = 4;
+    config.maxEpisodeSeconds = 300.f;
+    config.spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
+    config.doSpeedUp = DEFAULT_DO_SPEED_UP;
+    config.sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
+    config.initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
+    config.specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
+
+    bi_gym_rewards *r = &config.rewards;
+    r->win = 1.f;
+    r->lose = -1.f;
+    if (role == BI_GYM_ROLE_PADDLE){
+        r->lifeLost = -.3f;
+        r->brickBroken = .01f;
+        r->paddleHit = .02f;
+    }else{
+        r->lifeLost = .3f;
+        r->shapePlaced = .01f;
+        r->invalidPlacement = -.01f;
+        r->perSecond = .002f;
+    }
+    return config;
+}
+
+extern "C" BI_GYM_API bi_gym *bi_gym_create(const bi_gym_config *config){
+    if (config->numEnvs <= 0 || config->ticksPerStep <= 0 ||
+        (config->role != BI_GYM_ROLE_PADDLE && config->role != BI_GYM_ROLE_BRICKS))
+        return 0;
+
+    bi_gym *gym = (bi_gym *)calloc(1, sizeof(bi_gym));
+    if (!gym)
+        return 0;
+    gym->envs = (gym_env *)calloc(config->numEnvs, sizeof(gym_env));
+    if (!gym->envs){
+        free(gym);
+        return 0;
+    }
+    gym->config = *config;
+    gym->gameConfig.spawnShapeTime = config->spawnShapeTime;
+    gym->gameConfig.doSpeedUp = config->doSpeedUp;
+    gym->gameConfig.sameColorComboMax = config->sameColorComboMax;
+    gym->gameConfig.initialPaddleLifes = config->initialPaddleLifes;
+    gym->gameConfig.specialBrickChance = config->specialBrickChance;
+    InitThreadPool(&gym->pool, config->numThreads);
+
+    // A few jobs per thread, so uneven environments even out.
+    s32 numJobs = MinS32(config->numEnvs, MinS32(MAX_THREAD_JOBS, (gym->pool.numThreads + 1)*4));
+    for(s32 i = 0; i < numJobs; i++){
+        gym_job *job = &gym->jobs[i];
+        job->gym = gym;
+        job->firstEnv = (s32)((s64)config->numEnvs*i/numJobs);
+        job->endEnv = (s32)((s64)config->numEnvs*(i + 1)/numJobs);
+    }
+    gym->numJobs = numJobs;
+
+    bi_gym_reset(gym, 0, 0);
+    return gym;
+}
+
+extern "C" BI_GYM_API void bi_gym_destroy(bi_gym *gym){
+    if (gym){
+        ShutdownThreadPool(&gym->pool);
+        free(gym->envs);
+        free(gym);
+    }
+}
+
+extern "C" BI_GYM_API int32_t bi_gym_num_envs(bi_gym *gym){
+    return gym->config.numEnvs;
+}
+
+extern "C" BI_GYM_API void bi_gym_reset(bi_gym *gym, uint64_t seed, float *observations){
+    for(s32 i = 0; i < gym->config.numEnvs; i++){
+        gym_env *env = &gym->envs[i];
+        StartGymEpisode(gym, env, SimpleHash64(seed ^ SimpleHash64(i)));
+        if (observations)
+            WriteGymFeatures(env, observations + i*BI_GYM_NUM_FEATURES);
+        WriteGymObservations(gym, i);
+    }
+}
+
+extern "C" BI_GYM_API int32_t bi_gym_bind_observations(bi_gym *gym, const bi_gym_observation_buffers *buffers){
+    if (!buffers){
+        ZeroStruct(&gym->bound);
+        return 1;
+    }
+    void *pointers[] = {buffers->grid, buffers->shapes, buffers->balls, buffers->drops, buffers->state, buffers->raster};
+    for(s32 i = 0; i < ArrayCount(pointers); i++){
+        if ((uintptr_t)pointers[i] % BI_GYM_BUFFER_ALIGNMENT)
+            return 0;
+    }
+    if (buffers->raster && (buffers->rasterWidth <= 0 || buffers->rasterHeight <= 0 ||
+                            buffers->rasterWidth > 1024 || buffers->rasterHeight > 1024))
+        return 0;
+    gym->bound = *buffers;
+    return 1;
+}
+
+extern "C" BI_GYM_API void bi_gym_step(bi_gym *gym, const int32_t *actions, float *observations, float *rewards,
+                                       uint8_t *terminated, uint8_t *truncated){
+    gym->actions = actions;
+    gym->observations = observations;
+    gym->rewards = rewards;
+    gym->terminated = terminated;
+    gym->truncated = truncated;
+    for(s32 i = 0; i < gym->numJobs; i++){
+        AddThreadJob(&gym->pool, RunGymJob, &gym->jobs[i]);
+    }
+    WaitForThreadJobs(&gym->pool);
+}
@@ -0,0 +1,176 @@
+/*
+*  C API to train agents on Break-In, Gym style: N copies of the game (environments) that are reset and
+*  stepped together, in batch, over a pool of threads. The agent plays one side and the built-in AI
+*  plays the other (the paddle bot, or the bricks AI).
+*
+*  This header is plain C, for the users of the shared library (see bat/build_gym.bat). The
+*  implementation is bi_gym.cpp.
+*
+*  Usage:
+*      bi_gym_config config = bi_gym_default_config(BI_GYM_ROLE_PADDLE);
+*      config.numEnvs = 64;
+*      bi_gym *gym = bi_gym_create(&config);
+*      bi_gym_reset(gym, seed, observations);
+*      while(training){
+*          ... fill actions (numEnvs*BI_GYM_ACTION_SIZE) from observations ...
+*          bi_gym_step(gym, actions, observations, rewards, terminated, truncated);
+*      }
+*      bi_gym_destroy(gym);
+*
+*  Environments that end are reset on their own during bi_gym_step(). Their 'terminated' or
+*  'truncated' is set, and their observation is already the first one of the next episode.
+*
+*  For the full state as dense arrays, bind your own buffers with bi_gym_bind_observations() once.
+*  Every reset and step then writes straight into them, in the layout below. Nothing is allocated or
+*  copied per step.
+*/
+
+#ifndef BI_GYM_H
+#define BI_GYM_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #define BI_GYM_API __declspec(dllexport)
+#else
+    #define BI_GYM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The side the agent plays.
+enum{
+    BI_GYM_ROLE_PADDLE = 0,
+    BI_GYM_ROLE_BRICKS = 1,
+};
+
+// Actions are BI_GYM_ACTION_SIZE int32s per environment:
+//   Paddle: [direction (-1 left, 0 stay, 1 right), launch (0 or 1), unused, unused]
+//   Bricks: [slot (0 or 1, -1 to do nothing), tile x, tile y, clockwise quarter turns (0 to 3)]
+// A bricks action is done on the first tick of the step; the paddle direction is held for all of them.
+#define BI_GYM_ACTION_SIZE 4
+
+// Observations are BI_GYM_NUM_FEATURES floats per environment, roughly in [-1, 1]:
+//   [0, 4)   paddle: x, speed, width, lifes/10
+//   [4, 28)  up to 4 balls: present, x, y, speed x, speed y, on paddle (positions relative to the board)
+//   [28, 48) height of the bricks in each column (0 if empty), for 20 columns
+//   [48, 56) 2 available slots: present, width, height, special type
+//   [56, 60) time until the next shape, game speed, whether the last bricks action failed, falling drops/20
+#define BI_GYM_MAX_OBSERVED_BALLS 4
+#define BI_GYM_NUM_FEATURES 60
+
+// Layout of the bound observation buffers. All of them are float32 except the raster, indexed
+// [env][...] in C order. Positions are relative to the board ([0, 1]) and speeds are in pixels per tick/10.
+//
+// grid   [env][BI_GYM_GRID_CHANNELS][BI_GYM_GRID_HEIGHT][BI_GYM_GRID_WIDTH], one plane per channel:
+#define BI_GYM_GRID_WIDTH 20
+#define BI_GYM_GRID_HEIGHT 20
+enum{
+    BI_GYM_GRID_INSIDE = 0, // 1 for the tiles of the board (the planes are bigger than the default board).
+    BI_GYM_GRID_OCCUPIED,
+    BI_GYM_GRID_RED, // Brick color
+    BI_GYM_GRID_GREEN,
+    BI_GYM_GRID_BLUE,
+    BI_GYM_GRID_POWERUP, // 1 for bricks of each special type
+    BI_GYM_GRID_BAD_POWERUP,
+    BI_GYM_GRID_ARROW,
+    BI_GYM_GRID_SPAWNER,
+    BI_GYM_GRID_SPECIAL_TIME, // Fraction of the special's lifetime that has passed.
+    BI_GYM_GRID_CHANNELS,
+};
+// shapes [env][2 slots][BI_GYM_SHAPE_CHANNELS][8][8], the available shapes: bricks, special bricks.
+#define BI_GYM_SHAPE_CHANNELS 2
+// balls  [env][BI_GYM_MAX_BALLS][BI_GYM_BALL_SIZE]: present, x, y, speed x, speed y, radius/10, on paddle, 0
+#define BI_GYM_MAX_BALLS 10
+#define BI_GYM_BALL_SIZE 8
+// drops  [env][BI_GYM_MAX_DROPS][BI_GYM_DROP_SIZE]: present, x, y, speed y, type/12, bad, 0, 0
+#define BI_GYM_MAX_DROPS 20
+#define BI_GYM_DROP_SIZE 8
+// state  [env][BI_GYM_STATE_SIZE]:
+//   0-5   paddle: x, y, width, speed, lifes/10, last input direction
+//   6-15  powerup time left, as a fraction of its full time: big paddle, magnet, big balls, barrier,
+//         fast balls, slow balls, small paddle, reverse controls, slippery controls, randomizer
+//   16-23 time until the next shape, game speed, game time/300, same color combo/max, slots present (2),
+//         slots special type/4 (2)
+//   24    whether the last bricks action failed
+//   25-31 0
+#define BI_GYM_STATE_SIZE 32
+// raster [env][rasterHeight][rasterWidth] uint8, optional: a low-res picture of the board.
+// 0 background, 64 barrier, 96 bricks, 160 special bricks, 192 drops, 224 paddle, 255 balls.
+//
+// Every buffer must be aligned to BI_GYM_BUFFER_ALIGNMENT bytes. The per-env parts of the float buffers
+// are multiples of it, so threads never write to the same cache line (make rasterWidth*rasterHeight a
+// multiple of it too).
+#define BI_GYM_BUFFER_ALIGNMENT 64
+
+typedef struct bi_gym_observation_buffers{
+    float *grid; // Any of them can be null, to leave them out.
+    float *shapes;
+    float *balls;
+    float *drops;
+    float *state;
+    uint8_t *raster;
+    int32_t rasterWidth;
+    int32_t rasterHeight;
+} bi_gym_observation_buffers;
+
+// Rewards are given for these events, from the agent's point of view (put in the signs that make sense
+// for the role).
+typedef struct bi_gym_rewards{
+    float win;
+    float lose;
+    float lifeLost; // The paddle lost a life.
+    float brickBroken;
+    float paddleHit; // The ball hit the paddle.
+    float shapePlaced;
+    float invalidPlacement; // The bricks action couldn't be done.
+    float perSecond; // For each second played.
+} bi_gym_rewards;
+
+typedef struct bi_gym_config{
+    int32_t numEnvs;
+    int32_t role;
+    int32_t numThreads; // Worker threads. -1: one less than the number of cores.
+    int32_t ticksPerStep; // Game ticks (1/60 s) per step.
+    float maxEpisodeSeconds; // Episodes are truncated after this much game time. 0 for no limit.
+
+    // Game options (like in the options menu)
+    float spawnShapeTime;
+    int32_t doSpeedUp;
+    int32_t sameColorComboMax;
+    int32_t initialPaddleLifes;
+    float specialBrickChance;
+
+    bi_gym_rewards rewards;
+} bi_gym_config;
+
+typedef struct bi_gym bi_gym;
+
+BI_GYM_API bi_gym_config bi_gym_default_config(int32_t role);
+
+// Returns 0 if the config isn't valid or there's not enough memory.
+BI_GYM_API bi_gym *bi_gym_create(const bi_gym_config *config);
+BI_GYM_API void bi_gym_destroy(bi_gym *gym);
+BI_GYM_API int32_t bi_gym_num_envs(bi_gym *gym);
+
+// The buffers must stay valid until they're unbound (with null) or the gym is destroyed. The gym doesn't
+// copy them, and it writes all the environments on every reset and step. Returns 0 (and binds nothing)
+// if a buffer isn't aligned or the raster size is wrong, 1 otherwise.
+BI_GYM_API int32_t bi_gym_bind_observations(bi_gym *gym, const bi_gym_observation_buffers *buffers);
+
+// Starts a new episode in every environment. Environment i uses a seed made from 'seed' and i.
+// 'observations' (numEnvs*BI_GYM_NUM_FEATURES floats) can be null.
+BI_GYM_API void bi_gym_reset(bi_gym *gym, uint64_t seed, float *observations);
+
+// Steps every environment with its action. 'actions' has numEnvs*BI_GYM_ACTION_SIZE int32s.
+// The outputs have numEnvs elements (or BI_GYM_NUM_FEATURES floats per env), and any of them can be null.
+BI_GYM_API void bi_gym_step(bi_gym *gym, const int32_t *actions, float *observations, float *rewards,
+                            uint8_t *terminated, uint8_t *truncated);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -25,24 +25,43 @@
 *
 *  - I don't use stupid C++ features.
 *
-*  - All the game code is in this file. Math utilites are at bi_math.h and basic utilities
-*  are at bi_base.h.
+*  - The match simulation (board, balls, rules) is at bi_game.h and doesn't use Raylib, so it
+*  can also run headless. The bots are at bi_ai.h, and the thread pool they use at
+*  bi_threads.h. The rest of the game code (menus, input, drawing, sound) is in this file.
+*
+*  - Drawing only pushes render commands (bi_render.h) into a buffer, which is drawn with
+*  Raylib at the end of the frame. The match itself is drawn by bi_draw.h, shared with the
+*  headless tools, and its particles by bi_particles.h. Math utilites are at bi_math.h and
+*  basic utilities are at bi_base.h.
 *
 */
 
 
-#ifndef PLATFORM_WEB
+#if defined(__EMSCRIPTEN__) && !defined(PLATFORM_WEB)
    #define PLATFORM_WEB // already defined in .bat
 #endif
 
 #include "raylib.h"
 #include "rshapes.c"
+#include "rlgl.h"
 
 #include "bi_base.h"
 #include "bi_math.h"
+#include "bi_game.h"
+#include "bi_threads.h"
+#include "bi_ai.h"
+#include "bi_replay.h"
+#include "bi_particles.h"
+#include "bi_render.h"
+#include "bi_draw.h"
+#include "bi_watch.h"
+#include "bi_quality.h"
 
 #include <stdio.h>
-#include <emscripten/emscripten.h>
+#if defined(__EMSCRIPTEN__)
+    #include <emscripten/emscripten.h>
+    #include <emscripten/html5.h>
+#endif
 
 
 
@@ -86,6 +105,11 @@ inline Color Color_(v4 a){
     Color result = {(u8)(Clamp01(a.r)*255), (u8)(Clamp01(a.g)*255), (u8)(Clamp01(a.b)*255), (u8)(Clamp01(a.a)*255)};
     return result;
 }
+// From a render command's RGBA8 color (see RenderColor()).
+inline Color Color_(u32 a){
+    Color result = {(u8)a, (u8)(a >> 8), (u8)(a >> 16), (u8)(a >> 24)};
+    return result;
+}
 
 
 //
@@ -98,108 +122,153 @@ enum meta_state{
     MetaState_Tutorial,
     MetaState_Options,
     MetaState_Game,
+    MetaState_Watch, // A grid of bot matches (bi_watch.h)
 };
 
-enum special_brick_type : u8{
-    SpecialBrick_None = 0,
-    SpecialBrick_Powerup,
-    SpecialBrick_BadPowerup,
-    SpecialBrick_Arrow,
-    SpecialBrick_Spawner,
-};
-#define TILE_DRAW_MARGIN 3.f
-struct tile_state{
-    b32 occupied;
-    special_brick_type specialType;
-    f32 specialTypeTimer; // in seconds
-    f32 specialAlpha; // Fade-in used to avoid unfairly placing a bad powerup right in front of the ball.
-    v4 color;
+// Sprite batch: triangles textured from texMain, pushed into a vertex array and submitted to Raylib in
+// one go, so a whole layer (like the bricks) takes one draw call no matter how many things it has. Solid
+// shapes sample a white texel of texMain, so they don't break the batch by switching textures.
+#define BATCH_WHITE_TEXEL V2(16.f, 6.f) // Center of a white area of the star sprite.
+#define MAX_BATCH_VERTICES (3*4096) // Fits a full grid of spawner bricks (30 vertices each). More gets submitted in parts.
+#define BATCH_SUBMIT_CHUNK (3*256) // Vertices checked against Raylib's buffer at a time.
+
+// Particles don't go through Raylib's batch. Where there's instancing, their arrays are copied as they are
+// into vertex buffers and drawn with one instanced call: a small shader makes each one's square (see
+// DrawParticles()). Elsewhere they're written into Raylib's batch as quads, in chunks.
+#define PARTICLE_SUBMIT_CHUNK 256 // Particles checked against Raylib's buffer at a time.
+
+enum particle_attribute{
+    ParticleAttribute_Corner, // Per vertex: the corners of a square, 0 to 1.
+    ParticleAttribute_PosX, // The rest are per particle, straight from particle_system.
+    ParticleAttribute_PosY,
+    ParticleAttribute_Size,
+    ParticleAttribute_Alpha,
+    ParticleAttribute_Color,
+    ParticleAttribute_Count,
 };
 
-#define DEFAULT_BALL_RADIUS 6.f
-#define DEFAULT_BALL_SPEED 5.f
-enum ball_flags{
-    BallFlags_OnPaddle = 0x1, // Ball stuck on the paddle, waiting for player to press space.
-    BallFlags_StuckShootRandomly = 0x2, // If set, stuck ball should start in a random direction.
-    BallFlags_InRandomizer = 0x4, // Used to only count the randomizer collision once.
+struct particle_buffers{
+    u32 shader; // 0 without instancing
+    s32 mvpLoc;
+    s32 offsetLoc;
+    u32 vertexArray; // 0 without VAOs
+    u32 buffers[ParticleAttribute_Count];
+    s32 locs[ParticleAttribute_Count];
+    s32 maxParticles;
 };
-struct ball_state{
+
+struct batch_vertex{
     v2 pos;
-    v2 speed; // (pixels per frame)
-    s32 flags;
-    f32 positionOnPaddle; // [-1, 1] Only used when on paddle.
-    f32 r; // radius.
+    v2 uv;
+    Color color;
+};
+struct sprite_batch{
+    batch_vertex *vertices;
+    s32 numVertices;
+    s32 maxVertices;
 };
 
-struct brick_shape{
-    // Each u8 represents a row, with each bit representing a position in that row.
-    // The first subscript is 0 for occupied brick and 1 for "special".
-    // E.g. ((rows[0][2] >> (7 - 3)) & 0x1) Evaluates to 1 if there is a solid brick at x=3, y=2.
-    //      ((rows[1][2] >> (7 - 3)) & 0x1) Evaluates to 1 if that brick is a special brick (type dictated by specialType).
-    u8 rows[2][8];
-    special_brick_type specialType;
-    v4 color;
+// Text cache: the layout of the strings drawn with DrawTextCached() (their glyph quads and width), kept
+// between frames so static text isn't laid out again. A string that changes (like the timer) just takes
+// another entry, replacing the least recently used one.
+#define MAX_CACHED_TEXT_LENGTH 64 // Longer strings, and ones with line breaks, go straight to DrawText().
+#define TEXT_CACHE_SIZE 128 // Power of 2
+#define TEXT_CACHE_PROBES 4
+
+struct cached_glyph{
+    Rectangle src; // In the font texture
+    Rectangle dest; // Relative to the text position
+    s32 colorIndex; // Number of visible characters before it, for DrawTextColorful().
+};
+struct text_layout{
+    u64 hash;
+    u64 lastUsedFrame;
+    char text[MAX_CACHED_TEXT_LENGTH];
+    s32 fontSize;
+    b32 colorful; // Laid out like DrawTextColorful().
+    s32 width; // Same as MeasureText()
+    s32 numGlyphs;
+    cached_glyph glyphs[MAX_CACHED_TEXT_LENGTH];
 };
-struct brick_shape_slot{
-    brick_shape shape;
-    b32 occupied;
-    v2s shapeDim; // In tiles
+struct text_cache{
+    text_layout entries[TEXT_CACHE_SIZE];
+    u64 frameIndex;
 };
 
-enum drop_type{
-    // Good
-    Drop_Life,
-    Drop_ExtraBall,
-    Drop_BigPaddle,
-    Drop_Magnet,
-    Drop_BigBalls,
-    Drop_Barrier,
-    Drop_TwoExtraBalls,
-
-    // Bad
-    Drop_FastBalls,
-    Drop_SlowBalls,
-    Drop_SmallPaddle,
-    Drop_ReverseControls,
-    Drop_SlipperyControls,
-    Drop_Randomizer,
+// Sim thread: on native builds the match runs on its own thread, at a fixed tick rate, and the main
+// thread only sends it the input and draws its latest state, so neither one's slow frames hold up the
+// other. After each tick it publishes a snapshot of the game into a triple buffer. The web build updates
+// the match in UpdateDrawFrame().
+#if BI_THREADS && !defined(__EMSCRIPTEN__)
+    #define SIM_THREAD 1
+#else
+    #define SIM_THREAD 0
+#endif
+#define SIM_TICK_MICROSECONDS 8333 // 120 ticks per second
+#define SIM_MAX_LAG_MICROSECONDS 100000 // Further behind than this (after a pause or a stall), it skips ahead instead of catching up.
+#define SIM_EVENT_QUEUE_SIZE 256 // Power of 2
+
+// Fast-forward, for watching the bots play each other: several whole ticks per frame (or per tick of the
+// sim thread), and only the last one is drawn. If they take longer than the budget the rest are dropped,
+// so the match goes slower than asked instead of the frame rate going down.
+#define MAX_TURBO_SPEED 64
+#define TURBO_BUDGET_MICROSECONDS 8000 // Per frame, on the main thread.
+#define SIM_TURBO_BUDGET_MICROSECONDS (SIM_TICK_MICROSECONDS*3/4)
+
+#if SIM_THREAD
+enum sim_key{
+    SimKey_Right = 0x1,
+    SimKey_Left = 0x2,
+    SimKey_Launch = 0x4,
 };
-#define FIRST_GOOD_DROP Drop_Life
-#define LAST_GOOD_DROP Drop_TwoExtraBalls
-#define FIRST_BAD_DROP Drop_FastBalls
-#define LAST_BAD_DROP Drop_Randomizer
-#define DROP_RADIUS 15.f
-
-#define DEFAULT_POWERUP_TIME 25.f
-#define POWERUP_TIME_BIG_PADDLE        DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_MAGNET            30.f
-#define POWERUP_TIME_BIG_BALLS         30.f
-#define POWERUP_TIME_BARRIER           DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_FAST_BALLS        DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_SLOW_BALLS        DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_SMALL_PADDLE      DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_REVERSE_CONTROLS  DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_SLIPPERY_CONTROLS DEFAULT_POWERUP_TIME
-#define POWERUP_TIME_RANDOMIZER        30.f
-
-#define PADDLE_WIDTH_SMALL 50
-#define PADDLE_WIDTH_NORMAL 90
-#define PADDLE_WIDTH_BIG 130
-
-struct drop_state{
-    v2 pos;
-    drop_type type;
-    f32 ySpeed;
+
+// The game after a tick. Never changed once published.
+struct sim_snapshot{
+    game_state game;
+    u64 tickTime; // GetMicroseconds() when the tick was due.
+    // Where what moves was a tick before, to draw it in between.
+    v2 prevPaddlePos;
+    v2 prevBallPos[ArrayCount(game_state::balls)];
+    s32 prevNumBalls;
+    v2 prevDropPos[ArrayCount(game_state::drops)];
+    s32 prevNumDrops;
 };
 
-#define MAX_GAME_SPEED 2.f
+// The fields marked atomic are written by one thread and read by the other.
+struct sim_thread{
+    pthread_t thread;
+    b32 running;
+    u32 quit; // Atomic
+    u32 pause; // Atomic
+    u32 keys; // Atomic. sim_key bits, from the last time the main thread polled the input (once a frame).
+    s32 rotations[2]; // Atomic. Quarter turns of each slot not passed to the game yet.
+    u32 placeRequest; // Atomic. A shape placed with the mouse, see SendMatchInput().
+    u32 dragging; // Atomic. The player is holding a shape, so the bricks AI doesn't place any.
+    u32 turbo; // Atomic. Ticks to run each tick (fast-forward).
+    u32 randomSeed[2]; // For the thread's own globalPcgRandom (it's per thread), drawn by the main thread.
+
+    sim_snapshot snapshots[3];
+    triple_buffer snapshotBuffer;
+
+    // The game's events, for the main thread to play their sounds. One writer, one reader.
+    game_event events[SIM_EVENT_QUEUE_SIZE];
+    u32 eventsWritten; // Atomic
+    u32 eventsRead; // Atomic
+
+    game_state view; // What the main thread draws: the latest snapshot, interpolated.
+};
+#endif
 
-#define DEFAULT_SAME_COLOR_COMBO_MAX 4
 #define DEFAULT_MASTER_VOLUME .8f
-#define DEFAULT_SPAWN_SHAPE_TIME 8.f
-#define DEFAULT_DO_SPEED_UP false
-#define DEFAULT_INITIAL_PADDLE_LIFES 3
-#define DEFAULT_SPECIAL_BRICK_CHANCE .5f
+
+// The frame is drawn at the logical resolution (winDim) times a render scale, into a render target that's
+// then scaled to the window. Auto picks the biggest scale that isn't sharper than the window, and the
+// quality governor lowers it while the frames are too slow (bi_quality.h).
+static f32 globalRenderScales[] = {.5f, .75f, 1.f, 1.5f, 2.f, 3.f, 4.f};
+
+#define MENU_NUM_COLUMNS 13 // Of the menu background
+#define MENU_TILES_PER_COLUMN 30
+#define MENU_TILE_HEIGHT 28.f
 
 struct global_state {
     Texture2D texMain;
@@ -222,125 +291,485 @@ struct global_state {
     Sound sndWinPaddle;
     Sound sndWinBricks;
 
+    Texture2D texMenuBackground;
+    f32 menuColumnStarts[MENU_NUM_COLUMNS]; // Scroll of each column at time 0, in [0, 1).
+
     f32 masterVolume;
 
     meta_state metaState;
     s32 tutorialPage;
-    v2 winDim;
+    v2 winDim; // Logical resolution: everything is drawn and laid out in these units.
     v2 mousePos;
 
+    RenderTexture2D renderTarget; // winDim times the render scale.
+    s32 renderScaleIndex; // In globalRenderScales, or -1 for auto.
+    s32 windowRenderScaleIndex; // The biggest one that isn't sharper than the window.
+    s32 usedRenderScaleIndex; // This frame's.
+    b32 pixelUpscale; // Scale the target by whole multiples (letterboxed) without filtering, instead of filtered to fit.
+    v2 presentPos; // Where the target goes in the window, in window pixels.
+    f32 presentScale; // Window pixels per logical one.
+    quality_governor quality;
+    s32 ringStep; // Of ringDirs: 2 draws circles with half the segments.
+
     u64 guiActiveId;
     u64 guiHoveredId;
     b32 guiKeepActive;
 
 
-    v2s gridDim;
-    v2 tileDim;
-    v2 viewDim;
     v2 viewPos;
-    tile_state *tiles;
 
+    game_config config;
+    b32 autoPlaceShapes;
+    b32 autoPlayPaddle;
+    b32 planBricks; // Use the rollout planner instead of the simple bricks AI.
+    bricks_ai_profile aiProfiles[MAX_BRICKS_AI_PROFILES]; // The first one is the default.
+    s32 numAIProfiles;
+    s32 aiProfileIndex; // For the simple bricks AI.
+
+    game_state game;
+    paddle_bot paddleBot;
+    placement_cache placementCache;
+    async_bricks_ai bricksAI; // Used when planBricks.
+    replay currentReplay; // Recording of the current match
+    b32 turbo; // Fast-forward, when both bots play.
+    s32 turboSpeed; // 2 to MAX_TURBO_SPEED
+    f32 turboTime; // Not run yet, in seconds of game time.
+    f32 speedSampleTime; // Seconds since the last measure of effectiveSpeed
+    f32 speedSampleGameTime; // The game's time then
+    f32 effectiveSpeed; // Game seconds per second
+
+    match_grid watchGrid;
+    b32 watchGridReady; // Allocated, the first time it's opened.
+    s32 watchGridSizeIndex; // In globalWatchGridSizes
+    s32 watchSpeedIndex; // In globalWatchSpeeds
+#if SIM_THREAD
+    sim_thread sim; // While it runs, it owns the match: game, bots, bricksAI and currentReplay.
+#endif
+    thread_pool threadPool;
+    s32 draggingShapeIndex; // -1 for default
+    s32 queuedRotations[2]; // Pressed rotate buttons, passed to the game next frame.
+    b32 pause;
 
-    brick_shape shapeCatalog[7];
-    f32 spawnShapeTime; // Seconds
+    hud_powerups hud;
+    particle_system particles;
+    particle_buffers particleBuffers;
 
-    f32 randomizerY;
-    f32 barrierTopY;
-    f32 barrierHeight;
+    // What's drawn this frame. It's drawn with DrawRenderCommands() at the end of the frame.
+    render_buffer renderBuffer;
+    b32 showRenderStats; // F3
 
-    b32 doSpeedUp;
-    s32 sameColorComboMax;
-    s32 initialPaddleLifes;
-    f32 specialBrickChance;
+    // Shared by every layer that's batched: each one is submitted before the next one starts.
+    batch_vertex batchVertices[MAX_BATCH_VERTICES];
+    sprite_batch spriteBatch;
+    v2 ringDirs[RENDER_CIRCLE_SEGMENTS + 1]; // Unit vectors around a circle, starting at the top.
 
-    b32 autoPlaceShapes;
+    text_cache textCache;
 
-    ////////////////////////////////////////////////////////////////////////////
-    u8 membersBelowThisGetZeroedOnEveryNewGame;
+    // The bricks without their special overlays. Only the tiles that changed are redrawn into it.
+    RenderTexture2D brickLayer;
+    b32 brickLayerValid; // False to redraw all of it.
+    tile_state brickLayerTiles[MAX_GRID_DIM_X*MAX_GRID_DIM_Y]; // What's drawn in it.
+};
+static global_state globalState;
 
-    v2 paddleDim;
-    f32 gameTime;
-    f32 gameSpeed;
-    f32 speedUpMessageTimer; // 0 for inactive. Non-zero shows "Speed up!" message.
-    f32 speedUpMessageTime; 
 
-    v2 paddlePos; // Center position
-    f32 paddleXSpeed; // in pixels per frame (16.66ms frame)
-    s32 paddleLastInputDir;
 
-    ball_state balls[10];
-    s32 numBalls;
-    s32 paddleLifes;
 
-    drop_state drops[20];
-    s32 numDrops;
+//
+// Sprite batch
+//
 
-    brick_shape_slot availableSlots[2];
-    brick_shape_slot nextSlots[2];
-    f32 spawnShapeTimer; // Seconds
+void SubmitBatch(sprite_batch *batch);
 
-    s32 draggingShapeIndex; // -1 for default
+// Submits what's in the batch if the next primitive doesn't fit.
+inline void ReserveBatch(sprite_batch *batch, s32 numVertices){
+    if (batch->numVertices + numVertices > batch->maxVertices){
+        SubmitBatch(batch);
+    }
+}
+inline void PushBatchVertex(sprite_batch *batch, v2 pos, v2 texPos, Color color){
+    batch_vertex *v = &batch->vertices[batch->numVertices++];
+    v->pos = pos;
+    v->uv = V2(texPos.x/globalState.texMain.width, texPos.y/globalState.texMain.height);
+    v->color = color;
+}
+// Any winding works: they're flipped to the one DrawTriangle() expects, so they're not culled.
+void PushBatchTriangle(sprite_batch *batch, v2 p0, v2 p1, v2 p2, Color col){
+    if (Cross(p1 - p0, p2 - p0) > 0){
+        SWAP(p1, p2);
+    }
+    ReserveBatch(batch, 3);
+    PushBatchVertex(batch, p0, BATCH_WHITE_TEXEL, col);
+    PushBatchVertex(batch, p1, BATCH_WHITE_TEXEL, col);
+    PushBatchVertex(batch, p2, BATCH_WHITE_TEXEL, col);
+}
+// Like DrawSpriteFit(). A negative texDim flips the sprite.
+void PushBatchSprite(sprite_batch *batch, v2 texPos, v2 texDim, v2 pos, v2 dim, Color col = WHITE){
+    v2 t0 = texPos;
+    v2 t1 = texPos + texDim;
+    ReserveBatch(batch, 6);
+    PushBatchVertex(batch, pos, t0, col);
+    PushBatchVertex(batch, V2(pos.x, pos.y + dim.y), V2(t0.x, t1.y), col);
+    PushBatchVertex(batch, pos + dim, t1, col);
+    PushBatchVertex(batch, pos, t0, col);
+    PushBatchVertex(batch, pos + dim, t1, col);
+    PushBatchVertex(batch, V2(pos.x + dim.x, pos.y), V2(t1.x, t0.y), col);
+}
+void PushBatchRect(sprite_batch *batch, v2 pos, v2 dim, Color color){
+    PushBatchSprite(batch, BATCH_WHITE_TEXEL, V2(0), pos, dim, color);
+}
 
-    b32 gameEnded;
-    b32 paddleWon; // (when gameEnded)  true: attacker won;  false: defender won
-    b32 pause;
+// A ring split in two colors, like the 2 DrawRing() calls from 180 to 180 + 360*progress degrees (colorA)
+// and from there to 540 (colorB). Only the segment where the colors meet needs a new direction.
+void PushBatchProgressRing(sprite_batch *batch, v2 center, f32 r1, f32 r2, f32 progress, Color colorA, Color colorB){
+    v2 *dirs = globalState.ringDirs;
+    s32 step = globalState.ringStep;
+    f32 split = Clamp01(progress)*RENDER_CIRCLE_SEGMENTS;
+    for(s32 i = 0; i < RENDER_CIRCLE_SEGMENTS; i += step){
+        v2 d0 = dirs[i];
+        v2 d1 = dirs[i + step];
+        if (i < split && i + step > split){
+            f32 angle = PI + 2*PI*progress;
+            v2 dSplit = V2(Sin(angle), Cos(angle));
+            PushBatchTriangle(batch, center + r2*d0, center + r1*d0, center + r1*dSplit, colorA);
+            PushBatchTriangle(batch, center + r1*dSplit, center + r2*dSplit, center + r2*d0, colorA);
+            d0 = dSplit;
+        }
+        Color color = (i + step <= split ? colorA : colorB);
+        PushBatchTriangle(batch, center + r2*d0, center + r1*d0, center + r1*d1, color);
+        PushBatchTriangle(batch, center + r1*d1, center + r2*d1, center + r2*d0, color);
+    }
+}
+void PushBatchCircle(sprite_batch *batch, v2 center, f32 r, Color color){
+    v2 *dirs = globalState.ringDirs;
+    s32 step = globalState.ringStep;
+    for(s32 i = 0; i < RENDER_CIRCLE_SEGMENTS; i += step){
+        PushBatchTriangle(batch, center, center + r*dirs[i], center + r*dirs[i + step], color);
+    }
+}
 
-    // Powerups
-    f32 powerupCountdownBigPaddle;
-    f32 powerupCountdownMagnet;
-    f32 powerupCountdownBigBalls;
-    f32 powerupCountdownBarrier;
-    // Bad Powerups
-    f32 powerupCountdownFastBalls;
-    f32 powerupCountdownSlowBalls;
-    f32 powerupCountdownSmallPaddle;
-    f32 powerupCountdownReverseControls;
-    f32 powerupCountdownSlipperyControls;
-    f32 powerupCountdownRandomizer;
-
-    s32 sameColorCombo;
-    v4 sameColorComboLastColor;
+// Raylib keeps the color and texcoord it was last given for the vertices that follow, so they're only
+// passed when they change: most shapes are one color, and the solid ones share a texel.
+void SubmitBatch(sprite_batch *batch){
+    if (!batch->numVertices)
+        return;
+    rlSetTexture(globalState.texMain.id);
+    rlBegin(RL_TRIANGLES);
+    batch_vertex *prev = 0;
+    for(s32 i = 0; i < batch->numVertices; i++){
+        if (i % BATCH_SUBMIT_CHUNK == 0){
+            // Only flushes if Raylib's buffer can't fit the chunk, which with the default buffer size
+            // doesn't happen for the amount of bricks on screen.
+            rlCheckRenderBatchLimit(MinS32(BATCH_SUBMIT_CHUNK, batch->numVertices - i));
+        }
+        batch_vertex *v = &batch->vertices[i];
+        if (!prev || v->color.r != prev->color.r || v->color.g != prev->color.g || v->color.b != prev->color.b || v->color.a != prev->color.a){
+            rlColor4ub(v->color.r, v->color.g, v->color.b, v->color.a);
+        }
+        if (!prev || v->uv != prev->uv){
+            rlTexCoord2f(v->uv.x, v->uv.y);
+        }
+        rlVertex2f(v->pos.x, v->pos.y);
+        prev = v;
+    }
+    rlEnd();
+    rlSetTexture(0);
+    batch->numVertices = 0;
+}
 
-};
-static global_state globalState;
+// Raylib's MatrixMultiply(), which is in raymath.h.
+Matrix MultiplyMatrix(Matrix left, Matrix right){
+    f32 a[16], b[16], m[16];
+    memcpy(a, &left, sizeof(a));
+    memcpy(b, &right, sizeof(b));
+    for(s32 row = 0; row < 4; row++){
+        for(s32 col = 0; col < 4; col++){
+            m[row*4 + col] = b[row*4]*a[col] + b[row*4 + 1]*a[4 + col] + b[row*4 + 2]*a[8 + col] + b[row*4 + 3]*a[12 + col];
+        }
+    }
+    Matrix result;
+    memcpy(&result, m, sizeof(m));
+    return result;
+}
+
+// The shader does what ParticleSize() and ParticleColor() do. The corner attribute and the color have
+// the names Raylib binds to locations 0 and 3: WebGL wants attribute 0 to be one that isn't instanced.
+#if defined(PLATFORM_WEB)
+static char *globalParticleVertexShader =
+    "#version 100\n"
+    "attribute vec2 vertexPosition;\n"
+    "attribute float posX, posY, size, alpha;\n"
+    "attribute vec4 vertexColor;\n"
+    "uniform mat4 mvp;\n"
+    "uniform vec2 offset;\n"
+    "varying vec4 fragColor;\n"
+    "void main(){\n"
+    "    vec2 pos = offset + vec2(posX, posY) + (vertexPosition - 0.5)*size*(0.4 + 0.6*alpha);\n"
+    "    fragColor = vec4(vertexColor.rgb, vertexColor.a*alpha);\n"
+    "    gl_Position = mvp*vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+static char *globalParticleFragmentShader =
+    "#version 100\n"
+    "precision mediump float;\n"
+    "varying vec4 fragColor;\n"
+    "void main(){ gl_FragColor = fragColor; }\n";
+#else
+static char *globalParticleVertexShader =
+    "#version 330\n"
+    "in vec2 vertexPosition;\n"
+    "in float posX, posY, size, alpha;\n"
+    "in vec4 vertexColor;\n"
+    "uniform mat4 mvp;\n"
+    "uniform vec2 offset;\n"
+    "out vec4 fragColor;\n"
+    "void main(){\n"
+    "    vec2 pos = offset + vec2(posX, posY) + (vertexPosition - 0.5)*size*(0.4 + 0.6*alpha);\n"
+    "    fragColor = vec4(vertexColor.rgb, vertexColor.a*alpha);\n"
+    "    gl_Position = mvp*vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+static char *globalParticleFragmentShader =
+    "#version 330\n"
+    "in vec4 fragColor;\n"
+    "out vec4 finalColor;\n"
+    "void main(){ finalColor = fragColor; }\n";
+#endif
+
+// Needs the window (the GL context). Leaves pb->shader at 0 if there's no instancing.
+void InitParticleBuffers(particle_buffers *pb, s32 maxParticles){
+    ZeroStruct(pb);
+#if defined(PLATFORM_WEB)
+    // WebGL 1 has it as an extension, which Raylib loads if the browser has it.
+    if (!emscripten_webgl_enable_extension(emscripten_webgl_get_current_context(), "ANGLE_instanced_arrays"))
+        return;
+#endif
+    // Natively it comes with GL 3.3, which the shader needs too: Raylib gives back its default shader (or 0,
+    // without shaders) if it doesn't compile.
+    u32 shader = rlLoadShaderCode(globalParticleVertexShader, globalParticleFragmentShader);
+    if (!shader || shader == rlGetShaderIdDefault())
+        return;
+    char *names[ParticleAttribute_Count] = {"vertexPosition", "posX", "posY", "size", "alpha", "vertexColor"};
+    for(s32 i = 0; i < ParticleAttribute_Count; i++){
+        pb->locs[i] = rlGetLocationAttrib(shader, names[i]);
+        if (pb->locs[i] < 0){
+            rlUnloadShaderProgram(shader);
+            return;
+        }
+    }
+    pb->shader = shader;
+    pb->mvpLoc = rlGetLocationUniform(shader, "mvp");
+    pb->offsetLoc = rlGetLocationUniform(shader, "offset");
+    pb->maxParticles = maxParticles;
+
+    // Two triangles, like the quads of Raylib's batch.
+    f32 corners[] = {0, 0,  0, 1,  1, 1,  0, 0,  1, 1,  1, 0};
+    pb->vertexArray = rlLoadVertexArray();
+    rlEnableVertexArray(pb->vertexArray);
+    for(s32 i = 0; i < ParticleAttribute_Count; i++){
+        if (i == ParticleAttribute_Corner){
+            pb->buffers[i] = rlLoadVertexBuffer(corners, sizeof(corners), false);
+        }else{
+            pb->buffers[i] = rlLoadVertexBuffer(0, maxParticles*sizeof(u32), true); // f32 or RGBA8
+        }
+    }
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+}
+
+// A square for each live particle, with (0, 0) at 'offset', drawn with Raylib's current transform (the
+// render scale) and blend mode.
+void DrawParticles(particle_system *ps, v2 offset){
+    auto gs = &globalState;
+    particle_buffers *pb = &gs->particleBuffers;
+    if (pb->shader){
+        s32 num = MinS32(ps->numParticles, pb->maxParticles);
+        rlDrawRenderBatchActive(); // What was drawn before goes under them.
+        rlEnableShader(pb->shader);
+        rlSetUniformMatrix(pb->mvpLoc, MultiplyMatrix(MultiplyMatrix(rlGetMatrixTransform(), rlGetMatrixModelview()), rlGetMatrixProjection()));
+        rlSetUniform(pb->offsetLoc, &offset, SHADER_UNIFORM_VEC2, 1);
+        b32 vertexArray = rlEnableVertexArray(pb->vertexArray);
+        void *arrays[ParticleAttribute_Count] = {0, ps->posX, ps->posY, ps->size, ps->alpha, ps->color};
+        for(s32 i = 0; i < ParticleAttribute_Count; i++){
+            rlEnableVertexBuffer(pb->buffers[i]);
+            if (i == ParticleAttribute_Corner){
+                rlSetVertexAttribute(pb->locs[i], 2, RL_FLOAT, false, 0, 0);
+            }else{
+                rlUpdateVertexBuffer(pb->buffers[i], arrays[i], num*sizeof(u32), 0);
+                if (i == ParticleAttribute_Color){
+                    rlSetVertexAttribute(pb->locs[i], 4, RL_UNSIGNED_BYTE, true, 0, 0);
+                }else{
+                    rlSetVertexAttribute(pb->locs[i], 1, RL_FLOAT, false, 0, 0);
+                }
+            }
+            rlEnableVertexAttribute(pb->locs[i]);
+            rlSetVertexAttributeDivisor(pb->locs[i], (i == ParticleAttribute_Corner ? 0 : 1));
+        }
+        rlDrawVertexArrayInstanced(0, 6, num);
+        if (vertexArray){
+            rlDisableVertexArray();
+        }else{
+            // Without a VAO the attributes are global. Raylib's batch sets its own up again, but not the
+            // divisors.
+            for(s32 i = 0; i < ParticleAttribute_Count; i++){
+                rlSetVertexAttributeDivisor(pb->locs[i], 0);
+                rlDisableVertexAttribute(pb->locs[i]);
+            }
+        }
+        rlDisableVertexBuffer();
+        rlDisableShader();
+    }else{
+        // Written into Raylib's vertex buffer as quads, each with its color and its 4 corners (they all
+        // use the same white texel).
+        rlSetTexture(gs->texMain.id);
+        rlBegin(RL_QUADS);
+        rlTexCoord2f(BATCH_WHITE_TEXEL.x/gs->texMain.width, BATCH_WHITE_TEXEL.y/gs->texMain.height);
+        for(s32 i = 0; i < ps->numParticles; i++){
+            if (i % PARTICLE_SUBMIT_CHUNK == 0){
+                rlCheckRenderBatchLimit(4*MinS32(PARTICLE_SUBMIT_CHUNK, ps->numParticles - i));
+            }
+            f32 halfSize = .5f*ParticleSize(ps, i);
+            f32 x0 = offset.x + ps->posX[i] - halfSize;
+            f32 y0 = offset.y + ps->posY[i] - halfSize;
+            f32 x1 = x0 + 2*halfSize;
+            f32 y1 = y0 + 2*halfSize;
+            u32 color = ParticleColor(ps, i);
+            rlColor4ub((u8)color, (u8)(color >> 8), (u8)(color >> 16), (u8)(color >> 24));
+            rlVertex2f(x0, y0);
+            rlVertex2f(x0, y1);
+            rlVertex2f(x1, y1);
+            rlVertex2f(x1, y0);
+        }
+        rlEnd();
+        rlSetTexture(0);
+    }
+}
+
+//
+// Text cache
+//
+
+// Returns 0 if the text can't be cached.
+text_layout *GetTextLayout(char *text, s32 fontSize, b32 colorful = false){
+    auto cache = &globalState.textCache;
 
+    u64 hash = 14695981039346656037ULL; // FNV-1a
+    s32 length = 0;
+    for(char *it = text; *it; it++){
+        if (*it == '\n' || length == MAX_CACHED_TEXT_LENGTH - 1)
+            return 0;
+        hash = (hash ^ (u8)*it)*1099511628211ULL;
+        length++;
+    }
+    hash = SimpleHash64(hash ^ ((u64)fontSize << 1) ^ (colorful ? 1 : 0));
+
+    text_layout *result = 0;
+    for(s32 i = 0; i < TEXT_CACHE_PROBES; i++){
+        text_layout *entry = &cache->entries[(hash + i) & (TEXT_CACHE_SIZE - 1)];
+        if (entry->lastUsedFrame && entry->hash == hash && entry->fontSize == fontSize && entry->colorful == colorful && !strcmp(entry->text, text)){
+            entry->lastUsedFrame = cache->frameIndex;
+            return entry;
+        }
+        if (!result || entry->lastUsedFrame < result->lastUsedFrame){
+            result = entry;
+        }
+    }
 
-void DrawSprite(v2 texPos, v2 texDim, v2 pos, v2 scale = V2(1.f), v4 color = V4_White()){
-    Rectangle src = Rectangle_(texPos, texDim);
-    Rectangle dest = Rectangle_(pos, Hadamard(texDim, scale));
-    DrawTexturePro(globalState.texMain, src, dest, Vector2_(0), 0, Color_(color));
+    // Not cached: lay it out the same way DrawText() does.
+    result->hash = hash;
+    result->lastUsedFrame = cache->frameIndex;
+    strcpy(result->text, text);
+    result->fontSize = fontSize;
+    result->colorful = colorful;
+    result->width = MeasureText(text, fontSize);
+    result->numGlyphs = 0;
+
+    Font font = GetFontDefault();
+    s32 size = MaxS32(fontSize, 10); // DrawText()'s minimum
+    f32 scale = size/(f32)font.baseSize;
+    f32 spacing = (f32)(size/10);
+    f32 pad = (f32)font.glyphPadding;
+    f32 x = 0;
+    s32 visibleChars = 0;
+    for(char *it = text; *it; it++){
+        s32 index = GetGlyphIndex(font, (u8)*it);
+        if (*it != ' ' && *it != '\t' && *it != '\r'){
+            Rectangle rec = font.recs[index];
+            cached_glyph *glyph = &result->glyphs[result->numGlyphs++];
+            glyph->src = Rectangle_(rec.x - pad, rec.y - pad, rec.width + 2*pad, rec.height + 2*pad);
+            glyph->dest = Rectangle_(x + (font.glyphs[index].offsetX - pad)*scale, (font.glyphs[index].offsetY - pad)*scale, glyph->src.width*scale, glyph->src.height*scale);
+            glyph->colorIndex = visibleChars++;
+        }
+        if (colorful){
+            char tempText[2] = {*it, '\0'};
+            x += MeasureText(tempText, fontSize) + MeasureText("i", fontSize);
+        }else{
+            x += (font.glyphs[index].advanceX ? (f32)font.glyphs[index].advanceX : font.recs[index].width)*scale + spacing;
+        }
+    }
+    return result;
 }
-void DrawSpriteFit(v2 texPos, v2 texDim, v2 pos, v2 dim, v4 color = V4_White()){
-    Rectangle src = Rectangle_(texPos, texDim);
-    Rectangle dest = Rectangle_(pos, dim);
-    DrawTexturePro(globalState.texMain, src, dest, Vector2_(0), 0, Color_(color));
+
+// If 'colors' is given, glyph i gets colors[i % numColors] instead of 'color'.
+void DrawTextLayout(text_layout *layout, s32 x, s32 y, Color color, v4 *colors = 0, s32 numColors = 0){
+    Texture2D tex = GetFontDefault().texture;
+    rlCheckRenderBatchLimit(4*layout->numGlyphs);
+    rlSetTexture(tex.id);
+    rlBegin(RL_QUADS);
+    for(s32 i = 0; i < layout->numGlyphs; i++){
+        cached_glyph *glyph = &layout->glyphs[i];
+        if (colors){
+            color = Color_(colors[glyph->colorIndex % numColors]);
+        }
+        f32 u0 = glyph->src.x/tex.width;
+        f32 v0 = glyph->src.y/tex.height;
+        f32 u1 = (glyph->src.x + glyph->src.width)/tex.width;
+        f32 v1 = (glyph->src.y + glyph->src.height)/tex.height;
+        f32 x0 = x + glyph->dest.x;
+        f32 y0 = y + glyph->dest.y;
+        f32 x1 = x0 + glyph->dest.width;
+        f32 y1 = y0 + glyph->dest.height;
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        rlTexCoord2f(u0, v0); rlVertex2f(x0, y0);
+        rlTexCoord2f(u0, v1); rlVertex2f(x0, y1);
+        rlTexCoord2f(u1, v1); rlVertex2f(x1, y1);
+        rlTexCoord2f(u1, v0); rlVertex2f(x1, y0);
+    }
+    rlEnd();
+    rlSetTexture(0);
 }
 
-void DrawRotateArrow(v2 pos, v2 dim, b32 flipX, v4 color){
-#if 0
-    v2 rectAPos = {.1f, .1f};
-    v2 rectADim = {.7f, .2f};
-    v2 rectBPos = {.6f, .3f};
-    v2 rectBDim = {.2f, .4f};
-    f32 triR = .3f;
-    v2 tri0 = {.7f + triR, .7f};
-    v2 tri1 = {.7f - triR, .7f};
-    v2 tri2 = {.7f, .7f + triR};
-    if (flipX){
-        rectAPos.x = 1.f - rectAPos.x - rectADim.x;
-        rectBPos.x = 1.f - rectBPos.x - rectBDim.x;
-        tri0.x = 1.f - tri0.x;
-        tri1.x = 1.f - tri1.x;
-        tri2.x = 1.f - tri2.x;
-        SWAP(tri0, tri1);
+// Like DrawText() and MeasureText()
+void DrawTextCached(char *text, s32 x, s32 y, s32 fontSize, Color color){
+    text_layout *layout = GetTextLayout(text, fontSize);
+    if (layout){
+        DrawTextLayout(layout, x, y, color);
+    }else{
+        DrawText(text, x, y, fontSize, color);
     }
-    Color col = Color_(color);
-    DrawRectangleV(Vector2_(pos + Hadamard(dim, rectAPos)), Vector2_(Hadamard(dim, rectADim)), col);
-    DrawRectangleV(Vector2_(pos + Hadamard(dim, rectBPos)), Vector2_(Hadamard(dim, rectBDim)), col);
-    DrawTriangle(Vector2_(pos + Hadamard(dim, tri0)), Vector2_(pos + Hadamard(dim, tri1)), Vector2_(pos + Hadamard(dim, tri2)), col);
-#endif
-    DrawSpriteFit(V2(32, 0), V2(48*(flipX ? -1 : 1), 48), pos, dim, color);
 }
+s32 MeasureTextCached(char *text, s32 fontSize){
+    text_layout *layout = GetTextLayout(text, fontSize);
+    s32 result = (layout ? layout->width : MeasureText(text, fontSize));
+    return result;
+}
+
+// Each visible character takes the next color.
+void DrawTextColorful(char *text, s32 x, s32 y, s32 fontSize, v4 *colors, s32 numColors){
+    text_layout *layout = GetTextLayout(text, fontSize, true);
+    if (layout){
+        DrawTextLayout(layout, x, y, WHITE, colors, numColors);
+        return;
+    }
+    s32 xIt = x;
+    s32 colorIndex = 0;
+    for(char *it = text; *it; it++){
+        char tempText[2] = {*it, '\0'};
+        DrawText(tempText, xIt, y, fontSize, Color_(colors[colorIndex]));
+        if (*it != ' ' && *it != '\n' && *it != '\r' && *it != '\t')
+            colorIndex = (colorIndex + 1) % numColors;
+        xIt += MeasureText(tempText, fontSize) + MeasureText("i", fontSize);
+    }
+}
+
 
 // style=0: Flat color
 // style=1: Light outline and black inner outline.
@@ -371,40 +800,8 @@ b32 DoButton(u64 id, v2 pos, v2 dim, char *text, v4 color, s32 style = 0){
     }
 
     // Drawing
-    if (gs->guiHoveredId == id){
-        color = Clamp01V4(color + V4_Grey(.2f, 0));
-    }else if (gs->guiActiveId == id){
-        color = Clamp01V4(color + V4_Grey(-.2f, 0));
-    }
-    if (style == 1){
-        DrawRectangleV(Vector2_(pos), Vector2_(dim), Color_(Clamp01V4(color*1.1f)));
-        v2 m = {3.f, 3.f};
-        DrawRectangleV(Vector2_(pos + m), Vector2_(dim - 2*m), BLACK);
-        m += V2(3.f, 3.f);
-        DrawRectangleV(Vector2_(pos + m), Vector2_(dim - 2*m), Color_(color));
-    }else if (style == 2 || style == 3){
-        DrawRectangleV(Vector2_(pos), Vector2_(dim), WHITE);
-        v2 m = V2(3.f, 3.f);
-        DrawRectangleV(Vector2_(pos + m), Vector2_(dim - 2*m), Color_(color));
-        // Arrow
-        v2 arrowDim = V2(24.f);
-        v4 arrowColor = V4_Grey(.88f);
-        if (gs->guiHoveredId == id){
-            arrowColor = Clamp01V4(arrowColor + V4_Grey(.2f, 0));
-        }else if (gs->guiActiveId == id){
-            arrowColor = Clamp01V4(arrowColor + V4_Grey(-.2f, 0));
-        }
-        DrawRotateArrow(pos + dim/2 - arrowDim/2, arrowDim, (style == 3), arrowColor);
-    }else{
-        DrawRectangleV(Vector2_(pos), Vector2_(dim), Color_(color));
-    }
-
-    if (text){
-        f32 fontSize = 20.f;
-        f32 textWidth = (f32)MeasureText(text, (s32)fontSize); 
-        v2 textPos = pos + dim/2 - V2(textWidth, fontSize)/2;
-        DrawText(text, (s32)textPos.x, (s32)textPos.y, fontSize, BLACK);
-    }
+    s32 highlight = (gs->guiHoveredId == id ? 1 : (gs->guiActiveId == id ? -1 : 0));
+    RenderButton(&gs->renderBuffer, pos, dim, text, color, style, highlight);
     return result;
 }
 
@@ -427,13 +824,11 @@ s32 DoSliderS32(u64 id, v2 pos, v2 dim, char *text, s32 value, s32 min, s32 max,
     f32 t = (value - min)/(f32)(max - min);
     f32 barX = pos.x + m + barWidth/2 + t*(dim.x - 2*m - barWidth);
     v4 barColor = V4(.2f, .66f, .7f, 1.f);
-    DrawRectangleV(Vector2_(barX - barWidth/2, pos.y + m), Vector2_(barWidth, dim.y - 2*m), Color_(barColor));
+    RenderRect(&gs->renderBuffer, V2(barX - barWidth/2, pos.y + m), V2(barWidth, dim.y - 2*m), barColor);
     
     if (text){
         f32 fontSize = 20.f;
-        f32 textWidth = (f32)MeasureText(text, (s32)fontSize); 
-        v2 textPos = pos + dim/2 - V2(textWidth, fontSize)/2;
-        DrawText(text, (s32)textPos.x, (s32)textPos.y, fontSize, BLACK);
+        RenderText(&gs->renderBuffer, text, pos.x + dim.x/2, (f32)(s32)(pos.y + dim.y/2 - fontSize/2), (s32)fontSize, V4_Black(), RenderText_CenterX);
     }
 
     return result;
@@ -448,25 +843,7 @@ void FinishFrameForGui(){
 }            
 
 void UpdateDrawFrame(void);     // Update and Draw one frame
-
-#define MIN_PADDLE_BOUNCE_ANGLE (.3f*PI/2.f)
-v2 BallPaddleBounceDir(ball_state *ball){
-    auto gs = &globalState;
-
-    f32 relativeX = ball->pos.x - gs->paddlePos.x;
-    f32 t = Clamp(relativeX/(gs->paddleDim.x/2), -1.f, 1.f);
-    t = Lerp(t, -1.f + Map01ToArcSin(.5f + t*.5f)*2.f, .4f); // Gives less angles to the center and more to the edges.
-    v2 result = V2LengthDir(1.f, Lerp(PI + MIN_PADDLE_BOUNCE_ANGLE, 2*PI - MIN_PADDLE_BOUNCE_ANGLE, .5f + t*.5f));
-    return result;
-}
-
-
-#define TILE_COLOR_RED    V4(1.f, .2f, .2f)
-#define TILE_COLOR_ORANGE V4(1.f, .5f, .1f)
-#define TILE_COLOR_YELLOW V4(.92f, .85f, .06f)
-#define TILE_COLOR_GREEN  V4(.25f, .85f, .1f)
-#define TILE_COLOR_BLUE   V4(.4f, .3f, 1.f)
-#define TILE_COLOR_PURPLE V4(.8f, .4f, 1.f)
+void StopSimThread();
 
 static double globalDebugLastGetTime;
 
@@ -480,8 +857,15 @@ int main(void)
     ZeroStruct(gs);
     gs->winDim = V2(800, 450);
     gs->metaState = MetaState_MainMenu;
+    gs->renderScaleIndex = -1;
+    gs->presentScale = 1.f;
+    gs->ringStep = 1;
+    InitQualityGovernor(&gs->quality);
 
     
+#if !defined(__EMSCRIPTEN__)
+    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE);
+#endif
     InitWindow(gs->winDim.x, gs->winDim.y, "Break-In");
     InitAudioDevice();
     double randomSeed1 = GetTime();
@@ -532,312 +916,520 @@ int main(void)
     PcgRandomSeed(finalSeed1, finalSeed2);
     SetRandomSeed((s32)finalSeed1);
 
-    // Set up global state
-    gs->gridDim = V2S(12, 12); // 20)
-    gs->tileDim = V2(37, 19);
-    gs->viewDim = V2(gs->tileDim.x*gs->gridDim.x, 440);
-    gs->viewPos = (gs->winDim - gs->viewDim)/2;
+    // Bake the menu background. Each column of tiles is a vertical strip of the texture, and a screen's
+    // worth of its first tiles is repeated after the last one, so it can scroll without wrapping around.
+    {
+        // Init random
+        pcg_random_state random = { 0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL };
+        // Init colors
+        v4 originalColors[] = { TILE_COLOR_RED, TILE_COLOR_ORANGE, TILE_COLOR_YELLOW, TILE_COLOR_GREEN, TILE_COLOR_BLUE, TILE_COLOR_PURPLE };
+        v4 colors[40];
+        for(s32 i = 0; i < ArrayCount(colors); i++){
+            f32 t = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
+            f32 t2 = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
+            colors[i] = LerpV4(originalColors[i % ArrayCount(originalColors)], V4_Grey(.6f + t2*.2f, t), .2f + t*.3f);
+            colors[i].a = 1.f; // The column's alpha is applied when drawing.
+        }
+        u8 columns[MENU_NUM_COLUMNS][MENU_TILES_PER_COLUMN];
+        for(s32 col = 0; col < ArrayCount(columns); col++){
+            for(s32 i = 0; i < ArrayCount(columns[col]); i++){
+                columns[col][i] = PcgRandomU32(&random) % ArrayCount(colors);
+            }
+        }
+        for(s32 col = 0; col < ArrayCount(columns); col++){
+            gs->menuColumnStarts[col] = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
+        }
 
-    gs->tiles = (tile_state *)malloc(sizeof(tile_state)*gs->gridDim.x*gs->gridDim.y);
-    
-    gs->sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
-    
-    // Set up shapes 
-    // Line
-    gs->shapeCatalog[0].color = TILE_COLOR_YELLOW;
-    gs->shapeCatalog[0].rows[0][0] = 0xF0; // @@@@ 
-    
-    // Square
-    gs->shapeCatalog[1].color = TILE_COLOR_BLUE;
-    gs->shapeCatalog[1].rows[0][0] = 0xC0; // @@ 
-    gs->shapeCatalog[1].rows[0][1] = 0xC0; // @@ 
-    
-    // Stairs
-    gs->shapeCatalog[2].color = TILE_COLOR_GREEN;
-    gs->shapeCatalog[2].rows[0][0] = 0xC0; // @@ 
-    gs->shapeCatalog[2].rows[0][1] = 0x60; //  @@ 
-
-    // Triangle
-    gs->shapeCatalog[3].color = TILE_COLOR_ORANGE;
-    gs->shapeCatalog[3].rows[0][0] = 0x40; //  @ 
-    gs->shapeCatalog[3].rows[0][1] = 0xE0; // @@@ 
-    
-    // L
-    gs->shapeCatalog[4].color = TILE_COLOR_PURPLE;
-    gs->shapeCatalog[4].rows[0][0] = 0xF0; // @@@@ 
-    gs->shapeCatalog[4].rows[0][1] = 0x10; //    @ 
- 
-    // 2 Blocks
-    gs->shapeCatalog[5].color = TILE_COLOR_RED;
-    gs->shapeCatalog[5].rows[0][0] = 0xC0; // @@
-
-    // 1 Blocks
-    gs->shapeCatalog[6].color = TILE_COLOR_YELLOW;
-    gs->shapeCatalog[6].rows[0][0] = 0x80; // @
-
-    gs->spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
-    gs->doSpeedUp = DEFAULT_DO_SPEED_UP;
-    gs->initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
-    gs->specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
+        v2 tileDim = {gs->winDim.x/(f32)MENU_NUM_COLUMNS, MENU_TILE_HEIGHT};
+        s32 tilesSeenPerColumn = (s32)Ceil(gs->winDim.y/tileDim.y) + 1;
+        s32 numTiles = MENU_TILES_PER_COLUMN + tilesSeenPerColumn;
+        Image img = GenImageColor((s32)gs->winDim.x, numTiles*(s32)tileDim.y, BLANK);
+        for(s32 col = 0; col < MENU_NUM_COLUMNS; col++){
+            for(s32 i = 0; i < numTiles; i++){
+                f32 m = 5.f;
+                s32 x0 = (s32)(col*tileDim.x + m + .5f);
+                s32 x1 = (s32)((col + 1)*tileDim.x - m + .5f);
+                s32 y0 = (s32)(i*tileDim.y + m);
+                Color color = Color_(colors[columns[col][i % MENU_TILES_PER_COLUMN]]);
+                ImageDrawRectangle(&img, x0, y0, x1 - x0, (s32)(tileDim.y - 2*m), color);
+            }
+        }
+        gs->texMenuBackground = LoadTextureFromImage(img);
+        UnloadImage(img);
+    }
+
+    // Set up global state
+    gs->config.spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
+    gs->config.doSpeedUp = DEFAULT_DO_SPEED_UP;
+    gs->config.sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
+    gs->config.initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
+    gs->config.specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
+    strcpy(gs->aiProfiles[0].name, "Default");
+    gs->aiProfiles[0].weights = DefaultBricksAIWeights();
+    gs->numAIProfiles = 1;
+    if (FileExists(BRICKS_AI_PROFILES_PATH)){
+        char *text = LoadFileText(BRICKS_AI_PROFILES_PATH);
+        if (text){
+            gs->numAIProfiles += ParseBricksAIProfiles(text, gs->aiProfiles + 1, ArrayCount(gs->aiProfiles) - 1);
+            UnloadFileText(text);
+        }
+    }
+    gs->spriteBatch.vertices = gs->batchVertices;
+    gs->spriteBatch.maxVertices = ArrayCount(gs->batchVertices);
+    for(s32 i = 0; i <= RENDER_CIRCLE_SEGMENTS; i++){
+        // Same angles as Raylib's DrawRing(): 180 degrees is the top.
+        f32 angle = PI + 2*PI*i/(f32)RENDER_CIRCLE_SEGMENTS;
+        gs->ringDirs[i] = V2(Sin(angle), Cos(angle));
+    }
+    InitRenderBuffer(&gs->renderBuffer);
+    InitParticleSystem(&gs->particles);
+    InitParticleBuffers(&gs->particleBuffers, gs->particles.maxParticles);
+    gs->turboSpeed = 8;
+    InitThreadPool(&gs->threadPool);
+    InitAsyncBricksAI(&gs->bricksAI, &gs->threadPool);
 
     globalDebugLastGetTime = GetTime();
 
+#if defined(__EMSCRIPTEN__)
     emscripten_set_main_loop(UpdateDrawFrame, 0, 1);
+#else
+    SetExitKey(KEY_NULL); // Escape pauses
+    while(!WindowShouldClose()){
+        UpdateDrawFrame();
+    }
+    StopSimThread();
+#endif
 
     CloseWindow();
     CloseAudioDevice();
     return 0;
 }
 
-void DrawBrickSpecial(v2 brickPos, v2 brickDim, special_brick_type type, v4 brickColor, f32 alpha = 1.f){
-    if (type == SpecialBrick_Powerup || type == SpecialBrick_BadPowerup){
-        v4 color = (type == SpecialBrick_Powerup ? V4_White(alpha) : V4_Black(alpha));
-
-        // Draw 4-point star sprite
-        v2 texPos = V2(0);
-        v2 texDim = V2(32);
-        DrawSpriteFit(texPos, texDim, brickPos, brickDim, color);
-
-    }else if (type == SpecialBrick_Arrow){
-        Color color = Color_(V4_White(alpha));
-        f32 t = (f32)fmod(GetTime(), .8)/.8f;
-
-        v2 triDim = {Min(brickDim.x, 2*brickDim.y), brickDim.y};
-        v2 triPos = brickPos + (brickDim - triDim)/2 + V2(0, brickDim.y*(-1.f + 2*t));
-        v2 p0 = triPos + V2(triDim.x/2, triDim.y); // Bottom
-        v2 p1 = triPos + V2(triDim.x, 0); // Top Right
-        v2 p2 = triPos; // Top Left
-
-        if (p0.y <= brickPos.y + brickDim.y && p1.y >= brickPos.y){
-            DrawTriangle(Vector2_(p0), Vector2_(p1), Vector2_(p2), color);
-        }else if (p1.y < brickPos.y){
-            f32 l = Min(1.f, (p0.y - brickPos.y)/brickDim.y);
-            DrawTriangle(Vector2_(p0), Vector2_(LerpV2(p0, p1, l)), Vector2_(LerpV2(p0, p2, l)), color);
-        }else{
-            f32 l = Min(1.f, (brickPos.y + brickDim.y - p1.y)/brickDim.y);
-            DrawTriangle(Vector2_(LerpV2(p2, p0, l)), Vector2_(p1), Vector2_(p2), color);
-            DrawTriangle(Vector2_(LerpV2(p2, p0, l)), Vector2_(LerpV2(p1, p0, l)), Vector2_(p1), color);
+//
+// Render commands backend
+//
+
+// Redraws the tiles of brickLayer that changed since the last call. It can't be called while drawing into
+// another render target.
+void UpdateBrickLayer(game_state *game){
+    auto gs = &globalState;
+    sprite_batch *batch = &gs->spriteBatch;
+    f32 m = TILE_DRAW_MARGIN;
+    v2s layerDim = V2S(Hadamard(V2(game->gridDim), game->tileDim));
+    if (!gs->brickLayer.id || gs->brickLayer.texture.width != layerDim.x || gs->brickLayer.texture.height != layerDim.y){
+        if (gs->brickLayer.id){
+            UnloadRenderTexture(gs->brickLayer);
         }
-    }else if (type == SpecialBrick_Spawner){
-        DrawRectangleV(Vector2_(brickPos), Vector2_(brickDim), BLACK);
+        gs->brickLayer = LoadRenderTexture(layerDim.x, layerDim.y);
+        gs->brickLayerValid = false;
+    }
 
-        v2 c = brickPos + brickDim/2;
-        v2 r = brickDim/2;
+    for(s32 y = 0; y < game->gridDim.y; y++){
+        for(s32 x = 0; x < game->gridDim.x; x++){
+            s32 i = y*game->gridDim.x + x;
+            tile_state *tile = &game->tiles[i];
+            tile_state *drawn = &gs->brickLayerTiles[i];
+            if (gs->brickLayerValid && tile->occupied == drawn->occupied && (!tile->occupied || tile->color == drawn->color))
+                continue;
+            v2 p = V2(x*game->tileDim.x, y*game->tileDim.y);
+            if (gs->brickLayerValid){
+                PushBatchRect(batch, p, game->tileDim, BLANK); // Erase what was there
+            }
+            if (tile->occupied){
+                PushBatchRect(batch, p + V2(m), game->tileDim - V2(m*2), Color_(tile->color));
+            }
+            drawn->occupied = tile->occupied;
+            drawn->color = tile->color;
+        }
+    }
+    if (!gs->brickLayerValid || batch->numVertices){
+        BeginTextureMode(gs->brickLayer);
+        if (!gs->brickLayerValid){
+            ClearBackground(BLANK);
+        }
+        // Replace the texels instead of blending (GL_ONE, GL_ZERO, GL_FUNC_ADD), so erasing works.
+        rlSetBlendFactors(1, 0, 0x8006);
+        BeginBlendMode(BLEND_CUSTOM);
+        SubmitBatch(batch);
+        EndBlendMode();
+        EndTextureMode();
+        gs->brickLayerValid = true;
+    }
+}
+
+// The plain bricks of the board, from brickLayer (see UpdateBrickLayer()).
+void DrawBrickLayer(v2 pos){
+    auto gs = &globalState;
+    v2s layerDim = {gs->brickLayer.texture.width, gs->brickLayer.texture.height};
+    // Render textures are upside down
+    DrawTextureRec(gs->brickLayer.texture, Rectangle_(0, 0, (f32)layerDim.x, -(f32)layerDim.y), Vector2_(pos), WHITE);
+}
 
-        v4 colorInner = brickColor;
-        v4 colorCorners = V4_White(alpha);
-        double flickerPeriod = 1.0;
-        if (fmod(GetTime(), flickerPeriod) > flickerPeriod/2){
-            SWAP(colorInner, colorCorners);
+// Draws the commands in layer order. The ones textured from texMain go into the sprite batch, which is
+// only submitted when a command that isn't batched comes (text, the brick layer, the menu background).
+void DrawRenderCommands(render_buffer *rb){
+    auto gs = &globalState;
+    sprite_batch *batch = &gs->spriteBatch;
+    SortRenderCommands(rb);
+    for(s32 i = 0; i < rb->numCommands; i++){
+        render_command *command = &rb->commands[i];
+        Color color = Color_(command->color);
+        v2 *p = command->p;
+        if (!IsBatchedRenderCommand(command)){
+            SubmitBatch(batch);
+        }
+        switch(command->type){
+            case RenderCommand_Clear:    { ClearBackground(color); } break;
+            case RenderCommand_Rect:     { PushBatchRect(batch, p[0], p[1] - p[0], color); } break;
+            case RenderCommand_Triangle: { PushBatchTriangle(batch, p[0], p[1], p[2], color); } break;
+            case RenderCommand_Circle:   { PushBatchCircle(batch, p[0], command->circle.radius, color); } break;
+            case RenderCommand_ProgressRing: {
+                PushBatchProgressRing(batch, p[0], command->ring.innerRadius, command->ring.outerRadius, command->ring.progress, color, Color_(command->ring.colorB));
+            } break;
+            case RenderCommand_Line: { // Like DrawLineEx()
+                f32 length = Length(p[1] - p[0]);
+                if (length > 0){
+                    v2 n = V2(p[0].y - p[1].y, p[1].x - p[0].x)*(command->line.thick/(2*length));
+                    PushBatchTriangle(batch, p[0] + n, p[0] - n, p[1] - n, color);
+                    PushBatchTriangle(batch, p[0] + n, p[1] - n, p[1] + n, color);
+                }
+            } break;
+            case RenderCommand_Sprite: {
+                if (command->texture == RenderTexture_Main){
+                    PushBatchSprite(batch, command->sprite.texPos, command->sprite.texDim, p[0], p[1] - p[0], color);
+                }else{
+                    Rectangle src = Rectangle_(command->sprite.texPos, command->sprite.texDim);
+                    DrawTexturePro(gs->texMenuBackground, src, Rectangle_(p[0], p[1] - p[0]), Vector2_(0), 0, color);
+                }
+            } break;
+            case RenderCommand_Text: {
+                char *text = command->text.text;
+                s32 fontSize = command->text.fontSize;
+                f32 x = p[0].x;
+                if (command->flags & RenderText_CenterX){
+                    x -= MeasureTextCached(text, fontSize)/2;
+                }
+                if (command->flags & RenderText_Colorful){
+                    DrawTextColorful(text, (s32)x, (s32)p[0].y, fontSize, globalRenderTextColors, ArrayCount(globalRenderTextColors));
+                }else if (command->text.spacing >= 0){
+                    DrawTextEx(GetFontDefault(), text, Vector2_(x, p[0].y), fontSize, command->text.spacing, color);
+                }else{
+                    DrawTextCached(text, (s32)x, (s32)p[0].y, fontSize, color);
+                }
+            } break;
+            case RenderCommand_Bricks: { DrawBrickLayer(p[0]); } break;
+            case RenderCommand_Particles: { DrawParticles(command->particles.system, p[0]); } break;
         }
+    }
+    SubmitBatch(batch);
+}
 
-        // Inner diamond
-        r *= .4f;
-        DrawTriangle(Vector2_(c + V2(0, -r.y)), Vector2_(c + V2(-r.x, 0)), Vector2_(c + V2(0, r.y)), Color_(colorInner));
-        DrawTriangle(Vector2_(c + V2(0, -r.y)), Vector2_(c + V2(0, r.y)), Vector2_(c + V2(r.x, 0 )), Color_(colorInner));
+// Picks this frame's render scale, (re)creates the render target for it, and places it in the window. Call
+// it before reading the mouse, which is mapped through it.
+void UpdateRenderTarget(){
+    auto gs = &globalState;
+#if defined(__EMSCRIPTEN__)
+    // The page stretches the canvas to its width, so make its pixels the display's: the target is then
+    // scaled only once, by us.
+    double cssWidth, cssHeight;
+    emscripten_get_element_css_size("#canvas", &cssWidth, &cssHeight);
+    s32 canvasWidth = (s32)(cssWidth*emscripten_get_device_pixel_ratio());
+    s32 canvasHeight = (s32)(canvasWidth*gs->winDim.y/gs->winDim.x);
+    if (canvasWidth > 0 && (canvasWidth != GetScreenWidth() || canvasHeight != GetScreenHeight())){
+        SetWindowSize(canvasWidth, canvasHeight);
+    }
+#endif
+    v2 windowDim = V2((f32)GetScreenWidth(), (f32)GetScreenHeight());
+    f32 fitScale = Min(windowDim.x/gs->winDim.x, windowDim.y/gs->winDim.y);
+    if (fitScale <= 0){ // Minimized
+        fitScale = 1.f;
+    }
+
+    s32 windowIndex = 0;
+    while(windowIndex + 1 < ArrayCount(globalRenderScales) && globalRenderScales[windowIndex + 1] <= fitScale){
+        windowIndex++;
+    }
+    gs->windowRenderScaleIndex = windowIndex;
+    s32 index = gs->renderScaleIndex;
+    if (index < 0){
+        index = MaxS32(0, windowIndex - MaxS32(0, gs->quality.level - Quality_LowerResolution + 1));
+    }
+    gs->usedRenderScaleIndex = index;
+    f32 renderScale = globalRenderScales[index];
 
-        // Corners
-        r = brickDim/2;
-        f32 m = .2f;
-        DrawTriangle(Vector2_(c + -r), Vector2_(c + V2(-r.x, -m*r.y)), Vector2_(c + V2(-m*r.x, -r.y)), Color_(colorCorners));
-        DrawTriangle(Vector2_(c + V2(-r.x, r.y)), Vector2_(c + V2(-m*r.x, r.y)), Vector2_(c + V2(-r.x, m*r.y)), Color_(colorCorners));
-        DrawTriangle(Vector2_(c + r), Vector2_(c + V2(r.x, m*r.y)), Vector2_(c + V2(m*r.x, r.y)), Color_(colorCorners));
-        DrawTriangle(Vector2_(c + V2(r.x, -r.y)), Vector2_(c + V2(m*r.x, -r.y)), Vector2_(c + V2(r.x, -m*r.y)), Color_(colorCorners));
+    v2s targetDim = V2S(gs->winDim*renderScale);
+    if (!gs->renderTarget.id || gs->renderTarget.texture.width != targetDim.x || gs->renderTarget.texture.height != targetDim.y){
+        if (gs->renderTarget.id){
+            UnloadRenderTexture(gs->renderTarget);
+        }
+        gs->renderTarget = LoadRenderTexture(targetDim.x, targetDim.y);
+    }
+    SetTextureFilter(gs->renderTarget.texture, (gs->pixelUpscale ? TEXTURE_FILTER_POINT : TEXTURE_FILTER_BILINEAR));
 
+    gs->presentScale = fitScale;
+    if (gs->pixelUpscale && fitScale >= renderScale){
+        gs->presentScale = renderScale*Floor(fitScale/renderScale);
     }
+    gs->presentPos = V2(Round((windowDim.x - gs->winDim.x*gs->presentScale)/2), Round((windowDim.y - gs->winDim.y*gs->presentScale)/2));
 }
 
-// Draws it centered.
-void DrawBrickShape(brick_shape_slot *slot, v2 centerPos, f32 scale, f32 alpha = 1.f){
+// Runs the quality governor with the last frame's time, and turns down what its level says. Only the
+// last levels lower the resolution, and only when it's auto and there's a lower one left.
+void UpdateQuality(f32 frameTime){
     auto gs = &globalState;
-    v2 p = centerPos - Hadamard(V2(slot->shapeDim), gs->tileDim*scale)/2;
-    v4 col = slot->shape.color;
-    col.a = alpha;
-    f32 m = TILE_DRAW_MARGIN;
-    for(s32 y = 0; y < slot->shapeDim.y; y++){
-        for(s32 x = 0; x < slot->shapeDim.x; x++){
-            if (slot->shape.rows[0][y] & (0x1 << (7 - x))){
-                DrawRectangleV(Vector2_(p + scale*V2(x*gs->tileDim.x + m, y*gs->tileDim.y + m)), Vector2_(scale*(gs->tileDim - V2(2*m))), Color_(col));
-            }
-            if (slot->shape.rows[1][y] & (0x1 << (7 - x))){
-                DrawBrickSpecial(p + scale*V2(x*gs->tileDim.x + m, y*gs->tileDim.y + m), scale*(gs->tileDim - V2(2*m)), slot->shape.specialType, col);
-            }
+    s32 maxLevel = Quality_LowerResolution - 1;
+    if (gs->renderScaleIndex < 0){
+        maxLevel += gs->windowRenderScaleIndex;
+    }
+    UpdateQualityGovernor(&gs->quality, frameTime, maxLevel);
+    gs->ringStep = (gs->quality.level >= Quality_FewerRingSegments ? 2 : 1);
+    gs->particles.emitScale = (gs->quality.level >= Quality_FewerParticles ? .25f : 1.f);
+}
+
+// Draws the frame into the render target, and the target into the window.
+void PresentRenderCommands(render_buffer *rb){
+    auto gs = &globalState;
+    // Before the target is bound: updating it binds its own.
+    for(s32 i = 0; i < rb->numCommands; i++){
+        if (rb->commands[i].type == RenderCommand_Bricks){
+            UpdateBrickLayer(rb->commands[i].bricks.game);
         }
     }
+
+    f32 renderScale = gs->renderTarget.texture.width/gs->winDim.x;
+    BeginTextureMode(gs->renderTarget);
+    rlPushMatrix();
+    rlScalef(renderScale, renderScale, 1.f);
+    DrawRenderCommands(rb);
+    rlPopMatrix();
+    EndTextureMode();
+
+    BeginDrawing();
+    ClearBackground(BLACK);
+    Rectangle src = Rectangle_(0, 0, (f32)gs->renderTarget.texture.width, -(f32)gs->renderTarget.texture.height);
+    DrawTexturePro(gs->renderTarget.texture, src, Rectangle_(gs->presentPos, gs->winDim*gs->presentScale), Vector2_(0), 0, WHITE);
+    EndDrawing();
 }
 
 
+//
+// Match update
+//
 
-void FlipShapeSlot(brick_shape_slot *slot, b32 flipX, b32 flipY, b32 swapXY){
-    auto *gs = &globalState;
-    auto shape = &slot->shape;
-
-    // Flip horizontally
-    if (flipX){
-        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
-            for(s32 j = 0; j < ArrayCount(shape->rows[i]); j++){
-                u8 bits = shape->rows[i][j];
-                shape->rows[i][j] = ((bits >> 7) & 0x01) |
-                                    ((bits >> 5) & 0x02) |
-                                    ((bits >> 3) & 0x04) |
-                                    ((bits >> 1) & 0x08) |
-                                    ((bits << 1) & 0x10) |
-                                    ((bits << 3) & 0x20) |
-                                    ((bits << 5) & 0x40) |
-                                    ((bits << 7) & 0x80);
-            }
+void PlayGameEventSound(game_state *game, game_event *event){
+    auto gs = &globalState;
+    switch(event->type){
+    case GameEvent_BallHit: {
+        if (RandomS32(1)){
+            PlaySound((game->powerupCountdownBigBalls ? gs->sndHeavyBallHit1 : gs->sndBallHit1));
+        }else{
+            PlaySound((game->powerupCountdownBigBalls ? gs->sndHeavyBallHit2 : gs->sndBallHit2));
         }
+    } break;
+    case GameEvent_PaddleLaunch: { PlaySound(gs->sndPaddle); } break;
+    case GameEvent_PaddleHit:    { PlaySound(gs->sndPaddle); PlaySound(gs->sndPaddleHitsBall); } break;
+    case GameEvent_BrickBreak:   { PlaySound(gs->sndCombo[ClampS32(event->value, 0, ArrayCount(gs->sndCombo) - 1)]); } break;
+    case GameEvent_ArrowBounce:  { PlaySound(gs->sndBounce); } break;
+    case GameEvent_Randomizer:   { PlaySound(gs->sndWoot); } break;
+    case GameEvent_SpawnerDrop:  { PlaySound(gs->sndPreerw); } break;
+    case GameEvent_ShapePlaced:  { PlaySound(gs->sndPlace); } break;
+    case GameEvent_LifeLost:     { PlaySound(gs->sndHurt); } break;
+    case GameEvent_PaddleWon:    { PlaySound(gs->sndWinPaddle); } break;
+    case GameEvent_BricksWon:    { PlaySound(gs->sndWinBricks); } break;
+    default: break;
     }
-    // Flip vertically
-    if (flipY){
-        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
-            for(s32 j = 0; j < ArrayCount(shape->rows[i])/2; j++){
-                SWAP(shape->rows[i][j], shape->rows[i][ArrayCount(shape->rows[i]) - 1 - j]);
-            }
+}
+
+// One update of the match: the bots that are on, the game, and the replay. The caller takes the events.
+void StepMatch(game_state *game, game_input *input, f32 dt, b32 runBricksAI){
+    auto gs = &globalState;
+    if (gs->autoPlayPaddle){
+        UpdatePaddleAI(game, &gs->paddleBot, input);
+    }
+    if (runBricksAI && gs->autoPlaceShapes){
+        if (gs->planBricks){
+            UpdateAsyncBricksAI(&gs->bricksAI, game, input);
+        }else{
+            UpdateBricksAI(game, &gs->placementCache, input);
         }
     }
-    // Rotate (Swap x and y)
-    if (swapXY){
-        for(s32 i = 0; i < ArrayCount(shape->rows); i++){
-            Assert(ArrayCount(shape->rows[i]) == 8);
-            for(s32 y = 0; y < 8; y++){
-                for(s32 x = y + 1; x < 8; x++){
-                    u8 bitNE = (shape->rows[i][y] >> (7 - x)) & 0x1;
-                    u8 bitSW = (shape->rows[i][x] >> (7 - y)) & 0x1;
-                    SetOrUnsetFlag(shape->rows[i][y], 1 << (7 - x), bitSW);
-                    SetOrUnsetFlag(shape->rows[i][x], 1 << (7 - y), bitNE);
+    UpdateGame(game, input, dt);
+    RecordReplayFrame(&gs->currentReplay, dt, input, game);
+}
+
+#if SIM_THREAD
+u32 PollMatchKeys(){
+    u32 result = 0;
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
+        result |= SimKey_Right;
+    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
+        result |= SimKey_Left;
+    if (IsKeyDown(KEY_SPACE))
+        result |= SimKey_Launch;
+    return result;
+}
+
+void *SimThreadProc(void *data){
+    auto gs = &globalState;
+    sim_thread *sim = (sim_thread *)data;
+    game_state *game = &gs->game;
+    PcgRandomSeed(sim->randomSeed[0], sim->randomSeed[1]); // The bricks AI's random choices
+    u32 prevKeys = 0;
+    u64 nextTick = GetMicroseconds();
+    while(!AtomicLoadU32(&sim->quit)){
+        u64 now = GetMicroseconds();
+        if (now < nextTick){
+            usleep((u32)(nextTick - now));
+            continue;
+        }
+        if (now - nextTick > SIM_MAX_LAG_MICROSECONDS){
+            nextTick = now;
+        }
+
+        if (!AtomicLoadU32(&sim->pause) && !game->gameEnded){
+            // The keys are the ones the main thread polled on its last frame (Raylib only updates them when it
+            // polls the events), so every tick until the next frame sees the same ones. The placement is read
+            // before the rotations, which the main thread sends first, so a shape is never placed without them.
+            game_input input = {};
+            u32 keys = AtomicLoadU32(&sim->keys);
+            input.right = (keys & SimKey_Right) != 0;
+            input.left = (keys & SimKey_Left) != 0;
+            input.rightPressed = (keys & ~prevKeys & SimKey_Right) != 0;
+            input.leftPressed = (keys & ~prevKeys & SimKey_Left) != 0;
+            input.launch = (keys & SimKey_Launch) != 0;
+            prevKeys = keys;
+            u32 place = AtomicExchangeU32(&sim->placeRequest, 0);
+            for(s32 i = 0; i < ArrayCount(sim->rotations); i++){
+                input.rotateSlot[i] = (s32)AtomicExchangeU32((u32 *)&sim->rotations[i], 0);
+            }
+            if (place){
+                input.placeShape = true;
+                input.placeSlotIndex = (place >> 1) & 0x1;
+                input.placeTilePos = V2S((place >> 8) & 0xFF, (place >> 16) & 0xFF);
+            }
+
+            u32 turbo = MaxU32(AtomicLoadU32(&sim->turbo), 1);
+            u64 turboEnd = GetMicroseconds() + SIM_TURBO_BUDGET_MICROSECONDS;
+
+            sim_snapshot *snapshot = &sim->snapshots[sim->snapshotBuffer.writeSlot];
+            snapshot->prevPaddlePos = game->paddlePos;
+            snapshot->prevNumBalls = game->numBalls;
+            for(s32 i = 0; i < game->numBalls; i++){
+                snapshot->prevBallPos[i] = game->balls[i].pos;
+            }
+            snapshot->prevNumDrops = game->numDrops;
+            for(s32 i = 0; i < game->numDrops; i++){
+                snapshot->prevDropPos[i] = game->drops[i].pos;
+            }
+
+            for(u32 t = 0; t < turbo && !game->gameEnded; t++){
+                StepMatch(game, &input, SIM_TICK_MICROSECONDS/1000000.f, !input.placeShape && !AtomicLoadU32(&sim->dragging));
+
+                u32 written = sim->eventsWritten;
+                u32 read = AtomicLoadU32(&sim->eventsRead);
+                for(s32 i = 0; i < game->numEvents && written - read < SIM_EVENT_QUEUE_SIZE; i++){
+                    sim->events[(written++) & (SIM_EVENT_QUEUE_SIZE - 1)] = game->events[i];
                 }
+                AtomicStoreU32(&sim->eventsWritten, written);
+                game->numEvents = 0;
+
+                // What was pressed only happens on the first tick.
+                input.rightPressed = input.leftPressed = false;
+                input.placeShape = false;
+                ZeroArray(input.rotateSlot);
+                if (GetMicroseconds() > turboEnd)
+                    break;
             }
+
+            snapshot->game = *game;
+            snapshot->tickTime = nextTick;
+            PublishTripleBuffer(&sim->snapshotBuffer);
         }
+        nextTick += SIM_TICK_MICROSECONDS;
     }
+    return 0;
+}
 
-    // Move to top-left
-    v2s offset = {0};
-    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
-        if (shape->rows[0][y])
-            break;
-        offset.y++;
-    }
-    offset.x = 8;
-    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
-        for(s32 x = 0; x < offset.x; x++){
-            if (shape->rows[0][y] & (0x1 << (7 - x))){
-                offset.x = x;
-                break;
-            }
+// Main thread: puts in sim->view the latest snapshot, with what moves placed between the tick before and
+// it by the time since it was due. (So it's drawn a tick late, but moves smoothly at any frame rate.) And
+// plays the sounds of the events that came.
+void UpdateSimView(sim_thread *sim){
+    AcquireTripleBuffer(&sim->snapshotBuffer);
+    sim_snapshot *snapshot = &sim->snapshots[sim->snapshotBuffer.readSlot];
+    f32 t = Clamp01((f32)(s64)(GetMicroseconds() - snapshot->tickTime)/SIM_TICK_MICROSECONDS);
+    game_state *view = &sim->view;
+    *view = snapshot->game;
+    view->paddlePos = LerpV2(snapshot->prevPaddlePos, view->paddlePos, t);
+    f32 maxJump = 40.f; // Balls that respawned on the paddle aren't moved from where they were lost.
+    if (snapshot->prevNumBalls == view->numBalls){
+        for(s32 i = 0; i < view->numBalls; i++){
+            if (Length(view->balls[i].pos - snapshot->prevBallPos[i]) < maxJump)
+                view->balls[i].pos = LerpV2(snapshot->prevBallPos[i], view->balls[i].pos, t);
         }
     }
-    Assert(offset.x < 8 && offset.y < 8);
-    for(s32 i = 0; i < ArrayCount(shape->rows); i++){
-        for(s32 y = 0; y < ArrayCount(shape->rows[i]); y++){
-            s32 ySrc = y + offset.y;
-            shape->rows[i][y] = (ySrc < 8 ? (shape->rows[i][ySrc] << offset.x) : 0);
+    if (snapshot->prevNumDrops == view->numDrops){
+        for(s32 i = 0; i < view->numDrops; i++){
+            if (Length(view->drops[i].pos - snapshot->prevDropPos[i]) < maxJump)
+                view->drops[i].pos = LerpV2(snapshot->prevDropPos[i], view->drops[i].pos, t);
         }
     }
 
-    // Get dim
-    slot->shapeDim = V2S(0);
-    for(s32 y = 0; y < ArrayCount(shape->rows[0]); y++){
-        if (shape->rows[0][y]){
-            slot->shapeDim.y = y + 1;
-            for(s32 x = slot->shapeDim.x; x < 8; x++){
-                if (shape->rows[0][y] & (1 << (7 - x)))
-                    slot->shapeDim.x = x + 1;
-            }
-        }
+    u32 written = AtomicLoadU32(&sim->eventsWritten);
+    for(u32 i = sim->eventsRead; i != written; i++){
+        game_event *event = &sim->events[i & (SIM_EVENT_QUEUE_SIZE - 1)];
+        PlayGameEventSound(view, event);
+        EmitGameEventParticles(&globalState.particles, event);
     }
+    AtomicStoreU32(&sim->eventsRead, written);
 }
-void FillShapeSlot(brick_shape_slot *slot){
-    auto gs = &globalState;
-    slot->occupied = true;
-    // Choose random shape
-    slot->shape = gs->shapeCatalog[RandomS32(ArrayCount(gs->shapeCatalog) - 1)];
-
-    FlipShapeSlot(slot, RandomU32(1), RandomU32(1), RandomU32(1));
-
-    // Place powerup
-    if (RandomChance(gs->specialBrickChance)){
-        s32 numBricks = 0;
-        for(s32 y = 0; y < slot->shapeDim.y; y++){
-            for(s32 x = 0; x < slot->shapeDim.x; x++){
-                numBricks += (s32)((slot->shape.rows[0][y] >> (7 - x)) & 0x1);
-            }
-        }
-        if (numBricks){
-            // Decide special
-            s32 numSpecial = 1;
-            if (RandomChance(.25f)){
-                slot->shape.specialType = SpecialBrick_Arrow;
-                numSpecial = RandomRangeS32(2, 3);
-            }else if (RandomChance(.15f)){
-                slot->shape.specialType = SpecialBrick_Spawner;
-            }else{
-                slot->shape.specialType = (RandomS32(1) ? SpecialBrick_Powerup : SpecialBrick_BadPowerup);
-            }
-            s32 numPlaced = 0;
-            while(numPlaced < numSpecial && numPlaced < numBricks){
-                s32 chosenBrick = RandomS32(numBricks - numPlaced - 1);
-                for(s32 y = 0; y < slot->shapeDim.y; y++){
-                    for(s32 x = 0; x < slot->shapeDim.x; x++){
-                        if (slot->shape.rows[0][y] & (1 << (7 - x)) && !(slot->shape.rows[1][y] & (1 << (7 - x)))){
-                            if (chosenBrick == 0){
-                                SetFlag(slot->shape.rows[1][y], 1 << (7 - x));
-                                numPlaced++;
-                                goto LABEL_SpecialLoopEnd;
-                            }
-                            chosenBrick--;
-                        }
-                    }
-                }
-            LABEL_SpecialLoopEnd:
-                u8 apparentlyWeNeedThisToMakeTheLabelOrSomething = 69;
-            }
+
+// Main thread: what the mouse did this frame. The keys go through sim->keys, polled once a frame.
+void SendMatchInput(sim_thread *sim, game_input *input){
+    for(s32 i = 0; i < ArrayCount(sim->rotations); i++){
+        if (input->rotateSlot[i]){
+            AtomicAddS32(&sim->rotations[i], input->rotateSlot[i]);
         }
     }
-}
-void RotateShape90Degrees(brick_shape_slot *slot, b32 clockwise){
-    // The idea here is that combining the 3 easy operations we can do to the bits
-    // (flip x, flip y, and swap x by y) we can accomplish a 90 degree CW and CCW rotations.
-    // For 90 degree CCW we'll first flip the X and then swap X by Y.
-    // For 90 degree CW we'll first flip the Y and then swap X by Y.
-
-    if (clockwise){
-        FlipShapeSlot(slot, 0, 1, 1);
-    }else{
-        FlipShapeSlot(slot, 1, 0, 1);
+    if (input->placeShape){
+        u32 place = 0x1 | (input->placeSlotIndex << 1) | (input->placeTilePos.x << 8) | (input->placeTilePos.y << 16);
+        AtomicStoreU32(&sim->placeRequest, place);
     }
 }
+#endif
 
-
-drop_state *CreateDrop(v2 pos, drop_type type){
+// Call it when gs->game has been set up for a new match. Does nothing without SIM_THREAD.
+void StartSimThread(){
+#if SIM_THREAD
     auto gs = &globalState;
-    drop_state *result = 0;
-    if (gs->numDrops < ArrayCount(gs->drops)){
-        result = &gs->drops[gs->numDrops];
-        gs->numDrops++;
-
-        ZeroStruct(result);
-        result->pos = pos;
-        result->type = type;
-        if (type >= FIRST_GOOD_DROP && type <= LAST_GOOD_DROP){
-            result->ySpeed = 2.f + RandomBilateral(.3f);
-        }else{
-            result->ySpeed = 1.5f + RandomBilateral(.2f);
-        }
+    sim_thread *sim = &gs->sim;
+    sim->quit = sim->pause = sim->keys = sim->placeRequest = sim->dragging = 0;
+    sim->turbo = 1;
+    sim->randomSeed[0] = PcgRandomU32();
+    sim->randomSeed[1] = PcgRandomU32();
+    ZeroArray(sim->rotations);
+    sim->eventsWritten = sim->eventsRead = 0;
+    for(s32 i = 0; i < ArrayCount(sim->snapshots); i++){
+        sim_snapshot *snapshot = &sim->snapshots[i];
+        snapshot->game = gs->game;
+        snapshot->tickTime = GetMicroseconds();
+        snapshot->prevNumBalls = snapshot->prevNumDrops = -1; // Nothing to interpolate
     }
-    return result;
+    InitTripleBuffer(&sim->snapshotBuffer);
+    sim->view = gs->game;
+    sim->running = (pthread_create(&sim->thread, 0, SimThreadProc, sim) == 0);
+#endif
 }
 
-void DrawTextColorful(char *text, s32 x, s32 y, s32 fontSize, v4 *colors, s32 numColors){
-    s32 xIt = x;
-    s32 colorIndex = 0;
-    for(char *it = text; *it; it++){
-        char tempText[2] = {*it, '\0'};
-        DrawText(tempText, xIt, y, fontSize, Color_(colors[colorIndex]));
-        if (*it != ' ' && *it != '\n' && *it != '\r' && *it != '\t')
-            colorIndex = (colorIndex + 1) % numColors;
-        xIt += MeasureText(tempText, fontSize) + MeasureText("i", fontSize);
+// Returns when the sim thread is gone, so gs->game can be touched again.
+void StopSimThread(){
+#if SIM_THREAD
+    auto gs = &globalState;
+    if (gs->sim.running){
+        AtomicStoreU32(&gs->sim.quit, 1);
+        pthread_join(gs->sim.thread, 0);
+        gs->sim.running = false;
     }
+#endif
 }
 
 v2 MeasureTextV2(char *text, s32 fontSize){
@@ -846,23 +1438,6 @@ v2 MeasureTextV2(char *text, s32 fontSize){
     return result;
 }
 
-f32 BallRadius(){
-    f32 result = DEFAULT_BALL_RADIUS;
-    if (globalState.powerupCountdownBigBalls){
-        result *= 2.f;
-    }
-    return result;
-}
-f32 BallSpeed(){
-    f32 result = DEFAULT_BALL_SPEED;
-    if (globalState.powerupCountdownFastBalls > globalState.powerupCountdownSlowBalls){
-        result *= 1.5f;
-    }else if (globalState.powerupCountdownSlowBalls > globalState.powerupCountdownFastBalls){
-        result *= .66f;
-    }
-    return result;
-}
-
 void UpdateDrawFrame(void)
 {
 
@@ -885,120 +1460,82 @@ void UpdateDrawFrame(void)
 
 
     auto gs = &globalState;
-    gs->mousePos = V2(GetMousePosition());
+    UpdateQuality(getFrameTime);
+    UpdateRenderTarget();
+    gs->mousePos = (V2(GetMousePosition()) - gs->presentPos)/gs->presentScale;
+    gs->textCache.frameIndex++;
 
     v4 defaultButtonColor = V4_Grey(.86f);
     v2 defaultButtonDim = V2(194.f, 40.f);
 
-    // Update and Draw:
-    BeginDrawing();
+    if (IsKeyPressed(KEY_F3)){
+        gs->showRenderStats = !gs->showRenderStats;
+    }
+
+    // Update and Draw (into the render buffer, it's drawn at the end):
+    render_buffer *rb = &gs->renderBuffer;
+    ResetRenderBuffer(rb);
 
     if (gs->metaState == MetaState_MainMenu || gs->metaState == MetaState_Tutorial || gs->metaState == MetaState_Options){
-        ClearBackground(BLACK);
+        RenderClear(rb, V4_Black());
 
 
-        // Draw background effect
+        // Draw background effect (the columns of tiles are baked into texMenuBackground at startup)
         {
-            // Init random
-            pcg_random_state random = { 0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL };
-            // Init colors
-            v4 originalColors[] = { TILE_COLOR_RED, TILE_COLOR_ORANGE, TILE_COLOR_YELLOW, TILE_COLOR_GREEN, TILE_COLOR_BLUE, TILE_COLOR_PURPLE };
-            v4 colors[40];
-            for(s32 i = 0; i < ArrayCount(colors); i++){
-                f32 t = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
-                f32 t2 = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
-                colors[i] = LerpV4(originalColors[i % ArrayCount(originalColors)], V4_Grey(.6f + t2*.2f, t), .2f + t*.3f);
-            }
-            u8 columns[13][30];
-            for(s32 col = 0; col < ArrayCount(columns); col++){
-                for(s32 i = 0; i < ArrayCount(columns[col]); i++){
-                    columns[col][i] = PcgRandomU32(&random) % ArrayCount(colors);
-                }
-            }
-
             f32 loopTime = (f32)fmod(GetTime(), 60.0*3.0)/(60.f*3.f);
             s32 iterationsPerColumn[] = { 4, -8, 6, -4, -7, 2, -3, 7, 8, 3, -9, -6, 2, 6, -5}; // negative for reverse speed
-            f32 initialPosPerColumn[ArrayCount(columns)];
-            for(s32 col = 0; col < ArrayCount(initialPosPerColumn); col++){
-                initialPosPerColumn[col] = (f32)(PcgRandomU32(&random) % 1000)/1000.f;
-            }
-            // Draw
-            v2 tileDim = {gs->winDim.x/(f32)ArrayCount(columns), 28.f};
-            s32 tilesSeenPerColumn = (s32)Ceil(gs->winDim.y/tileDim.y) + 1;
-            for(s32 col = 0; col < ArrayCount(columns); col++){
+            v2 tileDim = {gs->winDim.x/(f32)MENU_NUM_COLUMNS, MENU_TILE_HEIGHT};
+            f32 columnLength = MENU_TILES_PER_COLUMN*tileDim.y;
+            for(s32 col = 0; col < MENU_NUM_COLUMNS; col++){
                 s32 numIterations = iterationsPerColumn[col % ArrayCount(iterationsPerColumn)];
-                f32 a = Clamp(Lerp(.05f, 1.f, Abs((col/(f32)(ArrayCount(columns) - 1))*2.f - 1.f)), .15f, .88f);
+                f32 a = Clamp(Lerp(.05f, 1.f, Abs((col/(f32)(MENU_NUM_COLUMNS - 1))*2.f - 1.f)), .15f, .88f);
 
-                if (gs->metaState == MetaState_Tutorial || gs->metaState == MetaState_Options){
-                    if (col > 0 && col < ArrayCount(columns) - 1)
+                b32 sidesOnly = (gs->metaState == MetaState_Tutorial || gs->metaState == MetaState_Options);
+                if (sidesOnly || gs->quality.level >= Quality_NoMenuBackground){
+                    if (col > 0 && col < MENU_NUM_COLUMNS - 1)
                         continue;
+                }
+                if (sidesOnly){
                     numIterations = (col == 0 ? -4 : 4)*(gs->metaState == MetaState_Tutorial ? 1 : -1);
                     a = .8f;
                 }
 
-                f32 t = Frac(loopTime*(f32)numIterations + initialPosPerColumn[col]);
+                f32 t = Frac(loopTime*(f32)numIterations + gs->menuColumnStarts[col]);
                 if (t < 0)
                     t += 1.f;
-                s32 numTiles = ArrayCount(columns[col]);
-                s32 firstTile = (s32)(t*numTiles);
-                f32 firstTileY = -Frac(t*numTiles)*tileDim.y;
-                for(s32 i = 0; i < tilesSeenPerColumn; i++){
-                    s32 tileIndex = (firstTile + i) % numTiles;
-                    v2 tilePos = {col*tileDim.x, firstTileY + i*tileDim.y};
-                    f32 m = 5.f;
-                    DrawRectangleV(Vector2_(tilePos + V2(m)), Vector2_(tileDim - V2(2*m)), Fade(Color_(colors[columns[col][tileIndex]]), a));
-                }
+                v2 texPos = V2(col*tileDim.x, t*columnLength);
+                v2 dim = V2(tileDim.x, gs->winDim.y);
+                RenderSprite(rb, texPos, dim, V2(col*tileDim.x, 0), dim, V4_White(a), RenderTexture_MenuBackground);
             }
         }
+        rb->layer = RenderLayer_Gui;
             
         if (gs->metaState == MetaState_MainMenu){
             // Draw Title
             char *titleText = "Break-In";
             f32 titleFontSize = 40;
-            DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, 104, titleFontSize, BLACK);
-            DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, 100, titleFontSize, WHITE);
+            RenderText(rb, titleText, gs->winDim.x/2, 104, titleFontSize, V4_Black(), RenderText_CenterX);
+            RenderText(rb, titleText, gs->winDim.x/2, 100, titleFontSize, V4_White(), RenderText_CenterX);
 
             v2 buttonDim = defaultButtonDim;
             v2 buttonPos = (gs->winDim - buttonDim)/2 - V2(0, 20.f);
             if (DoButton(101, buttonPos, buttonDim, "Play", defaultButtonColor, 1) || IsKeyPressed(KEY_ENTER)){//V4(.8f, .6f, .5f))){
                 gs->metaState = MetaState_Game;
 
-                // Zero game variables region of global state.
-                memset(&gs->membersBelowThisGetZeroedOnEveryNewGame, 0, sizeof(global_state) - (umm)&((global_state *)0)->membersBelowThisGetZeroedOnEveryNewGame);
-
-                //
-                // Init game state ,,
-                //
-
-                memset(gs->tiles, 0, sizeof(tile_state)*gs->gridDim.x*gs->gridDim.y);
-                v4 colors[] = { TILE_COLOR_RED, TILE_COLOR_ORANGE, TILE_COLOR_YELLOW, TILE_COLOR_GREEN, TILE_COLOR_BLUE, TILE_COLOR_PURPLE };
-                for(s32 y = 0; y < ArrayCount(colors); y++){
-                    for(s32 x = 0; x < gs->gridDim.x; x++){
-                        tile_state *tile = &gs->tiles[y*gs->gridDim.x + x];
-                        tile->color = colors[y];
-                        tile->occupied = true;
-                    }
-                }
-                gs->gameSpeed = 1.f;
-                gs->speedUpMessageTime = 2.f;
-
-                gs->paddleDim = V2(PADDLE_WIDTH_NORMAL, 10);
-                gs->paddlePos = V2(gs->viewDim.x/2, gs->viewDim.y - 30);
-                gs->paddleLifes = gs->initialPaddleLifes;
-
-                gs->randomizerY = gs->paddlePos.y*.6f;
-                gs->barrierTopY = gs->paddlePos.y + 16.f;
-                gs->barrierHeight = 8.f;
-
-                gs->numBalls = 1;
-                gs->balls[0].flags = BallFlags_OnPaddle | BallFlags_StuckShootRandomly;
-                gs->balls[0].r = DEFAULT_BALL_RADIUS;
-
-                for(s32 i = 0; i < ArrayCount(gs->nextSlots); i++){
-                    FillShapeSlot(&gs->nextSlots[i]);
-                }
-
+                u64 seed = RandomU32() | ((u64)RandomU32() << 32);
+                InitGame(&gs->game, &gs->config, seed);
+                StartReplay(&gs->currentReplay, &gs->game.config, seed);
+                gs->viewPos = (gs->winDim - gs->game.viewDim)/2;
                 gs->draggingShapeIndex = -1;
+                ZeroArray(gs->queuedRotations);
+                InitPaddleBot(&gs->paddleBot);
+                InitPlacementCache(&gs->placementCache, &gs->aiProfiles[gs->aiProfileIndex].weights);
+                ResetAsyncBricksAI(&gs->bricksAI);
+                gs->brickLayerValid = false;
+                gs->pause = false;
+                ClearParticles(&gs->particles);
+                gs->turboTime = gs->speedSampleTime = gs->speedSampleGameTime = 0;
+                StartSimThread();
             }
             buttonPos.y += 60.f;
             if (DoButton(102, buttonPos, buttonDim, "Options", defaultButtonColor, 1)){// V4(.8f, .6f, .5f))){
@@ -1008,11 +1545,21 @@ void UpdateDrawFrame(void)
             if (DoButton(103, buttonPos, buttonDim, "How to Play", defaultButtonColor, 1)){// V4(.8f, .6f, .5f))){
                 gs->metaState = MetaState_Tutorial;
             }
+            buttonPos.y += 60.f;
+            if (DoButton(104, buttonPos, buttonDim, "Watch Bots", defaultButtonColor, 1)){
+                if (!gs->watchGridReady){
+                    gs->watchGridReady = InitMatchGrid(&gs->watchGrid, &gs->config, gs->aiProfiles, gs->numAIProfiles);
+                }
+                if (gs->watchGridReady){
+                    RestartMatchGrid(&gs->watchGrid, globalWatchGridSizes[gs->watchGridSizeIndex], &gs->config);
+                    gs->metaState = MetaState_Watch;
+                }
+            }
 
         }else if (gs->metaState == MetaState_Tutorial){
             char *titleText = "How to Play";
             f32 titleFontSize = 30;
-            DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, 26, titleFontSize, Color_(V4_Grey(.66f)));
+            RenderText(rb, titleText, gs->winDim.x/2, 26, titleFontSize, V4_Grey(.66f), RenderText_CenterX);
 
             const s32 numTabs = 4;
             char *tabNames[numTabs] = {"Basics", "Bricks", "Combo", "Powerups"};
@@ -1029,7 +1576,7 @@ void UpdateDrawFrame(void)
             { // Tab line
                 f32 m = 9.f; // y offset
                 f32 h = 3.f; // line height
-                DrawRectangleV(Vector2_(lineMarginX, tabY + tabDim.y - m), Vector2_(gs->winDim.x - 2*lineMarginX, h), Color_(colorTabActive));
+                RenderRect(rb, V2(lineMarginX, tabY + tabDim.y - m), V2(gs->winDim.x - 2*lineMarginX, h), colorTabActive);
             }
             // Draw tabs
             s32 id = 250;
@@ -1042,14 +1589,14 @@ void UpdateDrawFrame(void)
                 if (tabIndex == gs->tutorialPage){
                     f32 m = 6.f;
                     f32 h = m + 1;
-                    DrawRectangleV(Vector2_(tabPos + V2(0, tabDim.y - m)), Vector2_(tabDim.x, h), BLACK);
+                    RenderRect(rb, tabPos + V2(0, tabDim.y - m), V2(tabDim.x, h), V4_Black());
                 }else{
                     f32 m = 12.f;
                     f32 h = m + 1;
-                    DrawRectangleV(Vector2_(tabPos + V2(0, tabDim.y - m)), Vector2_(tabDim.x, h), BLACK);
+                    RenderRect(rb, tabPos + V2(0, tabDim.y - m), V2(tabDim.x, h), V4_Black());
                     m = 9.f;
                     h = 3.f;
-                    DrawRectangleV(Vector2_(tabPos + V2(0, tabDim.y - m)), Vector2_(tabDim.x, h), Color_(colorTabActive));
+                    RenderRect(rb, tabPos + V2(0, tabDim.y - m), V2(tabDim.x, h), colorTabActive);
                 }
             }
             { // Tab line
@@ -1071,10 +1618,10 @@ mouse, which appear periodically on the right side bar.",
                 f32 y = pageY;
                 f32 x = 200;
                 for(s32 i = 0; i < ArrayCount(text); i++){
-                    x = Min(x, gs->winDim.x/2 - MeasureText(text[i], fontSize)/2);
+                    x = Min(x, gs->winDim.x/2 - MeasureTextCached(text[i], fontSize)/2);
                 }
                 for(s32 i = 0; i < ArrayCount(text); i++){
-                    DrawText(text[i], x, y, fontSize, Color_(textColor));
+                    RenderText(rb, text[i], x, y, fontSize, textColor);
                     y += MeasureTextV2(text[i], fontSize).y + 24.f;
                 }
 
@@ -1083,17 +1630,17 @@ mouse, which appear periodically on the right side bar.",
 Some bricks have special effects. Most fade out after a\n\
 while if they haven't been broken, becoming normal bricks."; 
                 f32 fontSize = 20.f;
-                f32 textX = (gs->winDim.x - MeasureText(text, fontSize))/2;
-                DrawText(text, textX, pageY + 0, fontSize, Color_(textColor));
+                f32 textX = (gs->winDim.x - MeasureTextCached(text, fontSize))/2;
+                RenderText(rb, text, textX, pageY + 0, fontSize, textColor);
             
                 special_brick_type specialTypes[] = {SpecialBrick_Powerup, SpecialBrick_BadPowerup, SpecialBrick_Arrow, SpecialBrick_Spawner};
                 for(s32 i = 0; i < ArrayCount(specialTypes); i++){
                     v2 p = {textX, pageY + 78 + 40*i};
-                    v2 brickDim = gs->tileDim;
+                    v2 brickDim = DEFAULT_TILE_DIM;
                     v2 brickPos = p + V2(0, (fontSize - brickDim.y)/2);
                     v4 brickColor = TILE_COLOR_ORANGE;
-                    DrawRectangleV(Vector2_(brickPos), Vector2_(brickDim), Color_(brickColor));
-                    DrawBrickSpecial(brickPos, brickDim, specialTypes[i], brickColor, 1.f);
+                    RenderRect(rb, brickPos, brickDim, brickColor);
+                    RenderBrickSpecial(rb, brickPos, brickDim, specialTypes[i], brickColor, 1.f, GetTime());
 
                     char *description = "";
                     if (specialTypes[i] == SpecialBrick_Powerup){
@@ -1106,7 +1653,7 @@ while if they haven't been broken, becoming normal bricks.";
                         description = "Spawns bricks around it. Doesn't fade out.";
                     }
                     v2 textPos = p + V2(brickDim.x + 20.f, 0);
-                    DrawText(description, textPos.x, textPos.y, fontSize, WHITE);
+                    RenderText(rb, description, textPos.x, textPos.y, fontSize, V4_White());
                 }
             }else if (gs->tutorialPage == 2){
                 char *text = "\
@@ -1119,14 +1666,14 @@ the breaking sound shows the progress of the combo.\n\
 You can configure this and other features to your\n\
 liking in the options menu.";
                 f32 fontSize = 20.f;
-                DrawText(text, (gs->winDim.x - MeasureText(text, fontSize))/2, pageY, fontSize, Color_(textColor));
+                RenderText(rb, text, gs->winDim.x/2, pageY, fontSize, textColor, RenderText_CenterX);
             
             }else if (gs->tutorialPage == 3){
                 f32 fontSize = 20.f;
                 char *text = "Powerups";
-                DrawText(text, pageMarginX + (gs->winDim.x - 2*pageMarginX)*.25f - MeasureText(text, fontSize)/2, pageY, fontSize, WHITE);
+                RenderText(rb, text, pageMarginX + (gs->winDim.x - 2*pageMarginX)*.25f, pageY, fontSize, V4_White(), RenderText_CenterX);
                 text = "Powerdowns";
-                DrawText(text, pageMarginX + (gs->winDim.x - 2*pageMarginX)*.75f - MeasureText(text, fontSize)/2, pageY, fontSize, Color_(V4(1.f, .2f, .2f)));
+                RenderText(rb, text, pageMarginX + (gs->winDim.x - 2*pageMarginX)*.75f, pageY, fontSize, V4(1.f, .2f, .2f), RenderText_CenterX);
 
                 char *powerupTexts[] = {"Extra life", "Extra ball", "Bigger paddle", "Ball sticks to paddle", "Bigger balls", "Barrier"};
                 char *powerdownTexts[] = {"Faster balls", "Slower balls", "Smaller paddle", "Reversed controls", "Slippery movement", "Speed randomizer"};
@@ -1141,10 +1688,10 @@ liking in the options menu.";
                         v2 texDim = V2(32);
                         v2 texPos = V2(i*texDim.x, 48.f);
                         f32 spriteScale = 1.f;
-                        DrawSprite(texPos, texDim, pos, V2(spriteScale));
+                        RenderSprite(rb, texPos, texDim, pos, texDim*spriteScale);
 
                         v2 textPos = pos + V2(texDim.x*spriteScale + 7.f, (texDim.y*spriteScale - fontSize)/2);
-                        DrawText(powerupTexts[(s32)(type - FIRST_GOOD_DROP)], textPos.x, textPos.y, fontSize, Color_(textColor));
+                        RenderText(rb, powerupTexts[(s32)(type - FIRST_GOOD_DROP)], textPos.x, textPos.y, fontSize, textColor);
                     }
                     // Bad
                     type = (drop_type)((s32)FIRST_BAD_DROP + i);
@@ -1153,10 +1700,10 @@ liking in the options menu.";
                         v2 texDim = V2(32);
                         v2 texPos = V2(i*texDim.x, 80.f);
                         f32 spriteScale = 1.f;
-                        DrawSprite(texPos, texDim, pos, V2(spriteScale));
+                        RenderSprite(rb, texPos, texDim, pos, texDim*spriteScale);
                         
                         v2 textPos = pos + V2(texDim.x*spriteScale + 7.f, (texDim.y*spriteScale - fontSize)/2);
-                        DrawText(powerdownTexts[(s32)(type - FIRST_BAD_DROP)], textPos.x, textPos.y, fontSize, Color_(textColor));
+                        RenderText(rb, powerdownTexts[(s32)(type - FIRST_BAD_DROP)], textPos.x, textPos.y, fontSize, textColor);
                     }
                 }
             }
@@ -1172,19 +1719,19 @@ liking in the options menu.";
             char *titleText = "Options";
             f32 titleFontSize = 30;
             v4 titleColor = V4_Grey(.66f);
-            DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, 30, titleFontSize, Color_(titleColor));
+            RenderText(rb, titleText, gs->winDim.x/2, 30, titleFontSize, titleColor, RenderText_CenterX);
 
             char hint[100] = "";
         
-            v2 widgetDim = {260.f, defaultButtonDim.y};
+            v2 widgetDim = {260.f, 36.f};
             f32 xSep = 48.f;
-            f32 ySep = 20.f;
-            v2 widgetPos = {gs->winDim.x/2 - widgetDim.x - xSep/2, 124.f};
+            f32 ySep = 14.f;
+            v2 widgetPos = {gs->winDim.x/2 - widgetDim.x - xSep/2, 120.f};
             u64 id = 231;
             { // Lifes
                 char text[50];
-                sprintf(text, "Initial Lifes: %i", gs->initialPaddleLifes);
-                gs->initialPaddleLifes = DoSliderS32(++id, widgetPos, widgetDim, text, gs->initialPaddleLifes, 0, 10, defaultButtonColor, 1);
+                sprintf(text, "Initial Lifes: %i", gs->config.initialPaddleLifes);
+                gs->config.initialPaddleLifes = DoSliderS32(++id, widgetPos, widgetDim, text, gs->config.initialPaddleLifes, 0, 10, defaultButtonColor, 1);
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "Initial paddle lifes.");
                 }
@@ -1192,12 +1739,12 @@ liking in the options menu.";
             }
             widgetPos.x = gs->winDim.x/2 + xSep/2;
             { // Shape frequency
-                s32 prevValue = (s32)Round(gs->spawnShapeTime);
+                s32 prevValue = (s32)Round(gs->config.spawnShapeTime);
                 char text[50];
                 sprintf(text, "Shape Period: %is", prevValue);
                 s32 newValue = DoSliderS32(++id, widgetPos, widgetDim, text, prevValue, 3, 13, defaultButtonColor, 1);
                 if (newValue != prevValue){
-                    gs->spawnShapeTime = (f32)newValue;
+                    gs->config.spawnShapeTime = (f32)newValue;
                 }
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "How often new shapes appear.");
@@ -1206,24 +1753,24 @@ liking in the options menu.";
             widgetPos = V2(gs->winDim.x/2 - widgetDim.x - xSep/2, widgetPos.y + widgetDim.y + ySep);
             { // Color combo max
                 char text[50];
-                if (gs->sameColorComboMax){
-                    sprintf(text, "Color Combo: %i", gs->sameColorComboMax);
+                if (gs->config.sameColorComboMax){
+                    sprintf(text, "Color Combo: %i", gs->config.sameColorComboMax);
                 }else{
                     sprintf(text, "Color Combo: NO");
                 }
-                gs->sameColorComboMax = DoSliderS32(++id, widgetPos, widgetDim, text, gs->sameColorComboMax, 0, 5, defaultButtonColor, 1);
+                gs->config.sameColorComboMax = DoSliderS32(++id, widgetPos, widgetDim, text, gs->config.sameColorComboMax, 0, 5, defaultButtonColor, 1);
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "Number of same-colored bricks to break to complete a combo.");
                 }
             }
             widgetPos.x = gs->winDim.x/2 + xSep/2;
             { // Special chance
-                s32 prevValue = Round(Clamp01(gs->specialBrickChance)*10);
+                s32 prevValue = Round(Clamp01(gs->config.specialBrickChance)*10);
                 char text[50];
                 sprintf(text, "Special Brick: %i%%", prevValue*10);
                 s32 newValue = DoSliderS32(++id, widgetPos, widgetDim, text, prevValue, 0, 10, defaultButtonColor, 1);
                 if (newValue != prevValue){
-                    gs->specialBrickChance = Clamp01(newValue/10.f);
+                    gs->config.specialBrickChance = Clamp01(newValue/10.f);
                 }
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "Chance of a special brick appearing in a shape.");
@@ -1232,23 +1779,35 @@ liking in the options menu.";
             widgetPos = V2(gs->winDim.x/2 - widgetDim.x - xSep/2, widgetPos.y + widgetDim.y + ySep);
             { // Speed up
                 char text[50];
-                sprintf(text, "Speed Up: %s", (gs->doSpeedUp ? "YES" : "NO"));
+                sprintf(text, "Speed Up: %s", (gs->config.doSpeedUp ? "YES" : "NO"));
                 if (DoButton(++id, widgetPos, widgetDim, text, defaultButtonColor, 1)){
-                    gs->doSpeedUp = !gs->doSpeedUp;
+                    gs->config.doSpeedUp = !gs->config.doSpeedUp;
                 }
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "Speed up all mechanics every minute.");
                 }
             }
             widgetPos.x = gs->winDim.x/2 + xSep/2;
-            { // Adversarial AI
+            { // AI players
+                // Cycles through these. Bits: 1 bricks, 2 paddle, 4 the bricks use the planner.
+                s32 modes[] = {0, 1, 1|4, 2, 1|2, 1|2|4};
+                char *names[] = {"NO", "Bricks", "Bricks (Hard)", "Paddle", "Both", "Both (Hard)"};
+                s32 mode = (gs->autoPlaceShapes ? 1 : 0) | (gs->autoPlayPaddle ? 2 : 0) | (gs->autoPlaceShapes && gs->planBricks ? 4 : 0);
+                s32 modeIndex = 0;
+                for(s32 i = 0; i < ArrayCount(modes); i++){
+                    if (modes[i] == mode)
+                        modeIndex = i;
+                }
                 char text[50];
-                sprintf(text, "Bricks AI: %s", (gs->autoPlaceShapes ? "YES" : "NO"));
+                sprintf(text, "AI: %s", names[modeIndex]);
                 if (DoButton(++id, widgetPos, widgetDim, text, defaultButtonColor, 1)){
-                    gs->autoPlaceShapes = !gs->autoPlaceShapes;
+                    mode = modes[(modeIndex + 1) % ArrayCount(modes)];
+                    gs->autoPlaceShapes = (mode & 1);
+                    gs->autoPlayPaddle = (mode & 2);
+                    gs->planBricks = (mode & 4);
                 }
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
-                    strcpy(hint, "Place shapes automatically (i.e. single-player mode).");
+                    strcpy(hint, "Let the computer play one side (single-player) or both. Hard bricks plan ahead.");
                 }
             }
             widgetPos = V2(gs->winDim.x/2 - widgetDim.x - xSep/2, widgetPos.y + widgetDim.y + ySep);
@@ -1271,20 +1830,65 @@ liking in the options menu.";
                 }
             }
             widgetPos.x = gs->winDim.x/2 + xSep/2;
+            { // AI profile
+                char text[50];
+                sprintf(text, "AI Level: %s", gs->aiProfiles[gs->aiProfileIndex].name);
+                if (DoButton(++id, widgetPos, widgetDim, text, defaultButtonColor, 1)){
+                    gs->aiProfileIndex = (gs->aiProfileIndex + 1) % gs->numAIProfiles;
+                }
+                if (gs->guiHoveredId == id || gs->guiActiveId == id){
+                    strcpy(hint, "How the bricks AI plays. Tuned levels are loaded from " BRICKS_AI_PROFILES_PATH ".");
+                }
+            }
+            widgetPos = V2(gs->winDim.x/2 - widgetDim.x - xSep/2, widgetPos.y + widgetDim.y + ySep);
             { // Defaults
                 if (DoButton(++id, widgetPos, widgetDim, "Revert to Defaults", defaultButtonColor, 1)){
-                    gs->sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
+                    gs->config.sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
                     gs->masterVolume = DEFAULT_MASTER_VOLUME;
-                    gs->spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
-                    gs->doSpeedUp = DEFAULT_DO_SPEED_UP;
-                    gs->initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
-                    gs->specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
+                    gs->config.spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
+                    gs->config.doSpeedUp = DEFAULT_DO_SPEED_UP;
+                    gs->config.initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
+                    gs->config.specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
                     gs->autoPlaceShapes = false;
+                    gs->autoPlayPaddle = false;
+                    gs->planBricks = false;
+                    gs->aiProfileIndex = 0;
+                    gs->renderScaleIndex = -1;
+                    gs->pixelUpscale = false;
                 }
                 if (gs->guiHoveredId == id || gs->guiActiveId == id){
                     strcpy(hint, "Reset all configuration.");
                 }
             }
+            widgetPos.x = gs->winDim.x/2 + xSep/2;
+            v2 upscaleDim = V2(80.f, widgetDim.y);
+            { // Render resolution
+                char text[50];
+                if (gs->renderScaleIndex < 0){
+                    sprintf(text, "Render: Auto");
+                }else{
+                    sprintf(text, "Render: %gx", globalRenderScales[gs->renderScaleIndex]);
+                }
+                if (DoButton(++id, widgetPos, V2(widgetDim.x - upscaleDim.x - 8.f, widgetDim.y), text, defaultButtonColor, 1)){
+                    gs->renderScaleIndex++;
+                    if (gs->renderScaleIndex >= ArrayCount(globalRenderScales)){
+                        gs->renderScaleIndex = -1;
+                    }
+                }
+                if (gs->guiHoveredId == id || gs->guiActiveId == id){
+                    sprintf(hint, "Drawn at %ix%i. Auto fits the window, and goes lower if it's slow.", gs->renderTarget.texture.width, gs->renderTarget.texture.height);
+                }
+            }
+            { // Upscale filter
+                v2 pos = V2(widgetPos.x + widgetDim.x - upscaleDim.x, widgetPos.y);
+                char *text = (gs->pixelUpscale ? (char *)"Pixels" : (char *)"Smooth");
+                if (DoButton(++id, pos, upscaleDim, text, defaultButtonColor, 1)){
+                    gs->pixelUpscale = !gs->pixelUpscale;
+                }
+                if (gs->guiHoveredId == id || gs->guiActiveId == id){
+                    strcpy(hint, "Scale up smoothly to fit the window, or by whole pixels.");
+                }
+            }
             
             // Hint
             v4 hintColor = V4_Grey(.96f);
@@ -1293,7 +1897,7 @@ liking in the options menu.";
                 hintColor = titleColor;
             }
             f32 fontSize = 20.f;
-            DrawText(hint, (gs->winDim.x - MeasureText(hint, fontSize))/2, 80, fontSize, Color_(hintColor));
+            RenderText(rb, hint, gs->winDim.x/2, 80, fontSize, hintColor, RenderText_CenterX);
 
 
             v2 buttonDim = defaultButtonDim;
@@ -1303,326 +1907,118 @@ liking in the options menu.";
             }
         }
     }else if (gs->metaState == MetaState_Game){
-
-        v2 slotDim = V2(75.f);
-        v2 slotPos0;
-        f32 slotPosOffsetY = slotDim.y + 10.f;
-        {
-            v2 regionPos = {gs->viewPos.x + gs->viewDim.x, 0};
-            v2 regionDim = MaxV2(V2(0), gs->winDim - regionPos);
-            slotPos0 = regionPos + V2(regionDim.x/2 - slotDim.x/2, 30.f);
+        auto game = &gs->game;
+        b32 threaded = false;
+#if SIM_THREAD
+        // The sim thread owns gs->game: we only read its latest snapshot.
+        threaded = gs->sim.running;
+        if (threaded){
+            AtomicStoreU32(&gs->sim.keys, PollMatchKeys());
+            UpdateSimView(&gs->sim);
+            game = &gs->sim.view;
         }
+#endif
+
+        v2 slotDim = V2(SLOT_DIM);
 
         // Pause
         if (IsKeyPressed(KEY_ESCAPE)){
             if (gs->pause){
                 gs->pause = false;
-            }else if (!gs->gameEnded){
+            }else if (!game->gameEnded){
                 gs->pause = true;
             }
         }
 
+        // Fast-forward: F toggles it, [ and ] change the speed.
+        b32 canTurbo = (gs->autoPlayPaddle && gs->autoPlaceShapes);
+        if (IsKeyPressed(KEY_F)){
+            gs->turbo = !gs->turbo;
+        }
+        if (IsKeyPressed(KEY_RIGHT_BRACKET)){
+            gs->turboSpeed = MinS32(gs->turboSpeed*2, MAX_TURBO_SPEED);
+        }
+        if (IsKeyPressed(KEY_LEFT_BRACKET)){
+            gs->turboSpeed = MaxS32(gs->turboSpeed/2, 2);
+        }
+        s32 turbo = (gs->turbo && canTurbo ? gs->turboSpeed : 1);
+#if SIM_THREAD
+        AtomicStoreU32(&gs->sim.pause, gs->pause);
+        AtomicStoreU32(&gs->sim.turbo, turbo);
+#endif
+
         //
         // Update
         //
-        b32 freeze = (gs->pause || gs->gameEnded);
+        b32 freeze = (gs->pause || game->gameEnded);
+
+        game_input input = {};
+        if (!threaded){
+            input.right = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D);
+            input.left = IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A);
+            input.rightPressed = IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D);
+            input.leftPressed = IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A);
+            input.launch = IsKeyDown(KEY_SPACE);
+        }
+        b32 runBricksAI = false;
+        for(s32 i = 0; i < ArrayCount(gs->queuedRotations); i++){
+            input.rotateSlot[i] = gs->queuedRotations[i]; // From the rotate buttons last frame
+            gs->queuedRotations[i] = 0;
+        }
 
         // Drag shape
         v2s draggingShapeTilePos = {};
         b32 isDraggingShapeOnWorld = false;
         b32 isDraggingShapePosValid = false;
-        f32 gameTimePrev = gs->gameTime;
         if (freeze){
             gs->draggingShapeIndex = -1;
         }else{ // Update frame normally
-            gs->gameTime += dt;
-
-            // Speed up game speed every minute.
-            if (gs->doSpeedUp){
-                f32 gameSpeedPrev = gs->gameSpeed;
-                gs->gameSpeed = Min(MAX_GAME_SPEED, 1.f + .1f*Floor(gs->gameTime/60));
-                if (gs->gameSpeed != gameSpeedPrev){
-                    gs->speedUpMessageTimer += dt;
-                }else if (gs->speedUpMessageTimer){
-                    gs->speedUpMessageTimer += dt;
-                    if (gs->speedUpMessageTimer > gs->speedUpMessageTime)
-                        gs->speedUpMessageTimer = 0;
-                }
-            }
-
-            // Reduce powerup timers
-            gs->powerupCountdownBigPaddle        = Max(0, gs->powerupCountdownBigPaddle        - dt*gs->gameSpeed);
-            gs->powerupCountdownMagnet           = Max(0, gs->powerupCountdownMagnet           - dt*gs->gameSpeed);
-            gs->powerupCountdownBigBalls         = Max(0, gs->powerupCountdownBigBalls         - dt*gs->gameSpeed);
-            gs->powerupCountdownBarrier          = Max(0, gs->powerupCountdownBarrier          - dt*gs->gameSpeed);
-            gs->powerupCountdownFastBalls        = Max(0, gs->powerupCountdownFastBalls        - dt*gs->gameSpeed);
-            gs->powerupCountdownSlowBalls        = Max(0, gs->powerupCountdownSlowBalls        - dt*gs->gameSpeed);
-            gs->powerupCountdownSmallPaddle      = Max(0, gs->powerupCountdownSmallPaddle      - dt*gs->gameSpeed);
-            gs->powerupCountdownReverseControls  = Max(0, gs->powerupCountdownReverseControls  - dt*gs->gameSpeed);
-            gs->powerupCountdownSlipperyControls = Max(0, gs->powerupCountdownSlipperyControls - dt*gs->gameSpeed);
-            gs->powerupCountdownRandomizer       = Max(0, gs->powerupCountdownRandomizer       - dt*gs->gameSpeed);
-
-            if (gs->powerupCountdownSmallPaddle > gs->powerupCountdownBigPaddle){
-                gs->paddleDim.x = PADDLE_WIDTH_SMALL;
-            }else if (gs->powerupCountdownBigPaddle > gs->powerupCountdownSmallPaddle){
-                gs->paddleDim.x = PADDLE_WIDTH_BIG;
-            }else{
-                gs->paddleDim.x = PADDLE_WIDTH_NORMAL;
-            }
-
             if (gs->draggingShapeIndex == -1){
                 if (IsMouseButtonPressed(0)){
-                    for(s32 i = 0; i < ArrayCount(gs->availableSlots); i++){
-                        if (!gs->availableSlots[i].occupied)
+                    for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+                        if (!game->availableSlots[i].occupied)
                             continue;
-                        v2 slotPos = slotPos0 + V2(0, slotPosOffsetY*i);
+                        v2 slotPos = SlotPos(game, gs->viewPos, gs->winDim, i);
                         if (PointInRectangle(gs->mousePos, slotPos, slotPos + slotDim)){
                             gs->draggingShapeIndex = i;
                             break;
                         }
                     }
-                }else if (gs->autoPlaceShapes){
-                    //
-                    // AI that places shapes automatically
-                    //
-                    brick_shape_slot *slot = 0;
-                    s32 preferredSlotIndex = RandomS32(ArrayCount(gs->availableSlots) - 1);
-                    for(s32 i = 0; i < ArrayCount(gs->availableSlots); i++){
-                        s32 index = (preferredSlotIndex + i) % ArrayCount(gs->availableSlots);
-                        if (gs->availableSlots[index].occupied){
-                            slot = &gs->availableSlots[index];
-                            break;
-                        }
-                    }
-                    if (slot){
-                        // Figure out if there's a deep hole exposing the top of the screen.
-                        // In that case we'll try harder to cover that region.
-                        b32 emergency = false;
-                        s32 emergencyX = 0;
-                        s32 xStart = RandomS32(gs->gridDim.x - 1); // Start the loop at a random x to avoid always focusing on the hole in the lowest x, because we break when we find the first hole.
-                        for(s32 initialY = 0; initialY < 2; initialY++){
-                            for(s32 i = 0; i < gs->gridDim.x; i++){
-                                s32 x = (xStart + i) % gs->gridDim.x;
-                                emergency = true;
-                                for(s32 y = initialY; y < gs->gridDim.y; y++){
-                                    if (gs->tiles[y*gs->gridDim.x + x].occupied){
-                                        emergency = false;
-                                        break;
-                                    }
-                                }
-                                if (emergency){
-                                    emergencyX = x;
-                                    break;
-                                }
-                            }
-                            if (emergency)
-                                break;
-                        }
-
-                        brick_shape_slot slotBest = *slot;
-                        v2s bestShapePos = {0};
-                        f32 bestHeuristic = 0;
-                        special_brick_type special = slot->shape.specialType;
-                        for(s32 tries = 0; tries < 25; tries++){
-                            // Try to place the shape in a random position and random rotation.
-                            // We do that multiple times and take the best position (higher heuristic).
-                            brick_shape_slot slotTry = *slot;
-                            for(s32 rotations = RandomS32(3); rotations > 0; rotations--){
-                                RotateShape90Degrees(&slotTry, 0); 
-                            }
-                            v2s shapePosMin = V2S(0);
-                            v2s shapePosMax = gs->gridDim - slotTry.shapeDim;
-                            v2s shapePos = {RandomRangeS32(shapePosMin.x, shapePosMax.x), RandomRangeS32(shapePosMin.y, shapePosMax.y)};
-                            f32 emergencyHeuristic = 0;
-                            if (emergency){
-                                if (RandomChance(.6f)){ // Increase probability of spawning with a brick at x=emergencyX
-                                    shapePos.x = ClampS32(emergencyX - RandomS32(slotTry.shapeDim.x - 1), shapePosMin.x, shapePosMax.x);
-                                    emergencyHeuristic += .7f;
-                                }
-                                if (RandomChance(.4f)){ // Increase probability of spawning close to y=0
-                                    shapePos.y = ClampS32((s32)(5*Square(Square(Random01()))), shapePosMin.y, shapePosMax.y);
-                                }
-                                // In an emergency, count being close to 0 more.
-                                emergencyHeuristic += .3f*Square(1.f - Clamp01(shapePos.y/4.f));
-                            }
-                            // Check collision
-                            b32 free = true;
-                            for(s32 y = 0; y < slotTry.shapeDim.y; y++){
-                                for(s32 x = 0; x < slotTry.shapeDim.x; x++){
-                                    if (slotTry.shape.rows[0][y] & (1 << (7 - x))){
-                                        v2s tilePos = shapePos + V2S(x, y);
-                                        if (gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x].occupied){
-                                            free = false;
-                                        }
-                                    }
-                                }
-                            }
-                            if (free){
-                                // Find fraction of empty adjancent tiles
-                                s32 numFreeAdjacentTiles = 0;
-                                s32 numFullAdjacentTiles = 0;
-                                f32 heuristicSpecialPlacement = 0;
-                                f32 specialHeuristicStrength = 0;
-                                for(s32 y = 0; y < slotTry.shapeDim.y; y++){
-                                    for(s32 x = 0; x < slotTry.shapeDim.x; x++){
-                                        if (slotTry.shape.rows[0][y] & (1 << (7 - x))){ // Tile in shape
-                                            s32 numFreeAdjacent = 0;
-                                            s32 numFullAdjacent = 0;
-                                            for(s32 i = 0; i < 4; i++){
-                                                // Test the 4 adjacent tiles
-                                                v2s offsets[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
-
-                                                b32 inShape = false;
-                                                v2s inShapePos = V2S(x, y) + offsets[i];
-                                                if (inShapePos.x >= 0 && inShapePos.y >= 0 && inShapePos.x < slotTry.shapeDim.x && inShapePos.y < slotTry.shapeDim.y){
-                                                    inShape = (slotTry.shape.rows[0][inShapePos.y] & (1 << (7 - inShapePos.x)));
-                                                }
-                                                if (inShape)
-                                                    continue; // Ignore tiles in the same shape.
-
-                                                // Check if it's full or free
-                                                v2s tilePos = shapePos + inShapePos;
-                                                b32 full = true;
-                                                if (tilePos.y >= gs->gridDim.y){
-                                                    full = false;
-                                                }else if (tilePos.x >= 0 && tilePos.y >= 0 && tilePos.x < gs->gridDim.x && tilePos.y < gs->gridDim.y){
-                                                    full = gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x].occupied;
-                                                }
-                                                if (full){
-                                                    numFullAdjacent++;
-                                                }else{
-                                                    numFreeAdjacent++;
-                                                }
-                                            }
-                                            numFreeAdjacentTiles += numFreeAdjacent;
-                                            numFullAdjacentTiles += numFullAdjacent;
-
-                                            // Special brick heuristic.
-                                            if (special && slotTry.shape.rows[1][y] & (1 << (7 - x))){
-                                                b32 tileBelowIsFree = true;
-                                                v2s tileBelow = shapePos + V2S(x, y + 1);
-                                                if (tileBelow.y < gs->gridDim.y){
-                                                    tileBelowIsFree = !gs->tiles[tileBelow.y*gs->gridDim.x + tileBelow.x].occupied;
-                                                    if (tileBelowIsFree && y + 1 < slotTry.shapeDim.y) // Check if tile below is occupied by a tile in the same shape
-                                                        tileBelowIsFree = !(slotTry.shape.rows[0][y + 1] & (1 << (7 - x)));
-                                                }
-                                                b32 tileAboveIsFree = false;
-                                                v2s tileAbove = shapePos + V2S(x, y - 1);
-                                                if (tileAbove.y >= 0){
-                                                    tileAboveIsFree = !gs->tiles[tileAbove.y*gs->gridDim.x + tileAbove.x].occupied;
-                                                    if (tileAboveIsFree && y - 1 >= 0) // Check if tile above is occupied by a tile in the same shape
-                                                        tileAboveIsFree = !(slotTry.shape.rows[0][y - 1] & (1 << (7 - x)));
-                                                }
-
-                                                // Set custom heuristics for each special
-                                                if (special == SpecialBrick_Spawner){
-                                                    specialHeuristicStrength = .5f;
-                                                    heuristicSpecialPlacement = .6f*Square(SafeDivide1((f32)numFullAdjacent, (f32)(numFreeAdjacent + numFullAdjacent))) + .4f*(tileBelowIsFree ? 0 : 1.f); 
-                                                }else if (special == SpecialBrick_Powerup){
-                                                    specialHeuristicStrength = .3f;
-                                                    heuristicSpecialPlacement = .7f*Square(SafeDivide1((f32)numFullAdjacent, (f32)(numFreeAdjacent + numFullAdjacent))) + .3f*(tileBelowIsFree ? 0 : 1.f); 
-                                                }else if (special == SpecialBrick_BadPowerup){
-                                                    specialHeuristicStrength = .3f;
-                                                    f32 howCenteredItIs = 1.f - ((f32)(shapePos.x + x) - (f32)gs->gridDim.x/2.f)/(f32)(gs->gridDim.x/2.f);
-                                                    b32 howCoveredItIs = SafeDivide1((f32)numFreeAdjacent, (f32)(numFreeAdjacent + numFullAdjacent));
-                                                    heuristicSpecialPlacement = .5f*howCoveredItIs + .3f*howCenteredItIs + .2f*(tileBelowIsFree ? 1.f : 0); 
-                                                }else if (special == SpecialBrick_Arrow){
-                                                    specialHeuristicStrength = .4f;
-                                                    heuristicSpecialPlacement = (tileAboveIsFree ? 0 : .66f) + (tileBelowIsFree ? .33f : 0);
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                                f32 fractionAdjacent = SafeDivide1((f32)numFullAdjacentTiles, (f32)(numFreeAdjacentTiles + numFullAdjacentTiles));
-                                f32 heuristicAdjacent = Square(fractionAdjacent);
-
-                                f32 heuristicYPos = Square(MapRangeTo01((f32)shapePos.y, (f32)shapePosMax.y, (f32)shapePosMin.y));
-                                f32 heuristicTime = Square(gs->spawnShapeTimer/gs->spawnShapeTime);
-
-                                // Bring all different heuristics together with different weights
-                                f32 heuristic = heuristicAdjacent*.4f + heuristicYPos*.3f + heuristicTime*.1f + emergencyHeuristic*.8f;
-                                heuristic = Lerp(heuristic, heuristicSpecialPlacement, specialHeuristicStrength);
-
-                                if (heuristic > bestHeuristic){
-                                    bestHeuristic = heuristic;
-                                    bestShapePos = shapePos;
-                                    slotBest = slotTry;
-                                }
-                            }
-                        }
-                        if (RandomChance(Square(bestHeuristic))){
-                            slot->occupied = false;
-                            // Place it down
-                            for(s32 y = 0; y < slotBest.shapeDim.y; y++){
-                                for(s32 x = 0; x < slotBest.shapeDim.x; x++){
-                                    // @CopyPaste
-                                    if (slotBest.shape.rows[0][y] & (1 << (7 - x))){
-                                        v2s tilePos = bestShapePos + V2S(x, y);
-                                        tile_state *dest = &gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x];
-                                        ZeroStruct(dest);
-                                        dest->occupied = true;
-                                        dest->color = slotBest.shape.color;
-                                        if (slotBest.shape.rows[1][y] & (1 << (7 - x))){
-                                            dest->specialType = slotBest.shape.specialType;
-                                            if (dest->specialType != SpecialBrick_BadPowerup)
-                                                dest->specialAlpha = 1.f;
-                                        }
-                                    }
-                                }
-                            }
-                            PlaySound(gs->sndPlace);
-                        }
-                    }
+                }else{
+                    runBricksAI = true;
                 }
             }else{
-                auto slot = &gs->availableSlots[gs->draggingShapeIndex];
+                // The game rotates the slot when it updates, so we work with a rotated copy here.
+                brick_shape_slot slot = game->availableSlots[gs->draggingShapeIndex];
                 // Rotate
                 f32 mouseWheel = GetMouseWheelMove();
                 if (mouseWheel){
-                    RotateShape90Degrees(slot, (mouseWheel < 0));
+                    input.rotateSlot[gs->draggingShapeIndex] += (mouseWheel < 0 ? 1 : -1);
                 }
+                for(s32 r = input.rotateSlot[gs->draggingShapeIndex]; r > 0; r--)
+                    RotateShape90Degrees(&slot, true);
+                for(s32 r = input.rotateSlot[gs->draggingShapeIndex]; r < 0; r++)
+                    RotateShape90Degrees(&slot, false);
+
                 // Find dragging shape tile pos.
-                b32 mouseOnView = PointInRectangle(gs->mousePos, gs->viewPos, gs->viewPos + gs->viewDim); 
+                b32 mouseOnView = PointInRectangle(gs->mousePos, gs->viewPos, gs->viewPos + game->viewDim); 
                 if (mouseOnView){
-                    v2 temp = Hadamard(gs->mousePos - gs->viewPos + gs->tileDim/2 - Hadamard(V2(slot->shapeDim), gs->tileDim)/2, V2(1.f/gs->tileDim.x, 1.f/gs->tileDim.y));
+                    v2 temp = Hadamard(gs->mousePos - gs->viewPos + game->tileDim/2 - Hadamard(V2(slot.shapeDim), game->tileDim)/2, V2(1.f/game->tileDim.x, 1.f/game->tileDim.y));
                     v2s tilePos0 = {(s32)temp.x, (s32)temp.y};
-                    v2s tilePos1 = tilePos0 + slot->shapeDim - V2S(1);
+                    v2s tilePos1 = tilePos0 + slot.shapeDim - V2S(1);
                     // Version 1: you can place anywhere that fits.
-                    if (tilePos0.x >= 0 && tilePos0.y >= 0 && tilePos1.x < gs->gridDim.x && tilePos1.y < gs->gridDim.y){
+                    if (tilePos0.x >= 0 && tilePos0.y >= 0 && tilePos1.x < game->gridDim.x && tilePos1.y < game->gridDim.y){
                         draggingShapeTilePos = tilePos0;
                         isDraggingShapeOnWorld = true;
-                        // Determine if it collides other tiles
-                        isDraggingShapePosValid = true;
-                        for(s32 y = 0; y < slot->shapeDim.y; y++){
-                            for(s32 x = 0; x < slot->shapeDim.x; x++){
-                                if (slot->shape.rows[0][y] & (1 << (7 - x))){
-                                    v2s tilePos = tilePos0 + V2S(x, y);
-                                    if (gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x].occupied){
-                                        isDraggingShapePosValid = false;
-                                    }
-                                }
-                            }
-                        }
+                        isDraggingShapePosValid = CanPlaceShape(game, &slot, tilePos0);
                     }
 
                     // Version 2: Blocks are placed bottom up (you only choose the X)
-                    //tilePos1.y = gs->gridDim.y - 1;
-                    //tilePos0.y = tilePos1.y - slot->shapeDim.y + 1;
-                    //if (tilePos0.x >= 0 && tilePos0.y >= 0 && tilePos1.x < gs->gridDim.x && tilePos1.y < gs->gridDim.y){
+                    //tilePos1.y = game->gridDim.y - 1;
+                    //tilePos0.y = tilePos1.y - slot.shapeDim.y + 1;
+                    //if (tilePos0.x >= 0 && tilePos0.y >= 0 && tilePos1.x < game->gridDim.x && tilePos1.y < game->gridDim.y){
                     //	while(tilePos0.y >= 0){
-                    //		b32 valid = true;
-                    //		for(s32 y = 0; y < slot->shapeDim.y; y++){
-                    //			for(s32 x = 0; x < slot->shapeDim.x; x++){
-                    //				if (slot->shape.rows[0][y] & (1 << (7 - x))){
-                    //					v2s tilePos = tilePos0 + V2S(x, y);
-                    //					if (gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x].occupied){
-                    //						valid = false;
-                    //					}
-                    //				}
-                    //			}
-                    //		}
-                    //		if (valid){
+                    //		if (CanPlaceShape(game, &slot, tilePos0)){
                     //			isDraggingShapeOnWorld = true;
                     //			isDraggingShapePosValid = true;
                     //			draggingShapeTilePos = tilePos0;
@@ -1635,958 +2031,145 @@ liking in the options menu.";
                     //}
                 }
                 if (!IsMouseButtonDown(0)){
-                    gs->draggingShapeIndex = -1;
-
                     if (isDraggingShapePosValid){
-                        slot->occupied = false;
-                        isDraggingShapeOnWorld = isDraggingShapePosValid = false;
                         // Place it down
-                        for(s32 y = 0; y < slot->shapeDim.y; y++){
-                            for(s32 x = 0; x < slot->shapeDim.x; x++){
-                                if (slot->shape.rows[0][y] & (1 << (7 - x))){
-                                    v2s tilePos = draggingShapeTilePos + V2S(x, y);
-                                    tile_state *dest = &gs->tiles[tilePos.y*gs->gridDim.x + tilePos.x];
-                                    ZeroStruct(dest);
-                                    dest->occupied = true;
-                                    dest->color = slot->shape.color;
-                                    if (slot->shape.rows[1][y] & (1 << (7 - x))){
-                                        dest->specialType = slot->shape.specialType;
-                                        if (dest->specialType != SpecialBrick_BadPowerup)
-                                            dest->specialAlpha = 1.f;
-                                    }
-                                }
-                            }
-                        }
-                        PlaySound(gs->sndPlace);
+                        input.placeShape = true;
+                        input.placeSlotIndex = gs->draggingShapeIndex;
+                        input.placeTilePos = draggingShapeTilePos;
+                        isDraggingShapeOnWorld = isDraggingShapePosValid = false;
                     }else if (mouseOnView){
                         PlaySound(gs->sndCantPlace);
                     }
+                    gs->draggingShapeIndex = -1;
                 }
             }
 
-            // Update available slots
-            gs->spawnShapeTimer = Min(gs->spawnShapeTime, gs->spawnShapeTimer + dt*gs->gameSpeed);
-            if (gs->spawnShapeTimer == gs->spawnShapeTime){
-                brick_shape_slot *firstFreeSlot = 0;
-                for(s32 i = 0; i < ArrayCount(gs->availableSlots); i++){
-                    if (!gs->availableSlots[i].occupied){
-                        firstFreeSlot = &gs->availableSlots[i];
-                        break;
-                    }
-                }
-                if (firstFreeSlot){
-                    gs->spawnShapeTimer = 0;
-                    *firstFreeSlot = gs->nextSlots[0];
-                    for(s32 i = 0; i < ArrayCount(gs->nextSlots) - 1; i++){
-                        gs->nextSlots[i] = gs->nextSlots[i + 1];
-                    }
-                    FillShapeSlot(&gs->nextSlots[ArrayCount(gs->nextSlots) - 1]);
-                }
-            }
-
-            // Paddle Movement
-            f32 maxSpeed = (gs->powerupCountdownSlipperyControls ? 10.f : 7.f); // in pix/frame
-            b32 keyRight = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D);
-            b32 keyLeft = IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A);
-            b32 keyRightPressed = IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D);
-            b32 keyLeftPressed = IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A);
-            if (gs->powerupCountdownReverseControls){
-                SWAP(keyRight, keyLeft);
-                SWAP(keyRightPressed, keyLeftPressed);
-            }
-
-            if (!gs->paddleLastInputDir)
-                gs->paddleLastInputDir = 1;
-        
-            if (!keyRight && !keyLeft){
-                // Decel
-                if (gs->powerupCountdownSlipperyControls){
-                    gs->paddleXSpeed = Lerp(MoveTowards(gs->paddleXSpeed, 0, .01f*dtMul*gs->gameSpeed), 0, .02f*dtMul*gs->gameSpeed);
-                }else{
-                    gs->paddleXSpeed = Lerp(MoveTowards(gs->paddleXSpeed, 0, 1.f*dtMul*gs->gameSpeed), 0, .3f*dtMul*gs->gameSpeed);
-                }
-            }else{
-                if (keyRight && keyLeft){
-                    if (keyRightPressed){
-                        gs->paddleLastInputDir = 1;
-                    }else if (keyLeftPressed){
-                        gs->paddleLastInputDir = -1;
-                    }
-                }else if (keyRight){
-                    gs->paddleLastInputDir = 1;
-                }else{
-                    gs->paddleLastInputDir = -1;
-                }
-                f32 target = maxSpeed*gs->paddleLastInputDir;
-                if (gs->powerupCountdownSlipperyControls){
-                    f32 spd = LerpClamp(.025f, .5f, gs->paddleXSpeed/target);
-                    gs->paddleXSpeed = Lerp(MoveTowards(gs->paddleXSpeed, target, spd*dtMul*gs->gameSpeed), target, .03f*dtMul*gs->gameSpeed);
-                }else{
-                    gs->paddleXSpeed = Lerp(MoveTowards(gs->paddleXSpeed, target, .05f*dtMul*gs->gameSpeed), target, .1f*dtMul*gs->gameSpeed);
-                }
-            }
-
-            f32 paddleXMin = gs->paddleDim.x/2;
-            f32 paddleXMax = gs->viewDim.x - gs->paddleDim.x/2;
-            gs->paddlePos.x = Clamp(gs->paddlePos.x + gs->paddleXSpeed*dtMul*gs->gameSpeed, paddleXMin, paddleXMax);
-            if (gs->paddlePos.x == paddleXMin){
-                if (gs->paddleXSpeed < 0){
-                    if (gs->powerupCountdownSlipperyControls){
-                        gs->paddleXSpeed *= -.5f;
-                    }else{
-                        gs->paddleXSpeed = 0;
-                    }
-                }
-            }else if (gs->paddlePos.x == paddleXMax){
-                if (gs->paddleXSpeed > 0){
-                    if (gs->powerupCountdownSlipperyControls){
-                        gs->paddleXSpeed *= -.5f;
-                    }else{
-                        gs->paddleXSpeed = 0;
-                    }
-                }
-            }
-
-            // Set position of balls on the paddle and shoot them out.
-            for(s32 i = 0; i < gs->numBalls; i++){
-                auto b = &gs->balls[i];
-                if (b->flags & BallFlags_OnPaddle){
-                    b->pos = gs->paddlePos + V2(b->positionOnPaddle*gs->paddleDim.x/2, -gs->paddleDim.y/2 - b->r);
-                    b->pos.x = Clamp(b->pos.x, b->r, gs->viewDim.x - b->r);
-
-                    if (IsKeyDown(KEY_SPACE)){
-                        if (CheckFlag(b->flags, BallFlags_StuckShootRandomly)){
-                            f32 minAngle = (.5f*PI/2.f);
-                            b->speed = V2LengthDir(BallSpeed(), Lerp(PI + minAngle, 2*PI - minAngle, Random01()));
-                        }else{
-                            b->speed = BallPaddleBounceDir(b)*BallSpeed();
-                        }
-                        UnsetFlags(b->flags, BallFlags_OnPaddle | BallFlags_StuckShootRandomly);
-                        PlaySound(gs->sndPaddle);
-                    }else{
-                        b->speed = V2(0);
-                    }
-                }
+#if SIM_THREAD
+            if (threaded){
+                AtomicStoreU32(&gs->sim.dragging, gs->draggingShapeIndex != -1);
+                SendMatchInput(&gs->sim, &input);
             }
-    
-            // Update Drops
-            for(s32 i = 0; i < gs->numDrops;){
-                gs->drops[i].pos.y += gs->drops[i].ySpeed*dtMul*gs->gameSpeed;
-
-                b32 remove = (gs->drops[i].pos.y - DROP_RADIUS > gs->winDim.y);
-                if (CircleInRectangle(gs->drops[i].pos, DROP_RADIUS, gs->paddlePos - gs->paddleDim/2, gs->paddleDim)){
-                    remove = true;
-                    switch(gs->drops[i].type){
-                    case Drop_Life: { gs->paddleLifes++; } break;
-                    case Drop_ExtraBall:
-                    case Drop_TwoExtraBalls: 
-                    {
-                        s32 num = (gs->drops[i].type == Drop_TwoExtraBalls ? 2 : 1);
-                        for(s32 index = 0; index < num; index++){
-                            if (gs->numBalls < ArrayCount(gs->balls)){
-                                auto newBall = &gs->balls[gs->numBalls];
-                                ZeroStruct(newBall);
-                                newBall->r = BallRadius();
-                                newBall->pos = gs->paddlePos + V2(0, -gs->paddleDim.y - newBall->r);
-                                f32 originalBallAngle = Random(2*PI);
-                                for(s32 i = 0; i < gs->numBalls; i++){
-                                    if (!CheckFlag(gs->balls[i].flags, BallFlags_OnPaddle)){
-                                        newBall->pos = gs->balls[i].pos;
-                                        originalBallAngle = AngleOf(gs->balls[i].speed);
-                                        break;
-                                    }
-                                }
-                                // Random angle
-                                // Basically we get a random angle except we don't allow it to be too close to the original ball's, because then it's confusing.
-                                // We also don't allow it to be too horizontal.
-                                f32 minAngle = MIN_PADDLE_BOUNCE_ANGLE*.5f;
-                                f32 minAngleDifference = PI*.1f;
-                                f32 angle = NormalizeAngle(originalBallAngle + RandomRange(minAngleDifference, PI - minAngleDifference) + (RandomChance(.5f) ? PI : 0));
-                                if (angle > 0){
-                                    angle = ClampAngle(angle, minAngle, PI - minAngle);
-                                }else{
-                                    angle = ClampAngle(angle, PI + minAngle, 2*PI - minAngle);
-                                }
-                                newBall->speed = V2LengthDir(BallSpeed(), angle);
-                                if (newBall->pos.y > gs->paddlePos.y - 130) // If it's too low we force it to go upwards to be fair to the player.
-                                    newBall->speed.y = -Abs(newBall->speed.y);
-                                gs->numBalls++;
-                            }
-                        }
-                    } break;
-                    case Drop_BigPaddle:        { gs->powerupCountdownBigPaddle        = POWERUP_TIME_BIG_PADDLE; } break;
-                    case Drop_Magnet:           { gs->powerupCountdownMagnet           = POWERUP_TIME_MAGNET; } break;
-                    case Drop_BigBalls:         { gs->powerupCountdownBigBalls         = POWERUP_TIME_BIG_BALLS; } break;
-                    case Drop_Barrier:          { gs->powerupCountdownBarrier          = POWERUP_TIME_BARRIER; } break;
-                    case Drop_FastBalls:        { gs->powerupCountdownFastBalls        = POWERUP_TIME_FAST_BALLS; } break;
-                    case Drop_SlowBalls:        { gs->powerupCountdownSlowBalls        = POWERUP_TIME_SLOW_BALLS; } break;
-                    case Drop_SmallPaddle:      { gs->powerupCountdownSmallPaddle      = POWERUP_TIME_SMALL_PADDLE; } break;
-                    case Drop_ReverseControls:  { gs->powerupCountdownReverseControls  = POWERUP_TIME_REVERSE_CONTROLS; } break;
-                    case Drop_SlipperyControls: { gs->powerupCountdownSlipperyControls = POWERUP_TIME_SLIPPERY_CONTROLS; } break;
-                    case Drop_Randomizer:       { gs->powerupCountdownRandomizer       = POWERUP_TIME_RANDOMIZER; } break;
-                    }
-                    if (gs->drops[i].type >= FIRST_GOOD_DROP && gs->drops[i].type <= LAST_GOOD_DROP){
-                        // TODO Powerup Sound
-                    }else{
-                        // TODO Powerdown Sound
-                    }
-                }
-                if (remove){
-                    gs->numDrops--;
-                    if (i < gs->numDrops){
-                        gs->drops[i] = gs->drops[gs->numDrops]; // Swap by last
-                    }
-                }else{
-                    i++;
-                }
-            }
-
-            // Update Balls
-            for(s32 i = 0; i < gs->numBalls;){
-                auto b = &gs->balls[i];
-                v2 prevPos = b->pos;
-                b->pos += b->speed*dtMul*gs->gameSpeed;
-                b->r = BallRadius();
-                if (b->speed != V2(0)){
-                    b->speed = Normalize(b->speed)*BallSpeed();
-                }
-                b32 playBallHitSound = false;
-                // Bounce off walls
-                v2 minPos = V2(b->r);
-                v2 maxPos = gs->viewDim - V2(b->r);
-                if (b->pos.x < minPos.x){
-                    b->pos.x = minPos.x;
-                    b->speed.x *= -1;
-                    playBallHitSound = true;
-                }else if (b->pos.x > maxPos.x){
-                    b->pos.x = maxPos.x;
-                    b->speed.x *= -1;
-                    playBallHitSound = true;
-                }
-                if (b->pos.y < 0){
-                    gs->gameEnded = true;
-                    gs->paddleWon = true;
-                    PlaySound(gs->sndWinPaddle);
-                }
-                // Barrier
-                if (gs->powerupCountdownBarrier && CircleInRectangle(b->pos, b->r, V2(0, gs->barrierTopY), V2(gs->winDim.x, gs->barrierHeight))){
-                    b->speed.y = -Abs(b->speed.y);
-                    playBallHitSound = true;
-                }
-                // Randomizer
-                if (gs->powerupCountdownRandomizer && CircleInRectangle(b->pos, b->r, V2(0, gs->randomizerY - 10.f), V2(gs->winDim.x, 20.f))){
-                    if (!CheckFlag(b->flags, BallFlags_InRandomizer)){
-                        SetFlag(b->flags, BallFlags_InRandomizer);
-                        if (b->speed != V2(0)){
-                            f32 angleIncrement = RandomRange(PI*.1f, PI*.18f)*(RandomS32(1) ? -1.f : 1.f);
-                            f32 angle = NormalizeAngle(AngleOf(b->speed) + angleIncrement);
-                            f32 minAngle = MIN_PADDLE_BOUNCE_ANGLE*.5f;
-                            if (angle > 0){
-                                angle = ClampAngle(angle, minAngle, PI - minAngle);
-                            }else{
-                                angle = ClampAngle(angle, PI + minAngle, 2*PI - minAngle);
-                            }
-
-                            b->speed = V2LengthDir(Length(b->speed), angle);
-
-                            if (RandomChance(.4f))
-                                b->speed.y *= -1;
-
-                            PlaySound(gs->sndWoot);
-                        }
-                    }
-                }else{
-                    UnsetFlag(b->flags, BallFlags_InRandomizer);
+#endif
+            if (!threaded){
+                // Fast-forward runs whole ticks, and what was pressed only happens on the first.
+                s32 numSteps = 1;
+                f32 stepDt = dt;
+                if (turbo > 1){
+                    gs->turboTime += dt*turbo;
+                    numSteps = (s32)(gs->turboTime/GAME_TICK_DT);
+                    gs->turboTime -= numSteps*GAME_TICK_DT;
+                    stepDt = GAME_TICK_DT;
                 }
-                b32 incrementI = true;
-                if (b->pos.y - b->r > gs->winDim.y){ // Ball was lost downscreen
-                    gs->numBalls--;
-                    if (gs->numBalls == 0){
-                        PlaySound(gs->sndHurt);
-                        if (gs->paddleLifes){
-                            gs->paddleLifes--;
-                            gs->numBalls++;
-                            // Spawn new ball
-                            ZeroStruct(b);
-                            b->r = DEFAULT_BALL_RADIUS;
-                            SetFlags(b->flags, BallFlags_OnPaddle | BallFlags_StuckShootRandomly);
-                        }else{
-                            gs->gameEnded = true;
-                            gs->paddleWon = false;
-                            PlaySound(gs->sndWinBricks);
-                        }
-                    }else{
-                        *b = gs->balls[gs->numBalls]; // Fill the hole in the array with the last element
-                    }
-                }else{ // (Ball wasn't removed)
-                    // Collide paddle
-                    if (b->speed.y > 0 && CircleInRectangle(b->pos, b->r, gs->paddlePos - gs->paddleDim/2, gs->paddleDim)){
-                        if (gs->powerupCountdownMagnet){
-                            // Stick to paddle.
-                            SetFlag(b->flags, BallFlags_OnPaddle);
-                            b->positionOnPaddle = Clamp((b->pos.x - gs->paddlePos.x)/(gs->paddleDim.x/2), -1.f, 1.f);
-                            b->pos = gs->paddlePos + V2(b->positionOnPaddle*gs->paddleDim.x/2, -gs->paddleDim.y/2 - b->r);
-                            b->pos.x = Clamp(b->pos.x, b->r, gs->viewDim.x - b->r);
-                            b->speed = V2(0);
-                        }else{
-                            // Bounce normally
-                            v2 paddleCornerTopLeft = gs->paddlePos + V2(-gs->paddleDim.x/2, -gs->paddleDim.y/2);
-                            v2 paddleCornerTopRight = gs->paddlePos + V2(gs->paddleDim.x/2, -gs->paddleDim.y/2);
-                            v2 speedN = RotateMinus90Degrees(Normalize(b->speed));
-                            f32 leftProj = Dot(speedN, paddleCornerTopLeft - b->pos);
-                            f32 rightProj = Dot(speedN, paddleCornerTopRight - b->pos);
-                            if (leftProj - b->r < 0 && rightProj + b->r > 0){ // Ball speed line intersects paddle's top edge.
-                                v2 newPos = b->pos;
-                                newPos.y = gs->paddlePos.y - gs->paddleDim.y/2 - b->r;
-                                if (b->speed.y){
-                                    newPos.x = b->pos.x + (newPos.y - b->pos.y)*b->speed.x/b->speed.y;
-                                }
-                                b->pos = b->pos + LimitLengthV2(newPos - b->pos, Length(b->speed*dtMul*gs->gameSpeed));
-                                b->pos.x = Clamp(b->pos.x, minPos.x, maxPos.x);
-
-                                b->speed = BallPaddleBounceDir(b)*BallSpeed();
-                            }
-                            PlaySound(gs->sndPaddle);
-                            PlaySound(gs->sndPaddleHitsBall);
-                        }
-                    }
-
-                    // Collide tiles
-                    v2s tileMin = {(s32)Clamp((b->pos.x - b->r)/gs->tileDim.x, 0, gs->gridDim.x - 1),
-                                   (s32)Clamp((b->pos.y - b->r)/gs->tileDim.y, 0, gs->gridDim.y - 1)};
-                    v2s tileMax = {(s32)Clamp((b->pos.x + b->r)/gs->tileDim.x, 0, gs->gridDim.x - 1),
-                                   (s32)Clamp((b->pos.y + b->r)/gs->tileDim.y, 0, gs->gridDim.y - 1)};
-
-                    // Get the ball very close to the edge
-                    f32 numerator = 1;
-                    f32 denominator = 1;
-                    v2 p = prevPos;
-                    v2s collidedTiles[6];
-                    s32 numCollidedTiles = 0;
-                    Assert((tileMax.x - tileMin.x)*(tileMax.y - tileMin.y) <= ArrayCount(collidedTiles));
-                    f32 m = 0;//3.f;
-                    for(s32 j = 0; j < 20; j++){
-                        f32 t = numerator/denominator;
-                        v2 checkPos = LerpV2(prevPos, b->pos, t);
-                        numerator *= 2;
-                        denominator *= 2;
-                        b32 collided = false;
-                        for(s32 y = tileMin.y; y <= tileMax.y; y++){
-                            for(s32 x = tileMin.x; x <= tileMax.x; x++){
-                                if (!gs->tiles[y*gs->gridDim.x + x].occupied)
-                                    continue;
-                                v2 tilePos = {x*gs->tileDim.x, y*gs->tileDim.y};
-                                if (CircleInRectangle(checkPos, b->r, tilePos + V2(m), gs->tileDim - V2(2*m))){
-                                    if (!collided){
-                                        numCollidedTiles = 0; // Clear collision data from previous iterations
-                                        collided = true;
-                                    }
-                                    collidedTiles[numCollidedTiles] = V2S(x, y);
-                                    numCollidedTiles++;
-                                }
-                            }
-                        }
-                        if (collided){
-                            numerator -= 1;
-                        }else{
-                            p = checkPos;
-                            if (numerator == denominator)
-                                break; // No collisions at first iteration.
-                            numerator += 1;
-                        }
+                u64 turboEnd = GetMicroseconds() + TURBO_BUDGET_MICROSECONDS;
+                for(s32 step = 0; step < numSteps && !game->gameEnded; step++){
+                    StepMatch(game, &input, stepDt, runBricksAI);
+
+                    // Sounds and particles of what happened
+                    for(s32 i = 0; i < game->numEvents; i++){
+                        PlayGameEventSound(game, &game->events[i]);
+                        EmitGameEventParticles(&gs->particles, &game->events[i]);
                     }
-                    b->pos = p;
-                    if (numCollidedTiles){
-                        // Bounce
-
-                        // Find closest edge to bounce against.
-                        v2 n = Normalize(-b->speed);
-                        f32 bestDistance = MAX_F32;
-                        for(s32 j = 0; j < numCollidedTiles; j++){
-                            v2 tilePos = Hadamard(V2(collidedTiles[j]), gs->tileDim) + V2(m);
-                            v2 brickPos = tilePos + V2(m);
-                            v2 brickDim = gs->tileDim - V2(2*m);
-                            v2 dis = {0, 0};
-                            if (b->speed.x > 0 && p.x < brickPos.x){
-                                dis.x = p.x - brickPos.x;
-                            }else if (b->speed.x < 0 && p.x > brickPos.x + brickDim.x){
-                                dis.x = p.x - (brickPos.x + brickDim.x);
-                            }
-                            if (b->speed.y > 0 && p.y < brickPos.y){
-                                dis.y = p.y - brickPos.y;
-                            }else if (b->speed.y < 0 && p.y > brickPos.y + brickDim.y){
-                                dis.y = p.y - (brickPos.y + brickDim.y);
-                            }
-                            f32 length = Length(dis);
-                            if (length < bestDistance){
-                                bestDistance = length;
-
-                                if (Abs(dis.x) > Abs(dis.y)){
-                                    n = V2(SignNonZero(dis.x), 0);
-                                }else{
-                                    n = V2(0, SignNonZero(dis.y));
-                                }
-                            }
-
-                            b32 startedInside = CircleInRectangle(b->pos, b->r, tilePos + V2(m), gs->tileDim - V2(2*m));
-
-                            auto tile = &gs->tiles[collidedTiles[j].y*gs->gridDim.x + collidedTiles[j].x];
-                            if (tile->specialType == SpecialBrick_Arrow && n != V2(0, -1.f) && !startedInside){
-                                // Bounce arrow brick
-                                if (b->speed.y < 0 && n.x){
-                                    b->speed.y *= -1.f;
-                                }
-                                PlaySound(gs->sndBounce);
-                            }else{ // Break brick normally
-                                // Drop
-                                if (tile->specialType != SpecialBrick_None && tile->specialAlpha > .5f){
-                                    if (gs->numDrops < ArrayCount(gs->drops)){
-                                        gs->drops[gs->numDrops].pos = tilePos + gs->tileDim/2;
-                                        if (tile->specialType == SpecialBrick_Spawner){
-                                            drop_type type;
-                                            if (RandomChance(.5f)){
-                                                type = (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP);
-                                            }else{
-                                                type = (drop_type)RandomRangeS32((s32)FIRST_BAD_DROP, (s32)LAST_BAD_DROP);
-                                            }
-                                            PlaySound(gs->sndPreerw);
-
-                                            CreateDrop(tilePos + gs->tileDim/2, type);
-                                        }else if (tile->specialType == SpecialBrick_Powerup){
-                                            CreateDrop(tilePos + gs->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP));
-                                        }else if (tile->specialType == SpecialBrick_BadPowerup){
-                                            CreateDrop(tilePos + gs->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_BAD_DROP, (s32)LAST_BAD_DROP));
-                                        }
-                                    }
-                                }
-                                s32 soundIndex = 1;
-                                if (gs->sameColorComboMax){ // Combo is enabled
-                                    // Combo
-                                    if (tile->color == gs->sameColorComboLastColor){
-                                        gs->sameColorCombo++;
-                                    }else{
-                                        gs->sameColorComboLastColor = tile->color;
-                                        gs->sameColorCombo = 1;
-                                    }
-                                    // Sound
-                                    if (gs->sameColorComboMax == ArrayCount(gs->sndCombo)){
-                                        soundIndex = (gs->sameColorCombo - 1) % ArrayCount(gs->sndCombo);
-                                    }else{
-                                        soundIndex = 1 + ((gs->sameColorCombo - 1) % gs->sameColorComboMax);
-                                        soundIndex = ClampS32(soundIndex, 0, ArrayCount(gs->sndCombo) - 1);
-                                    }
-                                        
-                                    if (gs->sameColorCombo % gs->sameColorComboMax == 0){
-                                        // Finished combo: drop powerup.
-                                        CreateDrop(tilePos + gs->tileDim/2, (drop_type)RandomRangeS32((s32)FIRST_GOOD_DROP, (s32)LAST_GOOD_DROP));
-                                        soundIndex = ArrayCount(gs->sndCombo) - 1; // Chord sound
-                                    }
-                                }
-                                PlaySound(gs->sndCombo[soundIndex]);
-                                ZeroStruct(tile); // (tile->occupied = false;)
-                            }
-                        }
+                    game->numEvents = 0;
 
-                        b->speed = b->speed - 2*Dot(b->speed, n)*n; // Bounce
-                    }
-                }
-                if (playBallHitSound){
-                    if (RandomS32(1)){
-                        PlaySound((gs->powerupCountdownBigBalls ? gs->sndHeavyBallHit1 : gs->sndBallHit1));
-                    }else{
-                        PlaySound((gs->powerupCountdownBigBalls ? gs->sndHeavyBallHit2 : gs->sndBallHit2));
+                    input.rightPressed = input.leftPressed = false;
+                    input.placeShape = false;
+                    ZeroArray(input.rotateSlot);
+                    if (GetMicroseconds() > turboEnd){
+                        gs->turboTime = 0; // Can't keep up
+                        break;
                     }
                 }
-
-                if (incrementI)
-                    i++;
             }
+            UpdateParticles(&gs->particles, dt);
         }
 
         //
         // Draw
         //
-        
-        v4 guiBackgroundColor = V4(.6f, .3f, .4f);
-        v4 backgroundColor = V4(.1f, .02f, .12f);
-        // View background
-        DrawRectangleV(Vector2_(gs->viewPos.x, 0), Vector2_(gs->viewDim.x, gs->winDim.y), Color_(backgroundColor)); 
-
-        // Draw drops
-        for(s32 i = 0; i < gs->numDrops; i++){
-            v2 texDim = V2(32.f);
-            v2 texPos = V2(((s32)gs->drops[i].type)*texDim.x, 48.f);
-            if (gs->drops[i].type >= FIRST_BAD_DROP){
-                texPos = V2(((s32)gs->drops[i].type - (s32)FIRST_BAD_DROP)*texDim.x, 80.f);
-            }
-            f32 scale = 1.f;
-            DrawSprite(texPos, texDim, gs->viewPos + gs->drops[i].pos - texDim*scale/2, V2(scale));
-        }
-
-        // Draw (and update) bricks
-        for(s32 y = 0; y < gs->gridDim.y; y++){
-            for(s32 x = 0; x < gs->gridDim.x; x++){
-                tile_state *tile = &gs->tiles[y*gs->gridDim.x + x];
-                if (tile->occupied){
-                    f32 m = TILE_DRAW_MARGIN;
-                    v2 p = gs->viewPos + V2(x*gs->tileDim.x, y*gs->tileDim.y);
-                    DrawRectangleV(Vector2_(p + V2(m)), Vector2_(gs->tileDim - V2(m*2)), Color_(tile->color));
-                    if (tile->specialType != SpecialBrick_None){
-                        if (tile->specialType == SpecialBrick_Spawner){
-                            f32 spawnRate = 5.f;
-                            if ((s32)(gs->gameTime/spawnRate) != (s32)(gameTimePrev/spawnRate)){
-                                // Spawn
-                                s32 emptyCount = 0;
-                                s32 r = 2;
-                                v2s minTile = MaxV2S(V2S(0), V2S(x - r, y - r));
-                                v2s maxTile = MinV2S(gs->gridDim - V2S(1), V2S(x + r, y + r));
-                                for(s32 ty = minTile.y; ty <= maxTile.y; ty++){
-                                    for(s32 tx = minTile.x; tx <= maxTile.x; tx++){
-                                        if (!gs->tiles[ty*gs->gridDim.x + tx].occupied){
-                                            emptyCount++;
-                                        }
-                                    }
-                                }
-                                if (emptyCount){
-                                    s32 chosenTile = RandomS32(emptyCount - 1);
-                                    for(s32 ty = minTile.y; ty <= maxTile.y; ty++){
-                                        for(s32 tx = minTile.x; tx <= maxTile.x; tx++){
-                                            tile_state *emptyTile = &gs->tiles[ty*gs->gridDim.x + tx];
-                                            if (!emptyTile->occupied){
-                                                if (chosenTile == 0){
-                                                    ZeroStruct(emptyTile);
-                                                    emptyTile->occupied = true;
-                                                    emptyTile->color = tile->color;
-                                                }
-                                                chosenTile--;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                            DrawBrickSpecial(p + V2(m), gs->tileDim - V2(m*2), tile->specialType, tile->color, tile->specialAlpha);
-                        }else{ // Momentary Special Bricks
-                            if (!freeze){
-                                tile->specialTypeTimer += dt;
-                            }
-                            tile->specialAlpha = Min(1.f, tile->specialAlpha + 1.3f*dt*gs->gameSpeed);
-                            f32 destroyTime = 60.f;
-                            f32 fadeoutTime = 15.f;
-                            f32 alpha = MapRangeToRangeClamp(tile->specialTypeTimer, destroyTime, destroyTime - fadeoutTime, .15f, 1.f);
-                            if (tile->specialTypeTimer >= destroyTime){
-                                tile->specialType = SpecialBrick_None;
-                                tile->specialTypeTimer = 0;
-                            }else{
-                                DrawBrickSpecial(p + V2(m), gs->tileDim - V2(m*2), tile->specialType, tile->color, tile->specialAlpha*alpha);
-                            }
-                        }
-                    }
-                }
-            }
+        UpdateHudPowerups(&gs->hud, game);
+        match_view view = {};
+        view.winDim = gs->winDim;
+        view.viewPos = gs->viewPos;
+        view.time = GetTime();
+        view.hud = &gs->hud;
+        view.particles = &gs->particles;
+        view.plainSpecials = (gs->quality.level >= Quality_PlainSpecials);
+        view.draggingShapeIndex = gs->draggingShapeIndex;
+        view.mousePos = gs->mousePos;
+        view.isDraggingShapeOnWorld = isDraggingShapeOnWorld;
+        view.isDraggingShapePosValid = isDraggingShapePosValid;
+        view.draggingShapeTilePos = draggingShapeTilePos;
+        DrawMatch(rb, game, &view);
+
+        // Fast-forward, with the speed it really goes at (measured every half second).
+        gs->speedSampleTime += getFrameTime;
+        if (gs->speedSampleTime >= .5f){
+            gs->effectiveSpeed = Max(0, game->gameTime - gs->speedSampleGameTime)/gs->speedSampleTime;
+            gs->speedSampleTime = 0;
+            gs->speedSampleGameTime = game->gameTime;
         }
-        // Draw Paddle
-        {
-            v4 paddleColor = V4_White();
-            if (gs->powerupCountdownReverseControls){
-                paddleColor = V4(.98f, .9f, .12f);
-            }else if (gs->powerupCountdownSlipperyControls){
-                paddleColor = V4(.25f, 1.f, 1.f);
-            }
-            //DrawRectangleV(Vector2_(gs->viewPos + gs->paddlePos - gs->paddleDim/2), Vector2_(gs->paddleDim), Color_(paddleColor)); // Draws rectangular paddle instead of rounded
-            DrawRectangleV(Vector2_(gs->viewPos + gs->paddlePos - gs->paddleDim/2 + V2(gs->paddleDim.y/2, 0)), Vector2_(gs->paddleDim - V2(gs->paddleDim.y, 0)), Color_(paddleColor));
-            DrawCircleV(Vector2_(gs->viewPos + gs->paddlePos + V2(-gs->paddleDim.x/2 + gs->paddleDim.y/2, 0)), gs->paddleDim.y/2, Color_(paddleColor));
-            DrawCircleV(Vector2_(gs->viewPos + gs->paddlePos + V2( gs->paddleDim.x/2 - gs->paddleDim.y/2, 0)), gs->paddleDim.y/2, Color_(paddleColor));
-
-            if (gs->powerupCountdownMagnet){
-                for(s32 i = 0; i < gs->numBalls; i++){
-                    if (CheckFlag(gs->balls[i].flags, BallFlags_OnPaddle) && !CheckFlag(gs->balls[i].flags, BallFlags_StuckShootRandomly)){
-                        v2 rd = BallPaddleBounceDir(&gs->balls[i]); // Ray dir
-                        v2 ro = gs->balls[i].pos + rd*gs->balls[i].r; // Ray origin
-                        if (!rd.y)
-                            break;
-                        // Collide walls
-                        if (rd.x){
-                            // Equation of left wall: x=0
-                            // Equation of ray:  pos = ro + rd*t
-                            // 0 = ro.x + rd.x*t
-                            // t = -ro.x/rd.x
-                            f32 leftT = -ro.x/rd.x;
-                            v2 leftP = ro + rd*leftT;
-                            // Similar thing for right wall...
-                            f32 rightT = (gs->viewDim.x - ro.x)/rd.x;
-                            v2 rightP = ro + rd*rightT;
-
-                            f32 maxT = gs->balls[i].pos.y - gs->tileDim.y*gs->gridDim.y;
-                            f32 t = maxT;
-                            if (leftT > 0){
-                                t = Min(t, leftT);
-                            }else if (rightT > 0){
-                                t = Min(t, rightT);
-                            }
-                            s32 numSegments = (s32)Max(1.f, t/5.f);
-                            for(s32 j = 0; j < numSegments; j++){
-                                f32 t0 = j*t/(f32)numSegments;
-                                f32 t1 = (j + 1)*t/(f32)numSegments;
-                                f32 alpha = Square(1.f - (j/(f32)numSegments)*(t/maxT))*.8f;
-                                DrawLineEx(Vector2_(gs->viewPos + ro + rd*t0), Vector2_(gs->viewPos + ro + rd*t1), 3.f, Color_(V4(1.f, .3f, .5f, alpha)));
-                            }
-
-                        }
-                    }
-                }
-            }
-        }
-        
-        // Draw Barrier
-        if (gs->powerupCountdownBarrier){
-            v2 barrierPos = gs->viewPos + V2(0, gs->barrierTopY);
-            DrawRectangleV(Vector2_(barrierPos), Vector2_(gs->viewDim.x, gs->barrierHeight), WHITE);
-
-            f32 d = gs->barrierHeight; // diagonal width and height (becauseangle is 45 deg)
-            s32 num = (s32)(gs->viewDim.x/(d*4) + .5f);
-            f32 lineWidth = gs->viewDim.x/(num*2);
-            v4 color = V4(1.f, .4f, .96f);
-            for(s32 i = 0; i < num; i++){
-                v2 p = barrierPos + V2(lineWidth*2*i, 0);
-                Vector2 vertices[4] = { Vector2_(p + V2(d, 0)),
-                                        Vector2_(p + V2(0, d)),
-                                        Vector2_(p + V2(lineWidth, d)),
-                                        Vector2_(p + V2(d + lineWidth, 0)) };
-                DrawTriangleFan(vertices, 4, Color_(color));
-            }
-        }
-        
-        // Draw Randomizer
-        if (gs->powerupCountdownRandomizer){
-            s32 num = (s32)Round(gs->viewDim.x/50.f);
-            for(s32 i = 0; i < num; i++){
-                f32 sep = gs->viewDim.x/(2.f*num);
-                v2 pos = gs->viewPos + V2((1.f + 2.f*i)*sep, gs->randomizerY);
-                v2 dim = {(f32)MeasureText("?", 20), 20.f};
-                DrawText("?", (s32)(pos.x - dim.x/2), (s32)(pos.y - dim.y/2), 20, Color_(V4(1.f,  .4f, .97f)));
-            }
-        }
-
-        // Draw Balls
-        for(s32 i = 0; i < gs->numBalls; i++){
-            DrawCircleV(Vector2_(gs->viewPos + gs->balls[i].pos), gs->balls[i].r, Color_(V4_Grey((gs->powerupCountdownMagnet ? .55f : 1.f))));
-        }
-
-
-        //
-        // GUI
-        //
-        
-        // "Speed up" message
-        char speedStr[50];
-        sprintf(speedStr, (Abs(Frac(gs->gameSpeed + .5f) - .5f) < .001f ? "%.0fx" : "%.01fx"), gs->gameSpeed);
-            
-        if (gs->speedUpMessageTimer){
-            f32 t = Clamp01(gs->speedUpMessageTimer/gs->speedUpMessageTime);
-            f32 h = 100.f;
-
-            f32 a = Min(1.f, gs->speedUpMessageTimer/.3f); // Fade in
-            f32 fadeout = Clamp01((gs->speedUpMessageTime - gs->speedUpMessageTimer)/.33f); // Fade out
-            a = Min(a, fadeout);
-            f32 alpha = a*(.4f + Map01ToBellSin(t)*.3f);
-
-            DrawRectangleV(Vector2_(gs->viewPos.x, gs->winDim.y/2 - h/2), Vector2_(gs->viewDim.x, h), Fade(WHITE, alpha));
-            char *str = "Speed up!";
-            f32 fontSize = 40.f;
-            f32 xOff = Lerp(-60.f, 50.f, t*.1f + Map01ToArcSin(t)*.9f) + (t*t*t)*100.f + (1.f - fadeout)*30.f;
-            f32 textWidth = MeasureText(str, fontSize);
-            v2 textPos = V2(gs->viewPos.x + gs->viewDim.x/2 - textWidth/2 + xOff, gs->winDim.y/2 - fontSize/2 - 20.f);
-            // I think the "Ex" version gives better anti-aliasing/stuttering results.
-            DrawTextEx(GetFontDefault(), str, Vector2_(textPos), fontSize, 2.f, Fade(BLACK, Min(1.f, alpha + .3f)));
-            //DrawText(str, textPos.x, textPos.y, fontSize, Fade(BLACK, Min(1.f, alpha + .3f)));
-
-            // Secondary text
-            fontSize = 20;
-            xOff = xOff*.7f;//Lerp(-60.f, 60.f, t*.1f + Map01ToArcSin(t)*.9f);
-            v2 text2Pos = V2(gs->viewPos.x + gs->viewDim.x/2 - MeasureText(speedStr, 20)/2 + xOff, gs->winDim.y/2 + 15.f);
-            DrawTextEx(GetFontDefault(), speedStr, Vector2_(text2Pos), fontSize, 2.f, Color_(V4_Grey(.15f, Min(1.f, alpha + .0f))));
-        }
-
-        // GUI background (side bars)
-        DrawRectangleV(Vector2_(0), Vector2_(gs->viewPos.x, gs->winDim.y), Color_(guiBackgroundColor));
-        DrawRectangleV(Vector2_(gs->viewPos.x + gs->viewDim.x, 0), Vector2_(gs->winDim.x - gs->viewPos.x - gs->viewDim.x, gs->winDim.y), Color_(guiBackgroundColor));
-        
-        // Draw game timer
-        {
-            char str[50];
-            sprintf(str, "%02i:%02i", (s32)(gs->gameTime/60), ((s32)gs->gameTime) % 60);
-            DrawText(str, gs->viewPos.x/2 - MeasureText(str, 20)/2 + 2.f, 20 + 2.f, 20, Fade(BLACK, .3f));
-            DrawText(str, gs->viewPos.x/2 - MeasureText(str, 20)/2, 20, 20, WHITE);
-        }
-        // Draw game speed
-        if (gs->doSpeedUp){
-            f32 speedStrWidth = MeasureText(speedStr, 20);
-            DrawText(speedStr, gs->viewPos.x/2 - speedStrWidth/2 + 2.f, 50 + 2.f, 20, Fade(BLACK, .3f));
-            DrawText(speedStr, gs->viewPos.x/2 - speedStrWidth/2, 50, 20, WHITE);
-
-        }
-
-        {
-            // Lifes left
-            s32 lifesPerRow = 4;
-            f32 r = 7.f;
-            f32 sep = 2*r + 8.f;
-            f32 ySep = 20.f;
-            for(s32 i = 0; i < gs->paddleLifes; i++){
-                v2 p = V2((gs->viewPos.x - sep*lifesPerRow)/2 + r + (i % lifesPerRow)*sep, gs->winDim.y - 35 - ySep*(i/lifesPerRow));
-                DrawCircleV(Vector2_(p + V2(2.f)), r, Fade(BLACK, .3f));
-                DrawCircleV(Vector2_(p), r, WHITE);
-            }
-            // Combo message
-            if (gs->sameColorCombo > 1){
-                char text[50];
-                sprintf(text, "Combo x%i!", gs->sameColorCombo);
-                s32 fontSize = 20;
-                v2 pos = {(gs->viewPos.x - MeasureText(text, fontSize))/2, gs->winDim.y - 80 - ySep*MaxS32(0, (gs->paddleLifes - 1)/lifesPerRow)};
-                DrawText(text, pos.x + 2, pos.y + 2, fontSize, Fade(BLACK, .3f));
-                DrawText(text, pos.x, pos.y, fontSize, Color_(LerpV4(gs->sameColorComboLastColor, V4_White(), .1f)));
-            }
-        }
-
-        // Draw powerups
-        { // Good powerups
-            drop_type powerups[4] = {};
-            f32 powerupTimes[ArrayCount(powerups)] = {};
-            s32 numPowerups = 0;
-            if (gs->powerupCountdownBigPaddle){
-                powerups[numPowerups] = Drop_BigPaddle;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownBigPaddle/POWERUP_TIME_BIG_PADDLE);
-            }
-            if (gs->powerupCountdownMagnet){
-                powerups[numPowerups] = Drop_Magnet;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownMagnet/POWERUP_TIME_MAGNET);
-            }
-            if (gs->powerupCountdownBigBalls){
-                powerups[numPowerups] = Drop_BigBalls;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownBigBalls/POWERUP_TIME_BIG_BALLS);
-            }
-            if (gs->powerupCountdownBarrier){
-                powerups[numPowerups] = Drop_Barrier;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownBarrier/POWERUP_TIME_BARRIER);
-            }
-            // Sort
-            for(s32 i = 0; i < numPowerups; i++){
-                for(s32 j = i; j < numPowerups - 1; j++){
-                    if (powerupTimes[j] < powerupTimes[j + 1]){
-                        SWAP(powerupTimes[j], powerupTimes[j + 1]);
-                        SWAP(powerups[j], powerups[j + 1]);
-                    }
-                }
-            }
-            // Draw
-            for(s32 i = 0; i < numPowerups; i++){
-                v2 texDim = V2(32.f);
-                v2 texPos = V2(((s32)powerups[i] - (s32)FIRST_GOOD_DROP)*texDim.x, 48.f);
-                f32 scale = 1.f;
-                v2 p = {20.f + (texDim.x*scale + 11.f)*i, 120};
-                f32 r1 = texDim.y*scale/2 - 2.f;
-                f32 r2 = texDim.y*scale/2 + 4.f;
-                DrawRing(Vector2_(p + texDim*scale/2), r1, r2, 180 + 360*powerupTimes[i], 540, 48, Color_(V4(.1f, .1f, .1f, .95f)));
-                DrawRing(Vector2_(p + texDim*scale/2), r1, r2, 180, 180 + 360*powerupTimes[i], 48, Color_(V4(1.f, 1.f, 1.f, .95f)));
-                DrawSprite(texPos, texDim, p, V2(scale), V4_White());
-            }
-        }
-        { // Bad powerups
-            drop_type powerups[7] = {};
-            f32 powerupTimes[ArrayCount(powerups)] = {};
-            s32 numPowerups = 0;
-            if (gs->powerupCountdownFastBalls){
-                powerups[numPowerups] = Drop_FastBalls;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownFastBalls/POWERUP_TIME_FAST_BALLS);
-            }
-            if (gs->powerupCountdownSlowBalls){
-                powerups[numPowerups] = Drop_SlowBalls;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownSlowBalls/POWERUP_TIME_SLOW_BALLS);
-            }
-            if (gs->powerupCountdownSmallPaddle){
-                powerups[numPowerups] = Drop_SmallPaddle;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownSmallPaddle/POWERUP_TIME_SMALL_PADDLE);
-            }
-            if (gs->powerupCountdownReverseControls){
-                powerups[numPowerups] = Drop_ReverseControls;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownReverseControls/POWERUP_TIME_REVERSE_CONTROLS);
-            }
-            if (gs->powerupCountdownSlipperyControls){
-                powerups[numPowerups] = Drop_SlipperyControls;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownSlipperyControls/POWERUP_TIME_SLIPPERY_CONTROLS);
-            }
-            if (gs->powerupCountdownRandomizer){
-                powerups[numPowerups] = Drop_Randomizer;
-                powerupTimes[numPowerups++] = (gs->powerupCountdownRandomizer/POWERUP_TIME_RANDOMIZER);
-            }
-            // Sort
-            for(s32 i = 0; i < numPowerups; i++){
-                for(s32 j = i; j < numPowerups - 1; j++){
-                    if (powerupTimes[j] < powerupTimes[j + 1]){
-                        SWAP(powerupTimes[j], powerupTimes[j + 1]);
-                        SWAP(powerups[j], powerups[j + 1]);
-                    }
-                }
-            }
-            // Draw
-            for(s32 i = 0; i < numPowerups; i++){
-                v2 texDim = V2(32.f);
-                v2 texPos = V2(((s32)powerups[i] - (s32)FIRST_BAD_DROP)*texDim.x, 80.f);
-                f32 scale = 1.f;
-                s32 columns = 3;
-                v2 p = {20.f + (texDim.x*scale + 11.f)*(i % columns), 170 + (i/columns)*50.f};
-                f32 r1 = texDim.y*scale/2 - 2.f;
-                f32 r2 = texDim.y*scale/2 + 4.f;
-                DrawRing(Vector2_(p + texDim*scale/2), r1, r2, 180 + 360*powerupTimes[i], 540, 48, Color_(V4(.1f, .1f, .1f, .95f)));
-                DrawRing(Vector2_(p + texDim*scale/2), r1, r2, 180, 180 + 360*powerupTimes[i], 48, Color_(V4(1.f, 1.f, 1.f, .95f)));
-                DrawSprite(texPos, texDim, p, V2(scale), V4_White());
-            }
-        }
-
-        // Draw shape slots
-        for(s32 i = 0; i < ArrayCount(gs->availableSlots) + ArrayCount(gs->nextSlots); i++){
-            brick_shape_slot *slot = (i < ArrayCount(gs->availableSlots) ? &gs->availableSlots[i] : &gs->nextSlots[i - ArrayCount(gs->availableSlots)]);
-            
-            v2 slotPos = slotPos0 + V2(0, slotPosOffsetY*i);
-            Color outlineColor = LIGHTGRAY;
-            Color fillColor = (slot->occupied ? Color_(backgroundColor) : BLACK);
-            if (i < ArrayCount(gs->availableSlots)) {
-                if (slot->occupied)
-                    outlineColor = WHITE;
+        if (canTurbo && !freeze){
+            char turboText[64];
+            v4 turboColor = V4_White(.7f);
+            if (turbo > 1){
+                sprintf(turboText, "Fast-forward %dx\nRunning at %.1fx", turbo, gs->effectiveSpeed);
+                if (gs->effectiveSpeed < turbo*.9f)
+                    turboColor = V4(1.f, .7f, .3f); // Can't keep up
             }else{
-                slotPos.y += 60.f; 
-                outlineColor = GRAY;
-                fillColor = Color_(V4(.2f, .14f, .19f, 1.f));
-            }
-            // Draw frame
-            f32 m = 3.f;
-
-            DrawRectangleV(Vector2_(slotPos + V2(m)), Vector2_(slotDim - V2(2*m)), fillColor);
-            DrawRectangleV(Vector2_(slotPos), Vector2_(V2(slotDim.x - m, m)), outlineColor);
-            DrawRectangleV(Vector2_(V2(slotPos.x + slotDim.x - m, slotPos.y)), Vector2_(V2(m, slotDim.y - m)), outlineColor);
-            DrawRectangleV(Vector2_(V2(slotPos.x + m, slotPos.y + slotDim.y - m)), Vector2_(V2(slotDim.x - m, m)), outlineColor);
-            DrawRectangleV(Vector2_(V2(slotPos.x, slotPos.y + m)), Vector2_(V2(m, slotDim.y - m)), outlineColor);
-
-            // Draw shape
-            if (slot->occupied){
-                v2 space = slotDim - V2(2*(m + 5.f));
-                f32 scale = Min(.6f, space.x/(Max(slot->shapeDim.x, slot->shapeDim.y)*gs->tileDim.x)); // Avoids choppy rotations
-                
-                DrawBrickShape(slot, slotPos + slotDim/2, scale);
+                sprintf(turboText, "F: Fast-forward");
             }
+            RenderText(rb, turboText, 20.f, gs->winDim.y - 80.f, 10, turboColor);
         }
-        
+
         // Rotate shape buttons
-        for(s32 i = 0; i < ArrayCount(gs->availableSlots); i++){
-            auto slot = &gs->availableSlots[i];
-            v2 slotPos = slotPos0 + V2(0, slotPosOffsetY*i);
+        rb->layer = RenderLayer_Gui;
+        for(s32 i = 0; i < ArrayCount(game->availableSlots); i++){
+            auto slot = &game->availableSlots[i];
+            v2 slotPos = SlotPos(game, gs->viewPos, gs->winDim, i);
             f32 m = 7.f;
             v2 buttonDim = V2(34.f);
             v2 buttonPos = slotPos + V2(slotDim.x + m, (slotDim.y - buttonDim.y)/2);
             if (DoButton(311 + i*2, buttonPos, buttonDim, "", V4_Grey(.25f), 2)){
                 if (slot->occupied && !freeze){
-                    RotateShape90Degrees(slot, true); // CW
+                    gs->queuedRotations[i]++; // CW
                 }
             }
             buttonPos.x = slotPos.x - m - buttonDim.x;
             if (DoButton(312 + i*2, buttonPos, buttonDim, "", V4_Grey(.25f), 3)){
                 if (slot->occupied && !freeze){
-                    RotateShape90Degrees(slot, false); // CCW
+                    gs->queuedRotations[i]--; // CCW
                 }
             }
         }
 
-        // Loading bar arrow
-        {
-            f32 regionX = gs->viewPos.x + gs->viewDim.x;
-            f32 regionW = gs->winDim.x - regionX;
-            
-            Color emptyColor = BLACK;
-            Color fillColor = WHITE;//GREEN;
-            v2 triDim = {46.f, 23.f};
-            v2 rectDim = {14.f, 32.f};
-            v2 triPos  = {regionX + regionW/2 - triDim.x/2, gs->winDim.y/2 - (triDim.y + rectDim.y)/2};
-            v2 rectPos = {regionX + regionW/2 - rectDim.x/2, triPos.y + triDim.y};
-            f32 t = Clamp01(gs->spawnShapeTimer/gs->spawnShapeTime);
-            f32 rectT = Clamp01(t*(rectDim.y + triDim.y)/(rectDim.y));
-            f32 triT = Clamp01((t*(rectDim.y + triDim.y) - rectDim.y)/(triDim.y));
-            // Arrow triangle
-            v2 tri0 = triPos + V2(0, triDim.y);
-            v2 tri1 = triPos + triDim;
-            v2 tri2 = triPos + V2(triDim.x/2, 0);
-            if (triT == 0){
-                DrawTriangle(Vector2_(tri0), Vector2_(tri1), Vector2_(tri2), emptyColor);
-            }else if (triT == 1.f){
-                DrawTriangle(Vector2_(tri0), Vector2_(tri1), Vector2_(tri2), fillColor);
-            }else{
-                v2 tri02 = LerpV2(tri0, tri2, triT);
-                v2 tri12 = LerpV2(tri1, tri2, triT);
-                DrawTriangle(Vector2_(tri0), Vector2_(tri1), Vector2_(tri12), fillColor);
-                DrawTriangle(Vector2_(tri0), Vector2_(tri12), Vector2_(tri02), fillColor);
-                DrawTriangle(Vector2_(tri02), Vector2_(tri12), Vector2_(tri2), emptyColor);
-            }
-            // Arrow rectangle
-            if (rectT == 0){
-                DrawRectangleV(Vector2_(rectPos), Vector2_(rectDim), emptyColor);
-            }else if (rectT == 1.f){
-                DrawRectangleV(Vector2_(rectPos), Vector2_(rectDim), fillColor);
-            }else{
-                DrawRectangleV(Vector2_(rectPos + V2(0, (1.f - rectT)*rectDim.y)), Vector2_(V2(rectDim.x, rectT*rectDim.y)), fillColor);
-                DrawRectangleV(Vector2_(rectPos), Vector2_(V2(rectDim.x, (1.f - rectT)*rectDim.y)), emptyColor);
-            }
-        }
-
-        // Draw dragging shape
-        if (gs->draggingShapeIndex != -1){
-            auto slot = &gs->availableSlots[gs->draggingShapeIndex];
-            if (isDraggingShapeOnWorld){
-                v4 prevColor = slot->shape.color;
-                slot->shape.color = (isDraggingShapePosValid ? slot->shape.color : V4_Grey(.5f));
-                v2 p = gs->viewPos + Hadamard(V2(draggingShapeTilePos) + V2(slot->shapeDim)/2, gs->tileDim);
-                DrawBrickShape(slot, p, 1.f, .6f);
-                slot->shape.color = prevColor;
-            }else{
-                DrawBrickShape(slot, gs->mousePos, 1.f, .6f);
-            }
-            // Dotted line indicating the end of the grid
-            for(s32 x = 0; x < gs->gridDim.x;  x++){
-                DrawRectangleV(Vector2_(gs->viewPos + V2(x*gs->tileDim.x + 3.f, gs->gridDim.y*gs->tileDim.y)), Vector2_(V2(gs->tileDim.x - 2*3.f, 4.f)), Color_(V4_Grey(.5f, .2f)));
-            }
-        }
-        
-        if (gs->gameEnded){
-            f32 h = 220.f;
-            DrawRectangleV(Vector2_(V2(0, (gs->winDim.y - h)/2)), Vector2_(V2(gs->winDim.x, h)), Fade(BLACK, .5f));
-            
-            char *textAttackerWon = "The paddle won!";
-            char *textDefenderWon = "The bricks won!";
-            char *titleText = (gs->paddleWon ? textAttackerWon : textDefenderWon);
-            f32 titleFontSize = 30;
-            if (gs->paddleWon){
-                char *titleText = "The paddle won!";
-                DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, (gs->winDim.y - h)/2 + 30.f, titleFontSize, WHITE);
-            }else{
-                char *titleText = "The bricks won!";
-                v4 colors[] = { {1.f, .44f, .4f, 1.f},
-                                {1.f, .7f, .3f, 1.f},
-                                {1.f, 1.f, .3f, 1.f},
-                                {.3f, 1.f, .3f, 1.f}, 
-                                {.35f, .72f, 1.f, 1.f},
-                                {.9f, .47f, 1.f, 1.f} };
-                DrawTextColorful(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, (gs->winDim.y - h)/2 + 30.f, titleFontSize, colors, ArrayCount(colors));
-            }
+        if (game->gameEnded){
+            DrawMatchResult(rb, game, gs->winDim);
             v2 buttonDim = defaultButtonDim;
             v2 buttonPos = {(gs->winDim.x - buttonDim.x)/2, gs->winDim.y/2 - buttonDim.y/2 + 20.f};
             if (DoButton(301, buttonPos, buttonDim, "Main Menu", defaultButtonColor, 1) || IsKeyPressed(KEY_ENTER)){
+                StopSimThread();
                 gs->metaState = MetaState_MainMenu;
             }
+            buttonPos.y += buttonDim.y + 20.f;
+            if (DoButton(304, buttonPos, buttonDim, "Save Replay", defaultButtonColor, 1)){
+#if defined(__EMSCRIPTEN__)
+                // The file goes to the in-memory file system, and the page's shell downloads it from there.
+                if (SaveReplay(&gs->currentReplay, "replay.bireplay")){
+                    emscripten_run_script("saveFileFromMEMFSToDisk('replay.bireplay', 'break-in.bireplay')");
+                }
+#else
+                // The game has ended, so the sim thread doesn't touch the replay anymore.
+                SaveReplay(&gs->currentReplay, "break-in.bireplay");
+#endif
+            }
         }else if (gs->pause){
+            rb->layer = RenderLayer_Overlay;
             f32 h = 220.f;
-            DrawRectangleV(Vector2_(V2(0, (gs->winDim.y - h)/2)), Vector2_(V2(gs->winDim.x, h)), Fade(BLACK, .5f));
+            RenderRect(rb, V2(0, (gs->winDim.y - h)/2), V2(gs->winDim.x, h), V4_Black(.5f));
             
             char *titleText = "Pause";
             f32 titleFontSize = 30;
-            DrawText(titleText, (gs->winDim.x - MeasureText(titleText, titleFontSize))/2, (gs->winDim.y - h)/2 + 30.f, titleFontSize, WHITE);
+            RenderText(rb, titleText, gs->winDim.x/2, (gs->winDim.y - h)/2 + 30.f, titleFontSize, V4_White(), RenderText_CenterX);
             
             v2 buttonDim = defaultButtonDim;
             v2 buttonPos = {(gs->winDim.x - buttonDim.x)/2, gs->winDim.y/2 - 5.f - buttonDim.y/2};
@@ -2595,23 +2178,69 @@ liking in the options menu.";
             }
             buttonPos.y += buttonDim.y + 20.f;
             if (DoButton(303, buttonPos, buttonDim, "Quit", defaultButtonColor, 1)){
+                StopSimThread();
                 gs->metaState = MetaState_MainMenu;
             }
         }
 
+    }else if (gs->metaState == MetaState_Watch){
+        match_grid *grid = &gs->watchGrid;
+        if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_DOWN)){
+            s32 sizeIndex = ClampS32(gs->watchGridSizeIndex + (IsKeyPressed(KEY_UP) ? 1 : -1), 0, ArrayCount(globalWatchGridSizes) - 1);
+            if (sizeIndex != gs->watchGridSizeIndex){
+                gs->watchGridSizeIndex = sizeIndex;
+                RestartMatchGrid(grid, globalWatchGridSizes[sizeIndex], &gs->config);
+            }
+        }
+        if (IsKeyPressed(KEY_RIGHT)){
+            gs->watchSpeedIndex = MinS32(gs->watchSpeedIndex + 1, ArrayCount(globalWatchSpeeds) - 1);
+        }
+        if (IsKeyPressed(KEY_LEFT)){
+            gs->watchSpeedIndex = MaxS32(gs->watchSpeedIndex - 1, 0);
+        }
+        grid->speed = globalWatchSpeeds[gs->watchSpeedIndex];
+
+        UpdateMatchGrid(grid, dt);
+        DrawMatchGrid(rb, grid, gs->winDim, GetTime(), (gs->quality.level >= Quality_PlainSpecials));
+
+        rb->layer = RenderLayer_Overlay;
+        f32 barHeight = 24.f;
+        RenderRect(rb, V2(0, gs->winDim.y - barHeight), V2(gs->winDim.x, barHeight), V4_Black(.75f));
+        char text[128];
+        sprintf(text, "%d matches (Up/Down)   %.0fx (Left/Right)   Paddle %d - %d Bricks   Esc: Menu",
+                grid->numMatches, grid->speed, grid->paddleWins, grid->bricksWins);
+        RenderText(rb, text, gs->winDim.x/2, gs->winDim.y - barHeight + 5.f, 10, V4_White(), RenderText_CenterX);
+
+        if (IsKeyPressed(KEY_ESCAPE)){
+            StopMatchGrid(grid);
+            gs->metaState = MetaState_MainMenu;
+        }
     }else{
         // Invalid
-        ClearBackground(RED);
+        RenderClear(rb, V4(1.f, 0, 0));
     }
 
+    rb->layer = RenderLayer_Debug;
     if (0){ // Draw delta time.
         char buf[100] = {};
         sprintf(buf, "GetFrameTime(): %.3f\nGetTime() delta: %.3f\ndt: %.3f", getFrameTime, getTimeDelta, dt);
-        DrawText(buf, 8 + 1, 8 + 1, 10, Fade(BLACK, .5f));
-        DrawText(buf, 8, 8, 10, WHITE);
+        RenderText(rb, buf, 8 + 1, 8 + 1, 10, V4_Black(.5f));
+        RenderText(rb, buf, 8, 8, 10, V4_White());
+    }
+    if (gs->showRenderStats){ // What drawing this frame takes (without this text).
+        render_stats stats = CountRenderCommands(rb);
+        char buf[200] = {};
+        sprintf(buf, "Commands: %i (%i text)\nDraw calls: %i\nTriangles: %i", stats.numCommands, stats.commandsOfType[RenderCommand_Text], stats.numBatches, stats.numTriangles);
+        if (stats.numDropped){
+            sprintf(buf + strlen(buf), "\nDropped: %i", stats.numDropped);
+        }
+        sprintf(buf + strlen(buf), "\nResolution: %ix%i (%gx)", gs->renderTarget.texture.width, gs->renderTarget.texture.height, globalRenderScales[gs->usedRenderScaleIndex]);
+        sprintf(buf + strlen(buf), "\nQuality: -%i (90%%: %.1fms)", gs->quality.level, gs->quality.percentile*1000.f);
+        RenderText(rb, buf, 8 + 1, 8 + 1, 10, V4_Black(.5f));
+        RenderText(rb, buf, 8, 8, 10, V4_White());
     }
 
-    EndDrawing();
+    PresentRenderCommands(rb);
 
     FinishFrameForGui();
 }
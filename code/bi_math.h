@@ -33,6 +33,15 @@ inline u32 SimpleHash(u32 a){
     return a;
 }
 
+// SplitMix64's mixing.
+inline u64 SimpleHash64(u64 a){
+    a += 0x9E3779B97F4A7C15ULL;
+    a = (a ^ (a >> 30))*0xBF58476D1CE4E5B9ULL;
+    a = (a ^ (a >> 27))*0x94D049BB133111EBULL;
+    a ^= a >> 31;
+    return a;
+}
+
 //
 // Some <math.h> wrappers
 //
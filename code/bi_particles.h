@@ -0,0 +1,226 @@
+//
+// Particles: the debris and sparks of the match (brick breaks, arrow bounces, finished combos, paddle hits).
+// They're only looks: the game doesn't know about them, it just reports what happened with its events, and
+// whoever draws the match emits a burst for each one (EmitGameEventParticles()).
+//
+// The pool is a fixed number of particles stored as a structure of arrays, so the update runs 4 particles
+// at a time with SIMD (SSE2 natively, WASM SIMD on the web when built with -msimd128, plain floats
+// otherwise). Dead ones are replaced by the last live one, so the live particles are always the first
+// numParticles. They're drawn as a single render command (RenderParticles()). Include it after bi_game.h.
+//
+
+#ifndef BI_PARTICLES_H
+#define BI_PARTICLES_H
+
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define PARTICLES_SSE 1
+#elif defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define PARTICLES_WASM 1
+#endif
+
+#define DEFAULT_MAX_PARTICLES 20480
+#define PARTICLE_GRAVITY 300.f // Pixels per second squared
+#define PARTICLE_DRAG 1.5f // Fraction of the speed lost per second (roughly)
+#define MAX_PARTICLE_LIFETIME 1.2f // Seconds
+
+struct particle_system{
+    s32 numParticles;
+    s32 maxParticles; // Multiple of 4
+    s32 numDropped; // Particles that didn't fit since the last ClearParticles().
+    // 16 byte aligned arrays of maxParticles.
+    f32 *posX, *posY;
+    f32 *velX, *velY;
+    f32 *life; // Seconds left
+    f32 *invLifetime;
+    f32 *alpha; // life/lifetime, set by UpdateParticles().
+    f32 *size;
+    u32 *color; // RGBA8 before the fade.
+    void *memory;
+    pcg_random_state rng; // Its own, so emitting doesn't change anyone else's random numbers.
+    f32 emitScale; // Fraction of each burst that's emitted. 1 by default, lower to save time.
+};
+
+
+//
+// 4 wide floats
+//
+#if PARTICLES_SSE
+typedef __m128 f32x4;
+inline f32x4 LoadF32x4(f32 *p)             { return _mm_load_ps(p); }
+inline void StoreF32x4(f32 *p, f32x4 a)    { _mm_store_ps(p, a); }
+inline f32x4 SetF32x4(f32 x)               { return _mm_set1_ps(x); }
+inline f32x4 AddF32x4(f32x4 a, f32x4 b)    { return _mm_add_ps(a, b); }
+inline f32x4 MulF32x4(f32x4 a, f32x4 b)    { return _mm_mul_ps(a, b); }
+inline f32x4 MinF32x4(f32x4 a, f32x4 b)    { return _mm_min_ps(a, b); }
+inline f32x4 MaxF32x4(f32x4 a, f32x4 b)    { return _mm_max_ps(a, b); }
+#elif PARTICLES_WASM
+typedef v128_t f32x4;
+inline f32x4 LoadF32x4(f32 *p)             { return wasm_v128_load(p); }
+inline void StoreF32x4(f32 *p, f32x4 a)    { wasm_v128_store(p, a); }
+inline f32x4 SetF32x4(f32 x)               { return wasm_f32x4_splat(x); }
+inline f32x4 AddF32x4(f32x4 a, f32x4 b)    { return wasm_f32x4_add(a, b); }
+inline f32x4 MulF32x4(f32x4 a, f32x4 b)    { return wasm_f32x4_mul(a, b); }
+inline f32x4 MinF32x4(f32x4 a, f32x4 b)    { return wasm_f32x4_pmin(a, b); }
+inline f32x4 MaxF32x4(f32x4 a, f32x4 b)    { return wasm_f32x4_pmax(a, b); }
+#else
+struct f32x4{ f32 e[4]; };
+inline f32x4 LoadF32x4(f32 *p)             { f32x4 r; for(s32 i = 0; i < 4; i++) r.e[i] = p[i]; return r; }
+inline void StoreF32x4(f32 *p, f32x4 a)    { for(s32 i = 0; i < 4; i++) p[i] = a.e[i]; }
+inline f32x4 SetF32x4(f32 x)               { f32x4 r; for(s32 i = 0; i < 4; i++) r.e[i] = x; return r; }
+inline f32x4 AddF32x4(f32x4 a, f32x4 b)    { for(s32 i = 0; i < 4; i++) a.e[i] += b.e[i]; return a; }
+inline f32x4 MulF32x4(f32x4 a, f32x4 b)    { for(s32 i = 0; i < 4; i++) a.e[i] *= b.e[i]; return a; }
+inline f32x4 MinF32x4(f32x4 a, f32x4 b)    { for(s32 i = 0; i < 4; i++) a.e[i] = (b.e[i] < a.e[i] ? b.e[i] : a.e[i]); return a; }
+inline f32x4 MaxF32x4(f32x4 a, f32x4 b)    { for(s32 i = 0; i < 4; i++) a.e[i] = (b.e[i] > a.e[i] ? b.e[i] : a.e[i]); return a; }
+#endif
+
+
+//
+// Pool
+//
+
+b32 InitParticleSystem(particle_system *ps, s32 maxParticles = DEFAULT_MAX_PARTICLES){
+    ZeroStruct(ps);
+    maxParticles = (MaxS32(maxParticles, 4) + 3) & ~3;
+    s32 numArrays = 9;
+    ps->memory = calloc(1, (size_t)numArrays*maxParticles*sizeof(f32) + 16); // Zeroed: see UpdateParticles().
+    if (!ps->memory)
+        return false;
+    f32 *at = (f32 *)(((uintptr_t)ps->memory + 15) & ~(uintptr_t)15);
+    f32 **arrays[] = {&ps->posX, &ps->posY, &ps->velX, &ps->velY, &ps->life, &ps->invLifetime, &ps->alpha, &ps->size};
+    for(s32 i = 0; i < ArrayCount(arrays); i++){
+        *arrays[i] = at;
+        at += maxParticles;
+    }
+    ps->color = (u32 *)at;
+    ps->maxParticles = maxParticles;
+    PcgRandomSeed(0x5eed, 0x9a27, &ps->rng);
+    ps->emitScale = 1.f;
+    return true;
+}
+
+void ClearParticles(particle_system *ps){
+    ps->numParticles = 0;
+    ps->numDropped = 0;
+}
+
+// Returns false if the pool is full.
+inline b32 EmitParticle(particle_system *ps, v2 pos, v2 vel, f32 lifetime, f32 size, v4 color){
+    if (ps->numParticles >= ps->maxParticles){
+        ps->numDropped++;
+        return false;
+    }
+    s32 i = ps->numParticles++;
+    ps->posX[i] = pos.x;
+    ps->posY[i] = pos.y;
+    ps->velX[i] = vel.x;
+    ps->velY[i] = vel.y;
+    ps->life[i] = lifetime;
+    ps->invLifetime[i] = 1.f/lifetime;
+    ps->alpha[i] = 1.f;
+    ps->size[i] = size;
+    ps->color[i] = ((u32)(Clamp01(color.r)*255) | ((u32)(Clamp01(color.g)*255) << 8) | ((u32)(Clamp01(color.b)*255) << 16) | ((u32)(Clamp01(color.a)*255) << 24));
+    return true;
+}
+
+// 'num' particles (times emitScale) from 'pos', in directions within 'spread' radians of 'angle' (radians,
+// 0 is right, y goes down), with random speed, lifetime and size in the ranges.
+void EmitParticleBurst(particle_system *ps, v2 pos, s32 num, f32 angle, f32 spread, v2 speedRange, v2 lifetimeRange, v2 sizeRange, v4 color){
+    num = MaxS32(1, (s32)(num*ps->emitScale + .5f));
+    SwapRandomState(&ps->rng);
+    for(s32 i = 0; i < num; i++){
+        f32 a = angle + RandomBilateral(spread);
+        f32 speed = RandomRange(speedRange.x, speedRange.y);
+        v4 c = color;
+        f32 shade = RandomRange(.8f, 1.15f); // So debris of a color isn't all flat.
+        c.r *= shade; c.g *= shade; c.b *= shade;
+        if (!EmitParticle(ps, pos, V2(Cos(a), Sin(a))*speed, RandomRange(lifetimeRange.x, lifetimeRange.y), RandomRange(sizeRange.x, sizeRange.y), c))
+            break;
+    }
+    SwapRandomState(&ps->rng);
+}
+
+// The burst for a game event, at its position on the board. The events without one are ignored.
+void EmitGameEventParticles(particle_system *ps, game_event *event){
+    switch(event->type){
+        case GameEvent_BrickBreak: {
+            EmitParticleBurst(ps, event->pos, 24, -PI/2, PI, V2(40.f, 180.f), V2(.4f, .9f), V2(2.f, 4.f), event->color);
+        } break;
+        case GameEvent_ArrowBounce: {
+            EmitParticleBurst(ps, event->pos, 12, -PI/2, PI, V2(80.f, 220.f), V2(.2f, .4f), V2(1.5f, 2.5f), V4(1.f, .95f, .7f));
+        } break;
+        case GameEvent_PaddleHit: {
+            EmitParticleBurst(ps, event->pos, 16, -PI/2, PI/3, V2(60.f, 200.f), V2(.2f, .5f), V2(1.5f, 3.f), V4_White());
+        } break;
+        case GameEvent_ComboDone: {
+            EmitParticleBurst(ps, event->pos, 80, 0, PI, V2(100.f, 320.f), V2(.6f, MAX_PARTICLE_LIFETIME), V2(2.f, 4.f), event->color);
+            EmitParticleBurst(ps, event->pos, 40, 0, PI, V2(60.f, 260.f), V2(.5f, 1.f), V2(1.5f, 3.f), V4_White());
+        } break;
+        default: break;
+    }
+}
+
+
+//
+// Update
+//
+
+// Moves them and fades them out, 4 at a time, then removes the ones that died.
+void UpdateParticles(particle_system *ps, f32 dt){
+    s32 num = ps->numParticles;
+    f32x4 dt4 = SetF32x4(dt);
+    f32 dragFactor = 1.f/(1.f + PARTICLE_DRAG*dt);
+    f32x4 drag4 = SetF32x4(dragFactor);
+    f32x4 gravity4 = SetF32x4(PARTICLE_GRAVITY*dt);
+    f32x4 minusDt4 = SetF32x4(-dt);
+    f32x4 zero4 = SetF32x4(0);
+    f32x4 one4 = SetF32x4(1.f);
+    // The last group can go past numParticles, but not past maxParticles: the extra ones are ignored. They
+    // hold zeros or particles that died, so there's no garbage that could be a NaN or a denormal.
+    for(s32 i = 0; i < num; i += 4){
+        f32x4 velX = MulF32x4(LoadF32x4(ps->velX + i), drag4);
+        f32x4 velY = MulF32x4(AddF32x4(LoadF32x4(ps->velY + i), gravity4), drag4);
+        StoreF32x4(ps->velX + i, velX);
+        StoreF32x4(ps->velY + i, velY);
+        StoreF32x4(ps->posX + i, AddF32x4(LoadF32x4(ps->posX + i), MulF32x4(velX, dt4)));
+        StoreF32x4(ps->posY + i, AddF32x4(LoadF32x4(ps->posY + i), MulF32x4(velY, dt4)));
+        f32x4 life = AddF32x4(LoadF32x4(ps->life + i), minusDt4);
+        StoreF32x4(ps->life + i, life);
+        f32x4 alpha = MinF32x4(MaxF32x4(MulF32x4(life, LoadF32x4(ps->invLifetime + i)), zero4), one4);
+        StoreF32x4(ps->alpha + i, alpha);
+    }
+
+    for(s32 i = 0; i < num;){
+        if (ps->life[i] <= 0){
+            num--;
+            ps->posX[i] = ps->posX[num];
+            ps->posY[i] = ps->posY[num];
+            ps->velX[i] = ps->velX[num];
+            ps->velY[i] = ps->velY[num];
+            ps->life[i] = ps->life[num];
+            ps->invLifetime[i] = ps->invLifetime[num];
+            ps->alpha[i] = ps->alpha[num];
+            ps->size[i] = ps->size[num];
+            ps->color[i] = ps->color[num];
+        }else{
+            i++;
+        }
+    }
+    ps->numParticles = num;
+}
+
+// A particle's color with its fade applied.
+inline u32 ParticleColor(particle_system *ps, s32 i){
+    u32 result = (ps->color[i] & 0x00FFFFFF) | ((u32)(ps->alpha[i]*(ps->color[i] >> 24)) << 24);
+    return result;
+}
+// Side of its square: they shrink a bit as they fade.
+inline f32 ParticleSize(particle_system *ps, s32 i){
+    f32 result = ps->size[i]*(.4f + .6f*ps->alpha[i]);
+    return result;
+}
+
+#endif
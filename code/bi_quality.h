@@ -0,0 +1,119 @@
+//
+// Quality governor: watches how long the frames take and turns the optional work down when they're too
+// slow, one level at a time in a fixed order (see quality_level), and back up when they've been fast for a
+// while.
+//
+// It goes by a percentile of the last frames rather than their average, so a single hitch (loading, a tab
+// switch) doesn't count but a steady stutter does. It steps down after a second over budget, and up only
+// after several seconds under a lower time, which is above a 60 Hz vsync so a healthy frame counts. If a
+// step up is undone soon after, the wait before the next one doubles, so it doesn't keep flipping between
+// two levels. It only decides the level: whoever draws reads it. It doesn't use Raylib.
+//
+
+#ifndef BI_QUALITY_H
+#define BI_QUALITY_H
+
+#define QUALITY_NUM_SAMPLES 120 // Frames the percentile is taken from.
+#define QUALITY_PERCENTILE .9f
+#define QUALITY_FRAME_BUDGET (1.f/50.f) // Seconds. Slower than this at the percentile steps down.
+#define QUALITY_RECOVER_FRAME_TIME (1.f/57.f) // Seconds. Faster than this at the percentile steps up.
+#define QUALITY_DOWN_TIME 1.f // Seconds over budget before stepping down.
+#define QUALITY_UP_TIME 5.f // Seconds under the recover time before stepping up, at first.
+#define QUALITY_MAX_UP_TIME 80.f
+#define QUALITY_RELAPSE_TIME 10.f // Stepping down this soon after stepping up doubles the up time.
+
+// Each level keeps what the ones before it turned down.
+enum quality_level{
+    Quality_Full = 0,
+    Quality_NoMenuBackground, // Only the side columns of the menu background.
+    Quality_PlainSpecials, // Special bricks with a still, simpler overlay.
+    Quality_FewerRingSegments, // Circles and rings with half the segments.
+    Quality_FewerParticles, // A quarter of each burst.
+    Quality_LowerResolution, // Auto render scale one step down, and one more for each level after this.
+};
+
+struct quality_governor{
+    f32 samples[QUALITY_NUM_SAMPLES]; // Frame times, in seconds. A ring buffer.
+    s32 numSamples;
+    s32 nextSample;
+    s32 level; // quality_level, or more for lower resolutions.
+    f32 percentile; // Of the samples, in seconds. 0 while there aren't enough.
+    f32 overTime; // Seconds the percentile has been over budget.
+    f32 underTime; // Seconds it has been under the recover time.
+    f32 upTime; // Seconds needed under the recover time to step up.
+    f32 sinceUp; // Seconds since the last step up.
+    f32 sinceDown; // Seconds since the last step down.
+};
+
+void InitQualityGovernor(quality_governor *q){
+    ZeroStruct(q);
+    q->upTime = QUALITY_UP_TIME;
+    q->sinceUp = QUALITY_RELAPSE_TIME;
+}
+
+// The samples from before a level change say nothing about the new one.
+void ClearQualitySamples(quality_governor *q){
+    q->numSamples = 0;
+    q->nextSample = 0;
+    q->percentile = 0;
+    q->overTime = 0;
+    q->underTime = 0;
+}
+
+// Once a frame, with the last frame's time. Levels over 'maxLevel' aren't used (when there's nothing more
+// to turn down).
+void UpdateQualityGovernor(quality_governor *q, f32 frameTime, s32 maxLevel){
+    q->samples[q->nextSample] = Min(frameTime, .25f);
+    q->nextSample = (q->nextSample + 1) % QUALITY_NUM_SAMPLES;
+    q->numSamples = MinS32(q->numSamples + 1, QUALITY_NUM_SAMPLES);
+    q->sinceUp += frameTime;
+    q->sinceDown += frameTime;
+    if (q->sinceUp > QUALITY_MAX_UP_TIME && q->sinceDown > q->sinceUp){
+        q->upTime = QUALITY_UP_TIME; // The last step up has held for long enough.
+    }
+    if (q->level > maxLevel){
+        q->level = MaxS32(maxLevel, 0);
+        ClearQualitySamples(q);
+        return;
+    }
+    if (q->numSamples < QUALITY_NUM_SAMPLES/2)
+        return;
+
+    // Insertion sort: there are only a few.
+    f32 sorted[QUALITY_NUM_SAMPLES];
+    for(s32 i = 0; i < q->numSamples; i++){
+        f32 t = q->samples[i];
+        s32 j = i;
+        for(; j > 0 && sorted[j - 1] > t; j--){
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = t;
+    }
+    q->percentile = sorted[MinS32((s32)(QUALITY_PERCENTILE*q->numSamples), q->numSamples - 1)];
+
+    if (q->percentile > QUALITY_FRAME_BUDGET){
+        q->overTime += frameTime;
+        q->underTime = 0;
+    }else if (q->percentile < QUALITY_RECOVER_FRAME_TIME){
+        q->underTime += frameTime;
+        q->overTime = 0;
+    }else{
+        q->overTime = 0;
+        q->underTime = 0;
+    }
+
+    if (q->overTime >= QUALITY_DOWN_TIME && q->level < maxLevel){
+        q->level++;
+        if (q->sinceUp < QUALITY_RELAPSE_TIME){
+            q->upTime = Min(q->upTime*2, QUALITY_MAX_UP_TIME);
+        }
+        q->sinceDown = 0;
+        ClearQualitySamples(q);
+    }else if (q->underTime >= q->upTime && q->level > 0){
+        q->level--;
+        q->sinceUp = 0;
+        ClearQualitySamples(q);
+    }
+}
+
+#endif
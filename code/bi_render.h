@@ -0,0 +1,352 @@
+//
+// Render commands: a frame as a list of small draw commands (rectangles, triangles, circles, rings,
+// sprites, text), so the code that decides what's on screen doesn't call a graphics API or touch the
+// state of one. The drawing code fills a render_buffer, and a backend draws it afterwards: Raylib's in
+// bi_main.cpp, the software renderer's in bi_soft_render.h, or CountRenderCommands(), which only counts
+// what the Raylib backend would do. Include it after bi_game.h and bi_particles.h.
+//
+// Every command goes into a layer. The backends sort them by layer first, with a stable sort, so within
+// a layer they're drawn in the order they were pushed and overlaps come out the same as drawing right
+// away. Consecutive commands that use the same texture are then drawn as one batch.
+//
+
+#ifndef BI_RENDER_H
+#define BI_RENDER_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RENDER_COMMANDS 32768 // A grid of 64 full boards (bi_watch.h) needs around 30k.
+#define RENDER_TEXT_MEMORY (32*1024) // For the strings of the text commands
+#define RENDER_CIRCLE_SEGMENTS 48 // For circles and rings, in every backend.
+
+enum render_layer{
+    RenderLayer_Background,
+    RenderLayer_World, // The board and everything on it
+    RenderLayer_Hud,
+    RenderLayer_Gui, // Buttons
+    RenderLayer_Dragging, // The shape being placed, over the buttons.
+    RenderLayer_Overlay, // Pause and end screens, and their buttons.
+    RenderLayer_Debug,
+    RenderLayer_Count,
+};
+
+enum render_command_type{
+    RenderCommand_Clear, // The whole target, replacing what's there.
+    RenderCommand_Rect,
+    RenderCommand_Triangle,
+    RenderCommand_Circle,
+    RenderCommand_ProgressRing,
+    RenderCommand_Line,
+    RenderCommand_Sprite,
+    RenderCommand_Text,
+    RenderCommand_Bricks, // The plain bricks of a board (not their special overlays), see RenderBricks().
+    RenderCommand_Particles, // All the particles of a system, as squares. See RenderParticles().
+    RenderCommand_Count,
+};
+
+// What a sprite samples. The backends that don't have a texture skip its sprites.
+enum render_texture{
+    RenderTexture_Main, // main.png
+    RenderTexture_MenuBackground, // Baked at startup by the game
+};
+
+enum render_text_flags{
+    RenderText_CenterX = 0x1, // x is the center instead of the left.
+    RenderText_Colorful = 0x2, // Each visible character takes the next of globalRenderTextColors (like DrawTextColorful()).
+};
+
+// 48 bytes
+struct render_command{
+    u8 type;
+    u8 layer;
+    u8 texture; // Sprite
+    u8 flags; // Text
+    u32 color; // RGBA8, the same bytes as Raylib's Color.
+    v2 p[3]; // Rect and sprite: min, max. Triangle: vertices. Circle and ring: center. Line: ends. Text, bricks and particles: position.
+    union{
+        struct{ v2 texPos, texDim; } sprite; // Texels. A negative texDim flips it (it covers texPos to texPos + texDim).
+        struct{ f32 radius; } circle;
+        struct{ f32 innerRadius, outerRadius, progress; u32 colorB; } ring; // See RenderProgressRing().
+        struct{ f32 thick; } line;
+        struct{ char *text; s16 fontSize; s16 spacing; } text; // spacing < 0: DrawText()'s
+        struct{ game_state *game; } bricks;
+        struct{ particle_system *system; } particles;
+    };
+};
+
+struct render_buffer{
+    render_command *commands;
+    render_command *sorted; // Scratch for the sort
+    s32 numCommands;
+    s32 numDropped; // Commands that didn't fit this frame.
+    char *textMemory;
+    s32 textUsed;
+    render_layer layer; // Where the next commands go.
+};
+
+// What drawing a buffer costs, counted by CountRenderCommands().
+struct render_stats{
+    s32 numCommands;
+    s32 commandsOfType[RenderCommand_Count];
+    s32 numTriangles;
+    s32 numBatches; // Draw calls: runs of commands with the same texture.
+    s32 numDropped;
+};
+
+static v4 globalRenderTextColors[] = { {1.f, .44f, .4f, 1.f}, {1.f, .7f, .3f, 1.f}, {1.f, 1.f, .3f, 1.f},
+                                       {.3f, 1.f, .3f, 1.f}, {.35f, .72f, 1.f, 1.f}, {.9f, .47f, 1.f, 1.f} };
+
+// Same conversion as Color_()
+inline u32 RenderColor(v4 c){
+    u32 result = ((u32)(Clamp01(c.r)*255) | ((u32)(Clamp01(c.g)*255) << 8) | ((u32)(Clamp01(c.b)*255) << 16) | ((u32)(Clamp01(c.a)*255) << 24));
+    return result;
+}
+
+b32 InitRenderBuffer(render_buffer *rb){
+    ZeroStruct(rb);
+    rb->commands = (render_command *)malloc(MAX_RENDER_COMMANDS*sizeof(render_command));
+    rb->sorted = (render_command *)malloc(MAX_RENDER_COMMANDS*sizeof(render_command));
+    rb->textMemory = (char *)malloc(RENDER_TEXT_MEMORY);
+    if (!rb->commands || !rb->sorted || !rb->textMemory){
+        free(rb->commands);
+        free(rb->sorted);
+        free(rb->textMemory);
+        ZeroStruct(rb);
+        return false;
+    }
+    return true;
+}
+
+// Starts a new frame.
+void ResetRenderBuffer(render_buffer *rb){
+    rb->numCommands = 0;
+    rb->numDropped = 0;
+    rb->textUsed = 0;
+    rb->layer = RenderLayer_Background;
+}
+
+
+//
+// Pushing commands
+//
+
+// Returns 0 if the buffer is full (the command is dropped).
+render_command *PushRenderCommand(render_buffer *rb, render_command_type type, v4 color){
+    if (rb->numCommands >= MAX_RENDER_COMMANDS){
+        rb->numDropped++;
+        return 0;
+    }
+    render_command *command = &rb->commands[rb->numCommands++];
+    command->type = (u8)type;
+    command->layer = (u8)rb->layer;
+    command->texture = RenderTexture_Main;
+    command->flags = 0;
+    command->color = RenderColor(color);
+    return command;
+}
+
+void RenderClear(render_buffer *rb, v4 color){
+    PushRenderCommand(rb, RenderCommand_Clear, color);
+}
+void RenderRect(render_buffer *rb, v2 pos, v2 dim, v4 color){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Rect, color);
+    if (command){
+        command->p[0] = pos;
+        command->p[1] = pos + dim;
+    }
+}
+void RenderTriangle(render_buffer *rb, v2 p0, v2 p1, v2 p2, v4 color){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Triangle, color);
+    if (command){
+        command->p[0] = p0;
+        command->p[1] = p1;
+        command->p[2] = p2;
+    }
+}
+void RenderCircle(render_buffer *rb, v2 center, f32 radius, v4 color){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Circle, color);
+    if (command){
+        command->p[0] = center;
+        command->circle.radius = radius;
+    }
+}
+// A ring split in two colors, like the 2 DrawRing() calls from 180 to 180 + 360*progress degrees (colorA)
+// and from there to 540 (colorB).
+void RenderProgressRing(render_buffer *rb, v2 center, f32 innerRadius, f32 outerRadius, f32 progress, v4 colorA, v4 colorB){
+    render_command *command = PushRenderCommand(rb, RenderCommand_ProgressRing, colorA);
+    if (command){
+        command->p[0] = center;
+        command->ring.innerRadius = innerRadius;
+        command->ring.outerRadius = outerRadius;
+        command->ring.progress = Clamp01(progress);
+        command->ring.colorB = RenderColor(colorB);
+    }
+}
+// Like DrawLineEx()
+void RenderLine(render_buffer *rb, v2 p0, v2 p1, f32 thick, v4 color){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Line, color);
+    if (command){
+        command->p[0] = p0;
+        command->p[1] = p1;
+        command->line.thick = thick;
+    }
+}
+// Like DrawSpriteFit()
+void RenderSprite(render_buffer *rb, v2 texPos, v2 texDim, v2 pos, v2 dim, v4 color = V4_White(), render_texture texture = RenderTexture_Main){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Sprite, color);
+    if (command){
+        command->texture = (u8)texture;
+        command->p[0] = pos;
+        command->p[1] = pos + dim;
+        command->sprite.texPos = texPos;
+        command->sprite.texDim = texDim;
+    }
+}
+// Like DrawText(). The text is copied.
+void RenderText(render_buffer *rb, char *text, f32 x, f32 y, s32 fontSize, v4 color, u32 flags = 0, s32 spacing = -1){
+    s32 size = (s32)strlen(text) + 1;
+    if (rb->textUsed + size > RENDER_TEXT_MEMORY){
+        rb->numDropped++;
+        return;
+    }
+    render_command *command = PushRenderCommand(rb, RenderCommand_Text, color);
+    if (command){
+        command->flags = (u8)flags;
+        command->p[0] = V2(x, y);
+        command->text.text = rb->textMemory + rb->textUsed;
+        command->text.fontSize = (s16)fontSize;
+        command->text.spacing = (s16)spacing;
+        memcpy(command->text.text, text, size);
+        rb->textUsed += size;
+    }
+}
+// The occupied tiles of the board with their color, with the board's top-left at 'pos'. The game must
+// stay as it is until the buffer is drawn.
+void RenderBricks(render_buffer *rb, game_state *game, v2 pos){
+    render_command *command = PushRenderCommand(rb, RenderCommand_Bricks, V4_White());
+    if (command){
+        command->p[0] = pos;
+        command->bricks.game = game;
+    }
+}
+
+// The live particles of 'ps', with (0, 0) at 'pos'. The system must stay as it is until the buffer is
+// drawn. They're drawn in one go, but not in the sprite batch (see DrawParticles()).
+void RenderParticles(render_buffer *rb, particle_system *ps, v2 pos){
+    if (!ps->numParticles)
+        return;
+    render_command *command = PushRenderCommand(rb, RenderCommand_Particles, V4_White());
+    if (command){
+        command->p[0] = pos;
+        command->particles.system = ps;
+    }
+}
+
+// Scales the commands pushed from 'first' on by 'scale' around (0, 0) and then moves them by 'offset', to
+// draw a whole frame (of 'frameDim') in a part of the target. A clear becomes a rect over the frame.
+// Text ends up with a whole font size; the text that would be smaller than 'minFontSize' is removed.
+void TransformRenderCommands(render_buffer *rb, s32 first, v2 frameDim, f32 scale, v2 offset, s32 minFontSize = 0){
+    s32 numKept = first;
+    for(s32 i = first; i < rb->numCommands; i++){
+        render_command *command = &rb->commands[i];
+        if (command->type == RenderCommand_Clear){
+            command->type = RenderCommand_Rect;
+            command->p[0] = V2(0);
+            command->p[1] = frameDim;
+        }
+        for(s32 j = 0; j < ArrayCount(command->p); j++){
+            command->p[j] = command->p[j]*scale + offset;
+        }
+        switch(command->type){
+            case RenderCommand_Circle:       { command->circle.radius *= scale; } break;
+            case RenderCommand_ProgressRing: { command->ring.innerRadius *= scale; command->ring.outerRadius *= scale; } break;
+            case RenderCommand_Line:         { command->line.thick *= scale; } break;
+            case RenderCommand_Text: {
+                command->text.fontSize = (s16)(command->text.fontSize*scale + .5f);
+                if (command->text.spacing > 0){
+                    command->text.spacing = (s16)MaxS32(1, (s32)(command->text.spacing*scale + .5f));
+                }
+                if (command->text.fontSize < minFontSize)
+                    continue;
+            } break;
+            case RenderCommand_Bricks:
+            case RenderCommand_Particles: { Assert(!"These can't be scaled"); } break;
+            default: break;
+        }
+        rb->commands[numKept++] = *command;
+    }
+    rb->numCommands = numKept;
+}
+
+
+//
+// Backends
+//
+
+// Sorts the commands by layer, keeping their order inside each layer. Backends call it before drawing.
+void SortRenderCommands(render_buffer *rb){
+    s32 layerStarts[RenderLayer_Count + 1] = {};
+    b32 sorted = true;
+    for(s32 i = 0; i < rb->numCommands; i++){
+        layerStarts[rb->commands[i].layer + 1]++;
+        if (i && rb->commands[i].layer < rb->commands[i - 1].layer){
+            sorted = false;
+        }
+    }
+    if (sorted)
+        return;
+    for(s32 i = 1; i <= RenderLayer_Count; i++){
+        layerStarts[i] += layerStarts[i - 1];
+    }
+    for(s32 i = 0; i < rb->numCommands; i++){
+        rb->sorted[layerStarts[rb->commands[i].layer]++] = rb->commands[i];
+    }
+    SWAP(rb->commands, rb->sorted);
+}
+
+// Whether the Raylib backend draws it in the sprite batch (textured from main.png).
+inline b32 IsBatchedRenderCommand(render_command *command){
+    b32 result = (command->type != RenderCommand_Clear && command->type != RenderCommand_Text && command->type != RenderCommand_Bricks &&
+                  command->type != RenderCommand_Particles && (command->type != RenderCommand_Sprite || command->texture == RenderTexture_Main));
+    return result;
+}
+
+// Null backend: what drawing the buffer with the Raylib backend takes, without drawing it. The bricks
+// count as their cached layer (a quad), without the tiles that are redrawn into it when they change.
+render_stats CountRenderCommands(render_buffer *rb){
+    SortRenderCommands(rb);
+    render_stats stats = {};
+    stats.numCommands = rb->numCommands;
+    stats.numDropped = rb->numDropped;
+    b32 inBatch = false;
+    for(s32 i = 0; i < rb->numCommands; i++){
+        render_command *command = &rb->commands[i];
+        stats.commandsOfType[command->type]++;
+        b32 batched = IsBatchedRenderCommand(command);
+        if (command->type != RenderCommand_Clear && (!batched || !inBatch)){
+            stats.numBatches++;
+        }
+        inBatch = batched;
+        switch(command->type){
+            case RenderCommand_Rect:
+            case RenderCommand_Line:
+            case RenderCommand_Sprite:
+            case RenderCommand_Bricks:       { stats.numTriangles += 2; } break;
+            case RenderCommand_Triangle:     { stats.numTriangles += 1; } break;
+            case RenderCommand_Particles:    { stats.numTriangles += 2*command->particles.system->numParticles; } break;
+            case RenderCommand_Circle:       { stats.numTriangles += RENDER_CIRCLE_SEGMENTS; } break;
+            case RenderCommand_ProgressRing: { stats.numTriangles += 2*RENDER_CIRCLE_SEGMENTS + (command->ring.progress*RENDER_CIRCLE_SEGMENTS != (s32)(command->ring.progress*RENDER_CIRCLE_SEGMENTS) ? 2 : 0); } break;
+            case RenderCommand_Text: {
+                for(char *it = command->text.text; *it; it++){
+                    if (*it != ' ' && *it != '\t' && *it != '\r' && *it != '\n')
+                        stats.numTriangles += 2;
+                }
+            } break;
+            default: break;
+        }
+    }
+    return stats;
+}
+
+#endif
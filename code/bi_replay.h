@@ -0,0 +1,102 @@
+//
+// Replays: the seed and config a match started with, and the dt and input of every UpdateGame() call.
+// The game is deterministic, so that's all it takes to play the match again, in the game or headless
+// (bi_export.cpp turns them into videos). Include it after bi_game.h.
+//
+// The file is the header followed by the frames, as they are in memory. The hash of the bricks when the
+// recording was saved goes in the header, so a replay played on a build whose math library rounds
+// differently (the browser's against a native one) is caught instead of silently showing another match.
+//
+
+#ifndef BI_REPLAY_H
+#define BI_REPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define REPLAY_MAGIC 0x50524942 // "BIRP"
+#define REPLAY_VERSION 1
+
+struct replay_header{
+    u32 magic;
+    u32 version;
+    u64 seed;
+    game_config config;
+    s32 numFrames;
+    u64 endBoardHash; // stats.boardHash after the last frame.
+};
+
+struct replay_frame{
+    f32 dt;
+    game_input input;
+};
+
+struct replay{
+    replay_header header;
+    replay_frame *frames;
+    s32 maxFrames;
+};
+
+// Starts a new recording, reusing the memory of the last one.
+void StartReplay(replay *r, game_config *config, u64 seed){
+    ZeroStruct(&r->header);
+    r->header.magic = REPLAY_MAGIC;
+    r->header.version = REPLAY_VERSION;
+    r->header.seed = seed;
+    r->header.config = *config;
+}
+
+// Call it with what was passed to UpdateGame(), after the call. Frames are dropped if there's no memory.
+void RecordReplayFrame(replay *r, f32 dt, game_input *input, game_state *game){
+    if (r->header.numFrames == r->maxFrames){
+        s32 maxFrames = MaxS32(r->maxFrames*2, 60*60);
+        replay_frame *frames = (replay_frame *)realloc(r->frames, maxFrames*sizeof(replay_frame));
+        if (!frames)
+            return;
+        r->frames = frames;
+        r->maxFrames = maxFrames;
+    }
+    replay_frame *frame = &r->frames[r->header.numFrames++];
+    frame->dt = dt;
+    frame->input = *input;
+    r->header.endBoardHash = game->stats.boardHash;
+}
+
+void FreeReplay(replay *r){
+    free(r->frames);
+    ZeroStruct(r);
+}
+
+b32 SaveReplay(replay *r, char *path){
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    b32 result = (fwrite(&r->header, sizeof(r->header), 1, file) == 1);
+    if (result && r->header.numFrames){
+        result = (fwrite(r->frames, sizeof(replay_frame), r->header.numFrames, file) == (size_t)r->header.numFrames);
+    }
+    fclose(file);
+    return result;
+}
+
+// Returns false if the file can't be read or isn't a replay of this version.
+b32 LoadReplay(replay *r, char *path){
+    FreeReplay(r);
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    b32 result = (fread(&r->header, sizeof(r->header), 1, file) == 1 && r->header.magic == REPLAY_MAGIC &&
+                  r->header.version == REPLAY_VERSION && r->header.numFrames >= 0);
+    if (result && r->header.numFrames){
+        r->frames = (replay_frame *)malloc(r->header.numFrames*sizeof(replay_frame));
+        result = (r->frames && fread(r->frames, sizeof(replay_frame), r->header.numFrames, file) == (size_t)r->header.numFrames);
+        r->maxFrames = r->header.numFrames;
+    }
+    fclose(file);
+    if (!result){
+        FreeReplay(r);
+    }
+    return result;
+}
+
+#endif
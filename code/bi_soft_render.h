@@ -0,0 +1,582 @@
+//
+// Software renderer: draws the primitives the game uses (rectangles, triangles, circles, rings, sprites
+// from a texture like main.png, and text) into an RGBA framebuffer in memory, without Raylib or a GPU.
+// It's for capturing frames headless. Blending and sampling follow Raylib's defaults (alpha blending,
+// nearest texels), so the frames look like the game's.
+//
+// Draw calls are only recorded. SoftRenderFlush() rasterizes them, split in bands of rows over the thread
+// pool if there is one. Each band draws all the commands in order, so the result is the same with any
+// number of threads. SoftDrawRenderCommands() is the backend for render buffers. Include it after
+// bi_threads.h and bi_render.h. Colors are RGBA8, see RenderColor().
+//
+
+#ifndef BI_SOFT_RENDER_H
+#define BI_SOFT_RENDER_H
+
+#include <stdlib.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// Pixels are RGBA8 (R first in memory, like Raylib's Color), rows from the top.
+struct soft_image{
+    u32 *pixels;
+    s32 width;
+    s32 height;
+};
+
+#define SOFT_FONT_FIRST_CHAR 32
+#define SOFT_FONT_NUM_CHARS 224 // Like Raylib's default font: 32 to 255
+#define SOFT_FONT_ATLAS_SIZE 128
+
+struct soft_glyph{
+    s32 x, y, width, height; // In the atlas
+    f32 offsetX, offsetY; // From the text position, at the base size
+    f32 advanceX;
+};
+struct soft_font{
+    soft_image atlas; // White glyphs, the tint multiplies them.
+    s32 baseSize;
+    soft_glyph glyphs[SOFT_FONT_NUM_CHARS];
+};
+
+enum soft_command_type{
+    SoftCommand_Clear, // Replaces the pixels instead of blending.
+    SoftCommand_Rect,
+    SoftCommand_Triangle,
+    SoftCommand_Circle,
+    SoftCommand_Sprite,
+};
+struct soft_command{
+    soft_command_type type;
+    u32 color;
+    s32 minY, maxY; // Rows it can touch, to skip it quickly in other bands.
+    v2 p[3]; // Rect and sprite: min, max. Triangle: vertices. Circle: center, (radius, 0).
+    v2 uv0, uv1; // Sprite: texel coordinates at min and at max (flipped if uv1 < uv0).
+    soft_image *texture;
+};
+
+#define SOFT_MAX_COMMANDS (1 << 15)
+#define SOFT_BANDS_PER_THREAD 4
+
+struct soft_renderer;
+struct soft_band_job{
+    soft_renderer *renderer;
+    s32 minY, endY;
+};
+
+struct soft_renderer{
+    soft_image target;
+    soft_image *texture; // For sprites
+    soft_font *font; // For text
+    thread_pool *pool; // Can be null
+    soft_command *commands;
+    s32 numCommands;
+    soft_band_job bandJobs[MAX_THREAD_JOBS];
+};
+
+
+//
+// Default font
+//
+// Raylib's default font, rebuilt on the CPU the way LoadFontDefault() does it, from the same data: the
+// bits of its 128x128 atlas and the width of each glyph. Headless tools get them from the header that
+// bi_fontgen.cpp generates from Raylib's rtext.c when they're built (bi_default_font.h).
+//
+static u32 globalSoftFontPixels[SOFT_FONT_ATLAS_SIZE*SOFT_FONT_ATLAS_SIZE];
+
+// 'fontData': SOFT_FONT_ATLAS_SIZE^2/32 words, bit j of each one is the pixel j after the ones of the
+// words before it, rows from the top. 'glyphWidths': SOFT_FONT_NUM_CHARS.
+void InitSoftDefaultFont(soft_font *font, u32 *fontData, u8 *glyphWidths){
+    ZeroStruct(font);
+    font->atlas.pixels = globalSoftFontPixels;
+    font->atlas.width = SOFT_FONT_ATLAS_SIZE;
+    font->atlas.height = SOFT_FONT_ATLAS_SIZE;
+    for(s32 i = 0; i < SOFT_FONT_ATLAS_SIZE*SOFT_FONT_ATLAS_SIZE; i++){
+        globalSoftFontPixels[i] = ((fontData[i/32] >> (i % 32)) & 0x1) ? 0xFFFFFFFF : 0x00FFFFFF;
+    }
+
+    // The glyphs are 10 pixels high, in rows, with a pixel between them and around the edges. A glyph
+    // that reaches the right edge starts the next row, as in LoadFontDefault().
+    s32 height = 10;
+    s32 divisor = 1;
+    font->baseSize = height;
+    s32 line = 0;
+    s32 x = divisor;
+    s32 testX = divisor;
+    for(s32 i = 0; i < SOFT_FONT_NUM_CHARS; i++){
+        soft_glyph *glyph = &font->glyphs[i];
+        s32 width = glyphWidths[i];
+        glyph->x = x;
+        glyph->y = divisor + line*(height + divisor);
+        glyph->width = width;
+        glyph->height = height;
+        testX += width + divisor;
+        if (testX >= SOFT_FONT_ATLAS_SIZE){
+            line++;
+            x = 2*divisor + width;
+            testX = x;
+            glyph->x = divisor;
+            glyph->y = divisor + line*(height + divisor);
+        }else{
+            x = testX;
+        }
+        glyph->advanceX = (f32)width; // Raylib's advance is 0 for these, which means the width.
+    }
+}
+
+
+//
+// Recording
+//
+
+b32 InitSoftRenderer(soft_renderer *r, s32 width, s32 height, soft_image *texture, soft_font *font, thread_pool *pool = 0){
+    ZeroStruct(r);
+    r->target.pixels = (u32 *)calloc((size_t)width*height, sizeof(u32));
+    r->commands = (soft_command *)malloc(SOFT_MAX_COMMANDS*sizeof(soft_command));
+    if (!r->target.pixels || !r->commands){
+        free(r->target.pixels);
+        free(r->commands);
+        ZeroStruct(r);
+        return false;
+    }
+    r->target.width = width;
+    r->target.height = height;
+    r->texture = texture;
+    r->font = font;
+    r->pool = pool;
+    return true;
+}
+void FreeSoftRenderer(soft_renderer *r){
+    free(r->target.pixels);
+    free(r->commands);
+    ZeroStruct(r);
+}
+
+// Returns 0 if the command buffer is full (the draw is dropped) or it can't touch any row.
+soft_command *PushSoftCommand(soft_renderer *r, soft_command_type type, u32 color, f32 minY, f32 maxY){
+    s32 rowMin = MaxS32(0, (s32)Floor(minY));
+    s32 rowMax = MinS32(r->target.height - 1, (s32)Ceil(maxY));
+    if (r->numCommands >= SOFT_MAX_COMMANDS || rowMin > rowMax)
+        return 0;
+    soft_command *command = &r->commands[r->numCommands++];
+    command->type = type;
+    command->color = color;
+    command->minY = rowMin;
+    command->maxY = rowMax;
+    return command;
+}
+
+void SoftClear(soft_renderer *r, u32 color){
+    r->numCommands = 0; // Nothing drawn before matters.
+    soft_command *command = PushSoftCommand(r, SoftCommand_Clear, color, 0, (f32)r->target.height);
+    if (command){
+        command->p[0] = V2(0);
+        command->p[1] = V2((f32)r->target.width, (f32)r->target.height);
+    }
+}
+void SoftDrawRect(soft_renderer *r, v2 pos, v2 dim, u32 color){
+    soft_command *command = PushSoftCommand(r, SoftCommand_Rect, color, pos.y, pos.y + dim.y);
+    if (command){
+        command->p[0] = pos;
+        command->p[1] = pos + dim;
+    }
+}
+void SoftDrawTriangle(soft_renderer *r, v2 p0, v2 p1, v2 p2, u32 color){
+    soft_command *command = PushSoftCommand(r, SoftCommand_Triangle, color, Min(p0.y, Min(p1.y, p2.y)), Max(p0.y, Max(p1.y, p2.y)));
+    if (command){
+        command->p[0] = p0;
+        command->p[1] = p1;
+        command->p[2] = p2;
+    }
+}
+// Like DrawLineEx()
+void SoftDrawLine(soft_renderer *r, v2 p0, v2 p1, f32 thick, u32 color){
+    f32 length = Length(p1 - p0);
+    if (length > 0){
+        v2 n = V2(p0.y - p1.y, p1.x - p0.x)*(thick/(2*length));
+        SoftDrawTriangle(r, p0 + n, p0 - n, p1 - n, color);
+        SoftDrawTriangle(r, p0 + n, p1 - n, p1 + n, color);
+    }
+}
+void SoftDrawCircle(soft_renderer *r, v2 center, f32 radius, u32 color){
+    soft_command *command = PushSoftCommand(r, SoftCommand_Circle, color, center.y - radius, center.y + radius);
+    if (command){
+        command->p[0] = center;
+        command->p[1] = V2(radius, 0);
+    }
+}
+// Like Raylib's DrawRing(): angles in degrees, 180 is the top.
+void SoftDrawRing(soft_renderer *r, v2 center, f32 innerRadius, f32 outerRadius, f32 startAngle, f32 endAngle, s32 segments, u32 color){
+    f32 step = (endAngle - startAngle)/(f32)MaxS32(segments, 1);
+    v2 d0 = V2(Sin(startAngle*PI/180.f), Cos(startAngle*PI/180.f));
+    for(s32 i = 0; i < segments; i++){
+        f32 angle = (startAngle + (i + 1)*step)*PI/180.f;
+        v2 d1 = V2(Sin(angle), Cos(angle));
+        SoftDrawTriangle(r, center + outerRadius*d0, center + innerRadius*d0, center + innerRadius*d1, color);
+        SoftDrawTriangle(r, center + innerRadius*d1, center + outerRadius*d1, center + outerRadius*d0, color);
+        d0 = d1;
+    }
+}
+void SoftDrawImage(soft_renderer *r, soft_image *texture, v2 texPos, v2 texDim, v2 pos, v2 dim, u32 color){
+    soft_command *command = PushSoftCommand(r, SoftCommand_Sprite, color, pos.y, pos.y + dim.y);
+    if (command){
+        command->p[0] = pos;
+        command->p[1] = pos + dim;
+        command->uv0 = texPos;
+        command->uv1 = texPos + texDim;
+        command->texture = texture;
+    }
+}
+// Like DrawSpriteFit(). A negative texDim flips it.
+void SoftDrawSprite(soft_renderer *r, v2 texPos, v2 texDim, v2 pos, v2 dim, u32 color = 0xFFFFFFFF){
+    if (r->texture){
+        SoftDrawImage(r, r->texture, texPos, texDim, pos, dim, color);
+    }
+}
+
+// Characters the font doesn't have are drawn as '?', like in Raylib.
+inline s32 SoftGlyphIndex(char c){
+    s32 index = (u8)c - SOFT_FONT_FIRST_CHAR;
+    if (index < 0 || index >= SOFT_FONT_NUM_CHARS)
+        index = '?' - SOFT_FONT_FIRST_CHAR;
+    return index;
+}
+
+// Like DrawText() and MeasureText(). spacing < 0: DrawText()'s (fontSize/10).
+void SoftDrawText(soft_renderer *r, char *text, f32 x, f32 y, s32 fontSize, u32 color, f32 spacing = -1.f){
+    soft_font *font = r->font;
+    if (!font)
+        return;
+    s32 size = MaxS32(fontSize, 10);
+    f32 scale = size/(f32)font->baseSize;
+    if (spacing < 0){
+        spacing = (f32)(size/10);
+    }
+    f32 xIt = 0;
+    f32 yIt = 0;
+    for(char *it = text; *it; it++){
+        if (*it == '\n'){
+            xIt = 0;
+            yIt += (s32)(font->baseSize*1.5f*scale);
+            continue;
+        }
+        s32 index = SoftGlyphIndex(*it);
+        soft_glyph *glyph = &font->glyphs[index];
+        if (*it != ' ' && *it != '\t'){
+            v2 pos = V2(x + xIt + glyph->offsetX*scale, y + yIt + glyph->offsetY*scale);
+            SoftDrawImage(r, &font->atlas, V2((f32)glyph->x, (f32)glyph->y), V2((f32)glyph->width, (f32)glyph->height), pos, scale*V2((f32)glyph->width, (f32)glyph->height), color);
+        }
+        xIt += glyph->advanceX*scale + spacing;
+    }
+}
+s32 SoftMeasureText(soft_renderer *r, char *text, s32 fontSize){
+    soft_font *font = r->font;
+    if (!font)
+        return 0;
+    s32 size = MaxS32(fontSize, 10);
+    f32 scale = size/(f32)font->baseSize;
+    f32 width = 0;
+    f32 maxWidth = 0;
+    s32 chars = 0;
+    s32 maxChars = 0;
+    for(char *it = text; *it; it++){
+        if (*it == '\n'){
+            width = 0;
+            chars = 0;
+            continue;
+        }
+        s32 index = SoftGlyphIndex(*it);
+        width += font->glyphs[index].advanceX;
+        chars++;
+        maxWidth = Max(maxWidth, width);
+        maxChars = MaxS32(maxChars, chars);
+    }
+    s32 result = (s32)(maxWidth*scale + (f32)(MaxS32(maxChars - 1, 0)*(size/10)));
+    return result;
+}
+
+
+//
+// Rasterization
+//
+// Pixel (x, y) is covered if its center (x + .5, y + .5) is inside, with the right and bottom edges left
+// out, so shapes that share an edge (like the segments of a ring) don't blend twice on it.
+//
+
+// round(a*b/255), exact for 8-bit values.
+inline u32 SoftMul255(u32 a, u32 b){
+    u32 t = a*b + 128;
+    u32 result = (t + (t >> 8)) >> 8;
+    return result;
+}
+
+// Alpha blending like Raylib's default (src*alpha + dest*(1 - alpha), on the alpha channel too).
+inline u32 SoftBlend(u32 dest, u32 src){
+    u32 a = src >> 24;
+    if (a == 255)
+        return src;
+    u32 ia = 255 - a;
+    u32 result = 0;
+    for(s32 shift = 0; shift < 32; shift += 8){
+        u32 s = (src >> shift) & 0xFF;
+        u32 d = (dest >> shift) & 0xFF;
+        result |= (SoftMul255(s, a) + SoftMul255(d, ia)) << shift;
+    }
+    return result;
+}
+
+// Blends a color over the pixels [x0, x1) of a row.
+void SoftFillSpan(u32 *row, s32 x0, s32 x1, u32 color){
+    u32 a = color >> 24;
+    if (a == 0)
+        return;
+    s32 x = x0;
+    if (a == 255){
+#if defined(__SSE2__)
+        __m128i c = _mm_set1_epi32((s32)color);
+        for(; x + 4 <= x1; x += 4){
+            _mm_storeu_si128((__m128i *)(row + x), c);
+        }
+#endif
+        for(; x < x1; x++){
+            row[x] = color;
+        }
+        return;
+    }
+    u32 ia = 255 - a;
+#if defined(__SSE2__)
+    // The color's part is the same for every pixel, only dest*(1 - alpha) is computed per pixel. Same
+    // rounding as SoftBlend(), so both paths give the same result.
+    u32 premultiplied = (SoftMul255(color & 0xFF, a) | (SoftMul255((color >> 8) & 0xFF, a) << 8) |
+                         (SoftMul255((color >> 16) & 0xFF, a) << 16) | (SoftMul255(color >> 24, a) << 24));
+    __m128i src = _mm_set1_epi32((s32)premultiplied);
+    __m128i inv = _mm_set1_epi16((s16)ia);
+    __m128i half = _mm_set1_epi16(128);
+    __m128i zero = _mm_setzero_si128();
+    for(; x + 4 <= x1; x += 4){
+        __m128i d = _mm_loadu_si128((__m128i *)(row + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv), half);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)(row + x), _mm_adds_epu8(_mm_packus_epi16(lo, hi), src));
+    }
+#endif
+    for(; x < x1; x++){
+        row[x] = SoftBlend(row[x], color);
+    }
+}
+
+// First pixel whose center is at or after x.
+inline s32 SoftPixelStart(f32 x){
+    s32 result = (s32)Ceil(x - .5f);
+    return result;
+}
+
+void SoftRasterizeCommand(soft_renderer *r, soft_command *command, s32 minY, s32 endY){
+    soft_image *target = &r->target;
+    minY = MaxS32(minY, command->minY);
+    endY = MinS32(endY, command->maxY + 1);
+
+    if (command->type == SoftCommand_Clear || command->type == SoftCommand_Rect || command->type == SoftCommand_Sprite){
+        v2 p0 = command->p[0];
+        v2 p1 = command->p[1];
+        s32 x0 = MaxS32(0, SoftPixelStart(p0.x));
+        s32 x1 = MinS32(target->width, SoftPixelStart(p1.x));
+        s32 y0 = MaxS32(minY, SoftPixelStart(p0.y));
+        s32 y1 = MinS32(endY, SoftPixelStart(p1.y));
+        if (command->type == SoftCommand_Clear){
+            for(s32 y = y0; y < y1; y++){
+                u32 *row = target->pixels + y*target->width;
+                for(s32 x = x0; x < x1; x++){
+                    row[x] = command->color;
+                }
+            }
+        }else if (command->type == SoftCommand_Rect){
+            for(s32 y = y0; y < y1; y++){
+                SoftFillSpan(target->pixels + y*target->width, x0, x1, command->color);
+            }
+        }else{
+            soft_image *tex = command->texture;
+            v2 uvPerPixel = V2((command->uv1.x - command->uv0.x)/(p1.x - p0.x), (command->uv1.y - command->uv0.y)/(p1.y - p0.y));
+            u32 tint = command->color;
+            for(s32 y = y0; y < y1; y++){
+                s32 ty = ClampS32((s32)Floor(command->uv0.y + (y + .5f - p0.y)*uvPerPixel.y), 0, tex->height - 1);
+                u32 *texRow = tex->pixels + ty*tex->width;
+                u32 *row = target->pixels + y*target->width;
+                for(s32 x = x0; x < x1; x++){
+                    s32 tx = ClampS32((s32)Floor(command->uv0.x + (x + .5f - p0.x)*uvPerPixel.x), 0, tex->width - 1);
+                    u32 texel = texRow[tx];
+                    if (tint != 0xFFFFFFFF){
+                        texel = (SoftMul255(texel & 0xFF, tint & 0xFF) | (SoftMul255((texel >> 8) & 0xFF, (tint >> 8) & 0xFF) << 8) |
+                                 (SoftMul255((texel >> 16) & 0xFF, (tint >> 16) & 0xFF) << 16) | (SoftMul255(texel >> 24, tint >> 24) << 24));
+                    }
+                    if (texel >> 24){
+                        row[x] = SoftBlend(row[x], texel);
+                    }
+                }
+            }
+        }
+    }else if (command->type == SoftCommand_Triangle){
+        v2 *p = command->p;
+        for(s32 y = minY; y < endY; y++){
+            f32 yc = y + .5f;
+            f32 xl = 1e30f;
+            f32 xr = -1e30f;
+            for(s32 i = 0; i < 3; i++){
+                v2 a = p[i];
+                v2 b = p[(i + 1) % 3];
+                if (a.y > b.y){
+                    SWAP(a, b);
+                }
+                if (yc >= a.y && yc < b.y){
+                    f32 x = a.x + (yc - a.y)*(b.x - a.x)/(b.y - a.y);
+                    xl = Min(xl, x);
+                    xr = Max(xr, x);
+                }
+            }
+            if (xl < xr){
+                s32 x0 = MaxS32(0, SoftPixelStart(xl));
+                s32 x1 = MinS32(target->width, SoftPixelStart(xr));
+                SoftFillSpan(target->pixels + y*target->width, x0, x1, command->color);
+            }
+        }
+    }else if (command->type == SoftCommand_Circle){
+        v2 c = command->p[0];
+        f32 radius = command->p[1].x;
+        for(s32 y = minY; y < endY; y++){
+            f32 dy = y + .5f - c.y;
+            if (dy*dy < radius*radius){
+                f32 dx = SquareRoot(radius*radius - dy*dy);
+                s32 x0 = MaxS32(0, SoftPixelStart(c.x - dx));
+                s32 x1 = MinS32(target->width, SoftPixelStart(c.x + dx));
+                SoftFillSpan(target->pixels + y*target->width, x0, x1, command->color);
+            }
+        }
+    }
+}
+
+void SoftRasterizeBand(void *data){
+    soft_band_job *job = (soft_band_job *)data;
+    soft_renderer *r = job->renderer;
+    for(s32 i = 0; i < r->numCommands; i++){
+        soft_command *command = &r->commands[i];
+        if (command->maxY >= job->minY && command->minY < job->endY){
+            SoftRasterizeCommand(r, command, job->minY, job->endY);
+        }
+    }
+}
+
+// Draws the recorded commands into r->target and starts a new list.
+void SoftRenderFlush(soft_renderer *r){
+    s32 numBands = 1;
+    if (r->pool && r->pool->numThreads){
+        numBands = MinS32(MAX_THREAD_JOBS, (r->pool->numThreads + 1)*SOFT_BANDS_PER_THREAD);
+    }
+    numBands = MinS32(numBands, r->target.height);
+    s32 bandHeight = (r->target.height + numBands - 1)/numBands;
+    for(s32 i = 0; i < numBands; i++){
+        soft_band_job *job = &r->bandJobs[i];
+        job->renderer = r;
+        job->minY = i*bandHeight;
+        job->endY = MinS32(r->target.height, job->minY + bandHeight);
+        if (numBands == 1){
+            SoftRasterizeBand(job);
+        }else{
+            AddThreadJob(r->pool, SoftRasterizeBand, job);
+        }
+    }
+    if (numBands > 1){
+        WaitForThreadJobs(r->pool);
+    }
+    r->numCommands = 0;
+}
+
+
+//
+// Render commands backend
+//
+
+// Draws a render buffer (records it, SoftRenderFlush() rasterizes it). Sprites that don't sample main.png
+// are skipped.
+void SoftDrawRenderCommands(soft_renderer *r, render_buffer *rb){
+    SortRenderCommands(rb);
+    for(s32 i = 0; i < rb->numCommands; i++){
+        render_command *command = &rb->commands[i];
+        u32 color = command->color;
+        v2 *p = command->p;
+        switch(command->type){
+            case RenderCommand_Clear:    { SoftClear(r, color); } break;
+            case RenderCommand_Rect:     { SoftDrawRect(r, p[0], p[1] - p[0], color); } break;
+            case RenderCommand_Triangle: { SoftDrawTriangle(r, p[0], p[1], p[2], color); } break;
+            case RenderCommand_Circle:   { SoftDrawCircle(r, p[0], command->circle.radius, color); } break;
+            case RenderCommand_Line:     { SoftDrawLine(r, p[0], p[1], command->line.thick, color); } break;
+            case RenderCommand_ProgressRing: {
+                f32 progress = command->ring.progress;
+                f32 splitAngle = 180.f + 360.f*progress;
+                s32 segmentsA = (s32)(RENDER_CIRCLE_SEGMENTS*progress + .5f);
+                if (progress > 0){
+                    SoftDrawRing(r, p[0], command->ring.innerRadius, command->ring.outerRadius, 180.f, splitAngle, MaxS32(segmentsA, 1), color);
+                }
+                if (progress < 1.f){
+                    SoftDrawRing(r, p[0], command->ring.innerRadius, command->ring.outerRadius, splitAngle, 540.f, MaxS32(RENDER_CIRCLE_SEGMENTS - segmentsA, 1), command->ring.colorB);
+                }
+            } break;
+            case RenderCommand_Sprite: {
+                if (command->texture == RenderTexture_Main){
+                    SoftDrawSprite(r, command->sprite.texPos, command->sprite.texDim, p[0], p[1] - p[0], color);
+                }
+            } break;
+            case RenderCommand_Text: {
+                char *text = command->text.text;
+                s32 fontSize = command->text.fontSize;
+                f32 x = p[0].x;
+                f32 y = p[0].y;
+                if (command->flags & RenderText_CenterX){
+                    x -= SoftMeasureText(r, text, fontSize)/2;
+                }
+                if (command->text.spacing < 0){ // DrawText() takes whole pixels
+                    x = (f32)(s32)x;
+                    y = (f32)(s32)y;
+                }
+                if (command->flags & RenderText_Colorful){
+                    // Like DrawTextColorful(): a color per letter.
+                    char letter[2] = {};
+                    s32 colorIndex = 0;
+                    for(char *it = text; *it; it++){
+                        letter[0] = *it;
+                        SoftDrawText(r, letter, x, y, fontSize, RenderColor(globalRenderTextColors[colorIndex % ArrayCount(globalRenderTextColors)]));
+                        x += SoftMeasureText(r, letter, fontSize) + SoftMeasureText(r, "i", fontSize);
+                        if (*it != ' ')
+                            colorIndex++;
+                    }
+                }else{
+                    SoftDrawText(r, text, x, y, fontSize, color, command->text.spacing);
+                }
+            } break;
+            case RenderCommand_Particles: {
+                particle_system *ps = command->particles.system;
+                for(s32 j = 0; j < ps->numParticles; j++){
+                    f32 size = ParticleSize(ps, j);
+                    SoftDrawRect(r, p[0] + V2(ps->posX[j], ps->posY[j]) - V2(size/2), V2(size), ParticleColor(ps, j));
+                }
+            } break;
+            case RenderCommand_Bricks: {
+                game_state *game = command->bricks.game;
+                f32 m = TILE_DRAW_MARGIN;
+                for(s32 y = 0; y < game->gridDim.y; y++){
+                    for(s32 x = 0; x < game->gridDim.x; x++){
+                        tile_state *tile = &game->tiles[y*game->gridDim.x + x];
+                        if (tile->occupied){
+                            v2 tilePos = p[0] + V2(x*game->tileDim.x + m, y*game->tileDim.y + m);
+                            SoftDrawRect(r, tilePos, game->tileDim - V2(2*m), RenderColor(tile->color));
+                        }
+                    }
+                }
+            } break;
+        }
+    }
+}
+
+#endif
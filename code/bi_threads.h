@@ -0,0 +1,242 @@
+//
+// A small pool of worker threads and a clock, for the headless work (AI searches) that doesn't touch Raylib.
+// Also atomics and a triple buffer, to pass state between threads without locks.
+// Without thread support (the web build isn't compiled with -pthread) the pool has no threads and the
+// jobs run on the thread that waits for them, so the callers don't need to care. Include it after bi_base.h.
+//
+
+#ifndef BI_THREADS_H
+#define BI_THREADS_H
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    #define BI_THREADS 1
+    #include <pthread.h>
+    #include <unistd.h>
+#else
+    #define BI_THREADS 0
+#endif
+
+#if defined(__EMSCRIPTEN__)
+    #include <emscripten/emscripten.h>
+#else
+    #include <time.h>
+#endif
+
+//
+// Clock
+//
+u64 GetMicroseconds(){
+#if defined(__EMSCRIPTEN__)
+    u64 result = (u64)(emscripten_get_now()*1000.0);
+#else
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    u64 result = (u64)t.tv_sec*1000000 + (u64)t.tv_nsec/1000;
+#endif
+    return result;
+}
+
+//
+// Atomics
+//
+// GCC and Clang builtins (emcc and MinGW have them too). Loads acquire and stores release, so what was
+// written before a store is seen by the thread that loads it.
+//
+inline u32 AtomicLoadU32(u32 *p){
+    u32 result = __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    return result;
+}
+inline void AtomicStoreU32(u32 *p, u32 value){
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+// Returns the old value.
+inline u32 AtomicExchangeU32(u32 *p, u32 value){
+    u32 result = __atomic_exchange_n(p, value, __ATOMIC_ACQ_REL);
+    return result;
+}
+// Returns the old value.
+inline s32 AtomicAddS32(s32 *p, s32 value){
+    s32 result = __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL);
+    return result;
+}
+
+//
+// Triple buffer
+//
+// One thread publishes a value over and over and another one reads the latest, without locks and without
+// either waiting for the other. There are 3 slots (in an array the user keeps): the writer's, the
+// reader's, and the latest one published, which they swap for theirs with an atomic exchange.
+//
+#define TRIPLE_BUFFER_NEW 0x4 // In 'latest': published since the reader took the last one.
+
+struct triple_buffer{
+    u32 latest; // Slot index, | TRIPLE_BUFFER_NEW
+    u32 writeSlot; // Only used by the writer
+    u32 readSlot; // Only used by the reader
+};
+
+// Fill all the slots before the threads start using it.
+void InitTripleBuffer(triple_buffer *tb){
+    tb->latest = 0;
+    tb->writeSlot = 1;
+    tb->readSlot = 2;
+}
+// The writer fills writeSlot, then calls this, which gives it another one to fill.
+void PublishTripleBuffer(triple_buffer *tb){
+    u32 old = AtomicExchangeU32(&tb->latest, tb->writeSlot | TRIPLE_BUFFER_NEW);
+    tb->writeSlot = old & 0x3;
+}
+// Makes readSlot the latest published slot. Returns false if nothing was published since the last call
+// (readSlot stays the same).
+b32 AcquireTripleBuffer(triple_buffer *tb){
+    if (!(AtomicLoadU32(&tb->latest) & TRIPLE_BUFFER_NEW))
+        return false;
+    u32 old = AtomicExchangeU32(&tb->latest, tb->readSlot);
+    tb->readSlot = old & 0x3;
+    return true;
+}
+
+//
+// Thread pool
+//
+// Jobs are added in batches: AddThreadJob() a few times, then WaitForThreadJobs(), which also works
+// on the queue until it's empty. Jobs must not add jobs.
+//
+typedef void thread_job_proc(void *data);
+
+struct thread_job{
+    thread_job_proc *proc;
+    void *data;
+};
+
+#define MAX_WORKER_THREADS 15
+#define MAX_THREAD_JOBS 64
+
+struct thread_pool{
+    s32 numThreads; // 0 when there's no thread support.
+    thread_job jobs[MAX_THREAD_JOBS];
+    s32 numJobs;
+    s32 nextJob; // Jobs before this one were taken.
+    s32 numJobsDone;
+    s32 numRunningThreads;
+    b32 quit;
+#if BI_THREADS
+    pthread_t threads[MAX_WORKER_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t jobsAdded;
+    pthread_cond_t jobsDone;
+#endif
+};
+
+// Takes the next job and runs it. Returns false if there were none. (Called with the mutex locked.)
+b32 DoNextThreadJob(thread_pool *pool){
+    if (pool->nextJob >= pool->numJobs)
+        return false;
+    thread_job job = pool->jobs[pool->nextJob++];
+#if BI_THREADS
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+    job.proc(job.data);
+#if BI_THREADS
+    pthread_mutex_lock(&pool->mutex);
+#endif
+    pool->numJobsDone++;
+#if BI_THREADS
+    if (pool->numJobsDone == pool->numJobs)
+        pthread_cond_broadcast(&pool->jobsDone);
+#endif
+    return true;
+}
+
+#if BI_THREADS
+void *WorkerThreadProc(void *data){
+    thread_pool *pool = (thread_pool *)data;
+    pthread_mutex_lock(&pool->mutex);
+    while(!pool->quit){
+        if (!DoNextThreadJob(pool))
+            pthread_cond_wait(&pool->jobsAdded, &pool->mutex);
+    }
+    pool->numRunningThreads--;
+    pthread_cond_broadcast(&pool->jobsDone);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+#endif
+
+// 'numThreads' < 0 uses one thread less than the number of cores (the caller works too).
+// The threads live until the program ends, or until ShutdownThreadPool().
+void InitThreadPool(thread_pool *pool, s32 numThreads = -1){
+    ZeroStruct(pool);
+#if BI_THREADS
+    if (numThreads < 0){
+        numThreads = (s32)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    }
+    numThreads = ClampS32(numThreads, 0, MAX_WORKER_THREADS);
+    pthread_mutex_init(&pool->mutex, 0);
+    pthread_cond_init(&pool->jobsAdded, 0);
+    pthread_cond_init(&pool->jobsDone, 0);
+    for(s32 i = 0; i < numThreads; i++){
+        if (pthread_create(&pool->threads[i], 0, WorkerThreadProc, pool) != 0)
+            break;
+        pthread_detach(pool->threads[i]);
+        pool->numThreads++;
+        pool->numRunningThreads++;
+    }
+#endif
+}
+
+// If the queue is full the job runs right away.
+void AddThreadJob(thread_pool *pool, thread_job_proc *proc, void *data){
+    b32 added = false;
+#if BI_THREADS
+    pthread_mutex_lock(&pool->mutex);
+#endif
+    if (pool->numJobs < ArrayCount(pool->jobs)){
+        pool->jobs[pool->numJobs].proc = proc;
+        pool->jobs[pool->numJobs].data = data;
+        pool->numJobs++;
+        added = true;
+#if BI_THREADS
+        pthread_cond_signal(&pool->jobsAdded);
+#endif
+    }
+#if BI_THREADS
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+    if (!added)
+        proc(data);
+}
+
+// Returns when all the added jobs are done.
+void WaitForThreadJobs(thread_pool *pool){
+#if BI_THREADS
+    pthread_mutex_lock(&pool->mutex);
+#endif
+    while(DoNextThreadJob(pool)){}
+#if BI_THREADS
+    while(pool->numJobsDone < pool->numJobs)
+        pthread_cond_wait(&pool->jobsDone, &pool->mutex);
+#endif
+    pool->numJobs = pool->nextJob = pool->numJobsDone = 0;
+#if BI_THREADS
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+// Stops the threads and waits until they're gone, so the pool can be freed. No jobs can be pending.
+void ShutdownThreadPool(thread_pool *pool){
+#if BI_THREADS
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->jobsAdded);
+    while(pool->numRunningThreads > 0)
+        pthread_cond_wait(&pool->jobsDone, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->jobsAdded);
+    pthread_cond_destroy(&pool->jobsDone);
+#endif
+    pool->numThreads = 0;
+}
+
+#endif
@@ -0,0 +1,377 @@
+/*
+*  Headless tuner for the bricks AI weights (bricks_ai_weights in bi_ai.h).
+*
+*  It's a small genetic search. Every generation, each candidate set of weights plays the same matches
+*  against the paddle bot, spread over all the cores. The best candidates are kept, and the rest of the
+*  population is bred from them. At the end the best few are played again on new matches (with the
+*  default weights for comparison), and the winner is saved as a named profile in the profiles file,
+*  which the game loads at startup ("AI Level" in the options).
+*
+*  Usage: bi_tuner <profile name> [options]
+*    -generations N  (default 20)
+*    -population N   (default 16)
+*    -matches N      Matches per candidate per generation (default 24).
+*    -maxtime S      Seconds a match can last before it counts as a bricks win on time (default 180).
+*    -target S       Look for weights whose matches last about S seconds instead of the strongest ones,
+*                    to make easier levels.
+*    -threads N      Worker threads (default: one less than the number of cores).
+*    -file PATH      Profiles file (default resources/ai_profiles.txt, run it from the repo root).
+*
+*  It doesn't use Raylib. Build it natively with bat/build_tuner.bat.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bi_base.h"
+#include "bi_math.h"
+#include "bi_game.h"
+#include "bi_threads.h"
+#include "bi_ai.h"
+
+//
+// Genes
+//
+// The weights as an array of floats, with the range each one is searched in.
+//
+
+#define NUM_GENES 9
+
+struct gene_range{
+    f32 min;
+    f32 max;
+};
+gene_range geneRanges[NUM_GENES] = {
+    {0, 1.5f}, // adjacent
+    {0, 1.5f}, // yPos
+    {0, 1.f},  // time
+    {0, 2.f},  // emergency
+    {0, 1.f},  // spawnerStrength
+    {0, 1.f},  // powerupStrength
+    {0, 1.f},  // badPowerupStrength
+    {0, 1.f},  // arrowStrength
+    {1.f, (f32)MAX_BRICKS_AI_TRIES}, // numTries
+};
+
+struct tuner_candidate{
+    f32 genes[NUM_GENES];
+    bricks_ai_weights weights;
+    f32 fitness;
+};
+
+void WeightsToGenes(bricks_ai_weights *w, f32 *genes){
+    f32 values[NUM_GENES] = {w->adjacent, w->yPos, w->time, w->emergency, w->spawnerStrength, w->powerupStrength,
+                             w->badPowerupStrength, w->arrowStrength, (f32)w->numTries};
+    memcpy(genes, values, sizeof(values));
+}
+
+bricks_ai_weights GenesToWeights(f32 *genes){
+    bricks_ai_weights w;
+    w.adjacent = genes[0];
+    w.yPos = genes[1];
+    w.time = genes[2];
+    w.emergency = genes[3];
+    w.spawnerStrength = genes[4];
+    w.powerupStrength = genes[5];
+    w.badPowerupStrength = genes[6];
+    w.arrowStrength = genes[7];
+    w.numTries = ClampS32((s32)Round(genes[8]), 1, MAX_BRICKS_AI_TRIES);
+    return w;
+}
+
+f32 RandomGaussian(){
+    f32 u = Max(Random01(), 1e-7f);
+    f32 v = Random01();
+    return sqrtf(-2.f*logf(u))*cosf(2.f*PI*v);
+}
+
+// Moves each gene with probability 'chance', by a normal amount of 'sigma' times its range.
+void MutateGenes(f32 *genes, f32 sigma, f32 chance){
+    for(s32 i = 0; i < NUM_GENES; i++){
+        if (RandomChance(chance)){
+            f32 range = geneRanges[i].max - geneRanges[i].min;
+            genes[i] = Clamp(genes[i] + RandomGaussian()*sigma*range, geneRanges[i].min, geneRanges[i].max);
+        }
+    }
+}
+
+//
+// Matches
+//
+
+struct tuner_match{
+    bricks_ai_weights *weights;
+    game_config *config;
+    u64 seed;
+    f32 maxTime;
+
+    // Results
+    f32 gameTime;
+    b32 bricksWon; // Also when the time ran out.
+};
+
+// Thread job: plays a match of the bricks AI against the paddle bot.
+void RunTunerMatch(void *data){
+    tuner_match *match = (tuner_match *)data;
+    game_state *game = (game_state *)malloc(sizeof(game_state));
+    placement_cache *cache = (placement_cache *)malloc(sizeof(placement_cache));
+    paddle_bot bot;
+
+    // The bots get their own random state, since the thread running this could be the main one helping
+    // with the jobs, and its global one is the tuner's. (The game has its own.)
+    pcg_random_state botRandom;
+    PcgRandomSeed(match->seed, 7, &botRandom);
+    SwapRandomState(&botRandom);
+    InitGame(game, match->config, match->seed);
+    InitPaddleBot(&bot);
+    InitPlacementCache(cache, match->weights);
+    while(!game->gameEnded && game->gameTime < match->maxTime){
+        s32 maxTicks = MaxS32(1, (s32)Ceil((match->maxTime - game->gameTime)/GAME_TICK_DT));
+        StepBotMatch(game, &bot, cache, maxTicks);
+        game->numEvents = 0;
+    }
+    SwapRandomState(&botRandom);
+    match->gameTime = Min(game->gameTime, match->maxTime);
+    match->bricksWon = !game->paddleWon;
+
+    free(cache);
+    free(game);
+}
+
+struct tuner{
+    game_config config;
+    thread_pool pool;
+    s32 matchesPerCandidate;
+    f32 maxTime;
+    f32 targetTime; // 0 to look for the strongest weights.
+    u64 numMatchesPlayed;
+};
+
+// Plays 'numMatches' matches for each candidate (the same seeds for all) and sets their fitness.
+void EvaluateCandidates(tuner *t, tuner_candidate *candidates, s32 numCandidates, s32 numMatches, u64 seed0){
+    s32 numTotal = numCandidates*numMatches;
+    tuner_match *matches = (tuner_match *)calloc(numTotal, sizeof(tuner_match));
+    for(s32 c = 0; c < numCandidates; c++){
+        for(s32 m = 0; m < numMatches; m++){
+            tuner_match *match = &matches[c*numMatches + m];
+            match->weights = &candidates[c].weights;
+            match->config = &t->config;
+            match->seed = SimpleHash64(seed0 + m);
+            match->maxTime = t->maxTime;
+        }
+    }
+    for(s32 first = 0; first < numTotal; first += MAX_THREAD_JOBS){
+        s32 end = Min(first + MAX_THREAD_JOBS, numTotal);
+        for(s32 i = first; i < end; i++){
+            AddThreadJob(&t->pool, RunTunerMatch, &matches[i]);
+        }
+        WaitForThreadJobs(&t->pool);
+    }
+    t->numMatchesPlayed += numTotal;
+
+    for(s32 c = 0; c < numCandidates; c++){
+        f32 sumScore = 0;
+        f32 sumLength = 0;
+        for(s32 m = 0; m < numMatches; m++){
+            tuner_match *match = &matches[c*numMatches + m];
+            f32 timeFraction = match->gameTime/t->maxTime;
+            // Surviving longer is better, and winning sooner is better than that.
+            sumScore += (match->bricksWon ? 2.f - timeFraction : timeFraction);
+            sumLength += match->gameTime; // (Capped at maxTime.)
+        }
+        if (t->targetTime > 0){
+            candidates[c].fitness = -fabsf(sumLength/numMatches - t->targetTime);
+        }else{
+            candidates[c].fitness = sumScore/numMatches;
+        }
+    }
+    free(matches);
+}
+
+s32 CompareCandidates(const void *a, const void *b){
+    f32 fa = ((tuner_candidate *)a)->fitness;
+    f32 fb = ((tuner_candidate *)b)->fitness;
+    return (fa > fb ? -1 : (fa < fb ? 1 : 0));
+}
+
+// Index of the best of 3 random candidates.
+s32 TournamentPick(tuner_candidate *candidates, s32 numCandidates){
+    s32 best = RandomS32(numCandidates - 1);
+    for(s32 i = 0; i < 2; i++){
+        s32 other = RandomS32(numCandidates - 1);
+        if (candidates[other].fitness > candidates[best].fitness)
+            best = other;
+    }
+    return best;
+}
+
+//
+// Profiles file
+//
+
+// Replaces the profile with the same name in the file, or adds it at the end.
+b32 SaveBricksAIProfile(char *path, bricks_ai_profile *profile){
+    char *oldText = 0;
+    FILE *file = fopen(path, "rb");
+    if (file){
+        fseek(file, 0, SEEK_END);
+        s32 size = (s32)ftell(file);
+        fseek(file, 0, SEEK_SET);
+        oldText = (char *)calloc(size + 1, 1);
+        fread(oldText, 1, size, file);
+        fclose(file);
+    }
+
+    file = fopen(path, "wb");
+    if (!file){
+        free(oldText);
+        return false;
+    }
+    if (oldText){
+        s32 nameLength = (s32)strlen(profile->name);
+        char *line = oldText;
+        while(*line){
+            char *lineEnd = line;
+            while(*lineEnd && *lineEnd != '\n')
+                lineEnd++;
+            b32 sameName = (strncmp(line, profile->name, nameLength) == 0 && (line[nameLength] == ' ' || line[nameLength] == '\t'));
+            if (!sameName && lineEnd > line)
+                fwrite(line, 1, lineEnd - line + (*lineEnd ? 1 : 0), file);
+            line = (*lineEnd ? lineEnd + 1 : lineEnd);
+        }
+    }else{
+        fprintf(file, "# name adjacent yPos time emergency spawner powerup badPowerup arrow tries\n");
+    }
+    char text[256];
+    PrintBricksAIProfile(text, sizeof(text), profile);
+    fputs(text, file);
+    fclose(file);
+    free(oldText);
+    return true;
+}
+
+void PrintCandidate(char *label, tuner_candidate *c){
+    bricks_ai_profile profile = {};
+    strcpy(profile.name, label);
+    profile.weights = c->weights;
+    char text[256];
+    PrintBricksAIProfile(text, sizeof(text), &profile);
+    printf("  fitness %.4f  %s", c->fitness, text);
+}
+
+int main(int argc, char **argv){
+    if (argc < 2 || argv[1][0] == '-'){
+        printf("Usage: bi_tuner <profile name> [-generations N] [-population N] [-matches N] [-maxtime S] [-target S] [-threads N] [-file PATH]\n");
+        return 1;
+    }
+    char *profileName = argv[1];
+    s32 numGenerations = 20;
+    s32 populationSize = 16;
+    s32 numThreads = -1;
+    char *path = BRICKS_AI_PROFILES_PATH;
+
+    static tuner t = {};
+    t.config.spawnShapeTime = DEFAULT_SPAWN_SHAPE_TIME;
+    t.config.doSpeedUp = DEFAULT_DO_SPEED_UP;
+    t.config.sameColorComboMax = DEFAULT_SAME_COLOR_COMBO_MAX;
+    t.config.initialPaddleLifes = DEFAULT_INITIAL_PADDLE_LIFES;
+    t.config.specialBrickChance = DEFAULT_SPECIAL_BRICK_CHANCE;
+    t.matchesPerCandidate = 24;
+    t.maxTime = 180.f;
+
+    for(s32 i = 2; i + 1 < argc; i += 2){
+        char *option = argv[i];
+        char *value = argv[i + 1];
+        if (!strcmp(option, "-generations")){
+            numGenerations = Max(1, atoi(value));
+        }else if (!strcmp(option, "-population")){
+            populationSize = Max(4, atoi(value));
+        }else if (!strcmp(option, "-matches")){
+            t.matchesPerCandidate = Max(1, atoi(value));
+        }else if (!strcmp(option, "-maxtime")){
+            t.maxTime = Max(10.f, (f32)atof(value));
+        }else if (!strcmp(option, "-target")){
+            t.targetTime = (f32)atof(value);
+        }else if (!strcmp(option, "-threads")){
+            numThreads = atoi(value);
+        }else if (!strcmp(option, "-file")){
+            path = value;
+        }else{
+            printf("Unknown option %s\n", option);
+            return 1;
+        }
+    }
+    if (strlen(profileName) >= sizeof(((bricks_ai_profile *)0)->name) || strchr(profileName, ' ')){
+        printf("The profile name must be a single word of less than 32 characters.\n");
+        return 1;
+    }
+
+    InitThreadPool(&t.pool, numThreads);
+    PcgRandomSeed(GetMicroseconds(), 1);
+    printf("Tuning '%s' with %d threads: %d generations of %d candidates, %d matches each.\n",
+           profileName, t.pool.numThreads + 1, numGenerations, populationSize, t.matchesPerCandidate);
+
+    tuner_candidate *population = (tuner_candidate *)calloc(populationSize, sizeof(tuner_candidate));
+    tuner_candidate *nextPopulation = (tuner_candidate *)calloc(populationSize, sizeof(tuner_candidate));
+    bricks_ai_weights defaultWeights = DefaultBricksAIWeights();
+    for(s32 i = 0; i < populationSize; i++){
+        WeightsToGenes(&defaultWeights, population[i].genes);
+        if (i > 0)
+            MutateGenes(population[i].genes, .3f, .7f);
+        population[i].weights = GenesToWeights(population[i].genes);
+    }
+
+    s32 numElites = Max(1, populationSize/4);
+    f32 sigma = .15f;
+    u64 startTime = GetMicroseconds();
+    for(s32 generation = 0; generation < numGenerations; generation++){
+        // New seeds every generation, so the weights don't fit a few particular matches.
+        EvaluateCandidates(&t, population, populationSize, t.matchesPerCandidate, (u64)generation*100000);
+        qsort(population, populationSize, sizeof(tuner_candidate), CompareCandidates);
+        printf("Generation %d (%.0fs, %llu matches):\n", generation + 1, (GetMicroseconds() - startTime)/1000000.0,
+               (unsigned long long)t.numMatchesPlayed);
+        PrintCandidate("best", &population[0]);
+
+        for(s32 i = 0; i < populationSize; i++){
+            tuner_candidate *child = &nextPopulation[i];
+            if (i < numElites){
+                *child = population[i];
+            }else{
+                tuner_candidate *a = &population[TournamentPick(population, populationSize)];
+                tuner_candidate *b = &population[TournamentPick(population, populationSize)];
+                for(s32 g = 0; g < NUM_GENES; g++){
+                    child->genes[g] = (RandomChance(.5f) ? a->genes[g] : b->genes[g]);
+                }
+                MutateGenes(child->genes, sigma, .3f);
+                child->weights = GenesToWeights(child->genes);
+            }
+        }
+        tuner_candidate *temp = population;
+        population = nextPopulation;
+        nextPopulation = temp;
+        sigma = Max(.02f, sigma*.9f);
+    }
+
+    // Final check on new matches: the elites against the defaults.
+    s32 numFinalists = numElites + 1;
+    tuner_candidate *finalists = (tuner_candidate *)calloc(numFinalists, sizeof(tuner_candidate));
+    memcpy(finalists, population, numElites*sizeof(tuner_candidate));
+    finalists[numElites].weights = defaultWeights;
+    EvaluateCandidates(&t, finalists, numFinalists, t.matchesPerCandidate*4, 999999999);
+    printf("Final check (%d matches each):\n", t.matchesPerCandidate*4);
+    PrintCandidate("default", &finalists[numElites]);
+    qsort(finalists, numFinalists, sizeof(tuner_candidate), CompareCandidates);
+    PrintCandidate(profileName, &finalists[0]);
+
+    bricks_ai_profile profile = {};
+    strcpy(profile.name, profileName);
+    profile.weights = finalists[0].weights;
+    if (!SaveBricksAIProfile(path, &profile)){
+        printf("Couldn't write %s\n", path);
+        return 1;
+    }
+    printf("Saved '%s' to %s (%llu matches in %.0fs).\n", profileName, path, (unsigned long long)t.numMatchesPlayed,
+           (GetMicroseconds() - startTime)/1000000.0);
+    return 0;
+}
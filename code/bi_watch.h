@@ -0,0 +1,211 @@
+//
+// Watching the bots: a grid of live matches of the paddle bot against the bricks AI, each with one of the
+// AI levels in turn, for bot tournaments. When a match ends it stays on screen for a moment, its result is
+// counted, and a new one starts in its place.
+//
+// The matches are simulated by jobs on a thread pool of their own, which run while the main thread draws
+// the frame before: UpdateMatchGrid() waits for the jobs of the last frame, takes a copy of each game to
+// draw, and starts the next ones. Every match is drawn by DrawMatch() into the same render buffer, scaled
+// down into its cell, so they're batched together. It doesn't use Raylib. Include it after bi_draw.h and
+// bi_ai.h.
+//
+
+#ifndef BI_WATCH_H
+#define BI_WATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_WATCHED_MATCHES 64
+#define WATCH_END_TIME 2.f // Seconds an ended match stays on screen.
+#define WATCH_MAX_TICKS_PER_FRAME 8 // At 1x. Slower frames than that slow the matches down instead.
+#define WATCH_MIN_FONT_SIZE 6 // Smaller text isn't drawn.
+
+static s32 globalWatchGridSizes[] = {4, 9, 16, 25, 36, 49, 64};
+static f32 globalWatchSpeeds[] = {1.f, 2.f, 4.f, 8.f};
+
+struct watched_match{
+    game_state game; // Only touched by its job while the jobs run.
+    game_state view; // What's drawn: the game when the last jobs finished.
+    hud_powerups hud;
+    placement_cache cache;
+    paddle_bot bot;
+    pcg_random_state rng; // For the bots (the game has its own).
+    s32 profileIndex;
+    s32 numTicks; // For the running job.
+    f32 endTimer; // Seconds since it ended.
+};
+
+struct match_grid{
+    watched_match *matches; // MAX_WATCHED_MATCHES
+    s32 numMatches;
+    thread_pool pool;
+    b32 jobsRunning;
+
+    game_config config;
+    bricks_ai_profile *profiles;
+    s32 numProfiles;
+    s32 nextProfile;
+    f32 speed;
+    f32 tickTime; // Not run yet, in seconds of game time.
+
+    // Results
+    s32 paddleWins;
+    s32 bricksWins;
+    s32 profileBricksWins[MAX_BRICKS_AI_PROFILES];
+    s32 profileMatches[MAX_BRICKS_AI_PROFILES];
+};
+
+void StartWatchedMatch(match_grid *grid, watched_match *match){
+    u64 seed = RandomU32() | ((u64)RandomU32() << 32);
+    InitGame(&match->game, &grid->config, seed);
+    InitPaddleBot(&match->bot);
+    match->profileIndex = grid->nextProfile;
+    grid->nextProfile = (grid->nextProfile + 1) % grid->numProfiles;
+    InitPlacementCache(&match->cache, &grid->profiles[match->profileIndex].weights);
+    PcgRandomSeed(seed, 7, &match->rng);
+    ZeroStruct(&match->hud);
+    match->endTimer = 0;
+    match->view = match->game;
+}
+
+// Thread job: plays a match for its numTicks, or until it ends.
+void RunWatchedMatch(void *data){
+    watched_match *match = (watched_match *)data;
+    game_state *game = &match->game;
+    SwapRandomState(&match->rng);
+    for(s32 i = 0; i < match->numTicks && !game->gameEnded;){
+        i += StepBotMatch(game, &match->bot, &match->cache, match->numTicks - i);
+        game->numEvents = 0;
+    }
+    SwapRandomState(&match->rng);
+}
+
+// Returns false if there's not enough memory. The profiles are kept (not copied).
+b32 InitMatchGrid(match_grid *grid, game_config *config, bricks_ai_profile *profiles, s32 numProfiles){
+    ZeroStruct(grid);
+    grid->matches = (watched_match *)malloc(MAX_WATCHED_MATCHES*sizeof(watched_match));
+    if (!grid->matches)
+        return false;
+    InitThreadPool(&grid->pool);
+    grid->config = *config;
+    grid->profiles = profiles;
+    grid->numProfiles = MaxS32(1, numProfiles);
+    grid->speed = 1.f;
+    return true;
+}
+
+// Waits for the running jobs, so the matches can be touched.
+void StopMatchGrid(match_grid *grid){
+    if (grid->jobsRunning){
+        WaitForThreadJobs(&grid->pool);
+        grid->jobsRunning = false;
+    }
+}
+
+// Starts over with 'numMatches' new matches, and the results cleared.
+void RestartMatchGrid(match_grid *grid, s32 numMatches, game_config *config){
+    StopMatchGrid(grid);
+    grid->config = *config;
+    grid->numMatches = ClampS32(numMatches, 1, MAX_WATCHED_MATCHES);
+    grid->nextProfile = 0;
+    grid->tickTime = 0;
+    grid->paddleWins = grid->bricksWins = 0;
+    ZeroArray(grid->profileBricksWins);
+    ZeroArray(grid->profileMatches);
+    for(s32 i = 0; i < grid->numMatches; i++){
+        StartWatchedMatch(grid, &grid->matches[i]);
+    }
+}
+
+// Once a frame: picks up what the last jobs did, replaces the matches that ended a while ago, and starts
+// the jobs for the next 'dt' seconds (times the speed).
+void UpdateMatchGrid(match_grid *grid, f32 dt){
+    StopMatchGrid(grid);
+
+    for(s32 i = 0; i < grid->numMatches; i++){
+        watched_match *match = &grid->matches[i];
+        if (match->game.gameEnded){
+            if (match->endTimer == 0){
+                b32 paddleWon = match->game.paddleWon;
+                grid->paddleWins += (paddleWon ? 1 : 0);
+                grid->bricksWins += (paddleWon ? 0 : 1);
+                grid->profileMatches[match->profileIndex]++;
+                grid->profileBricksWins[match->profileIndex] += (paddleWon ? 0 : 1);
+            }
+            match->endTimer += dt;
+            if (match->endTimer >= WATCH_END_TIME){
+                StartWatchedMatch(grid, match);
+            }
+        }
+        match->view = match->game;
+        UpdateHudPowerups(&match->hud, &match->view);
+    }
+
+    grid->tickTime = Min(grid->tickTime + dt*grid->speed, WATCH_MAX_TICKS_PER_FRAME*grid->speed*GAME_TICK_DT);
+    s32 numTicks = (s32)(grid->tickTime/GAME_TICK_DT);
+    grid->tickTime -= numTicks*GAME_TICK_DT;
+    if (numTicks > 0){
+        for(s32 i = 0; i < grid->numMatches; i++){
+            watched_match *match = &grid->matches[i];
+            if (!match->game.gameEnded){
+                match->numTicks = numTicks;
+                AddThreadJob(&grid->pool, RunWatchedMatch, match);
+            }
+        }
+        grid->jobsRunning = true;
+    }
+}
+
+// The matches in a square grid over 'winDim', each one the whole screen of a match scaled down.
+void DrawMatchGrid(render_buffer *rb, match_grid *grid, v2 winDim, f64 time, b32 plainSpecials = false){
+    s32 side = 1;
+    while(side*side < grid->numMatches){
+        side++;
+    }
+    f32 scale = 1.f/side;
+    v2 cellDim = winDim*scale;
+
+    rb->layer = RenderLayer_Background;
+    RenderClear(rb, V4_Black());
+    for(s32 i = 0; i < grid->numMatches; i++){
+        watched_match *match = &grid->matches[i];
+        game_state *game = &match->view;
+        v2 cellPos = V2((i % side)*cellDim.x, (i/side)*cellDim.y);
+
+        s32 first = rb->numCommands;
+        match_view view = {};
+        view.winDim = winDim;
+        view.viewPos = (winDim - game->viewDim)/2;
+        view.time = time;
+        view.hud = &match->hud;
+        view.bricksAsRects = true;
+        view.plainSpecials = plainSpecials;
+        view.draggingShapeIndex = -1;
+        DrawMatch(rb, game, &view);
+        if (game->gameEnded){
+            DrawMatchResult(rb, game, winDim);
+        }
+
+        // Which one it is, on the left bar under the timer.
+        rb->layer = RenderLayer_Overlay;
+        char label[64];
+        snprintf(label, sizeof(label), "#%d %s", i + 1, grid->profiles[match->profileIndex].name);
+        RenderText(rb, label, 10.f, 70.f, 20, V4_White(.8f));
+
+        TransformRenderCommands(rb, first, winDim, scale, cellPos, WATCH_MIN_FONT_SIZE);
+        // Text on top of everything in the cell, so the shapes of all the cells are one batch.
+        for(s32 j = first; j < rb->numCommands; j++){
+            if (rb->commands[j].type == RenderCommand_Text)
+                rb->commands[j].layer = RenderLayer_Overlay;
+        }
+    }
+
+    rb->layer = RenderLayer_Overlay;
+    for(s32 i = 1; i < side; i++){
+        RenderRect(rb, V2(i*cellDim.x - 1.f, 0), V2(2.f, winDim.y), V4_Grey(.3f));
+        RenderRect(rb, V2(0, i*cellDim.y - 1.f), V2(winDim.x, 2.f), V4_Grey(.3f));
+    }
+}
+
+#endif